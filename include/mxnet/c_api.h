@@ -1091,6 +1091,20 @@ MXNET_DLL int MXDataIterGetPadNum(DataIterHandle handle,
  */
 MXNET_DLL int MXDataIterGetLabel(DataIterHandle handle,
                                  NDArrayHandle *out);
+/*!
+ * \brief Get the statistics of the stages of a data iterator, e.g. the time
+ *  spent on reading, decoding and augmenting, and the occupancy of the
+ *  prefetch queues. They are only collected if MXNET_IO_PROFILE is set.
+ * \param handle the handle pointer to the data iterator
+ * \param out_size the number of statistics
+ * \param out_keys the names of the statistics
+ * \param out_vals the values of the statistics
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXDataIterGetStats(DataIterHandle handle,
+                                 mx_uint *out_size,
+                                 const char ***out_keys,
+                                 const double **out_vals);
 //--------------------------------------------
 // Part 6: basic KVStore interface
 //--------------------------------------------
@@ -1131,6 +1145,19 @@ MXNET_DLL int MXKVStoreInit(KVStoreHandle handle,
                             mx_uint num,
                             const int* keys,
                             NDArrayHandle* vals);
+/*!
+ * \brief Init a list of (key,value) pairs in kvstore, which are pushed and
+ *  pulled by rows with MXKVStorePushRowSparse and MXKVStorePullRowSparse
+ * \param handle handle to the kvstore
+ * \param num the number of key-value pairs
+ * \param keys the list of keys
+ * \param vals the list of values
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXKVStoreInitRowSparse(KVStoreHandle handle,
+                                     mx_uint num,
+                                     const int* keys,
+                                     NDArrayHandle* vals);
 
 /*!
  * \brief Push a list of (key,value) pairs to kvstore
@@ -1160,6 +1187,39 @@ MXNET_DLL int MXKVStorePull(KVStoreHandle handle,
                             const int* keys,
                             NDArrayHandle* vals,
                             int priority);
+/*!
+ * \brief push a subset of rows of a list of (key, value) pairs to kvstore
+ * \param handle handle to the kvstore
+ * \param num the number of key-value pairs
+ * \param keys the list of keys
+ * \param vals the list of rows, the first dimension of vals[i] is the number
+ *  of rows
+ * \param row_ids the list of row ids, row_ids[i] has one id per row of vals[i]
+ * \param priority the priority of the action
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXKVStorePushRowSparse(KVStoreHandle handle,
+                                     mx_uint num,
+                                     const int* keys,
+                                     NDArrayHandle* vals,
+                                     NDArrayHandle* row_ids,
+                                     int priority);
+/*!
+ * \brief pull a subset of rows of a list of (key, value) pairs from kvstore
+ * \param handle handle to the kvstore
+ * \param num the number of key-value pairs
+ * \param keys the list of keys
+ * \param vals the list of buffers for the pulled rows
+ * \param row_ids the list of row ids to pull
+ * \param priority the priority of the action
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXKVStorePullRowSparse(KVStoreHandle handle,
+                                     mx_uint num,
+                                     const int* keys,
+                                     NDArrayHandle* vals,
+                                     NDArrayHandle* row_ids,
+                                     int priority);
 /*!
  * \brief user-defined updater for the kvstore
  * It's this updater's responsibility to delete \a recv and \a local
@@ -1182,6 +1242,31 @@ typedef void (MXKVStoreUpdater)(int key,
 MXNET_DLL int MXKVStoreSetUpdater(KVStoreHandle handle,
                                   MXKVStoreUpdater updater,
                                   void *updater_handle);
+/*!
+ * \brief user-defined updater for the row sparse pushes of the kvstore
+ * It's this updater's responsibility to delete \a recv, \a rows and \a local
+ * \param the key
+ * \param recv the pushed rows on this key, row i for the i-th of the rows
+ * \param rows int32 array of the number of rows followed by the sorted rows
+ * \param local the value stored on local on this key
+ * \param handle The additional handle to the updater
+ */
+typedef void (MXKVStoreRowSparseUpdater)(int key,
+                                         NDArrayHandle recv,
+                                         NDArrayHandle rows,
+                                         NDArrayHandle local,
+                                         void *handle);
+/*!
+ * \brief register an updater for row sparse pushes, which only updates the
+ *  pushed rows
+ * \param handle handle to the KVStore
+ * \param updater udpater function
+ * \param updater_handle The additional handle used to invoke the updater
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXKVStoreSetRowSparseUpdater(KVStoreHandle handle,
+                                           MXKVStoreRowSparseUpdater updater,
+                                           void *updater_handle);
 /*!
  * \brief get the type of the kvstore
  * \param handle handle to the KVStore
@@ -1314,6 +1399,18 @@ MXNET_DLL int MXKVStoreGetNumDeadNode(KVStoreHandle handle,
 */
 MXNET_DLL int MXRecordIOWriterCreate(const char *uri, RecordIOHandle *out);
 
+/**
+ * \brief Create a RecordIO writer object which also writes an index, a line
+ *  "number\tposition" for every record, which allows random access, e.g. by
+ *  the path_imgidx of ImageRecordIter
+ * \param uri path to file
+ * \param idx_uri path to the index file
+ * \param out handle pointer to the created object
+ * \return 0 when success, -1 when failure happens
+*/
+MXNET_DLL int MXRecordIOWriterCreateIndexed(const char *uri, const char *idx_uri,
+                                            RecordIOHandle *out);
+
 /**
  * \brief Delete a RecordIO writer object
  * \param handle handle to RecordIO object
@@ -1414,6 +1511,41 @@ MXNET_DLL int MXOptimizerUpdate(OptimizerHandle handle,
                                 NDArrayHandle grad,
                                 mx_float lr,
                                 mx_float wd);
+/*!
+ * \brief update only some rows of a weight, the other rows are updated lazily
+ * \param rows int32 array of the number of rows followed by the rows
+ * \param compact whether grad only has the rows, row i for the i-th of the
+ *  rows, rather than the shape of weight
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXOptimizerUpdateRows(OptimizerHandle handle,
+                                    int index,
+                                    NDArrayHandle weight,
+                                    NDArrayHandle grad,
+                                    NDArrayHandle rows,
+                                    int compact,
+                                    mx_float lr,
+                                    mx_float wd);
+
+/*!
+ * \brief update a group of weights with their gradients, in one operation
+ *  if the optimizer supports it
+ * \param handle handle returned by MXOptimizerCreateOptimizer
+ * \param num number of weights
+ * \param indices the unique index of each weight
+ * \param weights the weights
+ * \param grads the gradients
+ * \param lrs the learning rate of each weight
+ * \param wds the weight decay of each weight
+ * \return 0 when success, -1 when failure happens
+ */
+MXNET_DLL int MXOptimizerUpdateGroup(OptimizerHandle handle,
+                                     mx_uint num,
+                                     const int *indices,
+                                     NDArrayHandle *weights,
+                                     NDArrayHandle *grads,
+                                     const mx_float *lrs,
+                                     const mx_float *wds);
 
 MXNET_DLL int MXCustomOpRegister(const char* op_type, CustomOpPropCreator creator);
 
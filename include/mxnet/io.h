@@ -16,6 +16,8 @@
 #include "./ndarray.h"
 
 namespace mxnet {
+/*! \brief named statistics of a data iterator */
+typedef std::vector<std::pair<std::string, double> > IOStats;
 /*!
  * \brief iterator type
  * \tparam DType data type
@@ -34,6 +36,12 @@ class IIterator : public dmlc::DataIter<DType> {
   virtual bool Next(void) = 0;
   /*! \brief get current data */
   virtual const DType &Value(void) const = 0;
+  /*!
+   * \brief append the statistics of the stages of this iterator and the
+   *  iterators it wraps, which are only collected if MXNET_IO_PROFILE is set
+   * \param stats the output
+   */
+  virtual void GetStats(IOStats *stats) const {}
   /*! \brief constructor */
   virtual ~IIterator(void) {}
   /*! \brief store the name of each data, it could be used for making NDArrays */
@@ -35,6 +35,8 @@ class KVStore {
    *       multi-devices on a single machine. can be also
    *   - 'device' or 'local_allreduce_device' : same to local but use gpus for kv
    *       allreduce
+   *   - 'dist_allreduce' : multi-machines, gradients are summed by a ring
+   *       allreduce among workers without parameter servers
    *   - 'dist_*' : multi-machines
    * \return a new created KVStore.
    */
@@ -63,6 +65,21 @@ class KVStore {
    */
   virtual void Init(const std::vector<int>& keys,
                     const std::vector<NDArray>& values) = 0;
+  /*!
+   * \brief Initialize a list of key-value pairs which are pushed and pulled by
+   * rows, see \ref PushRowSparse
+   *
+   * The same as \ref Init, except that distributed stores partition these
+   * values over servers at row boundaries, which row sparse pushes and pulls
+   * need. Other values are partitioned by elements.
+   *
+   * \param keys a list of unique keys
+   * \param values a list of values
+   */
+  virtual void InitRowSparse(const std::vector<int>& keys,
+                             const std::vector<NDArray>& values) {
+    Init(keys, values);
+  }
   /*!
    * \brief push a list of key-value pairs into the store
    *
@@ -129,10 +146,58 @@ class KVStore {
                     const std::vector<NDArray*>& values,
                     int priority = 0) = 0;
 
+  /*!
+   * \brief push a subset of rows of a list of values into the store
+   *
+   * It is used for gradients which are non-zero only on a few rows, such as
+   * the gradient of an embedding weight. Only the rows and their ids are
+   * communicated. Semantically it is the same as pushing a value which equals
+   * \a values[i] on the rows \a row_ids[i] and zero elsewhere, but the store
+   * can avoid touching the other rows, see \ref set_row_sparse_updater.
+   *
+   * Row ids can be duplicated, then the rows are summed. Distributed stores
+   * need the keys initialized by \ref InitRowSparse.
+   *
+   * \param keys the list of keys
+   * \param values the list of rows, values[i] has shape (k_i, ...)
+   * \param row_ids the list of row ids, row_ids[i] has k_i elements
+   * \param priority Priority of the action.
+   */
+  virtual void PushRowSparse(const std::vector<int>& keys,
+                             const std::vector<NDArray>& values,
+                             const std::vector<NDArray>& row_ids,
+                             int priority = 0) {
+    LOG(FATAL) << "kvstore " << type_ << " does not support row sparse push";
+  }
+  /*!
+   * \brief pull a subset of rows of a list of values from the store
+   *
+   * \param keys the list of keys
+   * \param values the list of buffers for the pulled rows, values[i] has shape
+   *  (k_i, ...) and should be preallocated
+   * \param row_ids the list of row ids to pull, row_ids[i] has k_i elements
+   * \param priority Priority of the action.
+   */
+  virtual void PullRowSparse(const std::vector<int>& keys,
+                             const std::vector<NDArray*>& values,
+                             const std::vector<NDArray>& row_ids,
+                             int priority = 0) {
+    LOG(FATAL) << "kvstore " << type_ << " does not support row sparse pull";
+  }
+
   /**
    * \brief the prototype of user-defined updater
    */
   typedef std::function<void(int, const NDArray&, NDArray*)> Updater;
+  /**
+   * \brief the prototype of an updater for row sparse pushes, which is
+   * called by updater(key, grad, rows, &value_in_store) and only modifies
+   * the given rows. \a rows is an int32 array in CPU memory of the number of
+   * rows followed by the sorted rows, and row i of \a grad is the summed
+   * gradient of the i-th of them. \a grad may have more rows than that.
+   */
+  typedef std::function<void(int, const NDArray&, const NDArray&, NDArray*)>
+      RowSparseUpdater;
   /*!
    * \brief set an updater
    *
@@ -147,6 +212,20 @@ class KVStore {
     updater_ = updater;
   }
 
+  /*!
+   * \brief set an updater for row sparse pushes
+   *
+   * Without it, a row sparse push runs the updater set by \ref set_updater on
+   * a gradient which is zero except on the pushed rows, which costs as much as
+   * a dense push, or assigns the pushed rows if no updater is set.
+   *
+   * \param updater the updater for row sparse pushes
+   */
+  virtual void set_row_sparse_updater(const RowSparseUpdater& updater) {
+    CHECK(updater) << "invalid updater";
+    row_sparse_updater_ = updater;
+  }
+
   /******************************************************
    * the following are used for multi-machines.
    ******************************************************/
@@ -291,6 +370,11 @@ class KVStore {
    */
   Updater updater_;
 
+  /**
+   * \brief the user-defined updater for row sparse pushes
+   */
+  RowSparseUpdater row_sparse_updater_;
+
   /**
    * \brief the kvstore type
    */
@@ -57,6 +57,44 @@ class Optimizer {
    */
   virtual void Update(const int index, NDArray *weight,
                       const NDArray *grad, const float lr, const float wd) = 0;
+  /*!
+   *  \brief Update only some rows of a weight, the rows of the first dimension
+   *   that have a gradient, such as the rows of an embedding in a batch. The
+   *   other rows are updated lazily when they are next updated.
+   *  \param index the unique index for the weight.
+   *  \param weight the weight to update.
+   *  \param grad gradient for the weight, only read at the rows.
+   *  \param rows int32 array of the number of rows followed by the rows, or -1
+   *   for all rows, as the touched_rows state of Embedding with sparse_grad.
+   *  \param compact whether grad only has the rows, row i for the i-th of the
+   *   rows, as the row sparse pushes of a kvstore, rather than the shape of weight.
+   *  \param lr learning rate for this update.
+   *  \param wd weight decay for this update.
+   */
+  virtual void UpdateRows(const int index, NDArray *weight, const NDArray *grad,
+                          const NDArray *rows, bool compact,
+                          const float lr, const float wd) {
+    LOG(FATAL) << "This optimizer does not support updating rows";
+  }
+  /*!
+   *  \brief Update a group of weights, such as all the weights of a network
+   *   after a backward. Optimizers may fuse the updates into a single
+   *   operation; by default the weights are updated one by one.
+   *  \param indices the unique index of each weight.
+   *  \param weights the weights to update.
+   *  \param grads gradient for each weight.
+   *  \param lrs learning rate for each update.
+   *  \param wds weight decay for each update.
+   */
+  virtual void UpdateGroup(const std::vector<int> &indices,
+                           const std::vector<NDArray*> &weights,
+                           const std::vector<const NDArray*> &grads,
+                           const std::vector<float> &lrs,
+                           const std::vector<float> &wds) {
+    for (size_t i = 0; i < indices.size(); ++i) {
+      Update(indices[i], weights[i], grads[i], lrs[i], wds[i]);
+    }
+  }
   /*!
    * \brief create Optimizer
    * \param type_name the type string of the Optimizer
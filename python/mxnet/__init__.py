@@ -48,6 +48,8 @@ from . import torch as th
 from . import module
 from . import module as mod
 
+from . import quantization
+
 from . import test_utils
 
 __version__ = base.__version__
@@ -262,7 +262,12 @@ class Executor(object):
         for name, array in aux_params.items():
             if name in self.aux_dict:
                 dst = self.aux_dict[name]
-                array.astype(dst.dtype).copyto(dst)
+                if name.endswith('touched_rows'):
+                    # the rows written to the gradient of this executor are
+                    # unknown rather than those of the source
+                    dst[0:1] = -1
+                else:
+                    array.astype(dst.dtype).copyto(dst)
             else:
                 if not allow_extra_params:
                     raise ValueError('Find name %s that is not in the auxiliary states' % name)
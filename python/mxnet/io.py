@@ -597,6 +597,26 @@ class MXDataIter(DataIter):
         check_call(_LIB.MXDataIterGetPadNum(self.handle, ctypes.byref(pad)))
         return pad.value
 
+    def get_stats(self):
+        """Get the statistics of the stages of the iterator, which are only
+        collected if the environment variable MXNET_IO_PROFILE is set.
+
+        Returns
+        -------
+        stats : dict of str to float
+            For every stage, e.g. read, decode, augment, the seconds spent in
+            it as stage.time and the number of items as stage.count. For every
+            prefetch queue, the seconds the consumer waited, the mean number
+            of ready items when an item is requested as queue.occupancy, and
+            the number of requests which found the queue empty as queue.empty.
+        """
+        size = mx_uint()
+        keys = ctypes.POINTER(ctypes.c_char_p)()
+        vals = ctypes.POINTER(ctypes.c_double)()
+        check_call(_LIB.MXDataIterGetStats(self.handle, ctypes.byref(size),
+                                           ctypes.byref(keys), ctypes.byref(vals)))
+        return dict((py_str(keys[i]), vals[i]) for i in range(size.value))
+
 def _make_io_iterator(handle):
     """Create an io iterator by handle."""
     name = ctypes.c_char_p()
@@ -46,6 +46,17 @@ def _updater_wrapper(updater):
     return updater_handle
 
 
+def _row_sparse_updater_wrapper(updater):
+    """ a wrapper for the user-defined handle of row sparse pushes """
+    def updater_handle(key, lhs_handle, rows_handle, rhs_handle, _):
+        """ ctypes function """
+        lhs = NDArray(NDArrayHandle(lhs_handle))
+        rows = NDArray(NDArrayHandle(rows_handle))
+        rhs = NDArray(NDArrayHandle(rhs_handle))
+        updater(key, lhs, rows, rhs)
+    return updater_handle
+
+
 class KVStore(object):
     """A key-value store for synchronization of values, over multiple devices."""
     def __init__(self, handle):
@@ -59,6 +70,7 @@ class KVStore(object):
         assert isinstance(handle, KVStoreHandle)
         self.handle = handle
         self._updater_func = None
+        self._row_sparse_updater_func = None
 
     def __del__(self):
         check_call(_LIB.MXKVStoreFree(self.handle))
@@ -99,6 +111,29 @@ class KVStore(object):
         check_call(_LIB.MXKVStoreInit(
             self.handle, mx_uint(len(ckeys)), ckeys, cvals))
 
+    def init_row_sparse(self, key, value):
+        """ Initialize a single or a sequence of key-value pairs which are pushed
+        and pulled by rows, see push_row_sparse.
+
+        The same as init, but the dist kvstores partition these values over the
+        servers at row boundaries, which push_row_sparse and pull_row_sparse
+        need there.
+
+        Parameters
+        ----------
+        key : int or sequence of int
+            The keys.
+        value : NDArray or sequence of NDArray
+            The values.
+
+        Examples
+        --------
+        >>> kv.init_row_sparse(3, mx.nd.zeros((4, 3)))
+        """
+        ckeys, cvals = _ctype_key_value(key, value)
+        check_call(_LIB.MXKVStoreInitRowSparse(
+            self.handle, mx_uint(len(ckeys)), ckeys, cvals))
+
     def push(self, key, value, priority=0):
         """ Push a single or a sequence of key-value pairs into the store.
 
@@ -228,6 +263,76 @@ class KVStore(object):
             self.handle, mx_uint(len(ckeys)), ckeys, cvals,
             ctypes.c_int(priority)))
 
+    def push_row_sparse(self, key, value, row_ids, priority=0):
+        """ Push a subset of rows of a single or a sequence of values.
+
+        It equals to pushing a value which equals to value on the rows row_ids
+        and zero elsewhere, but only the rows are communicated. It is useful
+        for the gradient of an embedding weight. Duplicated row ids are summed.
+        The dist kvstores need the key initialized by init_row_sparse.
+
+        Parameters
+        ----------
+        key : int or list of int
+            Keys
+
+        value : NDArray or list of NDArray or list of list of NDArray
+            The rows, the first dimension is the number of rows
+
+        row_ids : NDArray or list of NDArray or list of list of NDArray
+            The row ids, one for each row of value
+
+        priority : int, optional
+            The priority of the push operation.
+
+        Examples
+        --------
+        >>> # the store keeps a (4, 3) value
+        >>> kv.push_row_sparse(3, mx.nd.ones((2, 3)), mx.nd.array([0, 2]))
+        >>> kv.pull(3, out=a)
+        >>> print a.asnumpy()
+        [[ 1.  1.  1.]
+        [ 0.  0.  0.]
+        [ 1.  1.  1.]
+        [ 0.  0.  0.]]
+        """
+        ckeys, cvals = _ctype_key_value(key, value)
+        _, cids = _ctype_key_value(key, row_ids)
+        check_call(_LIB.MXKVStorePushRowSparse(
+            self.handle, mx_uint(len(ckeys)), ckeys, cvals, cids,
+            ctypes.c_int(priority)))
+
+    def pull_row_sparse(self, key, out, row_ids, priority=0):
+        """ Pull a subset of rows of a single or a sequence of values.
+
+        Parameters
+        ----------
+        key : int or list of int
+            Keys
+
+        out: NDArray or list of NDArray or list of list of NDArray
+            The buffers for the rows, the first dimension is the number of rows
+
+        row_ids : NDArray or list of NDArray or list of list of NDArray
+            The row ids to pull, one for each row of out
+
+        priority : int, optional
+            The priority of the pull operation.
+
+        Examples
+        --------
+        >>> b = mx.nd.zeros((2, 3))
+        >>> kv.pull_row_sparse(3, out=b, row_ids=mx.nd.array([2, 3]))
+        >>> print b.asnumpy()
+        [[ 1.  1.  1.]
+        [ 0.  0.  0.]]
+        """
+        ckeys, cvals = _ctype_key_value(key, out)
+        _, cids = _ctype_key_value(key, row_ids)
+        check_call(_LIB.MXKVStorePullRowSparse(
+            self.handle, mx_uint(len(ckeys)), ckeys, cvals, cids,
+            ctypes.c_int(priority)))
+
     def set_optimizer(self, optimizer):
         """Register an optimizer to the store
 
@@ -244,7 +349,7 @@ class KVStore(object):
         check_call(_LIB.MXKVStoreIsWorkerNode(ctypes.byref(is_worker)))
 
         # pylint: disable=invalid-name
-        if 'dist' in self.type and is_worker.value:
+        if 'dist' in self.type and 'allreduce' not in self.type and is_worker.value:
             # send the optimizer to server
             try:
                 # use ASCII protocol 0, might be slower, but not a big ideal
@@ -253,7 +358,11 @@ class KVStore(object):
                 raise
             self._send_command_to_servers(0, optim_str)
         else:
-            self._set_updater(opt.get_updater(optimizer))
+            updater = opt.get_updater(optimizer)
+            self._set_updater(updater)
+            if hasattr(updater, 'update_rows'):
+                # row sparse pushes only update the pushed rows
+                self._set_row_sparse_updater(updater.update_rows)
 
     @property
     def type(self):
@@ -327,6 +436,35 @@ class KVStore(object):
         self._updater_func = _updater_proto(_updater_wrapper(updater))
         check_call(_LIB.MXKVStoreSetUpdater(self.handle, self._updater_func, None))
 
+    def _set_row_sparse_updater(self, updater):
+        """Set an updater for the row sparse pushes into the store.
+
+        It is called by updater(key, input, rows, stored), where rows is an
+        int32 array of the number of rows followed by the sorted rows, and row
+        i of input is the summed pushed value of the i-th of them. It should
+        only update these rows of stored. This function only changes the local store. Use set_optimizer
+        for multi-machines.
+
+        Parameters
+        ----------
+        updater : function
+            the updater function
+
+        Examples
+        --------
+        >>> def update(key, input, rows, stored):
+        ...     r = rows.asnumpy()[1:1 + rows.asnumpy()[0]]
+        ...     print "update rows %s of key %d" % (r, key)
+        >>> kv._set_row_sparse_updater(update)
+        >>> kv.push_row_sparse(3, mx.nd.ones((2, 3)), mx.nd.array([2, 0]))
+        update rows [0 2] of key 3
+        """
+        _updater_proto = ctypes.CFUNCTYPE(
+            None, ctypes.c_int, NDArrayHandle, NDArrayHandle, NDArrayHandle, ctypes.c_void_p)
+        self._row_sparse_updater_func = _updater_proto(_row_sparse_updater_wrapper(updater))
+        check_call(_LIB.MXKVStoreSetRowSparseUpdater(
+            self.handle, self._row_sparse_updater_func, None))
+
 
     def _barrier(self):
         """Global barrier among all worker nodes
@@ -366,6 +504,8 @@ def create(name='local'):
         The type of KVStore
         - local works for multiple devices on a single machine (single process)
         - dist works for multi-machines (multiple processes)
+        - dist_allreduce works for multi-machines without parameter servers,
+          gradients are summed by a ring allreduce among the workers
     Returns
     -------
     kv : KVStore
@@ -96,6 +96,9 @@ def _update_params_on_kvstore(param_arrays, grad_arrays, kvstore):
 def _update_params(param_arrays, grad_arrays, updater, num_device,
                    kvstore=None):
     """ Perform update of param_arrays from grad_arrays not on kvstore."""
+    # updaters with update_group update all the parameters at once
+    update_group = getattr(updater, 'update_group', None)
+    group = ([], [], [])
     for index, pair in enumerate(zip(param_arrays, grad_arrays)):
         arg_list, grad_list = pair
         if grad_list[0] is None:
@@ -110,7 +113,23 @@ def _update_params(param_arrays, grad_arrays, updater, num_device,
             # state for the same index but on diff devs, TODO(mli)
             # use a better solution latter
             w, g = p
-            updater(index*num_device+k, g, w)
+            if update_group is not None:
+                group[0].append(index*num_device+k)
+                group[1].append(w)
+                group[2].append(g)
+            else:
+                updater(index*num_device+k, g, w)
+    if update_group is not None and len(group[0]) > 0:
+        update_group(*group)
+
+def _reset_touched_rows(aux_names, aux_arrays):
+    """Mark the rows written by the operators with sparse_grad unknown, after a
+    kvstore wrote the summed gradients back, so that their next backward zeroes
+    the whole gradient rather than only the rows they wrote."""
+    for name, arrays in zip(aux_names, aux_arrays):
+        if name.endswith('touched_rows'):
+            for arr in arrays:
+                arr[0:1] = -1
 
 def _train_multi_device(symbol, ctx, arg_names, param_names, aux_names,
                         arg_params, aux_params,
@@ -233,6 +252,9 @@ def _train_multi_device(symbol, ctx, arg_names, param_names, aux_names,
                                    updater=updater,
                                    num_device=len(ctx),
                                    kvstore=kvstore)
+                    if kvstore:
+                        _reset_touched_rows(executor_manager.aux_names,
+                                            executor_manager.aux_arrays)
 
                 if monitor is not None:
                     monitor.toc_print()
@@ -763,7 +785,8 @@ class FeedForward(BASE_ESTIMATOR):
         # init optmizer
         if isinstance(self.optimizer, str):
             batch_size = data.batch_size
-            if kvstore and 'dist' in kvstore.type and not '_async' in kvstore.type:
+            if kvstore and 'dist' in kvstore.type and not '_async' in kvstore.type \
+                    and not '_ssp' in kvstore.type:
                 batch_size *= kvstore.num_workers
             optimizer = opt.create(self.optimizer,
                                    rescale_grad=(1.0/batch_size),
@@ -259,6 +259,11 @@ class DataParallelExecutorGroup(object):
             weight = sum(w.copyto(ctx.cpu()) for w in block) / len(block)
             weight.astype(arg_params[name].dtype).copyto(arg_params[name])
         for name, block in zip(self.aux_names, self.aux_arrays):
+            if name.endswith('touched_rows'):
+                # the rows written to the gradient of each device are not a
+                # parameter, saved as unknown
+                aux_params[name][0:1] = -1
+                continue
             weight = sum(w.copyto(ctx.cpu()) for w in block) / len(block)
             weight.astype(aux_params[name].dtype).copyto(aux_params[name])
 
@@ -11,6 +11,7 @@ from .. import optimizer as opt
 
 from .executor_group import DataParallelExecutorGroup
 from ..model import _create_kvstore, _initialize_kvstore, _update_params, _update_params_on_kvstore
+from ..model import _reset_touched_rows
 from ..initializer import Uniform
 
 from .base_module import BaseModule
@@ -301,7 +302,7 @@ class Module(BaseModule):
 
         if isinstance(optimizer, str):
             batch_size = self._exec_group.batch_size
-            if kvstore and kvstore.type == 'dist_sync':
+            if kvstore and kvstore.type in ('dist_sync', 'dist_allreduce'):
                 batch_size *= kvstore.num_workers
             idx2name = {}
             if update_on_kvstore:
@@ -396,6 +397,9 @@ class Module(BaseModule):
                            updater=self._updater,
                            num_device=len(self._context),
                            kvstore=self._kvstore)
+            if self._kvstore:
+                _reset_touched_rows(self._exec_group.aux_names,
+                                    self._exec_group.aux_arrays)
 
     def get_outputs(self, merge_multi_context=True):
         """Get outputs of the previous forward computation.
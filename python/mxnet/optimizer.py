@@ -4,7 +4,7 @@ import math
 import ctypes
 from .base import _LIB, check_call
 from .base import c_array, mx_uint, mx_float, c_str
-from .base import OptimizerHandle, OptimizerCreator
+from .base import OptimizerHandle, OptimizerCreator, NDArrayHandle
 from .ndarray import NDArray, zeros, clip, sqrt, square
 from .random import normal
 
@@ -422,50 +422,39 @@ class SGLD(Optimizer):
                                                             weight.shape, weight.context)
 
 
-@register
-class ccSGD(Optimizer):
-    """A very simple SGD optimizer with momentum and weight regularization.
-    Implemented in C++.
+class _CCOptimizer(Optimizer):
+    """Base class of the optimizers implemented in C++.
 
     Parameters
     ----------
-    learning_rate : float, optional
-        learning_rate of SGD
-
-    momentum : float, optional
-       momentum value
+    cc_name : str
+        name of the optimizer registered with MXNET_REGISTER_OPTIMIZER
 
-    wd : float, optional
-        L2 regularization coefficient add to all the weights
-
-    rescale_grad : float, optional
-        rescaling factor of gradient.
-
-    clip_gradient : float, optional
-        clip gradient in range [-clip_gradient, clip_gradient]
+    cc_params : list of (str, value)
+        the arguments passed to Init(kwargs), also attributes of the optimizer
     """
-    def __init__(self, momentum=0.0, rescale_grad=1., clip_gradient=-1., **kwargs):
-        super(ccSGD, self).__init__(rescale_grad=rescale_grad,
-                                    clip_gradient=clip_gradient,
-                                    **kwargs)
-        self.momentum = momentum
-
-        self.handle = Optimizer._init_cc_optimizer(
-            'ccsgd',
-            ['momentum', 'rescale_grad', 'clip_gradient'],
-            [momentum, rescale_grad, clip_gradient])
+    def __init__(self, cc_name, cc_params, **kwargs):
+        super(_CCOptimizer, self).__init__(**kwargs)
+        self.cc_name = cc_name
+        self.cc_keys = [k for k, _ in cc_params]
+        for k, v in cc_params:
+            setattr(self, k, v)
+        self.handle = self._create_handle()
+
+    def _create_handle(self):
+        """Create the C++ optimizer from the attributes."""
+        return Optimizer._init_cc_optimizer(
+            self.cc_name, self.cc_keys, [getattr(self, k) for k in self.cc_keys])
 
     def __getstate__(self):
         this = self.__dict__.copy()
         this['handle'] = this.get('handle', None) is not None
+        return this
 
     def __setstate__(self, state):
-        if state.get('handle', False):
-            state['handle'] = Optimizer._init_cc_optimizer(
-                'ccsgd',
-                ['momentum', 'rescale_grad', 'clip_gradient'],
-                [state['momentum'], state['rescale_grad'], state['clip_gradient']])
         self.__dict__.update(state)
+        if state.get('handle', False):
+            self.handle = self._create_handle()
 
     def create_state(self, index, weight):
         return None
@@ -499,6 +488,185 @@ class ccSGD(Optimizer):
                                           mx_float(lr),
                                           mx_float(wd)))
 
+    def update_group(self, indices, weights, grads):
+        """Update a group of parameters, such as all the parameters after a
+        backward, in one fused operation on cpu.
+
+        Parameters
+        ----------
+        indices : list of int
+            An unique integer key of each parameter
+
+        weights : list of NDArray
+            weight ndarrays
+
+        grads : list of NDArray
+            grad ndarrays
+        """
+        assert len(indices) == len(weights) and len(indices) == len(grads)
+        lrs = [self._get_lr(index) for index in indices]
+        wds = [self._get_wd(index) for index in indices]
+        for index in indices:
+            self._update_count(index)
+        check_call(_LIB.MXOptimizerUpdateGroup(self.handle,
+                                               mx_uint(len(indices)),
+                                               c_array(ctypes.c_int, indices),
+                                               c_array(NDArrayHandle, [w.handle for w in weights]),
+                                               c_array(NDArrayHandle, [g.handle for g in grads]),
+                                               c_array(mx_float, lrs),
+                                               c_array(mx_float, wds)))
+
+
+@register
+class ccSGD(_CCOptimizer):
+    """A very simple SGD optimizer with momentum and weight regularization.
+    Implemented in C++.
+
+    Parameters
+    ----------
+    learning_rate : float, optional
+        learning_rate of SGD
+
+    momentum : float, optional
+       momentum value
+
+    wd : float, optional
+        L2 regularization coefficient add to all the weights
+
+    rescale_grad : float, optional
+        rescaling factor of gradient.
+
+    clip_gradient : float, optional
+        clip gradient in range [-clip_gradient, clip_gradient]
+    """
+    def __init__(self, momentum=0.0, rescale_grad=1., clip_gradient=-1., **kwargs):
+        super(ccSGD, self).__init__('ccsgd',
+                                    [('momentum', momentum),
+                                     ('rescale_grad', rescale_grad),
+                                     ('clip_gradient', clip_gradient)],
+                                    **kwargs)
+
+    def update_rows(self, index, weight, grad, rows, compact=False):
+        """Update only the rows of a weight with a gradient, on cpu.
+
+        The weight decay and momentum of the steps a row is not updated are
+        applied when it is next updated, exactly if the learning rate and the
+        weight decay stay the same. Updating the weight with update applies
+        them to all rows.
+
+        Parameters
+        ----------
+        index : int
+            An unique integer key used to index the parameters
+
+        weight : NDArray
+            weight ndarray
+
+        grad : NDArray
+            grad ndarray, only read at the rows
+
+        rows : NDArray
+            int32 ndarray of the number of rows followed by the rows, such as
+            the touched_rows state of Embedding with sparse_grad
+
+        compact : bool, optional
+            whether grad only has the rows, row i for the i-th of the rows, as
+            the row sparse pushes of kvstore, rather than the shape of weight
+        """
+        assert(isinstance(weight, NDArray))
+        assert(isinstance(grad, NDArray))
+        assert(isinstance(rows, NDArray))
+        lr = self._get_lr(index)
+        wd = self._get_wd(index)
+        self._update_count(index)
+        check_call(_LIB.MXOptimizerUpdateRows(self.handle,
+                                              ctypes.c_int(index),
+                                              weight.handle,
+                                              grad.handle,
+                                              rows.handle,
+                                              ctypes.c_int(compact),
+                                              mx_float(lr),
+                                              mx_float(wd)))
+
+
+@register
+class ccAdam(_CCOptimizer):
+    """The Adam optimizer implemented in C++, on cpu, with the same updates
+    as Adam.
+
+    Parameters
+    ----------
+    learning_rate : float, optional
+        Step size.
+
+    beta1 : float, optional
+        Exponential decay rate for the first moment estimates.
+
+    beta2 : float, optional
+        Exponential decay rate for the second moment estimates.
+
+    epsilon : float, optional
+        Small value to avoid division by 0.
+
+    wd : float, optional
+        L2 regularization coefficient add to all the weights
+
+    rescale_grad : float, optional
+        rescaling factor of gradient.
+
+    clip_gradient : float, optional
+        clip gradient in range [-clip_gradient, clip_gradient]
+    """
+    def __init__(self, learning_rate=0.001, beta1=0.9, beta2=0.999, epsilon=1e-8,
+                 rescale_grad=1., clip_gradient=-1., **kwargs):
+        super(ccAdam, self).__init__('ccadam',
+                                     [('beta1', beta1),
+                                      ('beta2', beta2),
+                                      ('epsilon', epsilon),
+                                      ('rescale_grad', rescale_grad),
+                                      ('clip_gradient', clip_gradient)],
+                                     learning_rate=learning_rate,
+                                     **kwargs)
+
+
+@register
+class ccRMSProp(_CCOptimizer):
+    """The RMSProp optimizer implemented in C++, on cpu, with the same
+    updates as RMSProp.
+
+    Parameters
+    ----------
+    learning_rate : float, optional
+        Step size.
+
+    gamma1: float, optional
+        decay factor of moving average for gradient, gradient^2.
+
+    gamma2: float, optional
+        "momentum" factor.
+
+    epsilon : float, optional
+        Small value added to the variance.
+
+    wd : float, optional
+        L2 regularization coefficient add to all the weights
+
+    rescale_grad : float, optional
+        rescaling factor of gradient.
+
+    clip_gradient : float, optional
+        clip gradient in range [-clip_gradient, clip_gradient]
+    """
+    def __init__(self, gamma1=0.95, gamma2=0.9, epsilon=1e-4,
+                 rescale_grad=1., clip_gradient=-1., **kwargs):
+        super(ccRMSProp, self).__init__('ccrmsprop',
+                                        [('gamma1', gamma1),
+                                         ('gamma2', gamma2),
+                                         ('epsilon', epsilon),
+                                         ('rescale_grad', rescale_grad),
+                                         ('clip_gradient', clip_gradient)],
+                                        **kwargs)
+
 
 @register
 class Adam(Optimizer):
@@ -818,4 +986,12 @@ def get_updater(optimizer):
         if index not in states:
             states[index] = optimizer.create_state(index, weight)
         optimizer.update(index, weight, grad, states[index])
+    if hasattr(optimizer, 'update_group'):
+        # the updates of all the parameters can be fused
+        updater.update_group = optimizer.update_group
+    if hasattr(optimizer, 'update_rows'):
+        def update_rows(index, grad, rows, weight):
+            """updater for the row sparse pushes of kvstore"""
+            optimizer.update_rows(index, weight, grad, rows, compact=True)
+        updater.update_rows = update_rows
     return updater
@@ -0,0 +1,271 @@
+# coding: utf-8
+# pylint: disable=too-many-locals, too-many-branches, too-many-arguments
+"""Post-training int8 quantization of Convolution and FullyConnected for
+inference on cpu.
+
+`calibrate` runs the float model over some batches and records the largest
+absolute value of the output of every layer. `quantize_graph` then replaces
+the 2d Convolution and FullyConnected layers by QuantizedConvolution and
+QuantizedFullyConnected on int8 data and int8 weights. A Quantize node is
+inserted where a quantized layer reads float data. A quantized layer whose
+output only feeds other quantized layers requantizes it to int8 itself, so
+consecutive quantized layers exchange int8 without extra nodes, and a relu
+right after a quantized layer is fused into it.
+
+The quantized model is saved and loaded like any other model, e.g. by
+`model.save_checkpoint`, and served by the predict API.
+"""
+from __future__ import absolute_import
+
+import ctypes
+import json
+import re
+import numpy as np
+
+from .base import NDArrayHandle, py_str
+from .context import cpu
+from .ndarray import NDArray
+from . import ndarray as nd
+from . import symbol as sym
+
+# the int8 values are in [-127, 127], the threshold of a tensor is mapped to 127
+_INT8_MAX = 127
+# the parameters the quantized layers share with the float layers
+_LAYER_PARAMS = {
+    'Convolution': ('kernel', 'stride', 'dilate', 'pad', 'num_filter', 'num_group', 'no_bias'),
+    'FullyConnected': ('num_hidden', 'no_bias')}
+
+
+def calibrate(symbol, arg_params, aux_params, data_iter, num_batches=None, ctx=cpu()):
+    """Find the threshold of every output of the layers of a float model, the
+    largest absolute value over the batches of data_iter.
+
+    Parameters
+    ----------
+    symbol : Symbol
+        The float model.
+    arg_params : dict of str to NDArray
+        The parameters of the model.
+    aux_params : dict of str to NDArray
+        The auxiliary states of the model.
+    data_iter : DataIter
+        The calibration data, a few batches of the data to serve.
+    num_batches : int, optional
+        The number of batches to use, default is all.
+    ctx : Context
+        The context to run the model on.
+
+    Returns
+    -------
+    thresholds : dict of str to float
+        The thresholds, by the names of the outputs as in
+        symbol.get_internals().list_outputs(), and by the names of the data.
+    """
+    shapes = dict(data_iter.provide_data + data_iter.provide_label)
+    exe = symbol.simple_bind(ctx, grad_req='null', **shapes)
+    exe.copy_params_from(arg_params, aux_params, allow_extra_params=True)
+    stats = []
+    def collect(name, array):
+        """record the largest absolute value of an output, async execution."""
+        array = NDArray(ctypes.cast(array, NDArrayHandle), writable=False)
+        stats.append((py_str(name), nd.max(nd.abs(array))))
+    exe.set_monitor_callback(collect)
+
+    thresholds = {}
+    data_iter.reset()
+    for nbatch, batch in enumerate(data_iter):
+        if num_batches is not None and nbatch >= num_batches:
+            break
+        for (name, _), array in zip(data_iter.provide_data, batch.data):
+            array.copyto(exe.arg_dict[name])
+            stats.append((name, nd.max(nd.abs(array))))
+        for (name, _), array in zip(data_iter.provide_label, batch.label):
+            if name in exe.arg_dict:
+                array.copyto(exe.arg_dict[name])
+        exe.forward(is_train=False)
+        for name, value in stats:
+            thresholds[name] = max(thresholds.get(name, 0.0), float(value.asscalar()))
+        del stats[:]
+    return thresholds
+
+
+def quantize_params(weight):
+    """Quantize a weight to int8 with one scale per output, the first dimension.
+
+    Returns
+    -------
+    weight : NDArray
+        The int8 weight, stored in a uint8 array.
+    scale : NDArray
+        The float scale of each output.
+    """
+    weight = weight.asnumpy()
+    flat = weight.reshape((weight.shape[0], -1))
+    scale = np.abs(flat).max(axis=1) / _INT8_MAX
+    scale[scale == 0] = 1.0
+    quantized = np.clip(np.round(flat / scale[:, None]), -_INT8_MAX, _INT8_MAX).astype(np.int8)
+    return (nd.array(quantized.view(np.uint8).reshape(weight.shape), dtype=np.uint8),
+            nd.array(scale))
+
+
+def _quantize_json(conf, output_names, arg_names, thresholds, excluded_layers):
+    """Rewrite the json graph conf, return the new graph and the names of the
+    weights quantized."""
+    nodes = conf['nodes']
+
+    def entry_name(entry):
+        """the name the thresholds of an output are recorded with"""
+        node = nodes[entry[0]]
+        if node['op'] == 'null':
+            return node['name']
+        for name in ['%s_output' % node['name'], '%s_output%d' % (node['name'], entry[1])]:
+            if name in output_names:
+                return name
+        return None
+
+    # the consumers of every output, (node, input position), None for the heads
+    consumers = {}
+    for nid, node in enumerate(nodes):
+        for pos, entry in enumerate(node['inputs']):
+            consumers.setdefault((entry[0], entry[1]), []).append((nid, pos))
+    for entry in conf['heads']:
+        consumers.setdefault((entry[0], entry[1]), []).append((None, 0))
+
+    def quantizable(node):
+        """whether a layer can be quantized"""
+        if node['op'] not in _LAYER_PARAMS or node['name'] in excluded_layers:
+            return False
+        if node['op'] == 'Convolution' and len(re.findall(r'\d+', node['param']['kernel'])) != 2:
+            return False
+        data, weight = node['inputs'][0], node['inputs'][1]
+        wnode = nodes[weight[0]]
+        return (thresholds.get(entry_name(data), 0.0) > 0 and wnode['op'] == 'null' and
+                wnode['name'] in arg_names and len(consumers[(weight[0], weight[1])]) == 1)
+    quantized = set(nid for nid, node in enumerate(nodes) if quantizable(node))
+
+    new_nodes = []
+    def add(node):
+        """add a node to the new graph"""
+        node.setdefault('backward_source_id', -1)
+        new_nodes.append(node)
+        return len(new_nodes) - 1
+    node_map = {}
+    # the outputs now produced by a quantized layer, in float or in int8
+    float_entries, int8_entries = {}, {}
+    def float_entry(entry):
+        """the new float entry of an old entry"""
+        key = (entry[0], entry[1])
+        if key in float_entries:
+            return float_entries[key]
+        return [node_map[entry[0]], entry[1]]
+    fused_relus = set()
+    weights = []
+
+    for nid, node in enumerate(nodes):
+        if nid in fused_relus:
+            continue
+        if nid not in quantized:
+            new_node = dict(node)
+            new_node['inputs'] = [float_entry(e) for e in node['inputs']]
+            node_map[nid] = add(new_node)
+            continue
+        data = (node['inputs'][0][0], node['inputs'][0][1])
+        if data in int8_entries:
+            qdata, in_threshold = int8_entries[data]
+        else:
+            in_threshold = thresholds[entry_name(data)]
+            qdata = [add({'op': 'Quantize', 'param': {'threshold': repr(in_threshold)},
+                          'name': '%s_quantize' % node['name'],
+                          'inputs': [float_entry(data)]}), 0]
+        weight = nodes[node['inputs'][1][0]]['name']
+        weights.append(weight)
+        scale = add({'op': 'null', 'param': {}, 'name': '%s_scale' % weight, 'inputs': []})
+        inputs = [qdata, float_entry(node['inputs'][1]), [scale, 0]]
+        inputs += [float_entry(e) for e in node['inputs'][2:]]
+
+        # fuse a relu which is the only consumer
+        out = (nid, 0)
+        fuse_relu = False
+        if len(consumers.get(out, [])) == 1:
+            cid = consumers[out][0][0]
+            if (cid is not None and nodes[cid]['op'] == 'Activation' and
+                    nodes[cid]['param']['act_type'] == 'relu'):
+                fuse_relu = True
+                fused_relus.add(cid)
+                out = (cid, 0)
+        # requantize the output if it only feeds quantized layers
+        out_threshold = thresholds.get(entry_name(out), 0.0)
+        int8_out = out_threshold > 0 and all(
+            cid in quantized and pos == 0 for cid, pos in consumers.get(out, [(None, 0)]))
+
+        param = dict((k, v) for k, v in node['param'].items() if k in _LAYER_PARAMS[node['op']])
+        param['in_threshold'] = repr(in_threshold)
+        param['out_threshold'] = repr(out_threshold if int8_out else 0.0)
+        param['fuse_relu'] = str(fuse_relu)
+        new_node = {'op': 'Quantized' + node['op'], 'param': param,
+                    'name': node['name'], 'inputs': inputs}
+        if 'attr' in node:
+            new_node['attr'] = node['attr']
+        qid = add(new_node)
+        node_map[nid] = qid
+        if int8_out:
+            int8_entries[out] = ([qid, 0], out_threshold)
+        else:
+            float_entries[out] = [qid, 0]
+
+    new_conf = {'nodes': new_nodes,
+                'arg_nodes': [i for i, node in enumerate(new_nodes) if node['op'] == 'null'],
+                'heads': [float_entry(e) for e in conf['heads']]}
+    return new_conf, weights
+
+
+def quantize_graph(symbol, arg_params, thresholds, excluded_layers=()):
+    """Replace the 2d Convolution and FullyConnected layers of a float model by
+    quantized layers.
+
+    Parameters
+    ----------
+    symbol : Symbol
+        The float model.
+    arg_params : dict of str to NDArray
+        The parameters of the model.
+    thresholds : dict of str to float
+        The thresholds found by calibrate.
+    excluded_layers : list of str
+        The names of the layers to keep in float, e.g. the first convolution
+        if it is sensitive to quantization.
+
+    Returns
+    -------
+    symbol : Symbol
+        The quantized model.
+    arg_params : dict of str to NDArray
+        The parameters of the quantized model, with the weights of the quantized
+        layers in int8 and their scales as weight name + '_scale'.
+    """
+    conf = json.loads(symbol.tojson())
+    output_names = set(symbol.get_internals().list_outputs())
+    new_conf, weights = _quantize_json(conf, output_names, set(arg_params.keys()),
+                                       thresholds, set(excluded_layers))
+    qarg_params = dict(arg_params)
+    for weight in weights:
+        qarg_params[weight], qarg_params[weight + '_scale'] = quantize_params(arg_params[weight])
+    return sym.load_json(json.dumps(new_conf)), qarg_params
+
+
+def quantize_model(symbol, arg_params, aux_params, data_iter, num_batches=None,
+                   ctx=cpu(), excluded_layers=()):
+    """Calibrate a float model on data_iter and quantize it.
+
+    Returns
+    -------
+    symbol : Symbol
+        The quantized model.
+    arg_params : dict of str to NDArray
+        The parameters of the quantized model.
+    aux_params : dict of str to NDArray
+        The auxiliary states, unchanged.
+    """
+    thresholds = calibrate(symbol, arg_params, aux_params, data_iter, num_batches, ctx)
+    qsym, qarg_params = quantize_graph(symbol, arg_params, thresholds, excluded_layers)
+    return qsym, qarg_params, aux_params
@@ -40,6 +40,8 @@ struct MXAPIThreadLocalEntry {
   std::vector<const char *> ret_vec_charp;
   /*! \brief result holder for returning handles */
   std::vector<void *> ret_handles;
+  /*! \brief result holder for returning doubles */
+  std::vector<double> ret_vec_double;
   /*! \brief result holder for returning shapes */
   std::vector<TShape> arg_shapes, out_shapes, aux_shapes;
   /*! \brief result holder for returning type flags */
@@ -1196,6 +1198,31 @@ int MXDataIterGetPadNum(DataIterHandle handle, int *pad) {
   API_END();
 }
 
+int MXDataIterGetStats(DataIterHandle handle,
+                       mx_uint *out_size,
+                       const char ***out_keys,
+                       const double **out_vals) {
+  MXAPIThreadLocalEntry *ret = MXAPIThreadLocalStore::Get();
+  API_BEGIN();
+  IOStats stats;
+  static_cast<IIterator<DataBatch>* >(handle)->GetStats(&stats);
+  ret->ret_vec_str.resize(stats.size());
+  ret->ret_vec_charp.resize(stats.size());
+  ret->ret_vec_double.resize(stats.size());
+  for (size_t i = 0; i < stats.size(); ++i) {
+    ret->ret_vec_str[i] = stats[i].first;
+    ret->ret_vec_double[i] = stats[i].second;
+  }
+  // the pointers only after all strings are stored
+  for (size_t i = 0; i < stats.size(); ++i) {
+    ret->ret_vec_charp[i] = ret->ret_vec_str[i].c_str();
+  }
+  *out_size = static_cast<mx_uint>(stats.size());
+  *out_keys = dmlc::BeginPtr(ret->ret_vec_charp);
+  *out_vals = dmlc::BeginPtr(ret->ret_vec_double);
+  API_END();
+}
+
 int MXKVStoreCreate(const char *type,
                     KVStoreHandle *out) {
   API_BEGIN();
@@ -1224,6 +1251,21 @@ int MXKVStoreInit(KVStoreHandle handle,
   API_END();
 }
 
+int MXKVStoreInitRowSparse(KVStoreHandle handle,
+                           mx_uint num,
+                           const int* keys,
+                           NDArrayHandle* vals) {
+  API_BEGIN();
+  std::vector<int> v_keys(num);
+  std::vector<NDArray> v_vals(num);
+  for (mx_uint i = 0; i < num; ++i) {
+    v_keys[i] = keys[i];
+    v_vals[i] = *static_cast<NDArray*>(vals[i]);
+  }
+  static_cast<KVStore*>(handle)->InitRowSparse(v_keys, v_vals);
+  API_END();
+}
+
 int MXKVStorePush(KVStoreHandle handle,
                   mx_uint num,
                   const int* keys,
@@ -1256,6 +1298,44 @@ int MXKVStorePull(KVStoreHandle handle,
   API_END();
 }
 
+int MXKVStorePushRowSparse(KVStoreHandle handle,
+                           mx_uint num,
+                           const int* keys,
+                           NDArrayHandle* vals,
+                           NDArrayHandle* row_ids,
+                           int priority) {
+  API_BEGIN();
+  std::vector<int> v_keys(num);
+  std::vector<NDArray> v_vals(num);
+  std::vector<NDArray> v_ids(num);
+  for (mx_uint i = 0; i < num; ++i) {
+    v_keys[i] = keys[i];
+    v_vals[i] = *static_cast<NDArray*>(vals[i]);
+    v_ids[i] = *static_cast<NDArray*>(row_ids[i]);
+  }
+  static_cast<KVStore*>(handle)->PushRowSparse(v_keys, v_vals, v_ids, priority);
+  API_END();
+}
+
+int MXKVStorePullRowSparse(KVStoreHandle handle,
+                           mx_uint num,
+                           const int* keys,
+                           NDArrayHandle* vals,
+                           NDArrayHandle* row_ids,
+                           int priority) {
+  API_BEGIN();
+  std::vector<int> v_keys(num);
+  std::vector<NDArray*> v_vals(num);
+  std::vector<NDArray> v_ids(num);
+  for (mx_uint i = 0; i < num; ++i) {
+    v_keys[i] = keys[i];
+    v_vals[i] = static_cast<NDArray*>(vals[i]);
+    v_ids[i] = *static_cast<NDArray*>(row_ids[i]);
+  }
+  static_cast<KVStore*>(handle)->PullRowSparse(v_keys, v_vals, v_ids, priority);
+  API_END();
+}
+
 int MXKVStoreSetUpdater(KVStoreHandle handle,
                         MXKVStoreUpdater updater,
                         void* updater_handle) {
@@ -1274,6 +1354,27 @@ int MXKVStoreSetUpdater(KVStoreHandle handle,
   API_END();
 }
 
+int MXKVStoreSetRowSparseUpdater(KVStoreHandle handle,
+                                 MXKVStoreRowSparseUpdater updater,
+                                 void* updater_handle) {
+  API_BEGIN();
+  MXKVStoreRowSparseUpdater * updater_temp = updater;
+  void* updater_handle_temp = updater_handle;
+  std::function<void(int, const NDArray&, const NDArray&, NDArray*)> updt
+  = [updater_temp, updater_handle_temp](int key, const NDArray& recv,
+                                        const NDArray& rows, NDArray* local) {
+    NDArray* recv_copy = new NDArray();
+    *recv_copy = recv;
+    NDArray* rows_copy = new NDArray();
+    *rows_copy = rows;
+    NDArray* local_copy = new NDArray();
+    *local_copy = *local;
+    updater_temp(key, recv_copy, rows_copy, local_copy, updater_handle_temp);
+  };
+  static_cast<KVStore*>(handle)->set_row_sparse_updater(updt);
+  API_END();
+}
+
 int MXKVStoreGetRank(KVStoreHandle handle, int *rank) {
   API_BEGIN();
   *rank = static_cast<KVStore*>(handle)->get_rank();
@@ -1372,6 +1473,8 @@ struct MXRecordIOContext {
   dmlc::RecordIOReader *reader;
   dmlc::Stream *stream;
   std::string *read_buff;
+  dmlc::Stream *idx_stream;
+  size_t num_records;
 };
 
 int MXRecordIOWriterCreate(const char *uri,
@@ -1383,6 +1486,23 @@ int MXRecordIOWriterCreate(const char *uri,
   context->reader = NULL;
   context->stream = stream;
   context->read_buff = NULL;
+  context->idx_stream = NULL;
+  context->num_records = 0;
+  *out = reinterpret_cast<RecordIOHandle>(context);
+  API_END();
+}
+
+int MXRecordIOWriterCreateIndexed(const char *uri, const char *idx_uri,
+                                  RecordIOHandle *out) {
+  API_BEGIN();
+  dmlc::Stream *stream = dmlc::Stream::Create(uri, "w");
+  MXRecordIOContext *context = new MXRecordIOContext;
+  context->writer = new dmlc::RecordIOWriter(stream);
+  context->reader = NULL;
+  context->stream = stream;
+  context->read_buff = NULL;
+  context->idx_stream = dmlc::Stream::Create(idx_uri, "w");
+  context->num_records = 0;
   *out = reinterpret_cast<RecordIOHandle>(context);
   API_END();
 }
@@ -1393,6 +1513,7 @@ int MXRecordIOWriterFree(RecordIOHandle handle) {
     reinterpret_cast<MXRecordIOContext*>(handle);
   delete context->writer;
   delete context->stream;
+  delete context->idx_stream;
   API_END();
 }
 
@@ -1401,6 +1522,12 @@ int MXRecordIOWriterWriteRecord(RecordIOHandle *handle,
   API_BEGIN();
   MXRecordIOContext *context =
     reinterpret_cast<MXRecordIOContext*>(handle);
+  if (context->idx_stream != NULL) {
+    std::ostringstream os;
+    os << context->num_records++ << '\t' << context->writer->Tell() << '\n';
+    std::string line = os.str();
+    context->idx_stream->Write(line.c_str(), line.size());
+  }
   context->writer->WriteRecord(reinterpret_cast<const void*>(buf), size);
   API_END();
 }
@@ -1422,6 +1549,8 @@ int MXRecordIOReaderCreate(const char *uri,
   context->writer = NULL;
   context->stream = stream;
   context->read_buff = new std::string();
+  context->idx_stream = NULL;
+  context->num_records = 0;
   *out = reinterpret_cast<RecordIOHandle>(context);
   API_END();
 }
@@ -1568,6 +1697,45 @@ int MXOptimizerUpdate(OptimizerHandle handle,
   API_END();
 }
 
+int MXOptimizerUpdateRows(OptimizerHandle handle,
+                          int index,
+                          NDArrayHandle weight,
+                          NDArrayHandle grad,
+                          NDArrayHandle rows,
+                          int compact,
+                          mx_float lr,
+                          mx_float wd) {
+  API_BEGIN();
+  Optimizer *opt = static_cast<Optimizer*>(handle);
+  opt->UpdateRows(index,
+                  static_cast<NDArray*>(weight),
+                  static_cast<NDArray*>(grad),
+                  static_cast<NDArray*>(rows),
+                  compact != 0, lr, wd);
+  API_END();
+}
+
+int MXOptimizerUpdateGroup(OptimizerHandle handle,
+                           mx_uint num,
+                           const int *indices,
+                           NDArrayHandle *weights,
+                           NDArrayHandle *grads,
+                           const mx_float *lrs,
+                           const mx_float *wds) {
+  API_BEGIN();
+  Optimizer *opt = static_cast<Optimizer*>(handle);
+  std::vector<NDArray*> w(num);
+  std::vector<const NDArray*> g(num);
+  for (mx_uint i = 0; i < num; ++i) {
+    w[i] = static_cast<NDArray*>(weights[i]);
+    g[i] = static_cast<NDArray*>(grads[i]);
+  }
+  opt->UpdateGroup(std::vector<int>(indices, indices + num), w, g,
+                   std::vector<float>(lrs, lrs + num),
+                   std::vector<float>(wds, wds + num));
+  API_END();
+}
+
 int MXCustomOpRegister(const char* op_type, CustomOpPropCreator creator) {
   API_BEGIN();
   mxnet::op::CustomOpProp::Register(op_type, creator);
@@ -158,18 +158,36 @@ int MXPredCreatePartialOut(const char* symbol_json_str,
   CHECK(sym.InferShape(&arg_shapes, &out_shapes, &aux_shapes))
       << "The shape information of is not enough to get the shapes";
   ret->out_shapes = out_shapes;
+  // the inputs are float, the types of the other arrays follow from them,
+  // e.g. the int8 weights of a quantized model
+  std::unordered_map<std::string, int> known_type;
+  for (mx_uint i = 0; i < num_input_nodes; ++i) {
+    known_type[std::string(input_keys[i])] = mshadow::kFloat32;
+  }
+  // the types that cannot be inferred stay float32 as before
+  std::vector<int> arg_types, out_types, aux_types;
+  sym.InferType(known_type, &arg_types, &out_types, &aux_types);
+  arg_types.resize(arg_shapes.size(), -1);
+  out_types.resize(out_shapes.size(), -1);
+  aux_types.resize(aux_shapes.size(), -1);
+  for (size_t i = 0; i < out_types.size(); ++i) {
+    CHECK(out_types[i] == -1 || out_types[i] == mshadow::kFloat32)
+        << "The outputs must be float32";
+  }
   Context ctx = Context::Create(static_cast<Context::DeviceType>(dev_type), dev_id);
 
   std::vector<NDArray> arg_arrays, aux_arrays;
   for (size_t i = 0; i < arg_shapes.size(); ++i) {
-    NDArray nd = NDArray(arg_shapes[i], ctx);
+    NDArray nd = NDArray(arg_shapes[i], ctx, false,
+                         arg_types[i] == -1 ? mshadow::kFloat32 : arg_types[i]);
     if (arg_params.count(arg_names[i]) != 0) {
       CopyFromTo(arg_params[arg_names[i]], &nd);
     }
     arg_arrays.push_back(nd);
   }
   for (size_t i = 0; i < aux_shapes.size(); ++i) {
-    NDArray nd = NDArray(aux_shapes[i], ctx);
+    NDArray nd = NDArray(aux_shapes[i], ctx, false,
+                         aux_types[i] == -1 ? mshadow::kFloat32 : aux_types[i]);
     if (aux_params.count(aux_names[i]) != 0) {
       CopyFromTo(aux_params[aux_names[i]], &nd);
     }
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <vector>
 #include "./image_augmenter.h"
+#include "./image_kernels.h"
 #include "../common/utils.h"
 
 #if MXNET_USE_OPENCV
@@ -23,6 +24,8 @@ namespace io {
 
 /*! \brief image augmentation parameters*/
 struct DefaultImageAugmentParam : public dmlc::Parameter<DefaultImageAugmentParam> {
+  /*! \brief resize the shorter edge to this size before other augmentations */
+  int resize;
   /*! \brief whether we do random cropping */
   bool rand_crop;
   /*! \brief whether we do nonrandom croping */
@@ -53,6 +56,12 @@ struct DefaultImageAugmentParam : public dmlc::Parameter<DefaultImageAugmentPara
   int random_s;
   /*! \brief max random in L channel */
   int random_l;
+  /*! \brief max relative brightness change */
+  float brightness;
+  /*! \brief max relative contrast change */
+  float contrast;
+  /*! \brief max relative saturation change */
+  float saturation;
   /*! \brief rotate angle */
   int rotate;
   /*! \brief filled color while padding */
@@ -65,6 +74,9 @@ struct DefaultImageAugmentParam : public dmlc::Parameter<DefaultImageAugmentPara
   TShape data_shape;
   // declare parameters
   DMLC_DECLARE_PARAMETER(DefaultImageAugmentParam) {
+    DMLC_DECLARE_FIELD(resize).set_default(-1)
+        .describe("Augmentation Param: scale shorter edge to size "
+                  "before applying other augmentations.");
     DMLC_DECLARE_FIELD(rand_crop).set_default(false)
         .describe("Augmentation Param: Whether to random crop on the image");
     DMLC_DECLARE_FIELD(crop_y_start).set_default(-1)
@@ -95,6 +107,15 @@ struct DefaultImageAugmentParam : public dmlc::Parameter<DefaultImageAugmentPara
         .describe("Augmentation Param: Maximum value of S channel in HSL color space.");
     DMLC_DECLARE_FIELD(random_l).set_default(0)
         .describe("Augmentation Param: Maximum value of L channel in HSL color space.");
+    DMLC_DECLARE_FIELD(brightness).set_default(0.0f).set_range(0.0f, 1.0f)
+        .describe("Augmentation Param: Scale the pixels by a random factor "
+                  "in [1 - brightness, 1 + brightness].");
+    DMLC_DECLARE_FIELD(contrast).set_default(0.0f).set_range(0.0f, 1.0f)
+        .describe("Augmentation Param: Blend the image with its mean gray value by "
+                  "a random factor in [1 - contrast, 1 + contrast].");
+    DMLC_DECLARE_FIELD(saturation).set_default(0.0f).set_range(0.0f, 1.0f)
+        .describe("Augmentation Param: Blend the pixels with their gray values by "
+                  "a random factor in [1 - saturation, 1 + saturation].");
     DMLC_DECLARE_FIELD(rotate).set_default(-1.0f)
         .describe("Augmentation Param: Rotate angle.");
     DMLC_DECLARE_FIELD(fill_value).set_default(255)
@@ -164,10 +185,20 @@ class DefaultImageAugmenter : public ImageAugmenter {
       return inter_method;
     }
   }
-  cv::Mat Process(const cv::Mat &src,
+  int MinSourceEdge() const override {
+    // everything after the resize only depends on the resized image
+    return param_.resize > 0 ? param_.resize : 0;
+  }
+  cv::Mat Prepare(const cv::Mat &src) override {
+    // a random interpolation method is part of the random augmentation
+    if (param_.inter_method == 10) return src;
+    return ResizeShorterEdge(src, nullptr);
+  }
+  cv::Mat Process(const cv::Mat &img,
                   common::RANDOM_ENGINE *prnd) override {
     using mshadow::index_t;
     cv::Mat res;
+    cv::Mat src = ResizeShorterEdge(img, prnd);
 
     // normal augmentation by affine transformation.
     if (param_.max_rotate_angle > 0 || param_.max_shear_ratio > 0.0f
@@ -272,26 +303,56 @@ class DefaultImageAugmenter : public ImageAugmenter {
       int h = rand_uniform(*prnd) * param_.random_h * 2 - param_.random_h;
       int s = rand_uniform(*prnd) * param_.random_s * 2 - param_.random_s;
       int l = rand_uniform(*prnd) * param_.random_l * 2 - param_.random_l;
-      int temp[3] = {h, l, s};
-      int limit[3] = {180, 255, 255};
-      for (int i = 0; i < res.rows; ++i) {
-        for (int j = 0; j < res.cols; ++j) {
-          for (int k = 0; k < 3; ++k) {
-            int v = res.at<cv::Vec3b>(i, j)[k];
-            v += temp[k];
-            v = std::max(0, std::min(limit[k], v));
-            res.at<cv::Vec3b>(i, j)[k] = v;
-          }
-        }
-      }
+      // add the offsets and clamp H to [0, 180], L and S to [0, 255]
+      cv::add(res, cv::Scalar(h, l, s), res);
+      cv::min(res, cv::Scalar(180, 255, 255), res);
       cvtColor(res, res, CV_HLS2BGR);
     }
+    if (param_.brightness > 0.0f || param_.contrast > 0.0f || param_.saturation > 0.0f) {
+      std::uniform_real_distribution<float> rand_uniform(-1, 1);
+      float b = 1.0f + rand_uniform(*prnd) * param_.brightness;
+      float c = 1.0f + rand_uniform(*prnd) * param_.contrast;
+      float s = 1.0f + rand_uniform(*prnd) * param_.saturation;
+      float mean_gray = 0.0f;
+      if (c != 1.0f) {
+        cv::Scalar m = cv::mean(res);
+        mean_gray = res.channels() == 1 ? m[0] : 0.114f * m[0] + 0.587f * m[1] + 0.299f * m[2];
+      }
+      // into another buffer, res may be a part of the input image
+      jitter_.create(res.rows, res.cols, res.type());
+      ColorJitter(res.data, res.step[0], res.rows, res.cols, res.channels(),
+                  b, c, s, mean_gray, jitter_.data, jitter_.step[0]);
+      res = jitter_;
+    }
     return res;
   }
 
  private:
+  // resize the shorter edge of img to param_.resize, keeping the aspect ratio
+  cv::Mat ResizeShorterEdge(const cv::Mat &img, common::RANDOM_ENGINE *prnd) {
+    if (param_.resize <= 0 || std::min(img.rows, img.cols) == param_.resize) return img;
+    int new_height, new_width;
+    if (img.rows > img.cols) {
+      new_width = param_.resize;
+      new_height = static_cast<int>(
+          static_cast<float>(param_.resize) * img.rows / img.cols + 0.5f);
+    } else {
+      new_height = param_.resize;
+      new_width = static_cast<int>(
+          static_cast<float>(param_.resize) * img.cols / img.rows + 0.5f);
+    }
+    int interpolation_method = GetInterMethod(param_.inter_method, img.cols, img.rows,
+                                              new_width, new_height, prnd);
+    cv::resize(img, resized_, cv::Size(new_width, new_height),
+               0, 0, interpolation_method);
+    return resized_;
+  }
+  // resized source image
+  cv::Mat resized_;
   // temporal space
   cv::Mat temp_;
+  // the output of color jitter
+  cv::Mat jitter_;
   // rotation param
   cv::Mat rotateM_;
   // parameters
@@ -40,6 +40,25 @@ class ImageAugmenter {
    */
   virtual cv::Mat Process(const cv::Mat &src,
                           common::RANDOM_ENGINE *prnd) = 0;
+  /*!
+   * \brief the shorter edge a source image can be reduced to before Process
+   *   without changing the result much, e.g. because Process resizes it to a
+   *   smaller size anyway. Used to decode JPEG images at a reduced resolution.
+   * \return the minimal shorter edge, or 0 if the source must not be reduced.
+   */
+  virtual int MinSourceEdge() const {
+    return 0;
+  }
+  /*!
+   * \brief the deterministic first step of Process, e.g. a fixed resize,
+   *   which only depends on the source image. Process leaves its output
+   *   unchanged, so the output can be cached across epochs.
+   * \param src the source image
+   * \return the prepared image, which may be reused by the next call.
+   */
+  virtual cv::Mat Prepare(const cv::Mat &src) {
+    return src;
+  }
   // virtual destructor
   virtual ~ImageAugmenter() {}
   /*!
@@ -0,0 +1,217 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file image_cache.h
+ * \brief cache of decoded images across epochs
+ */
+#ifndef MXNET_IO_IMAGE_CACHE_H_
+#define MXNET_IO_IMAGE_CACHE_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#if MXNET_USE_OPENCV
+#include <opencv2/opencv.hpp>
+#endif
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief cache of decoded 8-bit images, keyed by the image index.
+ *
+ *  The pixels are packed into large memory blocks up to a byte budget, and
+ *  written to a raw spill file after that, if a spill directory is given.
+ *  Images are never evicted: the records are read in a cycle, and evicting
+ *  the least recently used image would always evict the one needed next.
+ *  All functions are thread safe.
+ */
+class ImageCache {
+ public:
+  /*!
+   * \param mem_bytes the byte budget of the images in memory
+   * \param spill_dir directory of the spill file, empty for no spilling
+   */
+  ImageCache(size_t mem_bytes, const std::string& spill_dir)
+      : mem_budget_(mem_bytes), mem_used_(0), block_left_(0), block_ptr_(nullptr),
+        spill_(nullptr), disk_used_(0), complete_(true), hits_(0), misses_(0) {
+    if (spill_dir.length() != 0) {
+      std::ostringstream os;
+      os << spill_dir << "/mxnet_image_cache_" << this << ".raw";
+      spill_path_ = os.str();
+      spill_ = std::fopen(spill_path_.c_str(), "w+b");
+      CHECK(spill_ != nullptr) << "cannot create the spill file " << spill_path_;
+    }
+  }
+
+  ~ImageCache() {
+    if (spill_ != nullptr) {
+      std::fclose(spill_);
+      std::remove(spill_path_.c_str());
+    }
+  }
+#if MXNET_USE_OPENCV
+  /*!
+   * \brief copy the cached image of key into out
+   * \param src_size the size of the encoded image, to detect duplicated
+   *  image indices, or 0 to skip the check
+   * \return false if the image is not cached
+   */
+  inline bool Get(uint64_t key, size_t src_size, cv::Mat *out) {
+    Entry e;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      auto it = entries_.find(key);
+      if (it == entries_.end() || (src_size != 0 && it->second.src_size != src_size)) {
+        ++misses_;
+        return false;
+      }
+      e = it->second;
+    }
+    out->create(e.rows, e.cols, e.type);
+    size_t bytes = e.Bytes();
+    CHECK(out->isContinuous());
+    if (e.data != nullptr) {
+      std::copy(e.data, e.data + bytes, out->data);
+    } else {
+      std::lock_guard<std::mutex> lk(disk_mu_);
+      std::fseek(spill_, e.offset, SEEK_SET);
+      CHECK_EQ(std::fread(out->data, 1, bytes, spill_), bytes)
+          << "failed to read " << spill_path_;
+    }
+    ++hits_;
+    return true;
+  }
+  /*!
+   * \brief add the image of key
+   * \param src_size the size of the encoded image
+   * \return false if the image is not cached, because the budget is used up,
+   *  the image is not 8-bit, or the key is cached for another image
+   */
+  inline bool Put(uint64_t key, size_t src_size, const cv::Mat &img) {
+    if (img.depth() != CV_8U) {
+      complete_ = false;
+      return false;
+    }
+    Entry e;
+    e.rows = img.rows;
+    e.cols = img.cols;
+    e.type = img.type();
+    e.elem_size = img.elemSize();
+    e.src_size = src_size;
+    e.data = nullptr;
+    e.offset = 0;
+    size_t bytes = e.Bytes();
+    const size_t row_bytes = img.cols * img.elemSize();
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (entries_.count(key) != 0) {
+        // the same index for different images, or another thread was faster
+        if (entries_[key].src_size != src_size) {
+          LOG(WARNING) << "ImageCache: duplicated image index " << key;
+          complete_ = false;
+        }
+        return false;
+      }
+      if (mem_used_ + bytes <= mem_budget_) {
+        e.data = Alloc(bytes);
+        mem_used_ += bytes;
+      } else if (spill_ != nullptr) {
+        e.offset = disk_used_;
+        disk_used_ += bytes;
+      } else {
+        complete_ = false;
+        return false;
+      }
+      // the entry is only visible after it is written
+    }
+    if (e.data != nullptr) {
+      for (int i = 0; i < img.rows; ++i) {
+        std::copy(img.ptr<uint8_t>(i), img.ptr<uint8_t>(i) + row_bytes,
+                  e.data + i * row_bytes);
+      }
+    } else {
+      std::lock_guard<std::mutex> lk(disk_mu_);
+      std::fseek(spill_, e.offset, SEEK_SET);
+      for (int i = 0; i < img.rows; ++i) {
+        CHECK_EQ(std::fwrite(img.ptr<uint8_t>(i), 1, row_bytes, spill_), row_bytes)
+            << "failed to write " << spill_path_;
+      }
+    }
+    std::lock_guard<std::mutex> lk(mu_);
+    entries_[key] = e;
+    return true;
+  }
+#endif  // MXNET_USE_OPENCV
+  /*! \return whether all images given to Put are cached */
+  inline bool complete() const {
+    return complete_;
+  }
+  /*! \brief log the hit rate since the last call, and the cache size */
+  inline void Report() {
+    size_t hits = hits_.exchange(0), misses = misses_.exchange(0);
+    std::lock_guard<std::mutex> lk(mu_);
+    LOG(INFO) << "ImageCache: hit rate " << (hits + misses == 0 ? 0.0 :
+                                             100.0 * hits / (hits + misses))
+              << "% of " << hits + misses << " images, " << entries_.size()
+              << " images cached, " << (mem_used_ >> 20UL) << " MB in memory, "
+              << (disk_used_ >> 20UL) << " MB on disk";
+  }
+
+ private:
+  /*! \brief a cached image */
+  struct Entry {
+    int rows, cols, type, elem_size;
+    /*! \brief size of the encoded image */
+    size_t src_size;
+    /*! \brief the pixels in memory, or nullptr if on disk */
+    uint8_t *data;
+    /*! \brief the offset in the spill file */
+    size_t offset;
+    inline size_t Bytes() const {
+      return static_cast<size_t>(rows) * cols * elem_size;
+    }
+  };
+  // allocate from the current block, called with mu_ held
+  inline uint8_t *Alloc(size_t bytes) {
+    const size_t kBlockSize = 64UL << 20UL;
+    if (bytes > block_left_) {
+      size_t size = std::max(bytes, std::min(kBlockSize, mem_budget_ - mem_used_));
+      blocks_.emplace_back(new uint8_t[size]);
+      block_ptr_ = blocks_.back().get();
+      block_left_ = size;
+    }
+    uint8_t *ret = block_ptr_;
+    block_ptr_ += bytes;
+    block_left_ -= bytes;
+    return ret;
+  }
+
+  /*! \brief byte budget and usage of the memory blocks */
+  size_t mem_budget_, mem_used_;
+  /*! \brief the memory blocks */
+  std::vector<std::unique_ptr<uint8_t[]> > blocks_;
+  /*! \brief the free part of the last block */
+  size_t block_left_;
+  uint8_t *block_ptr_;
+  /*! \brief the spill file */
+  std::FILE *spill_;
+  std::string spill_path_;
+  size_t disk_used_;
+  /*! \brief the cached images */
+  std::unordered_map<uint64_t, Entry> entries_;
+  /*! \brief whether no image was refused */
+  std::atomic<bool> complete_;
+  /*! \brief statistics */
+  std::atomic<size_t> hits_, misses_;
+  std::mutex mu_, disk_mu_;
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_IMAGE_CACHE_H_
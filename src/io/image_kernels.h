@@ -0,0 +1,178 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file image_kernels.h
+ * \brief pixel kernels of the image pipeline, written so that the compiler
+ *  vectorizes them, see tests/cpp/image_kernels_test.cc for benchmarks
+ */
+#ifndef MXNET_IO_IMAGE_KERNELS_H_
+#define MXNET_IO_IMAGE_KERNELS_H_
+
+#include <dmlc/base.h>
+#include <dmlc/logging.h>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define MXNET_RESTRICT __restrict
+#else
+#define MXNET_RESTRICT __restrict__
+#endif
+
+namespace mxnet {
+namespace io {
+namespace kernel {
+/*!
+ * \brief the source channel of output channel k, opencv stores BGR(A) and
+ *  the outputs are RGB(A)
+ */
+template<int C>
+constexpr int SwapChannel(int k) {
+  return C == 1 ? 0 : (k < 3 ? 2 - k : k);
+}
+/*!
+ * \brief convert a row of C interleaved channels into C planes.
+ *  The channel count is a template argument, so that the loop over the
+ *  channels is unrolled and the loop over the pixels is vectorized with
+ *  interleaved loads, which needs at least SSSE3 on x86.
+ * \tparam kAffine whether to compute x * mul[k] + add[k] instead of x
+ */
+template<int C, bool kAffine, typename DType>
+inline void SplitRow(const uint8_t *MXNET_RESTRICT src, int cols, bool mirror,
+                     const float *mul, const float *add,
+                     DType *const *dst) {
+  DType *MXNET_RESTRICT d[C];
+  float m[C], a[C];
+  for (int k = 0; k < C; ++k) {
+    d[k] = dst[k];
+    m[k] = kAffine ? mul[k] : 1.0f;
+    a[k] = kAffine ? add[k] : 0.0f;
+  }
+  for (int j = 0; j < cols; ++j) {
+    for (int k = 0; k < C; ++k) {
+      const uint8_t v = src[j * C + SwapChannel<C>(k)];
+      d[k][j] = kAffine ? DType(v * m[k] + a[k]) : DType(v);
+    }
+  }
+  if (mirror) {
+    // reversed stores do not vectorize, flip the rows in cache instead
+    for (int k = 0; k < C; ++k) std::reverse(d[k], d[k] + cols);
+  }
+}
+
+template<int C, bool kAffine, typename DType>
+inline void HWCToCHW(const uint8_t *src, int rows, int cols, size_t stride,
+                     bool mirror, const float *mul, const float *add, DType *dst) {
+  const size_t plane = static_cast<size_t>(rows) * cols;
+  DType *d[C];
+  for (int i = 0; i < rows; ++i) {
+    for (int k = 0; k < C; ++k) d[k] = dst + k * plane + static_cast<size_t>(i) * cols;
+    SplitRow<C, kAffine>(src + i * stride, cols, mirror, mul, add, d);
+  }
+}
+
+template<int C>
+inline void ColorAffine(const uint8_t *src, size_t src_stride, int rows, int cols,
+                        float alpha, float beta, float bias,
+                        uint8_t *dst, size_t dst_stride) {
+  for (int i = 0; i < rows; ++i) {
+    const uint8_t *MXNET_RESTRICT s = src + i * src_stride;
+    uint8_t *MXNET_RESTRICT d = dst + i * dst_stride;
+    for (int j = 0; j < cols; ++j) {
+      float gray = C == 1 ? s[j] :
+          0.114f * s[j * C] + 0.587f * s[j * C + 1] + 0.299f * s[j * C + 2];
+      float shift = beta * gray + bias + 0.5f;
+      for (int k = 0; k < C; ++k) {
+        float v = std::min(255.0f, std::max(0.0f, alpha * s[j * C + k] + shift));
+        d[j * C + k] = static_cast<uint8_t>(static_cast<int>(v));
+      }
+    }
+  }
+}
+}  // namespace kernel
+
+/*!
+ * \brief convert an image from opencv layout, rows x cols x channels in BGR(A)
+ *  order, into channels x rows x cols in RGB(A) order, optionally mirrored.
+ *  Cropping is free by passing the top left pixel of the crop as src.
+ * \param src the first pixel
+ * \param rows the height
+ * \param cols the width
+ * \param channels the number of channels, 1, 3 or 4
+ * \param stride the number of bytes of a row of src
+ * \param mirror whether to flip the columns
+ * \param dst the output, a contiguous array of channels x rows x cols
+ */
+template<typename DType>
+inline void HWCToCHW(const uint8_t *src, int rows, int cols, int channels,
+                     size_t stride, bool mirror, DType *dst) {
+  switch (channels) {
+    case 1: kernel::HWCToCHW<1, false>(src, rows, cols, stride, mirror,
+                                        nullptr, nullptr, dst); break;
+    case 3: kernel::HWCToCHW<3, false>(src, rows, cols, stride, mirror,
+                                        nullptr, nullptr, dst); break;
+    case 4: kernel::HWCToCHW<4, false>(src, rows, cols, stride, mirror,
+                                        nullptr, nullptr, dst); break;
+    default: LOG(FATAL) << "unsupported number of channels " << channels;
+  }
+}
+/*!
+ * \brief the same as \ref HWCToCHW, and computes x * mul[k] + add[k] for
+ *  output channel k in the same pass
+ */
+template<typename DType>
+inline void HWCToCHWAffine(const uint8_t *src, int rows, int cols, int channels,
+                           size_t stride, bool mirror, const float *mul,
+                           const float *add, DType *dst) {
+  switch (channels) {
+    case 1: kernel::HWCToCHW<1, true>(src, rows, cols, stride, mirror,
+                                       mul, add, dst); break;
+    case 3: kernel::HWCToCHW<3, true>(src, rows, cols, stride, mirror,
+                                       mul, add, dst); break;
+    case 4: kernel::HWCToCHW<4, true>(src, rows, cols, stride, mirror,
+                                       mul, add, dst); break;
+    default: LOG(FATAL) << "unsupported number of channels " << channels;
+  }
+}
+/*!
+ * \brief brightness, contrast and saturation jitter of an 8-bit BGR or gray
+ *  image in a single pass.
+ *
+ *  The pixels are scaled by brightness, blended with the mean gray value of
+ *  the image by contrast, and blended with their own gray value by
+ *  saturation, in this order. All three are linear, so together they are
+ *  x * alpha + gray(x) * beta + bias with
+ *
+ *      alpha = b * c * s, beta = b * c * (1 - s), bias = b * (1 - c) * mean_gray
+ *
+ * \param src the first pixel of the input
+ * \param src_stride the number of bytes of a row of src
+ * \param rows the height
+ * \param cols the width
+ * \param channels the number of channels, 1 or 3
+ * \param brightness the brightness factor b, 1 for no change
+ * \param contrast the contrast factor c, 1 for no change
+ * \param saturation the saturation factor s, 1 for no change
+ * \param mean_gray the mean gray value of the image, only used if contrast != 1
+ * \param dst the first pixel of the output, which must not overlap src
+ * \param dst_stride the number of bytes of a row of dst
+ */
+inline void ColorJitter(const uint8_t *src, size_t src_stride, int rows, int cols,
+                        int channels, float brightness, float contrast,
+                        float saturation, float mean_gray,
+                        uint8_t *dst, size_t dst_stride) {
+  float alpha = brightness * contrast * saturation;
+  float beta = brightness * contrast * (1.0f - saturation);
+  float bias = brightness * (1.0f - contrast) * mean_gray;
+  switch (channels) {
+    case 1: kernel::ColorAffine<1>(src, src_stride, rows, cols, alpha, beta, bias,
+                                   dst, dst_stride); break;
+    case 3: kernel::ColorAffine<3>(src, src_stride, rows, cols, alpha, beta, bias,
+                                   dst, dst_stride); break;
+    default: LOG(FATAL) << "color jitter only supports gray and BGR images, got "
+                        << channels << " channels";
+  }
+}
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_IMAGE_KERNELS_H_
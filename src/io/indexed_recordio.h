@@ -0,0 +1,171 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file indexed_recordio.h
+ * \brief random access to the records of a recordio file by its index
+ */
+#ifndef MXNET_IO_INDEXED_RECORDIO_H_
+#define MXNET_IO_INDEXED_RECORDIO_H_
+
+#include <dmlc/base.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/recordio.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief random access reader of a local recordio file.
+ *
+ *  The file is memory mapped, and the record offsets are read from the index
+ *  file written next to it, e.g. by im2rec, which has a line "key\\tposition"
+ *  for every record. Without an index file the offsets are found by scanning
+ *  the record headers once.
+ *
+ *  Since the records are read in random order, the kernel read-ahead is
+ *  turned off, and the reader instead hints the pages of the records that
+ *  are read next by \ref WillNeed.
+ */
+class IndexedRecordIOReader {
+ public:
+  /*!
+   * \brief open a recordio file
+   * \param rec_path the local recordio file
+   * \param idx_path the index file, built from the records if it does not exist
+   */
+  IndexedRecordIOReader(const std::string& rec_path, const std::string& idx_path)
+      : data_(nullptr), size_(0) {
+    Map(rec_path);
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(idx_path.c_str(), "r", true));
+    if (fi.get() != nullptr) {
+      LoadIndex(fi.get());
+    } else {
+      LOG(INFO) << "Index file " << idx_path << " does not exist, scanning " << rec_path;
+      BuildIndex();
+    }
+    // the index may list the records in any order, e.g. written from a dict
+    std::sort(offset_.begin(), offset_.end());
+    offset_.erase(std::unique(offset_.begin(), offset_.end()), offset_.end());
+    CHECK(offset_.empty() || offset_.back() < size_)
+        << "index " << idx_path << " does not match " << rec_path;
+    offset_.push_back(size_);
+  }
+
+  ~IndexedRecordIOReader() {
+#if !defined(_WIN32)
+    if (data_ != nullptr) munmap(data_, size_);
+#endif
+  }
+  /*! \return the number of records */
+  inline size_t Size() const {
+    return offset_.size() - 1;
+  }
+  /*!
+   * \brief get a record, thread safe
+   * \param i the index of the record in file order
+   * \param buf buffer for records split into several parts, which are merged
+   * \return the record, which points into the mapped file or buf
+   */
+  inline dmlc::InputSplit::Blob Record(size_t i, std::vector<char> *buf) const {
+    CHECK_LT(i, Size());
+    dmlc::InputSplit::Blob chunk, rec;
+    chunk.dptr = data_ + offset_[i];
+    chunk.size = offset_[i + 1] - offset_[i];
+    dmlc::RecordIOChunkReader reader(chunk, 0, 1);
+    CHECK(reader.NextRecord(&rec)) << "invalid record at " << offset_[i];
+    const char *p = static_cast<const char*>(rec.dptr);
+    if (p < data_ || p >= data_ + size_) {
+      // merged in a buffer of the chunk reader
+      buf->assign(p, p + rec.size);
+      rec.dptr = buf->data();
+    }
+    return rec;
+  }
+  /*!
+   * \brief hint that record i will be read soon, so its pages are read ahead
+   */
+  inline void WillNeed(size_t i) const {
+#if !defined(_WIN32)
+    const size_t kPage = sysconf(_SC_PAGESIZE);
+    size_t begin = offset_[i] / kPage * kPage;
+    madvise(data_ + begin, offset_[i + 1] - begin, MADV_WILLNEED);
+#endif
+  }
+
+ private:
+  inline void Map(const std::string& path) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    CHECK_NE(fd, -1) << "cannot open " << path
+                     << ", indexed recordio only supports local files";
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0);
+    size_ = st.st_size;
+    if (size_ != 0) {
+      void *ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+      CHECK(ptr != MAP_FAILED) << "cannot mmap " << path;
+      data_ = static_cast<char*>(ptr);
+      madvise(data_, size_, MADV_RANDOM);
+    }
+    close(fd);
+#else
+    // no mmap, read the whole file instead
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(path.c_str(), "r"));
+    const size_t kBufferSize = 1 << 20UL;
+    while (true) {
+      copy_.resize(size_ + kBufferSize);
+      size_t nread = fi->Read(copy_.data() + size_, kBufferSize);
+      size_ += nread;
+      if (nread != kBufferSize) break;
+    }
+    copy_.resize(size_);
+    data_ = copy_.data();
+#endif
+  }
+  inline void LoadIndex(dmlc::Stream *fi) {
+    dmlc::istream is(fi);
+    std::string line, key;
+    size_t pos;
+    while (std::getline(is, line)) {
+      std::istringstream ls(line);
+      if (ls >> key >> pos) offset_.push_back(pos);
+    }
+  }
+  inline void BuildIndex() {
+    size_t pos = 0;
+    while (pos + 2 * sizeof(uint32_t) <= size_) {
+      const uint32_t *header = reinterpret_cast<const uint32_t*>(data_ + pos);
+      CHECK_EQ(header[0], dmlc::RecordIOWriter::kMagic)
+          << "invalid recordio file at " << pos;
+      uint32_t cflag = dmlc::RecordIOWriter::DecodeFlag(header[1]);
+      uint32_t len = dmlc::RecordIOWriter::DecodeLength(header[1]);
+      // a whole record, or the first part of a split one
+      if (cflag == 0 || cflag == 1) offset_.push_back(pos);
+      pos += 2 * sizeof(uint32_t) + (((len + 3U) >> 2U) << 2U);
+    }
+  }
+
+  /*! \brief the mapped file */
+  char *data_;
+  /*! \brief the size of the file */
+  size_t size_;
+  /*! \brief sorted offsets of the records, followed by the file size */
+  std::vector<size_t> offset_;
+#if defined(_WIN32)
+  /*! \brief the file content */
+  std::vector<char> copy_;
+#endif
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_INDEXED_RECORDIO_H_
@@ -14,6 +14,7 @@
 #include <vector>
 #include <string>
 #include "./inst_vector.h"
+#include "./iter_stats.h"
 
 namespace mxnet {
 namespace io {
@@ -36,7 +37,7 @@ struct BatchParam : public dmlc::Parameter<BatchParam> {
 class BatchLoader : public IIterator<TBlobBatch> {
  public:
   explicit BatchLoader(IIterator<DataInst> *base):
-      base_(base), head_(1), num_overflow_(0) {
+      base_(base), head_(1), num_overflow_(0), batch_("batch") {
   }
 
   virtual ~BatchLoader(void) {
@@ -74,6 +75,7 @@ class BatchLoader : public IIterator<TBlobBatch> {
     index_t top = 0;
 
     while (base_->Next()) {
+      double start = batch_.Start();
       const DataInst& d = base_->Value();
       out_.inst_index[top] = d.index;
       if (data_.size() == 0) {
@@ -84,6 +86,7 @@ class BatchLoader : public IIterator<TBlobBatch> {
         mshadow::Copy(data_[i].Slice(top * unit_size_[i], (top + 1) * unit_size_[i]),
                       d.data[i].get_with_shape<cpu, 1, real_t>(mshadow::Shape1(unit_size_[i])));
       }
+      batch_.Stop(start);
       if (++top >= param_.batch_size) {
         return true;
       }
@@ -114,6 +117,10 @@ class BatchLoader : public IIterator<TBlobBatch> {
   virtual const TBlobBatch &Value(void) const {
     return out_;
   }
+  virtual void GetStats(IOStats *stats) const {
+    base_->GetStats(stats);
+    batch_.Append(stats);
+  }
 
  private:
   /*! \brief batch parameters */
@@ -126,6 +133,8 @@ class BatchLoader : public IIterator<TBlobBatch> {
   int head_;
   /*! \brief number of overflow instances that readed in round_batch mode */
   int num_overflow_;
+  /*! \brief the copies of the instances into the batch */
+  IOStage batch_;
   /*! \brief data shape */
   std::vector<TShape> shape_;
   /*! \brief unit size */
@@ -131,10 +131,12 @@ DMLC_REGISTER_PARAMETER(CSVIterParam);
 MXNET_REGISTER_IO_ITER(CSVIter)
 .describe("Create iterator for dataset in csv.")
 .add_arguments(CSVIterParam::__FIELDS__())
+.add_arguments(PrefetcherParam::__FIELDS__())
 .set_body([]() {
-    return new PrefetcherIter(
-        new BatchLoader(
-            new CSVIter()));
+    return new DeviceRingIter(
+        new PrefetcherIter(
+            new BatchLoader(
+                new CSVIter())));
   });
 
 }  // namespace io
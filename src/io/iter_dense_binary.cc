@@ -0,0 +1,308 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file iter_dense_binary.cc
+ * \brief iterator over a dense matrix in a binary file, whose batches are
+ *  copied from the memory mapped file without parsing
+ */
+#include <mxnet/io.h>
+#include <mxnet/ndarray.h>
+#include <dmlc/base.h>
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "./iter_prefetcher.h"
+#include "./iter_batchloader.h"
+
+namespace mxnet {
+namespace io {
+/*!
+ * \brief header of a dense binary matrix file.
+ *
+ *  It is followed by the data, num_rows x num_cols float32 in row major, and
+ *  then the labels, num_rows x label_width float32 in row major, all in the
+ *  byte order of the machine. tools/csv2bin.py converts CSV files into it.
+ */
+struct DenseBinaryHeader {
+  /*! \brief magic number, kMagic */
+  uint32_t magic;
+  /*! \brief format version, kVersion */
+  uint32_t version;
+  /*! \brief number of rows */
+  uint64_t num_rows;
+  /*! \brief number of data values in a row */
+  uint64_t num_cols;
+  /*! \brief number of label values in a row, can be 0 */
+  uint64_t label_width;
+  static const uint32_t kMagic = 0x4d444258;
+  static const uint32_t kVersion = 1;
+};
+
+// dense binary parameters
+struct DenseBinaryIterParam : public dmlc::Parameter<DenseBinaryIterParam> {
+  /*! \brief path to the binary file */
+  std::string data_bin;
+  /*! \brief data shape */
+  TShape data_shape;
+  /*! \brief label shape */
+  TShape label_shape;
+  /*! \brief whether to shuffle the batches */
+  bool shuffle;
+  /*! \brief random seed */
+  int seed;
+  /*! \brief partition the data into multiple parts */
+  int num_parts;
+  /*! \brief the index of the part will read*/
+  int part_index;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(DenseBinaryIterParam) {
+    DMLC_DECLARE_FIELD(data_bin)
+        .describe("Dataset Param: Path to the dense binary file, e.g. converted "
+                  "from csv by tools/csv2bin.py.");
+    DMLC_DECLARE_FIELD(data_shape)
+        .describe("Dataset Param: Shape of the data of a row.");
+    DMLC_DECLARE_FIELD(label_shape).set_default(TShape())
+        .describe("Dataset Param: Shape of the label of a row, (label_width,) by default. "
+                  "If the file has no labels, all labels are 0.");
+    DMLC_DECLARE_FIELD(shuffle).set_default(false)
+        .describe("Augmentation Param: Whether to shuffle the order of the batches.");
+    DMLC_DECLARE_FIELD(seed).set_default(0)
+        .describe("Augmentation Param: Random Seed.");
+    DMLC_DECLARE_FIELD(num_parts).set_default(1)
+        .describe("partition the data into multiple parts");
+    DMLC_DECLARE_FIELD(part_index).set_default(0)
+        .describe("the index of the part will read");
+  }
+};
+
+/*!
+ * \brief iterator over a dense binary matrix file.
+ *
+ *  The file is memory mapped, and a batch is copied from batch_size
+ *  contiguous rows, converted to dtype, so there is no parsing. The batches
+ *  are owned by the iterator rather than views of the mapping, which is
+ *  unmapped with the iterator. The last batch of a part is padded with the
+ *  first rows of the part. Shuffling permutes the order of the batches, but
+ *  not the rows in a batch.
+ */
+class DenseBinaryIter : public IIterator<DataBatch> {
+ public:
+  DenseBinaryIter() : data_(nullptr), size_(0), batch_ptr_(0) {}
+
+  virtual ~DenseBinaryIter() {
+#if !defined(_WIN32)
+    if (data_ != nullptr) munmap(data_, size_);
+#endif
+  }
+
+  virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+    param_.InitAllowUnknown(kwargs);
+    batch_param_.InitAllowUnknown(kwargs);
+    prefetch_param_.InitAllowUnknown(kwargs);
+    PrefetcherParam defaults;
+    defaults.Init(std::vector<std::pair<std::string, std::string> >());
+    CHECK_EQ(prefetch_param_.prefetch_buffer, defaults.prefetch_buffer)
+        << "DenseBinaryIter reads the batches from the mapped file on demand, "
+        << "prefetch_buffer is not supported";
+    Map(param_.data_bin);
+    CHECK_GE(size_, sizeof(DenseBinaryHeader)) << param_.data_bin << " is too small";
+    std::memcpy(&header_, data_, sizeof(header_));
+    CHECK_EQ(header_.magic, DenseBinaryHeader::kMagic)
+        << param_.data_bin << " is not a dense binary file";
+    CHECK_EQ(header_.version, DenseBinaryHeader::kVersion)
+        << "unsupported version of " << param_.data_bin;
+    CHECK_EQ(size_, sizeof(DenseBinaryHeader) + sizeof(real_t) *
+             header_.num_rows * (header_.num_cols + header_.label_width))
+        << param_.data_bin << " is truncated";
+    CHECK_EQ(param_.data_shape.Size(), header_.num_cols)
+        << "data_shape " << param_.data_shape << " does not match the "
+        << header_.num_cols << " columns of " << param_.data_bin;
+    label_width_ = std::max<size_t>(header_.label_width, 1);
+    if (param_.label_shape.ndim() == 0) {
+      param_.label_shape = mshadow::Shape1(label_width_);
+    }
+    CHECK_EQ(param_.label_shape.Size(), label_width_)
+        << "label_shape " << param_.label_shape << " does not match the label width "
+        << header_.label_width << " of " << param_.data_bin;
+    real_t *begin = reinterpret_cast<real_t*>(data_ + sizeof(DenseBinaryHeader));
+    rows_ = begin;
+    labels_ = begin + header_.num_rows * header_.num_cols;
+    // the rows of this part
+    row_begin_ = header_.num_rows * param_.part_index / param_.num_parts;
+    row_end_ = header_.num_rows * (param_.part_index + 1) / param_.num_parts;
+    const size_t batch_size = batch_param_.batch_size;
+    CHECK_GE(row_end_ - row_begin_, batch_size)
+        << "number of input must be bigger than batch size";
+    size_t num_batch = (row_end_ - row_begin_ + batch_size - 1) / batch_size;
+    order_.resize(num_batch);
+    for (size_t i = 0; i < num_batch; ++i) order_[i] = i;
+    rnd_.seed(kRandMagic + param_.seed);
+    AllocBatch();
+    this->BeforeFirst();
+  }
+
+  virtual void BeforeFirst() {
+    if (param_.shuffle) std::shuffle(order_.begin(), order_.end(), rnd_);
+    batch_ptr_ = 0;
+  }
+
+  virtual bool Next() {
+    if (batch_ptr_ == order_.size()) return false;
+    const size_t batch_size = batch_param_.batch_size;
+    size_t begin = row_begin_ + order_[batch_ptr_++] * batch_size;
+    size_t end = std::min(begin + batch_size, row_end_);
+    FillBatch(begin, end);
+    out_.num_batch_padd = batch_size - (end - begin);
+    out_.index.resize(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      size_t row = begin + i < end ? begin + i : row_begin_ + (begin + i - end);
+      out_.index[i] = row;
+    }
+    if (param_.shuffle && batch_ptr_ != order_.size()) {
+      WillNeed(row_begin_ + order_[batch_ptr_] * batch_size);
+    }
+    return true;
+  }
+
+  virtual const DataBatch &Value(void) const {
+    return out_;
+  }
+
+ private:
+  inline void Map(const std::string& path) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    CHECK_NE(fd, -1) << "cannot open " << path << ", only local files are supported";
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0);
+    size_ = st.st_size;
+    if (size_ != 0) {
+      void *ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      CHECK(ptr != MAP_FAILED) << "cannot mmap " << path;
+      data_ = static_cast<char*>(ptr);
+      if (!param_.shuffle) madvise(data_, size_, MADV_SEQUENTIAL);
+    }
+    close(fd);
+#else
+    // no mmap, read the whole file instead
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(path.c_str(), "r"));
+    const size_t kBufferSize = 1 << 20UL;
+    while (true) {
+      copy_.resize(size_ + kBufferSize);
+      size_t nread = fi->Read(copy_.data() + size_, kBufferSize);
+      size_ += nread;
+      if (nread != kBufferSize) break;
+    }
+    copy_.resize(size_);
+    data_ = copy_.data();
+#endif
+  }
+  // read ahead the batch starting at row begin, which is read next
+  inline void WillNeed(size_t begin) const {
+#if !defined(_WIN32)
+    const size_t kPage = sysconf(_SC_PAGESIZE);
+    size_t end = std::min(begin + batch_param_.batch_size, row_end_);
+    const size_t widths[] = {header_.num_cols, header_.label_width};
+    const real_t *srcs[] = {rows_, labels_};
+    for (int k = 0; k < 2; ++k) {
+      if (widths[k] == 0) continue;
+      size_t first = reinterpret_cast<const char*>(srcs[k] + begin * widths[k]) - data_;
+      size_t last = reinterpret_cast<const char*>(srcs[k] + end * widths[k]) - data_;
+      first = first / kPage * kPage;
+      madvise(data_ + first, last - first, MADV_WILLNEED);
+    }
+#endif
+  }
+  inline TShape BatchShape(const TShape& row_shape) const {
+    std::vector<index_t> shape(1, batch_param_.batch_size);
+    for (index_t i = 0; i < row_shape.ndim(); ++i) shape.push_back(row_shape[i]);
+    return TShape(shape.begin(), shape.end());
+  }
+  // allocate the batch in the output types, with zero labels
+  inline void AllocBatch() {
+    out_.data.clear();
+    out_.data.push_back(NDArray(BatchShape(param_.data_shape), Context::CPU(),
+                                false, prefetch_param_.OutputType(0)));
+    out_.data.push_back(NDArray(BatchShape(param_.label_shape), Context::CPU(),
+                                false, prefetch_param_.OutputType(1)));
+    out_.data[1] = 0.0f;
+  }
+  // copy rows [begin, end) into the batch, padded with the first rows
+  inline void FillBatch(size_t begin, size_t end) {
+    const size_t batch_size = batch_param_.batch_size;
+    const size_t pad = batch_size - (end - begin);
+    // the previous use of the batch may not be finished
+    for (NDArray& arr : out_.data) arr.WaitToWrite();
+    const size_t widths[] = {header_.num_cols, header_.label_width};
+    const real_t *srcs[] = {rows_, labels_};
+    for (int k = 0; k < 2; ++k) {
+      if (widths[k] == 0) continue;
+      const real_t *src = srcs[k];
+      MSHADOW_TYPE_SWITCH(out_.data[k].dtype(), DType, {
+        DType *dst = static_cast<DType*>(out_.data[k].data().dptr_);
+        std::transform(src + begin * widths[k], src + end * widths[k], dst,
+                       [](real_t v) { return static_cast<DType>(v); });
+        std::transform(src + row_begin_ * widths[k], src + (row_begin_ + pad) * widths[k],
+                       dst + (end - begin) * widths[k],
+                       [](real_t v) { return static_cast<DType>(v); });
+      });
+    }
+  }
+
+  // random magic
+  static const int kRandMagic = 111;
+  /*! \brief parameters */
+  DenseBinaryIterParam param_;
+  BatchParam batch_param_;
+  PrefetcherParam prefetch_param_;
+  /*! \brief the mapped file */
+  char *data_;
+  size_t size_;
+#if defined(_WIN32)
+  /*! \brief the file content */
+  std::vector<char> copy_;
+#endif
+  /*! \brief the header of the file */
+  DenseBinaryHeader header_;
+  /*! \brief the number of label values of a batch row */
+  size_t label_width_;
+  /*! \brief the data and labels in the file */
+  real_t *rows_, *labels_;
+  /*! \brief the rows of this part */
+  size_t row_begin_, row_end_;
+  /*! \brief the order of the batches of this part */
+  std::vector<size_t> order_;
+  /*! \brief the next batch in order_ */
+  size_t batch_ptr_;
+  /*! \brief output, copied from the mapped file */
+  DataBatch out_;
+  /*! \brief random number generator for shuffling */
+  std::mt19937 rnd_;
+};
+
+DMLC_REGISTER_PARAMETER(DenseBinaryIterParam);
+
+MXNET_REGISTER_IO_ITER(DenseBinaryIter)
+.describe("Create iterator for a dense matrix in a binary file, e.g. converted from "
+          "csv by tools/csv2bin.py. The file is memory mapped, and the batches are "
+          "copied from it without parsing.")
+.add_arguments(DenseBinaryIterParam::__FIELDS__())
+.add_arguments(BatchParam::__FIELDS__())
+.add_arguments(PrefetcherParam::__FIELDS__())
+.set_body([]() {
+    return new DeviceRingIter(new DenseBinaryIter());
+  });
+}  // namespace io
+}  // namespace mxnet
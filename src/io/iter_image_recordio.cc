@@ -13,15 +13,22 @@
 #include <dmlc/parameter.h>
 #include <dmlc/recordio.h>
 #include <dmlc/threadediter.h>
+#include <dmlc/timer.h>
 #include <unordered_map>
 #include <vector>
+#include <queue>
+#include <algorithm>
 #include <cstdlib>
 #include "./inst_vector.h"
 #include "./image_recordio.h"
+#include "./indexed_recordio.h"
+#include "./image_cache.h"
+#include "./image_kernels.h"
 #include "./image_augmenter.h"
 #include "./iter_prefetcher.h"
 #include "./iter_normalize.h"
 #include "./iter_batchloader.h"
+#include "./iter_stats.h"
 
 namespace mxnet {
 namespace io {
@@ -95,6 +102,8 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
   std::string path_imglist;
   /*! \brief path to image recordio */
   std::string path_imgrec;
+  /*! \brief path to the index of image recordio */
+  std::string path_imgidx;
   /*! \brief a sequence of names of image augmenters, seperated by , */
   std::string aug_seq;
   /*! \brief label-width */
@@ -113,6 +122,12 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
   size_t shuffle_chunk_size;
   /*! \brief the seed for chunk shuffling*/
   int shuffle_chunk_seed;
+  /*! \brief whether to decode JPEG images at a reduced resolution when possible */
+  bool reduced_decode;
+  /*! \brief the memory budget of the decoded image cache, in MB */
+  size_t cache_size;
+  /*! \brief the directory to spill the decoded image cache to */
+  std::string cache_dir;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(ImageRecParserParam) {
@@ -120,6 +135,11 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
         .describe("Dataset Param: Path to image list.");
     DMLC_DECLARE_FIELD(path_imgrec).set_default("./data/imgrec.rec")
         .describe("Dataset Param: Path to image record file.");
+    DMLC_DECLARE_FIELD(path_imgidx).set_default("")
+        .describe("Dataset Param: Path to the index of the image record file. If set, "
+                  "the local record file is memory mapped and read in random order, "
+                  "so shuffle=True shuffles all records every epoch. The index is built "
+                  "from the record file if it does not exist.");
     DMLC_DECLARE_FIELD(aug_seq).set_default("aug_default")
         .describe("Augmentation Param: the augmenter names to represent"\
                   " sequence of augmenters to be applied, seperated by comma." \
@@ -142,26 +162,103 @@ struct ImageRecParserParam : public dmlc::Parameter<ImageRecParserParam> {
                   " it can enable global shuffling");
     DMLC_DECLARE_FIELD(shuffle_chunk_seed).set_default(0)
         .describe("the seed for chunk shuffling");
+    DMLC_DECLARE_FIELD(reduced_decode).set_default(false)
+        .describe("Backend Param: Decode JPEG images at 1/2, 1/4 or 1/8 of the resolution"
+                  " when the augmenter resizes them to a smaller size anyway. The pixels"
+                  " differ slightly from decoding at full resolution.");
+    DMLC_DECLARE_FIELD(cache_size).set_default(0)
+        .describe("Backend Param: Memory budget(MB) of a cache of the decoded images, "
+                  "after resize but before the random augmentations, 0 to disable. "
+                  "Once all images are cached, the record file is no longer read.");
+    DMLC_DECLARE_FIELD(cache_dir).set_default("")
+        .describe("Backend Param: Directory to spill the decoded images to when "
+                  "the cache_size is used up.");
   }
 };
 
 // parser to parse image recordio
 class ImageRecordIOParser {
  public:
+  ImageRecordIOParser()
+      : read_("read"), decode_("decode"), augment_("augment"), convert_("convert") {}
   // initialize the parser
   inline void Init(const std::vector<std::pair<std::string, std::string> >& kwargs);
 
   // set record to the head
   inline void BeforeFirst(void) {
+    if (cache_ != nullptr) {
+      if (param_.verbose && num_served_ != 0) {
+        double elapsed = dmlc::GetTime() - epoch_start_;
+        LOG(INFO) << "ImageRecordIOParser: " << num_served_ << " images in "
+                  << elapsed << " sec, " << num_served_ / elapsed << " images/sec";
+        cache_->Report();
+      }
+      num_served_ = 0;
+      epoch_start_ = dmlc::GetTime();
+      // start collecting the records again if the epoch was not finished
+      if (!cache_ready_) heads_.clear();
+    }
+    if (indexed_ != nullptr || cache_ready_) {
+      order_ptr_ = 0;
+      return;
+    }
     return source_->BeforeFirst();
   }
+  // shuffle the order of all records for the next epoch, if the records are
+  // indexed or cached. Otherwise the records can only be shuffled within a chunk
+  inline void ShuffleRecords(common::RANDOM_ENGINE *rnd) {
+    if (indexed_ != nullptr || cache_ready_) {
+      std::shuffle(order_.begin(), order_.end(), *rnd);
+    }
+  }
   // parse next set of records, return an array of
   // instance vector to the user
   inline bool ParseNext(std::vector<InstVector> *out);
+  // read the next chunk and split it into records
+  inline bool NextRecords(std::vector<dmlc::InputSplit::Blob> *out);
+  // decode, augment and normalize n records in parallel, writing the images
+  // and labels of record i into data[i] and label[i]
+  template<typename DType, typename LType>
+  inline void ParseRecords(const dmlc::InputSplit::Blob *records, size_t n,
+                           const ImageNormalizer &normalizer,
+                           mshadow::Tensor<cpu, 4, DType> data,
+                           mshadow::Tensor<cpu, 2, LType> label,
+                           uint64_t *index);
+  // the parameters
+  inline const ImageRecParserParam& param() const {
+    return param_;
+  }
+  // append the stats of the stages
+  inline void GetStats(IOStats *stats) const {
+    read_.Append(stats);
+    decode_.Append(stats);
+    augment_.Append(stats);
+    convert_.Append(stats);
+  }
 
  private:
+#if MXNET_USE_OPENCV
+  // decode and augment a record with the augmenters of thread tid
+  inline cv::Mat Decode(const ImageRecordIO &rec, int tid);
+  // the imdecode flag for rec, a reduced resolution one if the augmenters allow
+  inline int DecodeFlag(const ImageRecordIO &rec, int tid);
+#endif
+  // fill the label of a record, label_width values
+  inline void ParseLabel(const ImageRecordIO &rec, real_t *label);
+
+  // read and split the next chunk of the record file
+  inline bool NextChunkRecords(std::vector<dmlc::InputSplit::Blob> *out);
+  // read the next records in order_ from the indexed record file
+  inline bool NextIndexedRecords(std::vector<dmlc::InputSplit::Blob> *out);
+  // the next records in order_ without their images, which are all cached
+  inline bool NextCachedRecords(std::vector<dmlc::InputSplit::Blob> *out);
+
   // magic nyumber to see prng
   static const int kRandMagic = 111;
+  // number of records NextRecords returns from an indexed record file or the cache
+  static const size_t kRecordChunk = 1024;
+  // maximal label width of ParseRecords
+  static const int kMaxLabelWidth = 1024;
   /*! \brief parameters */
   ImageRecParserParam param_;
   #if MXNET_USE_OPENCV
@@ -176,6 +273,32 @@ class ImageRecordIOParser {
   std::unique_ptr<ImageLabelMap> label_map_;
   /*! \brief temp space */
   mshadow::TensorContainer<cpu, 3> img_;
+  /*! \brief the current chunk */
+  dmlc::InputSplit::Blob chunk_;
+  /*! \brief copies of the records which are not contiguous in the chunk */
+  std::vector<std::vector<char> > rec_copies_;
+  /*! \brief the indexed record file, if path_imgidx is set */
+  std::unique_ptr<IndexedRecordIOReader> indexed_;
+  /*! \brief the records of this part, in the order they are read */
+  std::vector<size_t> order_;
+  /*! \brief the next record in order_ */
+  size_t order_ptr_;
+  /*! \brief cache of the decoded images, if cache_size is set */
+  std::unique_ptr<ImageCache> cache_;
+#if MXNET_USE_OPENCV
+  /*! \brief the images read from the cache, per thread */
+  std::vector<cv::Mat> cached_;
+#endif
+  /*! \brief the records without their images, in the order they are first read */
+  std::vector<std::vector<char> > heads_;
+  /*! \brief whether all images are cached, so records are read from heads_ */
+  bool cache_ready_;
+  /*! \brief number of records returned by NextRecords in this epoch */
+  size_t num_served_;
+  /*! \brief the start time of this epoch */
+  double epoch_start_;
+  /*! \brief reading the records, decoding, augmenting, and converting the images */
+  IOStage read_, decode_, augment_, convert_;
 };
 
 inline void ImageRecordIOParser::Init(
@@ -214,11 +337,32 @@ inline void ImageRecordIOParser::Init(
   }
   CHECK(param_.path_imgrec.length() != 0)
       << "ImageRecordIOIterator: must specify image_rec";
+  cache_ready_ = false;
+  num_served_ = 0;
+  epoch_start_ = dmlc::GetTime();
+  if (param_.cache_size > 0) {
+    cache_.reset(new ImageCache(param_.cache_size << 20UL, param_.cache_dir));
+    cached_.resize(threadget);
+  }
 
   if (param_.verbose) {
     LOG(INFO) << "ImageRecordIOParser: " << param_.path_imgrec
               << ", use " << threadget << " threads for decoding..";
   }
+  if (param_.path_imgidx.length() != 0) {
+    indexed_.reset(new IndexedRecordIOReader(param_.path_imgrec, param_.path_imgidx));
+    size_t num = indexed_->Size();
+    size_t begin = num * param_.part_index / param_.num_parts;
+    size_t end = num * (param_.part_index + 1) / param_.num_parts;
+    order_.clear();
+    for (size_t i = begin; i < end; ++i) order_.push_back(i);
+    order_ptr_ = 0;
+    if (param_.verbose) {
+      LOG(INFO) << "ImageRecordIOParser: " << order_.size() << " of "
+                << num << " indexed records";
+    }
+    return;
+  }
   source_.reset(dmlc::InputSplit::Create(
       param_.path_imgrec.c_str(), param_.part_index,
       param_.num_parts, "recordio"));
@@ -255,10 +399,14 @@ inline void ImageRecordIOParser::Init(
 
 inline bool ImageRecordIOParser::
 ParseNext(std::vector<InstVector> *out_vec) {
-  CHECK(source_ != nullptr);
+  CHECK(source_ != nullptr)
+      << "path_imgidx is only supported by ImageRecordIter";
   dmlc::InputSplit::Blob chunk;
+  double read_start = read_.Start();
   if (!source_->NextChunk(&chunk)) return false;
 #if MXNET_USE_OPENCV
+  // the records are counted after they are split
+  double read_sec = read_.Start() - read_start;
   // save opencv out
   out_vec->resize(param_.preprocess_threads);
   #pragma omp parallel num_threads(param_.preprocess_threads)
@@ -272,63 +420,281 @@ ParseNext(std::vector<InstVector> *out_vec) {
     InstVector &out = (*out_vec)[tid];
     out.Clear();
     while (reader.NextRecord(&blob)) {
-      // Opencv decode and augments
-      cv::Mat res;
       rec.Load(blob.dptr, blob.size);
-      cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
-      // -1 to keep the number of channel of the encoded image, and not force gray or color.
-      res = cv::imdecode(buf, -1);
+      cv::Mat res = Decode(rec, tid);
       const int n_channels = res.channels();
-      for (auto& aug : augmenters_[tid]) {
-        res = aug->Process(res, prnds_[tid].get());
-      }
       out.Push(static_cast<unsigned>(rec.image_index()),
                mshadow::Shape3(n_channels, res.rows, res.cols),
                mshadow::Shape1(param_.label_width));
 
       mshadow::Tensor<cpu, 3> data = out.data().Back();
 
-      // For RGB or RGBA data, swap the B and R channel:
-      // OpenCV store as BGR (or BGRA) and we want RGB (or RGBA)
-      std::vector<int> swap_indices;
-      if (n_channels == 1) swap_indices = {0};
-      if (n_channels == 3) swap_indices = {2, 1, 0};
-      if (n_channels == 4) swap_indices = {2, 1, 0, 3};
-
-      for (int i = 0; i < res.rows; ++i) {
-        uchar* im_data = res.ptr<uchar>(i);
-        for (int j = 0; j < res.cols; ++j) {
-          for (int k = 0; k < n_channels; ++k) {
-              data[k][i][j] = im_data[swap_indices[k]];
-          }
-          im_data += n_channels;
-        }
-      }
+      // opencv stores BGR(A) and we want RGB(A)
+      double start = convert_.Start();
+      HWCToCHW(res.ptr<uint8_t>(0), res.rows, res.cols, n_channels, res.step[0],
+               false, data.dptr_);
+      convert_.Stop(start);
 
-      mshadow::Tensor<cpu, 1> label = out.label().Back();
-      if (label_map_ != nullptr) {
-        mshadow::Copy(label, label_map_->Find(rec.image_index()));
-      } else if (rec.label != NULL) {
-        CHECK_EQ(param_.label_width, rec.num_label)
-          << "rec file provide " << rec.num_label << "-dimensional label "
-             "but label_width is set to " << param_.label_width;
-        mshadow::Copy(label, mshadow::Tensor<cpu, 1>(rec.label,
-                                                     mshadow::Shape1(rec.num_label)));
-      } else {
-        CHECK_EQ(param_.label_width, 1)
-          << "label_width must be 1 unless an imglist is provided "
-             "or the rec file is packed with multi dimensional label";
-        label[0] = rec.header.label;
-      }
+      ParseLabel(rec, out.label().Back().dptr_);
       res.release();
     }
   }
+  size_t num_records = 0;
+  for (const auto& out : *out_vec) num_records += out.Size();
+  read_.Add(read_sec, num_records);
 #else
       LOG(FATAL) << "Opencv is needed for image decoding and augmenting.";
 #endif
   return true;
 }
 
+#if MXNET_USE_OPENCV
+/*!
+ * \brief read the size and the number of channels from the header of a JPEG
+ *  image, without decoding it
+ * \return false if buf is not a JPEG image
+ */
+inline bool ReadJPEGHeader(const uint8_t *buf, size_t size,
+                           int *rows, int *cols, int *channels) {
+  if (size < 4 || buf[0] != 0xFF || buf[1] != 0xD8) return false;
+  size_t pos = 2;
+  while (pos + 4 <= size) {
+    if (buf[pos] != 0xFF) return false;
+    uint8_t marker = buf[pos + 1];
+    if (marker == 0xFF) {  // fill byte
+      ++pos; continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {  // no payload
+      pos += 2; continue;
+    }
+    if (marker == 0xD9 || marker == 0xDA) return false;  // EOI or SOS before SOF
+    size_t len = (buf[pos + 2] << 8) | buf[pos + 3];
+    // SOF0-SOF15, except DHT, JPG and DAC
+    if (marker >= 0xC0 && marker <= 0xCF &&
+        marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      if (pos + 10 > size) return false;
+      *rows = (buf[pos + 5] << 8) | buf[pos + 6];
+      *cols = (buf[pos + 7] << 8) | buf[pos + 8];
+      *channels = buf[pos + 9];
+      return *rows > 0 && *cols > 0;
+    }
+    pos += 2 + len;
+  }
+  return false;
+}
+
+inline int ImageRecordIOParser::DecodeFlag(const ImageRecordIO &rec, int tid) {
+  // -1 to keep the number of channel of the encoded image, and not force gray or color.
+  const int kUnchanged = -1;
+// OpenCV 2.4 defines CV_VERSION_EPOCH, and the reduced flags need 3.2
+#if !defined(CV_VERSION_EPOCH) && \
+    ((CV_VERSION_MAJOR > 3) || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 2))
+  if (!param_.reduced_decode || augmenters_[tid].empty()) return kUnchanged;
+  // only the first augmenter sees the decoded image
+  int min_edge = augmenters_[tid][0]->MinSourceEdge();
+  if (min_edge <= 0) return kUnchanged;
+  int rows, cols, channels;
+  if (!ReadJPEGHeader(reinterpret_cast<const uint8_t*>(rec.content), rec.content_size,
+                      &rows, &cols, &channels)) {
+    return kUnchanged;
+  }
+  // the reduced flags force gray or color, which only keeps 1 and 3 channels
+  if (channels != 1 && channels != 3) return kUnchanged;
+  // libjpeg rounds the scaled size up
+  int edge = std::min(rows, cols);
+  const int gray[] = {cv::IMREAD_REDUCED_GRAYSCALE_8, cv::IMREAD_REDUCED_GRAYSCALE_4,
+                      cv::IMREAD_REDUCED_GRAYSCALE_2};
+  const int color[] = {cv::IMREAD_REDUCED_COLOR_8, cv::IMREAD_REDUCED_COLOR_4,
+                       cv::IMREAD_REDUCED_COLOR_2};
+  const int scale[] = {8, 4, 2};
+  for (int i = 0; i < 3; ++i) {
+    if ((edge + scale[i] - 1) / scale[i] >= min_edge) {
+      // -1 does not apply the EXIF orientation either
+      return (channels == 1 ? gray[i] : color[i]) | cv::IMREAD_IGNORE_ORIENTATION;
+    }
+  }
+#endif
+  return kUnchanged;
+}
+
+inline cv::Mat ImageRecordIOParser::Decode(const ImageRecordIO &rec, int tid) {
+  cv::Mat res;
+  double start = decode_.Start();
+  if (cache_ != nullptr && cache_->Get(rec.image_index(), rec.content_size, &cached_[tid])) {
+    res = cached_[tid];
+  } else {
+    CHECK_NE(rec.content_size, 0U) << "image " << rec.image_index() << " is not cached";
+    cv::Mat buf(1, rec.content_size, CV_8U, rec.content);
+    res = cv::imdecode(buf, DecodeFlag(rec, tid));
+    if (cache_ != nullptr) {
+      // cache the image before the random augmentations
+      if (augmenters_[tid].size() != 0) res = augmenters_[tid][0]->Prepare(res);
+      cache_->Put(rec.image_index(), rec.content_size, res);
+    }
+  }
+  decode_.Stop(start);
+  start = augment_.Start();
+  for (auto& aug : augmenters_[tid]) {
+    res = aug->Process(res, prnds_[tid].get());
+  }
+  augment_.Stop(start);
+  return res;
+}
+#endif
+
+inline void ImageRecordIOParser::ParseLabel(const ImageRecordIO &rec, real_t *out) {
+  mshadow::Tensor<cpu, 1> label(out, mshadow::Shape1(param_.label_width));
+  if (label_map_ != nullptr) {
+    mshadow::Copy(label, label_map_->Find(rec.image_index()));
+  } else if (rec.label != NULL) {
+    CHECK_EQ(param_.label_width, rec.num_label)
+      << "rec file provide " << rec.num_label << "-dimensional label "
+         "but label_width is set to " << param_.label_width;
+    mshadow::Copy(label, mshadow::Tensor<cpu, 1>(rec.label,
+                                                 mshadow::Shape1(rec.num_label)));
+  } else {
+    CHECK_EQ(param_.label_width, 1)
+      << "label_width must be 1 unless an imglist is provided "
+         "or the rec file is packed with multi dimensional label";
+    label[0] = rec.header.label;
+  }
+}
+
+inline bool ImageRecordIOParser::
+NextRecords(std::vector<dmlc::InputSplit::Blob> *out) {
+  double start = read_.Start();
+  if (cache_ready_) {
+    if (!NextCachedRecords(out)) return false;
+    num_served_ += out->size();
+    read_.Stop(start, out->size());
+    return true;
+  }
+  bool ret = indexed_ != nullptr ? NextIndexedRecords(out) : NextChunkRecords(out);
+  read_.Stop(start, ret ? out->size() : 0);
+  if (cache_ == nullptr) return ret;
+  if (ret) {
+    num_served_ += out->size();
+    for (const auto& blob : *out) {
+      ImageRecordIO rec;
+      rec.Load(blob.dptr, blob.size);
+      const char *p = static_cast<const char*>(blob.dptr);
+      heads_.emplace_back(p, p + blob.size - rec.content_size);
+    }
+  } else if (cache_->complete() && heads_.size() != 0) {
+    // the previous records are all decoded, and all their images are cached
+    if (param_.verbose) {
+      LOG(INFO) << "ImageRecordIOParser: all " << heads_.size()
+                << " images are cached, stop reading " << param_.path_imgrec;
+    }
+    cache_ready_ = true;
+    order_.resize(heads_.size());
+    for (size_t i = 0; i < order_.size(); ++i) order_[i] = i;
+    order_ptr_ = order_.size();
+  }
+  return ret;
+}
+
+inline bool ImageRecordIOParser::
+NextChunkRecords(std::vector<dmlc::InputSplit::Blob> *out) {
+  CHECK(source_ != nullptr);
+  out->clear();
+  rec_copies_.clear();
+  if (!source_->NextChunk(&chunk_)) return false;
+  const char *begin = static_cast<const char*>(chunk_.dptr);
+  const char *end = begin + chunk_.size;
+  dmlc::RecordIOChunkReader reader(chunk_, 0, 1);
+  dmlc::InputSplit::Blob blob;
+  while (reader.NextRecord(&blob)) {
+    const char *p = static_cast<const char*>(blob.dptr);
+    if (p < begin || p >= end) {
+      // a record split into several parts is merged in a buffer of the
+      // reader, which is reused by the next record
+      rec_copies_.emplace_back(p, p + blob.size);
+    }
+    out->push_back(blob);
+  }
+  // point to the copies only after all of them are made
+  size_t k = 0;
+  for (auto& rec : *out) {
+    const char *p = static_cast<const char*>(rec.dptr);
+    if (p < begin || p >= end) rec.dptr = rec_copies_[k++].data();
+  }
+  return true;
+}
+
+inline bool ImageRecordIOParser::
+NextIndexedRecords(std::vector<dmlc::InputSplit::Blob> *out) {
+  out->clear();
+  if (order_ptr_ == order_.size()) return false;
+  size_t end = std::min(order_ptr_ + kRecordChunk, order_.size());
+  rec_copies_.resize(end - order_ptr_);
+  for (size_t i = order_ptr_; i < end; ++i) {
+    out->push_back(indexed_->Record(order_[i], &rec_copies_[i - order_ptr_]));
+  }
+  order_ptr_ = end;
+  // read ahead the records of the next call while these are decoded
+  size_t next = std::min(order_ptr_ + kRecordChunk, order_.size());
+  for (size_t i = order_ptr_; i < next; ++i) {
+    indexed_->WillNeed(order_[i]);
+  }
+  return true;
+}
+
+inline bool ImageRecordIOParser::
+NextCachedRecords(std::vector<dmlc::InputSplit::Blob> *out) {
+  out->clear();
+  if (order_ptr_ == order_.size()) return false;
+  size_t end = std::min(order_ptr_ + kRecordChunk, order_.size());
+  for (size_t i = order_ptr_; i < end; ++i) {
+    std::vector<char>& head = heads_[order_[i]];
+    dmlc::InputSplit::Blob blob;
+    blob.dptr = head.data();
+    blob.size = head.size();
+    out->push_back(blob);
+  }
+  order_ptr_ = end;
+  return true;
+}
+
+template<typename DType, typename LType>
+inline void ImageRecordIOParser::
+ParseRecords(const dmlc::InputSplit::Blob *records, size_t n,
+             const ImageNormalizer &normalizer,
+             mshadow::Tensor<cpu, 4, DType> data,
+             mshadow::Tensor<cpu, 2, LType> label,
+             uint64_t *index) {
+#if MXNET_USE_OPENCV
+  CHECK_LE(n, data.size(0));
+  const int num = static_cast<int>(n);
+  #pragma omp parallel for num_threads(param_.preprocess_threads) schedule(dynamic)
+  for (int i = 0; i < num; ++i) {
+    int tid = omp_get_thread_num();
+    ImageRecordIO rec;
+    rec.Load(records[i].dptr, records[i].size);
+    cv::Mat res = Decode(rec, tid);
+    CHECK(res.rows == static_cast<int>(data.size(2)) &&
+          res.cols == static_cast<int>(data.size(3)) &&
+          res.channels() == static_cast<int>(data.size(1)))
+        << "the image is " << res.channels() << "x" << res.rows << "x" << res.cols
+        << " after augmentation but data_shape is " << param_.data_shape
+        << ", please resize or crop the images to data_shape";
+    double start = convert_.Start();
+    normalizer.Process(res.ptr<uint8_t>(0), res.rows, res.cols, res.channels(),
+                       res.step[0], prnds_[tid].get(), data[i]);
+    convert_.Stop(start);
+    real_t tmp[kMaxLabelWidth];
+    CHECK_LE(param_.label_width, kMaxLabelWidth);
+    ParseLabel(rec, tmp);
+    for (int k = 0; k < param_.label_width; ++k) {
+      label[i][k] = LType(tmp[k]);
+    }
+    index[i] = rec.image_index();
+  }
+#else
+  LOG(FATAL) << "Opencv is needed for image decoding and augmenting.";
+#endif
+}
+
 // Define image record parameters
 struct ImageRecordParam: public dmlc::Parameter<ImageRecordParam> {
   /*! \brief whether to do shuffle */
@@ -351,7 +717,7 @@ struct ImageRecordParam: public dmlc::Parameter<ImageRecordParam> {
 // iterator on image recordio
 class ImageRecordIter : public IIterator<DataInst> {
  public:
-  ImageRecordIter() : data_(nullptr) { }
+  ImageRecordIter() : data_(nullptr), queue_("parse") { }
   // destructor
   virtual ~ImageRecordIter(void) {
     iter_.Destroy();
@@ -369,7 +735,9 @@ class ImageRecordIter : public IIterator<DataInst> {
         if (*dptr == nullptr) {
           *dptr = new std::vector<InstVector>();
         }
-        return parser_.ParseNext(*dptr);
+        if (!parser_.ParseNext(*dptr)) return false;
+        queue_.Produced();
+        return true;
       },
       [this]() { parser_.BeforeFirst(); });
     inst_ptr_ = 0;
@@ -378,6 +746,7 @@ class ImageRecordIter : public IIterator<DataInst> {
   // before first
   virtual void BeforeFirst(void) {
     iter_.BeforeFirst();
+    queue_.Reset();
     inst_order_.clear();
     inst_ptr_ = 0;
   }
@@ -391,7 +760,10 @@ class ImageRecordIter : public IIterator<DataInst> {
         return true;
       } else {
         if (data_ != nullptr) iter_.Recycle(&data_);
-        if (!iter_.Next(&data_)) return false;
+        double start = queue_.Request();
+        bool ret = iter_.Next(&data_);
+        queue_.Received(start, ret);
+        if (!ret) return false;
         inst_order_.clear();
         for (unsigned i = 0; i < data_->size(); ++i) {
           const InstVector& tmp = (*data_)[i];
@@ -413,6 +785,11 @@ class ImageRecordIter : public IIterator<DataInst> {
     return out_;
   }
 
+  virtual void GetStats(IOStats *stats) const {
+    parser_.GetStats(stats);
+    queue_.Append(stats);
+  }
+
  private:
   // random magic
   static const int kRandMagic = 111;
@@ -432,13 +809,238 @@ class ImageRecordIter : public IIterator<DataInst> {
   ImageRecordParam param_;
   // random number generator
   common::RANDOM_ENGINE rnd_;
+  // counters of the parsed chunks
+  IOQueueStats queue_;
+};
+
+/*!
+ * \brief iterator on image recordio which decodes, augments, normalizes
+ *  and batches the images in the decoding threads.
+ *
+ *  Every decoding thread writes its images directly into their slots of a
+ *  preallocated batch, instead of passing single instances through
+ *  ImageNormalizeIter, BatchLoader and PrefetcherIter, whose serial copies
+ *  limit the throughput on many cores.
+ */
+class ImageRecordBatchIter : public IIterator<DataBatch> {
+ public:
+  ImageRecordBatchIter()
+      : rec_ptr_(0), num_overflow_(0), out_(nullptr), queue_("prefetch") { }
+
+  virtual ~ImageRecordBatchIter(void) {
+    iter_.Destroy();
+    while (recycle_queue_.size() != 0) {
+      delete recycle_queue_.front();
+      recycle_queue_.pop();
+    }
+    delete out_;
+  }
+
+  virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+    param_.InitAllowUnknown(kwargs);
+    batch_param_.InitAllowUnknown(kwargs);
+    prefetch_param_.InitAllowUnknown(kwargs);
+    normalize_param_.InitAllowUnknown(kwargs);
+    CheckRawPixels(normalize_param_, kwargs);
+    if (normalize_param_.mean_img.length() != 0) {
+      std::unique_ptr<dmlc::Stream> fi(
+          dmlc::Stream::Create(normalize_param_.mean_img.c_str(), "r", true));
+      if (fi.get() == nullptr) {
+        // ImageNormalizeIter creates the mean image when it is inited
+        ImageNormalizeIter(new ImageRecordIter()).Init(kwargs);
+      }
+      LoadMeanImg(normalize_param_.mean_img, &meanimg_);
+      normalizer_.Init(normalize_param_, &meanimg_);
+    } else {
+      normalizer_.Init(normalize_param_, nullptr);
+    }
+    parser_.Init(kwargs);
+    CHECK_EQ(parser_.param().data_shape.ndim(), 3)
+        << "data_shape must be (channels, height, width)";
+    rnd_.seed(kRandMagic + param_.seed);
+    if (param_.shuffle != 0) parser_.ShuffleRecords(&rnd_);
+    // maximum prefetch threaded iter internal size
+    const int kMaxPrefetchBuffer = 16;
+    iter_.set_max_capacity(kMaxPrefetchBuffer);
+    iter_.Init([this](DataBatch **dptr) {
+        if (!this->LoadBatch(dptr)) return false;
+        queue_.Produced();
+        return true;
+      },
+      [this]() { this->Reset(); });
+  }
+
+  virtual void BeforeFirst(void) {
+    iter_.BeforeFirst();
+    queue_.Reset();
+  }
+
+  virtual bool Next(void) {
+    if (out_ != nullptr) {
+      recycle_queue_.push(out_); out_ = nullptr;
+    }
+    // do recycle
+    if (recycle_queue_.size() == prefetch_param_.prefetch_buffer) {
+      DataBatch *old_batch =  recycle_queue_.front();
+      for (NDArray& arr : old_batch->data) {
+        arr.WaitToWrite();
+      }
+      recycle_queue_.pop();
+      iter_.Recycle(&old_batch);
+    }
+    double start = queue_.Request();
+    bool ret = iter_.Next(&out_);
+    queue_.Received(start, ret);
+    return ret;
+  }
+
+  virtual const DataBatch &Value(void) const {
+    return *out_;
+  }
+
+  virtual void GetStats(IOStats *stats) const {
+    parser_.GetStats(stats);
+    queue_.Append(stats);
+  }
+
+ private:
+  // random magic
+  static const int kRandMagic = 111;
+  // allocate the batch for the first time
+  inline DataBatch *AllocBatch() const {
+    const TShape& s = parser_.param().data_shape;
+    index_t batch_size = batch_param_.batch_size;
+    DataBatch *batch = new DataBatch();
+    batch->data.push_back(NDArray(mshadow::Shape4(batch_size, s[0], s[1], s[2]),
+                                  prefetch_param_.HostContext(), false,
+                                  prefetch_param_.OutputType(0)));
+    batch->data.push_back(NDArray(mshadow::Shape2(batch_size, parser_.param().label_width),
+                                  prefetch_param_.HostContext(), false,
+                                  prefetch_param_.OutputType(1)));
+    batch->index.resize(batch_size);
+    return batch;
+  }
+  // fill the batch from slot top, return the number of filled slots
+  inline index_t Fill(DataBatch *batch, index_t top) {
+    index_t batch_size = batch_param_.batch_size;
+    while (top < batch_size) {
+      if (rec_ptr_ == records_.size()) {
+        rec_ptr_ = 0;
+        if (!parser_.NextRecords(&records_)) break;
+        if (param_.shuffle != 0) {
+          std::shuffle(records_.begin(), records_.end(), rnd_);
+        }
+        continue;
+      }
+      index_t n = std::min(static_cast<size_t>(batch_size - top),
+                           records_.size() - rec_ptr_);
+      MSHADOW_TYPE_SWITCH(prefetch_param_.OutputType(0), DType, {
+        MSHADOW_TYPE_SWITCH(prefetch_param_.OutputType(1), LType, {
+          mshadow::Tensor<cpu, 4, DType> data =
+              batch->data[0].data().get<cpu, 4, DType>();
+          mshadow::Tensor<cpu, 2, LType> label =
+              batch->data[1].data().get<cpu, 2, LType>();
+          parser_.ParseRecords(dmlc::BeginPtr(records_) + rec_ptr_, n, normalizer_,
+                               data.Slice(top, top + n), label.Slice(top, top + n),
+                               dmlc::BeginPtr(batch->index) + top);
+        });
+      });
+      top += n;
+      rec_ptr_ += n;
+    }
+    return top;
+  }
+  // load the next batch, called by the prefetch thread
+  inline bool LoadBatch(DataBatch **dptr) {
+    // if overflow from previous round, directly return false, until before first is called
+    if (num_overflow_ != 0) return false;
+    if (*dptr == nullptr) *dptr = AllocBatch();
+    DataBatch *batch = *dptr;
+    index_t batch_size = batch_param_.batch_size;
+    index_t top = Fill(batch, 0);
+    if (top == 0) return false;
+    batch->num_batch_padd = 0;
+    if (top < batch_size) {
+      if (batch_param_.round_batch != 0) {
+        // fill the rest with the head of the data
+        this->ResetParser();
+        CHECK_EQ(Fill(batch, top), batch_size)
+            << "number of input must be bigger than batch size";
+        num_overflow_ = batch_size - top;
+        batch->num_batch_padd = num_overflow_;
+      } else {
+        batch->num_batch_padd = batch_size - top;
+      }
+    }
+    return true;
+  }
+  // reset, called by the prefetch thread
+  inline void Reset() {
+    if (batch_param_.round_batch == 0 || num_overflow_ == 0) {
+      this->ResetParser();
+    } else {
+      // otherise, we already reset in the round batch
+      num_overflow_ = 0;
+    }
+  }
+  inline void ResetParser() {
+    parser_.BeforeFirst();
+    if (param_.shuffle != 0) parser_.ShuffleRecords(&rnd_);
+    records_.clear();
+    rec_ptr_ = 0;
+  }
+
+  /*! \brief iterator parameters */
+  ImageRecordParam param_;
+  /*! \brief batch parameters */
+  BatchParam batch_param_;
+  /*! \brief prefetch parameters */
+  PrefetcherParam prefetch_param_;
+  /*! \brief normalize parameters */
+  ImageNormalizeParam normalize_param_;
+  /*! \brief mean image, if needed */
+  mshadow::TensorContainer<cpu, 3> meanimg_;
+  /*! \brief normalizer used by the decoding threads */
+  ImageNormalizer normalizer_;
+  /*! \brief internal parser */
+  ImageRecordIOParser parser_;
+  /*! \brief the records of the current chunk */
+  std::vector<dmlc::InputSplit::Blob> records_;
+  /*! \brief the next record to parse */
+  size_t rec_ptr_;
+  /*! \brief number of overflow instances that readed in round_batch mode */
+  index_t num_overflow_;
+  /*! \brief random number generator for shuffling */
+  common::RANDOM_ENGINE rnd_;
+  /*! \brief output data */
+  DataBatch *out_;
+  /*! \brief queue to be recycled */
+  std::queue<DataBatch*> recycle_queue_;
+  /*! \brief backend thread */
+  dmlc::ThreadedIter<DataBatch> iter_;
+  /*! \brief counters of the prefetched batches */
+  IOQueueStats queue_;
 };
 
 DMLC_REGISTER_PARAMETER(ImageRecParserParam);
 DMLC_REGISTER_PARAMETER(ImageRecordParam);
 
 MXNET_REGISTER_IO_ITER(ImageRecordIter)
-.describe("Create iterator for dataset packed in recordio.")
+.describe("Create iterator for dataset packed in recordio. The images are decoded, "
+          "augmented, normalized and batched in parallel by preprocess_threads threads.")
+.add_arguments(ImageRecParserParam::__FIELDS__())
+.add_arguments(ImageRecordParam::__FIELDS__())
+.add_arguments(BatchParam::__FIELDS__())
+.add_arguments(PrefetcherParam::__FIELDS__())
+.add_arguments(ListDefaultAugParams())
+.add_arguments(ImageNormalizeParam::__FIELDS__())
+.set_body([]() {
+    return new DeviceRingIter(new ImageRecordBatchIter());
+  });
+
+MXNET_REGISTER_IO_ITER(ImageRecordIter_v1)
+.describe("Create iterator for dataset packed in recordio, which normalizes and "
+          "batches the decoded images in a single thread.")
 .add_arguments(ImageRecParserParam::__FIELDS__())
 .add_arguments(ImageRecordParam::__FIELDS__())
 .add_arguments(BatchParam::__FIELDS__())
@@ -446,10 +1048,11 @@ MXNET_REGISTER_IO_ITER(ImageRecordIter)
 .add_arguments(ListDefaultAugParams())
 .add_arguments(ImageNormalizeParam::__FIELDS__())
 .set_body([]() {
-    return new PrefetcherIter(
-        new BatchLoader(
-            new ImageNormalizeIter(
-                new ImageRecordIter())));
+    return new DeviceRingIter(
+        new PrefetcherIter(
+            new BatchLoader(
+                new ImageNormalizeIter(
+                    new ImageRecordIter()))));
   });
 }  // namespace io
 }  // namespace mxnet
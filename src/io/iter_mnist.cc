@@ -243,7 +243,7 @@ MXNET_REGISTER_IO_ITER(MNISTIter)
 .add_arguments(MNISTParam::__FIELDS__())
 .add_arguments(PrefetcherParam::__FIELDS__())
 .set_body([]() {
-    return new PrefetcherIter(new MNISTIter());
+    return new DeviceRingIter(new PrefetcherIter(new MNISTIter()));
   });
 
 }  // namespace io
@@ -17,6 +17,9 @@
 #include <string>
 #include <vector>
 #include "../common/utils.h"
+#include "./image_kernels.h"
+#include "./iter_stats.h"
+#include "./iter_prefetcher.h"
 
 namespace mxnet {
 namespace io {
@@ -74,8 +77,50 @@ struct ImageNormalizeParam :  public dmlc::Parameter<ImageNormalizeParam> {
     DMLC_DECLARE_FIELD(verbose).set_default(true)
         .describe("Augmentation Param: Whether to print augmentor info.");
   }
+  /*! \brief whether the output equals the input pixels, up to mirroring */
+  inline bool IsIdentity() const {
+    return mean_img.length() == 0 && mean_r == 0.0f && mean_g == 0.0f &&
+        mean_b == 0.0f && mean_a == 0.0f && scale == 1.0f;
+  }
 };
 
+/*!
+ * \brief check that the images are not normalized if the data is output as
+ *  integers, which are the raw pixels
+ */
+inline void CheckRawPixels(const ImageNormalizeParam& param,
+                           const std::vector<std::pair<std::string, std::string> >& kwargs) {
+  PrefetcherParam prefetch_param;
+  prefetch_param.InitAllowUnknown(kwargs);
+  if (prefetch_param.IsIntegerType()) {
+    CHECK(param.IsIdentity())
+        << "integer outputs are raw pixels, normalize them in the network instead, "
+        << "e.g. by the ImageNormalize operator";
+  }
+}
+
+/*!
+ * \brief load the mean image saved by \ref ImageNormalizeIter
+ * \param fname the mean image file
+ * \param meanimg the output
+ */
+inline void LoadMeanImg(const std::string& fname,
+                        mshadow::TensorContainer<cpu, 3>* meanimg) {
+  // use python compatible ndarray store format
+  std::vector<NDArray> data;
+  std::vector<std::string> keys;
+  {
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r"));
+    NDArray::Load(fi.get(), &data, &keys);
+  }
+  CHECK_EQ(data.size(), 1)
+      << "Invalid mean image file format";
+  data[0].WaitToRead();
+  mshadow::Tensor<cpu, 3> src = data[0].data().get<cpu, 3, real_t>();
+  meanimg->Resize(src.shape_);
+  mshadow::Copy(*meanimg, src);
+}
+
 /*!
  * \brief Iterator that normalize a image.
  *  It also applies a few augmention before normalization.
@@ -83,11 +128,12 @@ struct ImageNormalizeParam :  public dmlc::Parameter<ImageNormalizeParam> {
 class ImageNormalizeIter : public IIterator<DataInst> {
  public:
   explicit ImageNormalizeIter(IIterator<DataInst> *base)
-      : base_(base), meanfile_ready_(false) {
+      : base_(base), meanfile_ready_(false), normalize_("normalize") {
   }
 
   virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
     param_.InitAllowUnknown(kwargs);
+    CheckRawPixels(param_, kwargs);
     base_->Init(kwargs);
     rnd_.seed(kRandMagic + param_.seed);
     outimg_.set_pad(false);
@@ -102,19 +148,7 @@ class ImageNormalizeIter : public IIterator<DataInst> {
         if (param_.verbose) {
           LOG(INFO) << "Load mean image from " << param_.mean_img;
         }
-        // use python compatible ndarray store format
-        std::vector<NDArray> data;
-        std::vector<std::string> keys;
-        {
-          std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(param_.mean_img.c_str(), "r"));
-          NDArray::Load(fi.get(), &data, &keys);
-        }
-        CHECK_EQ(data.size(), 1)
-            << "Invalid mean image file format";
-        data[0].WaitToRead();
-        mshadow::Tensor<cpu, 3> src = data[0].data().get<cpu, 3, real_t>();
-        meanimg_.Resize(src.shape_);
-        mshadow::Copy(meanimg_, src);
+        LoadMeanImg(param_.mean_img, &meanimg_);
         meanfile_ready_ = true;
       }
     }
@@ -133,6 +167,11 @@ class ImageNormalizeIter : public IIterator<DataInst> {
     return true;
   }
 
+  virtual void GetStats(IOStats *stats) const {
+    base_->GetStats(stats);
+    normalize_.Append(stats);
+  }
+
  private:
   /*! \brief base iterator */
   std::unique_ptr<IIterator<DataInst> > base_;
@@ -150,12 +189,16 @@ class ImageNormalizeIter : public IIterator<DataInst> {
   common::RANDOM_ENGINE rnd_;
   // random magic number of this iterator
   static const int kRandMagic = 0;
+  /*! \brief the normalization of the images */
+  IOStage normalize_;
 
   /*! \brief internal next function, inlined for fater processing. */
   inline bool Next_(void) {
     if (!base_->Next()) return false;
     const DataInst &src = base_->Value();
+    double start = normalize_.Start();
     this->SetOutImg(src);
+    normalize_.Stop(start);
     out_.data.resize(2);
     out_.data[0] = outimg_;
     out_.data[1] = src.data[1];
@@ -247,6 +290,118 @@ class ImageNormalizeIter : public IIterator<DataInst> {
     this->BeforeFirst();
   }
 };
+
+/*!
+ * \brief the normalization of \ref ImageNormalizeIter applied on a decoded
+ *  8-bit HWC image, which writes the CHW result into its slot in a batch.
+ *
+ *  Process is thread safe as long as every thread passes its own random
+ *  engine, so the decoding threads can normalize their own images.
+ */
+class ImageNormalizer {
+ public:
+  /*!
+   * \brief init the normalizer
+   * \param param the normalize parameters
+   * \param meanimg the mean image, nullptr if not used
+   */
+  inline void Init(const ImageNormalizeParam& param,
+                   const mshadow::Tensor<cpu, 3>* meanimg) {
+    param_ = param;
+    use_meanimg_ = meanimg != nullptr;
+    if (use_meanimg_) meanimg_ = *meanimg;
+    mean_[0] = param.mean_r;
+    mean_[1] = param.mean_g;
+    mean_[2] = param.mean_b;
+    mean_[3] = param.mean_a;
+    channel_mean_ = param.mean_r > 0.0f || param.mean_g > 0.0f ||
+        param.mean_b > 0.0f || param.mean_a > 0.0f;
+  }
+  /*!
+   * \brief whether the output equals the input pixels, up to mirroring, which
+   *  is required by 8-bit outputs
+   */
+  inline bool IsIdentity() const {
+    if (channel_mean_ || use_meanimg_) return false;
+    return param_.scale == 1.0f;
+  }
+  /*!
+   * \brief normalize an image
+   * \param src the image in BGR(A) order, as decoded by opencv
+   * \param rows the height
+   * \param cols the width
+   * \param channels the number of channels, 1, 3 or 4
+   * \param stride the number of bytes of a row of src
+   * \param rnd the random engine of the calling thread
+   * \param out the output in RGB(A) order, with shape (channels, rows, cols)
+   */
+  template<typename DType>
+  inline void Process(const uint8_t* src, int rows, int cols, int channels,
+                      size_t stride, common::RANDOM_ENGINE* rnd,
+                      mshadow::Tensor<cpu, 3, DType> out) const {
+    std::uniform_real_distribution<float> rand_uniform(0, 1);
+    std::bernoulli_distribution coin_flip(0.5);
+    CHECK(channels == 1 || channels == 3 || channels == 4)
+        << "unsupported number of channels " << channels;
+    CHECK_EQ(out.shape_, mshadow::Shape3(channels, rows, cols));
+    float contrast =
+        rand_uniform(*rnd) * param_.max_random_contrast * 2 - param_.max_random_contrast + 1;
+    float illumination =
+        rand_uniform(*rnd) * param_.max_random_illumination * 2 - param_.max_random_illumination;
+    bool flip = (param_.rand_mirror && coin_flip(*rnd)) || param_.mirror;
+    bool use_meanimg = !channel_mean_ && use_meanimg_;
+    if (use_meanimg) {
+      CHECK_EQ(meanimg_.shape_, out.shape_) << "the shape of the mean image mismatches";
+    }
+    // out = (x - mean) * mul + add, the same as ImageNormalizeIter
+    float mul = param_.scale, add = 0.0f;
+    if (channel_mean_ || use_meanimg) {
+      mul = contrast * param_.scale;
+      add = illumination * param_.scale;
+    }
+    if (IsIdentity()) {
+      // only reorder, e.g. for uint8 outputs normalized later by the network
+      HWCToCHW(src, rows, cols, channels, stride, flip, out.dptr_);
+      return;
+    }
+    if (!use_meanimg) {
+      // (x - mean) * mul + add, folded into x * mul + add
+      float muls[4], adds[4];
+      for (int k = 0; k < channels; ++k) {
+        muls[k] = mul;
+        adds[k] = add - (channel_mean_ ? mean_[k] : 0.0f) * mul;
+      }
+      HWCToCHWAffine(src, rows, cols, channels, stride, flip, muls, adds, out.dptr_);
+      return;
+    }
+    // opencv stores BGR(A) and we want RGB(A)
+    static const int kSwap[3][4] = {{0}, {2, 1, 0}, {2, 1, 0, 3}};
+    const int* swap = kSwap[channels == 1 ? 0 : channels - 2];
+    for (int k = 0; k < channels; ++k) {
+      for (int i = 0; i < rows; ++i) {
+        const uint8_t* im_data = src + i * stride + swap[k];
+        const real_t* mean_row = meanimg_[k][i].dptr_;
+        DType* dst = out[k][i].dptr_;
+        for (int j = 0; j < cols; ++j) {
+          int dj = flip ? cols - 1 - j : j;
+          dst[dj] = DType((im_data[j * channels] - mean_row[j]) * mul + add);
+        }
+      }
+    }
+  }
+
+ private:
+  /*! \brief normalize parameters */
+  ImageNormalizeParam param_;
+  /*! \brief whether to subtract the mean image */
+  bool use_meanimg_;
+  /*! \brief mean image, if used */
+  mshadow::Tensor<cpu, 3> meanimg_;
+  /*! \brief per channel mean in RGBA order */
+  float mean_[4];
+  /*! \brief whether to subtract the per channel mean */
+  bool channel_mean_;
+};
 }  // namespace io
 }  // namespace mxnet
 #endif  // MXNET_IO_ITER_NORMALIZE_H_
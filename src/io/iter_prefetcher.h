@@ -17,7 +17,9 @@
 #include <vector>
 #include <queue>
 #include <algorithm>
+#include <cstdlib>
 #include "./inst_vector.h"
+#include "./iter_stats.h"
 
 namespace mxnet {
 namespace io {
@@ -27,6 +29,10 @@ struct PrefetcherParam : public dmlc::Parameter<PrefetcherParam> {
   size_t prefetch_buffer;
   /*! \brief data type */
   int dtype;
+  /*! \brief the context the batches are copied to, empty to keep them in host memory */
+  std::string ctx;
+  /*! \brief number of batches on the device of ctx */
+  int device_buffer;
 
   // declare parameters
   DMLC_DECLARE_PARAMETER(PrefetcherParam) {
@@ -36,8 +42,50 @@ struct PrefetcherParam : public dmlc::Parameter<PrefetcherParam> {
       .add_enum("float32", mshadow::kFloat32)
       .add_enum("float64", mshadow::kFloat64)
       .add_enum("float16", mshadow::kFloat16)
+      .add_enum("uint8", mshadow::kUint8)
+      .add_enum("int32", mshadow::kInt32)
       .set_default(mshadow::default_type_flag)
-      .describe("Data type.");
+      .describe("Data type of the output batches. Integer types only apply to "
+                "the data, labels stay float32. With integer types, image iterators "
+                "output the raw pixels and normalization is left to the network, "
+                "e.g. by the ImageNormalize operator.");
+    DMLC_DECLARE_FIELD(ctx).set_default("")
+      .describe("Backend Param: The context, e.g. gpu(0), the batches are copied to. "
+                "The copy of the next batch overlaps with the use of the current one. "
+                "Empty to output the batches in host memory.");
+    DMLC_DECLARE_FIELD(device_buffer).set_default(2).set_lower_bound(2)
+      .describe("Backend Param: Number of batches kept on the device of ctx, at least 2: "
+                "the batch returned and the one being copied.");
+  }
+  /*! \brief the context of ctx */
+  inline Context DeviceContext() const {
+    std::string name = ctx;
+    int dev_id = 0;
+    size_t pos = ctx.find('(');
+    if (pos != std::string::npos) {
+      CHECK_EQ(ctx[ctx.length() - 1], ')') << "invalid ctx " << ctx;
+      name = ctx.substr(0, pos);
+      dev_id = atoi(ctx.substr(pos + 1).c_str());
+    }
+    if (name == "cpu") return Context::CPU();
+    if (name == "gpu") return Context::GPU(dev_id);
+    LOG(FATAL) << "invalid ctx " << ctx << ", expect cpu or gpu(i)";
+    return Context::CPU();
+  }
+  /*! \brief the context of the batches in host memory, pinned if copied to a GPU */
+  inline Context HostContext() const {
+    if (ctx.length() == 0) return Context::CPU();
+    Context dev = DeviceContext();
+    if (dev.dev_mask() == gpu::kDevMask) return Context::CPUPinned(dev.dev_id);
+    return Context::CPU();
+  }
+  /*! \brief whether the data is output as integers, which are the raw pixels of images */
+  inline bool IsIntegerType() const {
+    return dtype == mshadow::kUint8 || dtype == mshadow::kInt32;
+  }
+  /*! \brief the data type of the i-th output of a batch */
+  inline int OutputType(size_t i) const {
+    return i == 0 || !IsIntegerType() ? dtype : mshadow::DataType<real_t>::kFlag;
   }
 };
 
@@ -45,7 +93,7 @@ struct PrefetcherParam : public dmlc::Parameter<PrefetcherParam> {
 class PrefetcherIter : public IIterator<DataBatch> {
  public:
   explicit PrefetcherIter(IIterator<TBlobBatch>* base)
-      : loader_(base), out_(nullptr) {
+      : loader_(base), out_(nullptr), copy_("copy"), queue_("prefetch") {
   }
 
   ~PrefetcherIter() {
@@ -71,6 +119,7 @@ class PrefetcherIter : public IIterator<DataBatch> {
 
     iter_.Init([this](DataBatch **dptr) {
         if (!loader_->Next()) return false;
+        double start = copy_.Start();
         const TBlobBatch& batch = loader_->Value();
         if (*dptr == nullptr) {
           // allocate databatch
@@ -80,16 +129,25 @@ class PrefetcherIter : public IIterator<DataBatch> {
           (*dptr)->index.resize(batch.batch_size);
           for (size_t i = 0; i < batch.data.size(); ++i) {
             (*dptr)->data.at(i) = NDArray(batch.data[i].shape_,
-                                          Context::CPU(), false,
-                                          param_.dtype);
+                                          param_.HostContext(), false,
+                                          param_.OutputType(i));
           }
         }
         CHECK(batch.data.size() == (*dptr)->data.size());
-        // copy data over
+        // copy data over, converting to dtype
         for (size_t i = 0; i < batch.data.size(); ++i) {
           CHECK_EQ((*dptr)->data.at(i).shape(), batch.data[i].shape_);
-          mshadow::Copy(((*dptr)->data)[i].data().FlatTo2D<cpu, real_t>(),
-                        batch.data[i].FlatTo2D<cpu, real_t>());
+          mshadow::Tensor<cpu, 2> src = batch.data[i].FlatTo2D<cpu, real_t>();
+          int dtype = param_.OutputType(i);
+          MSHADOW_TYPE_SWITCH(dtype, DType, {
+              mshadow::Tensor<cpu, 2, DType> dst =
+                  ((*dptr)->data)[i].data().FlatTo2D<cpu, DType>();
+              if (dtype == mshadow::DataType<real_t>::kFlag) {
+                mshadow::Copy(dst, src);
+              } else {
+                dst = mshadow::expr::tcast<DType>(src);
+              }
+            });
           (*dptr)->num_batch_padd = batch.num_batch_padd;
         }
         if (batch.inst_index) {
@@ -97,13 +155,16 @@ class PrefetcherIter : public IIterator<DataBatch> {
                     batch.inst_index + batch.batch_size,
                     (*dptr)->index.begin());
         }
-       return true;
+        copy_.Stop(start);
+        queue_.Produced();
+        return true;
       },
       [this]() { loader_->BeforeFirst(); });
   }
 
   virtual void BeforeFirst(void) {
     iter_.BeforeFirst();
+    queue_.Reset();
   }
 
   virtual bool Next(void) {
@@ -120,11 +181,19 @@ class PrefetcherIter : public IIterator<DataBatch> {
       recycle_queue_.pop();
       iter_.Recycle(&old_batch);
     }
-    return iter_.Next(&out_);
+    double start = queue_.Request();
+    bool ret = iter_.Next(&out_);
+    queue_.Received(start, ret);
+    return ret;
   }
   virtual const DataBatch &Value(void) const {
     return *out_;
   }
+  virtual void GetStats(IOStats *stats) const {
+    loader_->GetStats(stats);
+    copy_.Append(stats);
+    queue_.Append(stats);
+  }
 
  protected:
   /*! \brief prefetcher parameters */
@@ -139,6 +208,102 @@ class PrefetcherIter : public IIterator<DataBatch> {
   std::queue<DataBatch*> recycle_queue_;
   /*! \brief backend thread */
   dmlc::ThreadedIter<DataBatch> iter_;
+  /*! \brief the conversion of the batches of loader_ */
+  IOStage copy_;
+  /*! \brief counters of the prefetched batches */
+  IOQueueStats queue_;
+};
+
+/*!
+ * \brief copies the batches of an iterator to a ring of batches on the
+ *  device of the ctx parameter.
+ *
+ *  When a batch is returned, the copy of the next one is already pushed to the
+ *  engine, so it overlaps with the computation on the current one. Batches
+ *  on the ring are overwritten device_buffer - 1 calls of Next later, after
+ *  the engine finished the operations which read them. Without ctx, the
+ *  batches of the base iterator are returned as they are.
+ *
+ *  Being the outermost iterator, it also logs the stats of all stages
+ *  periodically if MXNET_IO_PROFILE is set.
+ */
+class DeviceRingIter : public IIterator<DataBatch> {
+ public:
+  explicit DeviceRingIter(IIterator<DataBatch>* base)
+      : base_(base), head_(0), out_(nullptr), has_next_(false) {
+  }
+
+  virtual void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) {
+    param_.InitAllowUnknown(kwargs);
+    base_->Init(kwargs);
+    if (param_.ctx.length() != 0) {
+      ctx_ = param_.DeviceContext();
+      ring_.resize(param_.device_buffer);
+    }
+  }
+
+  virtual void BeforeFirst(void) {
+    base_->BeforeFirst();
+    // the batch copied ahead belongs to the previous epoch
+    has_next_ = false;
+  }
+
+  virtual bool Next(void) {
+    logger_.MaybeLog(*this);
+    if (ring_.size() == 0) return base_->Next();
+    if (!has_next_) has_next_ = CopyNext();
+    if (!has_next_) return false;
+    out_ = &ring_[head_];
+    head_ = (head_ + 1) % ring_.size();
+    has_next_ = CopyNext();
+    return true;
+  }
+
+  virtual const DataBatch &Value(void) const {
+    if (ring_.size() == 0) return base_->Value();
+    return *out_;
+  }
+
+  virtual void GetStats(IOStats *stats) const {
+    base_->GetStats(stats);
+  }
+
+ private:
+  // push the copy of the next batch of the base iterator to ring_[head_]
+  inline bool CopyNext() {
+    if (!base_->Next()) return false;
+    const DataBatch& src = base_->Value();
+    DataBatch& dst = ring_[head_];
+    dst.data.resize(src.data.size());
+    for (size_t i = 0; i < src.data.size(); ++i) {
+      if (dst.data[i].is_none() || dst.data[i].shape() != src.data[i].shape()) {
+        dst.data[i] = NDArray(src.data[i].shape(), ctx_, true, src.data[i].dtype());
+      }
+      // the engine orders it after the reads of the previous batch in this slot
+      CopyFromTo(src.data[i], &dst.data[i]);
+    }
+    dst.index = src.index;
+    dst.extra_data = src.extra_data;
+    dst.num_batch_padd = src.num_batch_padd;
+    return true;
+  }
+
+  /*! \brief prefetcher parameters */
+  PrefetcherParam param_;
+  /*! \brief the base iterator, whose batches are in host memory */
+  std::unique_ptr<IIterator<DataBatch> > base_;
+  /*! \brief the device */
+  Context ctx_;
+  /*! \brief the batches on the device */
+  std::vector<DataBatch> ring_;
+  /*! \brief the slot the next batch is copied to */
+  size_t head_;
+  /*! \brief the current batch */
+  DataBatch *out_;
+  /*! \brief whether the copy of the next batch is pushed */
+  bool has_next_;
+  /*! \brief periodic log of the stats, if profiled */
+  IOStatsLogger logger_;
 };
 }  // namespace io
 }  // namespace mxnet
@@ -0,0 +1,166 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file iter_stats.h
+ * \brief timers and queue counters of the stages of the data iterators
+ */
+#ifndef MXNET_IO_ITER_STATS_H_
+#define MXNET_IO_ITER_STATS_H_
+
+#include <mxnet/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <dmlc/timer.h>
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <utility>
+
+namespace mxnet {
+namespace io {
+/*! \brief whether the stages are profiled, set by MXNET_IO_PROFILE */
+inline bool IOProfileEnabled() {
+  static const bool enabled = dmlc::GetEnv("MXNET_IO_PROFILE", 0) != 0;
+  return enabled;
+}
+
+/*!
+ * \brief the time spent in a stage and the number of items it processed,
+ *  accumulated over all threads. All functions are thread safe.
+ *
+ * \code
+ * double start = stage.Start();
+ * ... process n items
+ * stage.Stop(start, n);
+ * \endcode
+ */
+class IOStage {
+ public:
+  explicit IOStage(const std::string& name) : name_(name), usec_(0), count_(0) {}
+  /*! \return the start time, or 0 if not profiling */
+  inline double Start() const {
+    return IOProfileEnabled() ? dmlc::GetTime() : 0.0;
+  }
+  /*! \brief add the time since start and n items */
+  inline void Stop(double start, size_t n = 1) {
+    if (!IOProfileEnabled()) return;
+    Add(dmlc::GetTime() - start, n);
+  }
+  /*! \brief add the time in seconds and n items */
+  inline void Add(double sec, size_t n) {
+    if (!IOProfileEnabled()) return;
+    usec_ += static_cast<uint64_t>(sec * 1e6);
+    count_ += n;
+  }
+  /*! \brief append name.time in seconds and name.count */
+  inline void Append(IOStats *stats) const {
+    stats->emplace_back(name_ + ".time", usec_ * 1e-6);
+    stats->emplace_back(name_ + ".count", static_cast<double>(count_));
+  }
+
+ private:
+  std::string name_;
+  std::atomic<uint64_t> usec_, count_;
+};
+
+/*!
+ * \brief counters of a prefetch queue between a producer thread and the
+ *  consumer. The occupancy is sampled whenever the consumer asks for an item,
+ *  an empty queue means the consumer is starved.
+ */
+class IOQueueStats {
+ public:
+  explicit IOQueueStats(const std::string& name)
+      : name_(name), produced_(0), consumed_(0), samples_(0), occupied_(0),
+        empty_(0), wait_(name + ".wait") {}
+  /*! \brief called by the producer after an item is ready */
+  inline void Produced() {
+    if (IOProfileEnabled()) ++produced_;
+  }
+  /*! \brief called by the consumer before it waits for an item, returns the start time */
+  inline double Request() {
+    if (!IOProfileEnabled()) return 0.0;
+    int64_t n = static_cast<int64_t>(produced_) - static_cast<int64_t>(consumed_);
+    if (n <= 0) {
+      ++empty_;
+      n = 0;
+    }
+    ++samples_;
+    occupied_ += n;
+    return wait_.Start();
+  }
+  /*! \brief called by the consumer after it got an item, or the end */
+  inline void Received(double start, bool has_item) {
+    if (!IOProfileEnabled()) return;
+    if (has_item) ++consumed_;
+    wait_.Stop(start, has_item ? 1 : 0);
+  }
+  /*! \brief called after the producer is reset, which drops the queued items */
+  inline void Reset() {
+    consumed_ = produced_.load();
+  }
+  /*!
+   * \brief append name.wait.time, the seconds the consumer waited,
+   *  name.occupancy, the mean number of ready items, and name.empty, the
+   *  number of requests which found no ready item
+   */
+  inline void Append(IOStats *stats) const {
+    wait_.Append(stats);
+    stats->emplace_back(name_ + ".occupancy",
+                        samples_ == 0 ? 0.0 : static_cast<double>(occupied_) / samples_);
+    stats->emplace_back(name_ + ".empty", static_cast<double>(empty_));
+  }
+
+ private:
+  std::string name_;
+  std::atomic<uint64_t> produced_, consumed_, samples_, occupied_, empty_;
+  IOStage wait_;
+};
+
+/*!
+ * \brief log the stats of an iterator every MXNET_IO_PROFILE_INTERVAL seconds
+ */
+class IOStatsLogger {
+ public:
+  IOStatsLogger()
+      : interval_(dmlc::GetEnv("MXNET_IO_PROFILE_INTERVAL", 60)),
+        last_(dmlc::GetTime()) {}
+  /*! \brief log the stats of iter if the interval passed */
+  template<typename DType>
+  inline void MaybeLog(const IIterator<DType> &iter) {
+    if (!IOProfileEnabled() || interval_ <= 0) return;
+    double now = dmlc::GetTime();
+    if (now - last_ < interval_) return;
+    last_ = now;
+    IOStats stats;
+    iter.GetStats(&stats);
+    // "stage ms x count" for the timers, and the queue counters as they are
+    std::ostringstream os;
+    os << "IO stats:";
+    const std::string kTime = ".time";
+    for (size_t i = 0; i < stats.size(); ++i) {
+      const std::string& key = stats[i].first;
+      os << (i == 0 ? " " : ", ");
+      if (key.length() > kTime.length() && i + 1 < stats.size() &&
+          key.compare(key.length() - kTime.length(), kTime.length(), kTime) == 0) {
+        // name.time followed by name.count
+        double count = stats[i + 1].second;
+        os << key.substr(0, key.length() - kTime.length()) << " "
+           << (count == 0 ? 0.0 : stats[i].second * 1e3 / count) << " ms x " << count;
+        ++i;
+      } else {
+        os << key << " " << stats[i].second;
+      }
+    }
+    LOG(INFO) << os.str();
+  }
+
+ private:
+  /*! \brief seconds between two logs, 0 to disable */
+  int interval_;
+  /*! \brief the time of the last log */
+  double last_;
+};
+}  // namespace io
+}  // namespace mxnet
+#endif  // MXNET_IO_ITER_STATS_H_
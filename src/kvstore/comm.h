@@ -9,6 +9,9 @@
 #include <limits>
 #include <vector>
 #include "mxnet/ndarray.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif  // defined(__SSE2__)
 namespace mxnet {
 namespace kvstore {
 /**
@@ -49,6 +52,12 @@ class CommCPU : public Comm {
   CommCPU() {
     nthread_reduction_ = dmlc::GetEnv("MXNET_KVSTORE_REDUCTION_NTHREADS", 4);
     bigarray_bound_ = dmlc::GetEnv("MXNET_KVSTORE_BIGARRAY_BOUND", 1000 * 1000);
+    pipeline_reduce_ = dmlc::GetEnv("MXNET_KVSTORE_REDUCE_PIPELINE", 1) != 0;
+    reduce_chunk_ = dmlc::GetEnv("MXNET_KVSTORE_REDUCE_CHUNK", 1 << 18);
+    num_staging_ = dmlc::GetEnv("MXNET_KVSTORE_REDUCE_NUM_STAGING", 4);
+    CHECK_GT(reduce_chunk_, 0U);
+    CHECK_GT(num_staging_, 0);
+    next_staging_ = 0;
   }
   virtual ~CommCPU() { }
 
@@ -63,6 +72,10 @@ class CommCPU : public Comm {
     if (src.size() == 1) {
       return src[0];
     }
+    if (pipeline_reduce_ && src[0].shape().Size() >= bigarray_bound_ &&
+        AllReal(src)) {
+      return ReducePipelined(key, src, priority);
+    }
     std::vector<Engine::VarHandle> const_vars(src.size() - 1);
     std::vector<NDArray> reduce(src.size());
     auto& buf = merge_buf_[key];
@@ -103,6 +116,117 @@ class CommCPU : public Comm {
   }
 
  private:
+  /**
+   * \brief reduce big arrays chunk by chunk.
+   *
+   * Instead of copying every source into its own full-size buffer and
+   * summing after all copies are done, each chunk of a non-CPU source is
+   * copied into a slot of a small staging pool, and summed into the merge
+   * buffer as soon as it lands. So the copy of the next chunk overlaps the
+   * summation of the current one, and the extra memory is bounded by the pool
+   * size. Sources already in CPU memory are summed directly without copy, all
+   * in one pass over the merge buffer.
+   */
+  const NDArray& ReducePipelined(int key, const std::vector<NDArray>& src,
+                                 int priority) {
+    auto& buf = merge_buf_[key];
+    CopyFromTo(src[0], &buf.merged, priority);
+    size_t total = buf.merged.shape().Size();
+    TShape flat = mshadow::Shape1(total);
+    NDArray merged = buf.merged.Reshape(flat);
+
+    if (staging_.empty()) {
+      staging_.resize(num_staging_);
+      for (auto& stage : staging_) {
+        stage = NDArray(mshadow::Shape1(reduce_chunk_), pinned_ctx_);
+      }
+    }
+    std::vector<NDArray> cpu_src = {merged};
+    std::vector<Engine::VarHandle> cpu_vars;
+    for (size_t i = 1; i < src.size(); ++i) {
+      if (src[i].ctx().dev_mask() == cpu::kDevMask) {
+        cpu_src.push_back(src[i].Reshape(flat));
+        cpu_vars.push_back(src[i].var());
+      }
+    }
+    if (cpu_src.size() > 1) {
+      Engine::Get()->PushSync([cpu_src, this](RunContext rctx) {
+          ReduceSumCPU(cpu_src);
+        }, Context::CPU(), cpu_vars, {merged.var()},
+        FnProperty::kCPUPrioritized, priority);
+    }
+    for (size_t i = 1; i < src.size(); ++i) {
+      if (src[i].ctx().dev_mask() == cpu::kDevMask) continue;
+      NDArray in = src[i].Reshape(flat);
+      for (size_t begin = 0; begin < total; begin += reduce_chunk_) {
+        size_t end = std::min(begin + reduce_chunk_, total);
+        // reusing a slot waits until its previous summation is done
+        NDArray stage = staging_[next_staging_].Slice(0, end - begin);
+        next_staging_ = (next_staging_ + 1) % staging_.size();
+        CopyFromTo(in.Slice(begin, end), &stage, priority);
+        AccumulateAsync(stage, merged.Slice(begin, end), priority);
+      }
+    }
+    return buf.merged;
+  }
+  /**
+   * \brief whether all sources are real_t, which the pipelined reduce sums
+   * without conversion
+   */
+  inline static bool AllReal(const std::vector<NDArray>& src) {
+    for (const auto& s : src) {
+      if (s.dtype() != mshadow::default_type_flag) return false;
+    }
+    return true;
+  }
+  /**
+   * \brief push dst += src into the engine, both are 1-D arrays in CPU memory
+   */
+  inline void AccumulateAsync(const NDArray& src, const NDArray& dst,
+                              int priority) {
+    Engine::Get()->PushSync([src, dst, this](RunContext rctx) {
+        real_t* out = dst.data().FlatTo2D<cpu, real_t>().dptr_;
+        const real_t* in = src.data().FlatTo2D<cpu, real_t>().dptr_;
+        size_t total = dst.shape().Size();
+        const size_t step = std::min(bigarray_bound_, static_cast<size_t>(4 << 10));
+        long ntask = (total + step - 1) / step; // NOLINT(*)
+        if (total < bigarray_bound_ || nthread_reduction_ <= 1) {
+          AccumulateCPU(out, in, total);
+        } else {
+          #pragma omp parallel for schedule(static) num_threads(nthread_reduction_)
+          for (long j = 0; j < ntask; ++j) { // NOLINT(*)
+            size_t k = static_cast<size_t>(j);
+            size_t begin = std::min(k * step, total);
+            size_t end = std::min((k + 1) * step, total);
+            AccumulateCPU(out + begin, in + begin, end - begin);
+          }
+        }
+      }, Context::CPU(), {src.var()}, {dst.var()},
+      FnProperty::kCPUPrioritized, priority);
+  }
+  /**
+   * \brief dst[i] += src[i], vectorized
+   */
+  inline static void AccumulateCPU(real_t* dst, const real_t* src, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    if (sizeof(real_t) == sizeof(float)) {
+      float* d = reinterpret_cast<float*>(dst);
+      const float* s = reinterpret_cast<const float*>(src);
+      for (; i + 16 <= size; i += 16) {
+        __m128 d0 = _mm_add_ps(_mm_loadu_ps(d + i), _mm_loadu_ps(s + i));
+        __m128 d1 = _mm_add_ps(_mm_loadu_ps(d + i + 4), _mm_loadu_ps(s + i + 4));
+        __m128 d2 = _mm_add_ps(_mm_loadu_ps(d + i + 8), _mm_loadu_ps(s + i + 8));
+        __m128 d3 = _mm_add_ps(_mm_loadu_ps(d + i + 12), _mm_loadu_ps(s + i + 12));
+        _mm_storeu_ps(d + i, d0);
+        _mm_storeu_ps(d + i + 4, d1);
+        _mm_storeu_ps(d + i + 8, d2);
+        _mm_storeu_ps(d + i + 12, d3);
+      }
+    }
+#endif  // defined(__SSE2__)
+    for (; i < size; ++i) dst[i] += src[i];
+  }
   inline static void ReduceSumCPU(
       const std::vector<real_t*> &dptr, size_t offset, index_t size) {
     using namespace mshadow;  // NOLINT(*)
@@ -173,6 +297,16 @@ class CommCPU : public Comm {
   std::unordered_map<int, BufferEntry> merge_buf_;
   size_t bigarray_bound_;
   int nthread_reduction_;
+  /// \brief whether to reduce big arrays chunk by chunk
+  bool pipeline_reduce_;
+  /// \brief the number of elements of a chunk
+  size_t reduce_chunk_;
+  /// \brief the number of slots in the staging pool
+  int num_staging_;
+  /// \brief the staging pool for chunks copied from devices
+  std::vector<NDArray> staging_;
+  /// \brief the next slot to use in the staging pool
+  size_t next_staging_;
 };
 
 /**
@@ -6,7 +6,10 @@
 #include <mxnet/kvstore.h>
 #include <stdlib.h>
 #include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <string>
 #include "./kvstore_local.h"
+#include "./kvstore_dist_allreduce.h"
 // #include "./kvstore_device.h"
 #if MXNET_USE_DIST_KVSTORE
 #include "./kvstore_dist.h"
@@ -26,10 +29,19 @@ KVStore* KVStore::Create(const char *type_name) {
     use_device_comm = true;
   }
 
-  if (has("dist")) {
+  if (has("dist_allreduce")) {
+    // ring allreduce among workers, no parameter server is needed
+    kv = new kvstore::KVStoreDistAllreduce(use_device_comm);
+  } else if (has("dist")) {
 #if MXNET_USE_DIST_KVSTORE
     kv = new kvstore::KVStoreDist(use_device_comm);
-    if (!has("_async") && kv->IsWorkerNode() && kv->get_rank() == 0) {
+    if (has("_ssp") && kv->IsWorkerNode() && kv->get_rank() == 0) {
+      // configure the server to be the bounded staleness mode
+      int staleness = dmlc::GetEnv("MXNET_KVSTORE_STALENESS", 1);
+      CHECK_GE(staleness, 0) << "invalid MXNET_KVSTORE_STALENESS " << staleness;
+      kv->SendCommandToServers(kvstore::kSSPMode, std::to_string(staleness));
+    } else if (!has("_async") && !has("_ssp") && kv->IsWorkerNode() &&
+               kv->get_rank() == 0) {
       // configure the server to be the sync mode
       kv->SendCommandToServers(kvstore::kSyncMode, "");
     }
@@ -7,6 +7,10 @@
 #define MXNET_KVSTORE_KVSTORE_DIST_H_
 #include <string>
 #include <vector>
+#include <sstream>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
 #include "./kvstore_local.h"
 #include "mxnet/engine.h"
 #include "ps/ps.h"
@@ -38,6 +42,7 @@ class KVStoreDist : public KVStoreLocal {
       }
     }
     bigarray_bound_ = dmlc::GetEnv("MXNET_KVSTORE_BIGARRAY_BOUND", 1000 * 1000);
+    fp16_wire_ = dmlc::GetEnv("MXNET_KVSTORE_DIST_FP16", 0) != 0;
   }
 
   virtual ~KVStoreDist() {
@@ -57,22 +62,12 @@ class KVStoreDist : public KVStoreLocal {
 
   void Init(const std::vector<int>& keys,
             const std::vector<NDArray>& values) override {
-    CheckUnique(keys);
-    for (size_t i = 0; i < keys.size(); ++i) {
-      comm_->Init(keys[i], values[i].shape());
-    }
-    if (get_rank() == 0) {
-      Push_(keys, values, 0, false);
-      // wait until the push is finished
-      for (const auto& v : values) {
-        v.WaitToWrite();
-      }
-    } else {
-      // do nothing
-    }
-    if (!ps::Postoffice::Get()->is_recovery()) {
-      Barrier();
-    }
+    Init_(keys, values, false);
+  }
+
+  void InitRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray>& values) override {
+    Init_(keys, values, true);
   }
 
   void Push(const std::vector<int>& keys,
@@ -97,8 +92,9 @@ class KVStoreDist : public KVStoreLocal {
         // it may happen for the first time a no-rank-0 worker pull the weight.
         recv_buf = NDArray(grouped_vals[i][0]->shape(), pinned_ctx_);
       }
-      real_t* data = static_cast<real_t*>(recv_buf.data().dptr_);
-      size_t size = recv_buf.shape().Size();
+      NDArray& wire_buf = IsFP16Wire(key) ? WireBuf(key, recv_buf.shape()) : recv_buf;
+      real_t* data = static_cast<real_t*>(wire_buf.data().dptr_);
+      size_t size = WireSize(key, recv_buf.shape().Size());
 
       auto pull_from_servers = [this, key, data, size](
           RunContext rctx, Engine::CallbackOnComplete cb) {
@@ -115,13 +111,120 @@ class KVStoreDist : public KVStoreLocal {
           pull_from_servers,
           pinned_ctx_,
           {},
-          {recv_buf.var()},
+          {wire_buf.var()},
           FnProperty::kNormal, priority);
+      if (IsFP16Wire(key)) {
+        // widen to fp32
+        NDArray received = wire_buf.Slice(0, recv_buf.shape().Size());
+        NDArray widened = recv_buf.Reshape(received.shape());
+        CopyFromTo(received, &widened, priority);
+      }
 
       comm_->Broadcast(key, recv_buf, grouped_vals[i], priority);
     }
   }
 
+  void PushRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray>& values,
+                     const std::vector<NDArray>& row_ids,
+                     int priority) override {
+    std::vector<int> uniq_keys;
+    std::vector<NDArray> rows, ids;
+    GroupRowSparse(keys, values, row_ids, &uniq_keys, &rows, &ids, priority);
+
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      int key = uniq_keys[i];
+      CHECK(row_len_.count(key)) << "row sparse push needs key " << key
+                                 << " initialized by init_row_sparse";
+      const NDArray& send_rows = rows[i];
+      const NDArray& send_ids = ids[i];
+      auto push_to_servers = [this, key, send_rows, send_ids](
+          RunContext rctx, Engine::CallbackOnComplete cb) {
+        size_t row_len = send_rows.shape()[1];
+        CHECK_EQ(row_len, row_len_[key]) << "row length mismatch of key " << key;
+        PSKV& pskv = EncodeKey(key, row_len * num_rows_[key]);
+        const real_t* id = send_ids.data().FlatTo1D<cpu, real_t>().dptr_;
+        const real_t* data = send_rows.data().FlatTo2D<cpu, real_t>().dptr_;
+        // sort the rows and sum the duplicated ones
+        std::vector<size_t> uniq, pos;
+        UniqueRows(id, send_ids.shape()[0], &uniq, &pos);
+        ps::SArray<real_t> vals(uniq.size() * row_len, 0);
+        for (size_t j = 0; j < pos.size(); ++j) {
+          real_t* dst = vals.data() + pos[j] * row_len;
+          for (size_t k = 0; k < row_len; ++k) dst[k] += data[j * row_len + k];
+        }
+        ps::SArray<ps::Key> ps_keys;
+        ps::SArray<int> lens;
+        // every server holding a part of the key gets the push, even without
+        // rows, since the servers count the pushes of every worker
+        EncodeRows(pskv, uniq, row_len, true, &ps_keys, &lens);
+        CHECK_NOTNULL(ps_worker_)->ZPush(
+            ps_keys, vals, lens, kRowSparse, [cb]() { cb(); });
+      };
+      Engine::Get()->PushAsync(
+          push_to_servers,
+          pinned_ctx_,
+          {send_rows.var(), send_ids.var()},
+          {},
+          FnProperty::kNormal, priority);
+    }
+  }
+
+  void PullRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray*>& values,
+                     const std::vector<NDArray>& row_ids,
+                     int priority) override {
+    CHECK_EQ(keys.size(), values.size());
+    CHECK_EQ(keys.size(), row_ids.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      int key = keys[i];
+      CHECK(row_len_.count(key)) << "row sparse pull needs key " << key
+                                 << " initialized by init_row_sparse";
+      NDArray out = AsRows(*values[i]);
+      NDArray recv_ids(mshadow::Shape1(out.shape()[0]), pinned_ctx_);
+      NDArray recv_rows(out.shape(), pinned_ctx_);
+      CopyFromTo(row_ids[i].Reshape(recv_ids.shape()), &recv_ids, priority);
+
+      auto pull_from_servers = [this, key, recv_rows, recv_ids](
+          RunContext rctx, Engine::CallbackOnComplete cb) {
+        size_t row_len = recv_rows.shape()[1];
+        CHECK_EQ(row_len, row_len_[key]) << "row length mismatch of key " << key;
+        PSKV& pskv = EncodeKey(key, row_len * num_rows_[key]);
+        const real_t* id = recv_ids.data().FlatTo1D<cpu, real_t>().dptr_;
+        auto pos = std::make_shared<std::vector<size_t>>();
+        std::vector<size_t> uniq;
+        UniqueRows(id, recv_ids.shape()[0], &uniq, pos.get());
+        if (uniq.empty()) {
+          cb();
+          return;
+        }
+        ps::SArray<ps::Key> ps_keys;
+        ps::SArray<int> lens;
+        EncodeRows(pskv, uniq, row_len, false, &ps_keys, &lens);
+        auto vals = new ps::SArray<real_t>();
+        real_t* data = recv_rows.data().FlatTo2D<cpu, real_t>().dptr_;
+        CHECK_NOTNULL(ps_worker_)->ZPull(
+            ps_keys, vals, nullptr, kRowSparse,
+            [vals, pos, data, row_len, cb]() {
+              // copy the unique rows back to the requested positions
+              for (size_t j = 0; j < pos->size(); ++j) {
+                const real_t* src = vals->data() + (*pos)[j] * row_len;
+                std::copy(src, src + row_len, data + j * row_len);
+              }
+              delete vals;
+              cb();
+            });
+      };
+      CHECK_NOTNULL(Engine::Get())->PushAsync(
+          pull_from_servers,
+          pinned_ctx_,
+          {recv_ids.var()},
+          {recv_rows.var()},
+          FnProperty::kNormal, priority);
+      CopyFromTo(recv_rows, &out, priority);
+    }
+  }
+
   void set_updater(const Updater& updater) override {
     CHECK(updater) << "invalid updater";
     if (IsServerNode()) {
@@ -131,6 +234,15 @@ class KVStoreDist : public KVStoreLocal {
     }
   }
 
+  void set_row_sparse_updater(const RowSparseUpdater& updater) override {
+    CHECK(updater) << "invalid updater";
+    if (IsServerNode()) {
+      CHECK_NOTNULL(server_)->set_row_sparse_updater(updater);
+    } else {
+      row_sparse_updater_ = updater;
+    }
+  }
+
   void Barrier() override {
     ps::Postoffice::Get()->Barrier(ps::kWorkerGroup);
   }
@@ -178,6 +290,47 @@ class KVStoreDist : public KVStoreLocal {
   }
 
  private:
+  void Init_(const std::vector<int>& keys,
+             const std::vector<NDArray>& values,
+             bool row_sparse) {
+    CheckUnique(keys);
+    std::ostringstream key_info;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      int key = keys[i];
+      comm_->Init(key, values[i].shape());
+      bool fp16_value = !values[i].is_none() && values[i].dtype() == mshadow::kFloat16;
+      if (row_sparse) {
+        // partitions are aligned to rows for row sparse push and pull, which
+        // are always sent in fp32
+        CHECK(!fp16_value) << "row sparse keys do not support fp16 values";
+        wire_type_[key] = mshadow::kFloat32;
+        row_len_[key] = RowLength(values[i].shape());
+        num_rows_[key] = values[i].shape().Size() / row_len_[key];
+      } else {
+        // keys of fp16 values, or all keys if MXNET_KVSTORE_DIST_FP16 is set,
+        // are sent in fp16
+        wire_type_[key] = fp16_wire_ || fp16_value ? mshadow::kFloat16 : mshadow::kFloat32;
+      }
+      key_info << key << ' ' << wire_type_[key] << ' '
+               << (row_sparse ? row_len_[key] : 0) << ' ';
+    }
+    if (get_rank() == 0) {
+      // tell the servers the wire type and row length of every key before the
+      // first push
+      SendCommandToServers(kSetKeyInfo, key_info.str());
+      Push_(keys, values, 0, false);
+      // wait until the push is finished
+      for (const auto& v : values) {
+        v.WaitToWrite();
+      }
+    } else {
+      // do nothing
+    }
+    if (!ps::Postoffice::Get()->is_recovery()) {
+      Barrier();
+    }
+  }
+
   void Push_(const std::vector<int>& keys,
              const std::vector<NDArray>& values,
              int priority,
@@ -202,10 +355,16 @@ class KVStoreDist : public KVStoreLocal {
         }
         CopyFromTo(merged, &send_buf);
       }
+      NDArray& wire_buf = IsFP16Wire(key) ? WireBuf(key, send_buf.shape()) : send_buf;
+      if (IsFP16Wire(key)) {
+        // narrow to fp16
+        NDArray narrowed = wire_buf.Slice(0, send_buf.shape().Size());
+        CopyFromTo(send_buf.Reshape(narrowed.shape()), &narrowed, priority);
+      }
 
       // push to servers
-      size_t size = send_buf.shape().Size();
-      real_t* data = static_cast<real_t*>(send_buf.data().dptr_);
+      size_t size = WireSize(key, send_buf.shape().Size());
+      real_t* data = static_cast<real_t*>(wire_buf.data().dptr_);
       auto push_to_servers =
           [this, key, data, size](RunContext rctx, Engine::CallbackOnComplete cb) {
          // convert to ps keys
@@ -219,12 +378,43 @@ class KVStoreDist : public KVStoreLocal {
       Engine::Get()->PushAsync(
           push_to_servers,
           pinned_ctx_,
-          {send_buf.var()},
+          {wire_buf.var()},
           {},
           FnProperty::kNormal, priority);
     }
   }
 
+  /**
+   * \brief whether the values of \a key are sent in fp16
+   */
+  inline bool IsFP16Wire(int key) const {
+    auto it = wire_type_.find(key);
+    return it != wire_type_.end() && it->second == mshadow::kFloat16;
+  }
+
+  /**
+   * \brief the number of real_t slots needed to send \a size values of \a key.
+   *
+   * fp16 values are packed two per slot, so that ps-lite still sees an array
+   * of real_t, and the key partitioning in \ref EncodeKey never splits a slot.
+   */
+  inline size_t WireSize(int key, size_t size) const {
+    return IsFP16Wire(key) ? (size + 1) / 2 : size;
+  }
+
+  /**
+   * \brief the fp16 buffer of \a key, padded to a whole number of slots
+   */
+  inline NDArray& WireBuf(int key, const TShape& shape) {
+    auto& buf = wire_buf_[key];
+    if (buf.is_none()) {
+      buf = NDArray(mshadow::Shape1(WireSize(key, shape.Size()) * 2),
+                    pinned_ctx_, false, mshadow::kFloat16);
+      buf = 0.0f;
+    }
+    return buf;
+  }
+
   /**
    * \brief check if the keys are all unique
    */
@@ -242,8 +432,42 @@ class KVStoreDist : public KVStoreLocal {
     ps::SArray<ps::Key> keys;  // n keys
     ps::SArray<int> lens;  // the length of the i-th value
     int size;
+    std::vector<size_t> row_begin;  // the first row of the i-th value, n+1 entries
   };
 
+  /**
+   * \brief encode the sorted unique rows of a key into ps keys.
+   *
+   * The row is put into the high bits of the key of the server holding that
+   * row, namely ps_key = pskv.keys[i] + ((row - row_begin[i] + 1) << kRowShift).
+   * If \a every_part is set, pskv.keys[i] with no value is added for every
+   * part i, so that a request reaches every server holding a part.
+   */
+  inline void EncodeRows(const PSKV& pskv, const std::vector<size_t>& rows,
+                         size_t row_len, bool every_part,
+                         ps::SArray<ps::Key>* keys, ps::SArray<int>* lens) {
+    auto krs = ps::Postoffice::Get()->GetServerKeyRanges();
+    auto row = rows.begin();
+    for (size_t part = 0; part < pskv.keys.size(); ++part) {
+      if (every_part) {
+        keys->push_back(pskv.keys[part]);
+        lens->push_back(0);
+      }
+      int server = static_cast<int>(
+          std::upper_bound(krs.begin(), krs.end(), pskv.keys[part],
+                           [](ps::Key k, const ps::Range& r) { return k < r.end(); })
+          - krs.begin());
+      for (; row != rows.end() && *row < pskv.row_begin[part + 1]; ++row) {
+        ps::Key ps_key = pskv.keys[part] +
+            (static_cast<ps::Key>(*row - pskv.row_begin[part] + 1) << kRowShift);
+        CHECK_LT(ps_key, krs[server].end()) << "too many rows";
+        keys->push_back(ps_key);
+        lens->push_back(static_cast<int>(row_len));
+      }
+    }
+    CHECK(row == rows.end()) << "row " << *row << " out of range";
+  }
+
   /**
    * \brief cache all key partitions
    */
@@ -269,6 +493,11 @@ class KVStoreDist : public KVStoreLocal {
       int num_servers = krs.size();
       CHECK_GT(num_servers, 0);
 
+      // partitions of row sparse keys never split a row
+      size_t row_len = row_len_.count(key) ? row_len_[key] : 1;
+      CHECK_EQ(size % row_len, 0U);
+      size_t num_rows = size / row_len;
+      pskv.row_begin.push_back(0);
       // a simple heuristic for load balance
       if (size < bigarray_bound_) {
         // send it to a single random picked server
@@ -278,18 +507,20 @@ class KVStoreDist : public KVStoreLocal {
         pskv.keys.push_back(ps_key);
         pskv.lens.push_back(size);
         pskv.size = size;
+        pskv.row_begin.push_back(num_rows);
       } else {
         // parition it to all servers
         pskv.size = 0;
         for (int i = 0; i < num_servers; ++i) {
-          size_t part_size =
-              static_cast<size_t>(static_cast<double>(size)/num_servers*(i+1)) -
-              static_cast<size_t>(static_cast<double>(size)/num_servers*i);
+          size_t part_rows =
+              static_cast<size_t>(static_cast<double>(num_rows)/num_servers*(i+1)) -
+              static_cast<size_t>(static_cast<double>(num_rows)/num_servers*i);
           ps::Key ps_key = krs[i].begin() + key;
           CHECK_LT(ps_key, krs[i].end());
           pskv.keys.push_back(ps_key);
-          pskv.lens.push_back(part_size);
-          pskv.size += part_size;
+          pskv.lens.push_back(part_rows * row_len);
+          pskv.size += part_rows * row_len;
+          pskv.row_begin.push_back(pskv.row_begin.back() + part_rows);
         }
         CHECK_EQ(static_cast<size_t>(pskv.size), size);
       }
@@ -311,6 +542,16 @@ class KVStoreDist : public KVStoreLocal {
   size_t bigarray_bound_;
   /// \brief send & recver buffer
   std::unordered_map<int, NDArray> comm_buf_;
+  /// \brief send & recver buffer in fp16 for the keys sent in fp16
+  std::unordered_map<int, NDArray> wire_buf_;
+  /// \brief the type on the wire of every key
+  std::unordered_map<int, int> wire_type_;
+  /// \brief the row length of every row sparse key, in elements on the wire
+  std::unordered_map<int, size_t> row_len_;
+  /// \brief the number of rows of every row sparse key
+  std::unordered_map<int, size_t> num_rows_;
+  /// \brief whether to send all keys in fp16
+  bool fp16_wire_;
 };
 
 }  // namespace kvstore
@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2016 by Contributors
+ * @file   kvstore_dist_allreduce.h
+ * @brief  distributed implementation based on ring allreduce among workers
+ */
+#ifndef MXNET_KVSTORE_KVSTORE_DIST_ALLREDUCE_H_
+#define MXNET_KVSTORE_KVSTORE_DIST_ALLREDUCE_H_
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include "./kvstore_local.h"
+#include "./ring_allreduce.h"
+#include "mxnet/engine.h"
+
+namespace mxnet {
+namespace kvstore {
+
+/**
+ * \brief distributed kvstore without parameter servers
+ *
+ * A push first reduces the values over local devices with \ref Comm, then sums
+ * the result over all workers with a ring allreduce, and finally every worker
+ * runs the updater on its own copy of the weight. Since all workers apply the
+ * same update to the same aggregated gradient, the weights stay identical.
+ *
+ * The ring requires all workers to issue the allreduces in the same order.
+ * Operations are therefore numbered in the order \ref Push is called, and a
+ * dedicated communication thread executes them strictly in that order, no
+ * matter in which order the engine makes them ready. So all workers must push
+ * the same keys in the same order, which is what data parallel training does.
+ */
+class KVStoreDistAllreduce : public KVStoreLocal {
+ public:
+  explicit KVStoreDistAllreduce(bool use_device_comm)
+      : KVStoreLocal(use_device_comm), next_seq_(0), exec_seq_(0), stop_(false) {
+    ring_ = new RingAllreduce();
+    thread_ = std::thread([this]() { this->RunComm(); });
+  }
+
+  virtual ~KVStoreDistAllreduce() {
+    Engine::Get()->WaitForAll();
+    if (barrier_before_exit_) Barrier();
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    delete ring_;
+  }
+
+  void Init(const std::vector<int>& keys,
+            const std::vector<NDArray>& values) override {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      int key = keys[i];
+      CHECK(local_.find(key) == local_.end())
+          << "duplicate init of key " << key;
+      comm_->Init(key, values[i].shape());
+      // only rank 0's values are used: the others contribute zeros to the sum
+      NDArray init(values[i].shape(), pinned_ctx_);
+      if (get_rank() == 0) {
+        CopyFromTo(values[i], &init);
+      } else {
+        init = 0.0f;
+      }
+      Allreduce(init, 0);
+      init.WaitToRead();
+      local_[key] = init;
+    }
+  }
+
+  void Push(const std::vector<int>& keys,
+            const std::vector<NDArray>& values,
+            int priority) override {
+    std::vector<int> uniq_keys;
+    std::vector<std::vector<NDArray> > grouped_vals;
+    GroupKVPairs(keys, values, &uniq_keys, &grouped_vals);
+
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      int key = uniq_keys[i];
+      // reduce over local devices first
+      const NDArray& merged = comm_->Reduce(key, grouped_vals[i], priority);
+      auto& buf = comm_buf_[key];
+      if (buf.is_none()) {
+        buf = NDArray(merged.shape(), pinned_ctx_);
+      }
+      CopyFromTo(merged, &buf, priority);
+      // then over workers
+      Allreduce(buf, priority);
+
+      NDArray& local = local_[key];
+      if (updater_ != nullptr) {
+        CHECK(!local.is_none()) << "key " << key << " has not been inited";
+        updater_(key, buf, &local);
+      } else {
+        local = buf;
+      }
+    }
+  }
+
+  void PushRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray>& values,
+                     const std::vector<NDArray>& row_ids,
+                     int priority) override {
+    // workers push different rows, so the rows are summed as a dense array
+    std::vector<int> uniq_keys;
+    std::vector<NDArray> rows, ids;
+    GroupRowSparse(keys, values, row_ids, &uniq_keys, &rows, &ids, priority);
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      int key = uniq_keys[i];
+      const NDArray& local = local_[key];
+      CHECK(!local.is_none()) << "key " << key << " has not been inited";
+      NDArray& grad = sparse_grad_[key];
+      if (grad.is_none()) {
+        grad = NDArray(local.shape(), pinned_ctx_);
+        grad = 0.0f;
+      }
+      ScatterAddRows(ids[i], rows[i], AsRows(grad), priority);
+      Push({key}, {grad}, priority);
+      ZeroRows(ids[i], AsRows(grad), priority);
+    }
+  }
+
+  void Barrier() override {
+    NDArray flag(TShape(mshadow::Shape1(1)), pinned_ctx_);
+    flag = 0.0f;
+    Allreduce(flag, 0);
+    flag.WaitToRead();
+  }
+
+  int get_group_size() const override { return ring_->num_workers(); }
+
+  int get_rank() const override { return ring_->rank(); }
+
+ private:
+  /**
+   * \brief an allreduce which has been made ready by the engine
+   */
+  struct Task {
+    real_t* data;
+    size_t size;
+    Engine::CallbackOnComplete cb;
+  };
+
+  /**
+   * \brief push an allreduce on \a arr into the engine
+   */
+  void Allreduce(const NDArray& arr, int priority) {
+    // sequence numbers are assigned in the program order, which is identical
+    // on all workers
+    uint64_t seq = next_seq_++;
+    real_t* data = static_cast<real_t*>(arr.data().dptr_);
+    size_t size = arr.shape().Size();
+    auto allreduce = [this, seq, data, size](
+        RunContext rctx, Engine::CallbackOnComplete cb) {
+      std::lock_guard<std::mutex> lk(mu_);
+      ready_[seq] = Task{data, size, cb};
+      cv_.notify_all();
+    };
+    Engine::Get()->PushAsync(
+        allreduce,
+        pinned_ctx_,
+        {},
+        {arr.var()},
+        FnProperty::kNormal, priority);
+  }
+
+  /**
+   * \brief the communication thread, runs allreduces in sequence order
+   */
+  void RunComm() {
+    while (true) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [this]() {
+            return stop_ || ready_.count(exec_seq_) != 0;
+          });
+        if (ready_.count(exec_seq_) == 0) break;
+        task = ready_[exec_seq_];
+        ready_.erase(exec_seq_);
+        ++exec_seq_;
+      }
+      ring_->Allreduce(task.data, task.size);
+      task.cb();
+    }
+  }
+
+  /// \brief the ring among workers
+  RingAllreduce* ring_;
+  /// \brief pinned buffers for the allreduce
+  std::unordered_map<int, NDArray> comm_buf_;
+  /// \brief dense gradient buffers for row sparse pushes, which are allreduced
+  std::unordered_map<int, NDArray> sparse_grad_;
+  /// \brief the sequence number of the next issued allreduce
+  uint64_t next_seq_;
+  /// \brief the sequence number of the next executed allreduce
+  uint64_t exec_seq_;
+  /// \brief allreduces made ready by the engine, by sequence number
+  std::map<uint64_t, Task> ready_;
+  bool stop_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+}  // namespace kvstore
+}  // namespace mxnet
+#endif  // MXNET_KVSTORE_KVSTORE_DIST_ALLREDUCE_H_
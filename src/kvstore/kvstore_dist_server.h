@@ -7,20 +7,36 @@
 #define MXNET_KVSTORE_KVSTORE_DIST_SERVER_H_
 #include <queue>
 #include <string>
+#include <sstream>
 #include <mutex>
 #include <condition_variable>
 #include <memory>
 #include <functional>
 #include <future>
+#include <chrono>
 #include <vector>
+#include <algorithm>
 #include "ps/ps.h"
 #include "mxnet/kvstore.h"
+#include "./row_sparse.h"
 
 namespace mxnet {
 namespace kvstore {
 
 static const int kStopServer = -1;
 static const int kSyncMode = -2;
+static const int kSetKeyInfo = -3;
+static const int kSSPMode = -4;
+
+/**
+ * \brief the data command of row sparse pushes and pulls
+ */
+static const int kRowSparse = 1;
+/**
+ * \brief a row sparse request puts row+1 into the bits above kRowShift of the
+ * ps key, where row is relative to the rows held by the server
+ */
+static const int kRowShift = 32;
 
 /**
  * \brief executor runs a function using the thread called \ref Start
@@ -94,6 +110,10 @@ class KVStoreDistServer {
     ps_server_->set_request_handle(
         std::bind(&KVStoreDistServer::DataHandle, this, _1, _2, _3));
     sync_mode_ = false;
+    ssp_mode_ = false;
+    staleness_ = 0;
+    ssp_log_interval_ = dmlc::GetEnv("MXNET_KVSTORE_SSP_LOG_INTERVAL", 60);
+    last_ssp_log_ = std::chrono::steady_clock::now();
   }
 
   ~KVStoreDistServer() {
@@ -110,6 +130,11 @@ class KVStoreDistServer {
     updater_ = updater;
   }
 
+  void set_row_sparse_updater(const KVStore::RowSparseUpdater& updater)  {
+    CHECK(updater);
+    row_sparse_updater_ = updater;
+  }
+
   /**
    * \brief blocked until received the command \a kSyncMode
    */
@@ -120,9 +145,27 @@ class KVStoreDistServer {
  private:
   void CommandHandle(const ps::SimpleData& recved, ps::SimpleApp* app) {
     if (recved.head == kStopServer) {
+      if (ssp_mode_) LogSSPStats();
       exec_.Stop();
     } else if (recved.head == kSyncMode) {
       sync_mode_ = true;
+    } else if (recved.head == kSSPMode) {
+      // asynchronous pushes, but a pull waits until the puller is at most
+      // staleness_ pushes ahead of the slowest worker on that key
+      ssp_mode_ = true;
+      staleness_ = std::stoi(recved.body);
+      LOG(INFO) << "server " << ps::MyRank()
+                << ": bounded staleness mode, staleness = " << staleness_;
+    } else if (recved.head == kSetKeyInfo) {
+      // triples of "key type row_len", row_len is 0 for keys not pushed by rows
+      std::istringstream is(recved.body);
+      int key, type;
+      size_t row_len;
+      std::lock_guard<std::mutex> lk(key_info_mu_);
+      while (is >> key >> type >> row_len) {
+        wire_type_[key] = type;
+        if (row_len > 0) row_len_[key] = row_len;
+      }
     } else {
       // let the main thread to execute ctrl, which is necessary for python
       exec_.Exec([this, recved]() {
@@ -136,6 +179,10 @@ class KVStoreDistServer {
   void DataHandle(const ps::KVMeta& req_meta,
                   const ps::KVPairs<real_t>& req_data,
                   ps::KVServer<real_t>* server) {
+    if (req_meta.cmd == kRowSparse) {
+      DataHandleRowSparse(req_meta, req_data, server);
+      return;
+    }
     // do some check
     CHECK_EQ(req_data.keys.size(), (size_t)1);
     if (req_meta.push) {
@@ -145,16 +192,31 @@ class KVStoreDistServer {
 
     int key = DecodeKey(req_data.keys[0]);
     auto& stored = store_[key];
+    // fp16 values are packed two per slot, the store always keeps fp32
+    bool fp16 = IsFP16(key);
 
     // there used several WaitToRead, this is because \a recved's memory
     // could be deallocated when this function returns. so we need to make sure
     // the operators with \a NDArray are actually finished
     if (req_meta.push) {
-      size_t ds[] = {(size_t)req_data.lens[0]};
+      size_t ds[] = {(size_t)req_data.lens[0] * (fp16 ? 2 : 1)};
       TShape dshape(ds, ds + 1);
-      TBlob recv_blob((real_t*)req_data.vals.data(), // NOLINT(*)
-                      dshape, cpu::kDevMask);
-      NDArray recved = NDArray(recv_blob, 0);
+      NDArray recved;
+      if (fp16) {
+        TBlob recv_blob((void*)req_data.vals.data(), // NOLINT(*)
+                        dshape, cpu::kDevMask, mshadow::kFloat16);
+        auto& widened = decode_buf_[key];
+        if (widened.is_none()) {
+          widened = NDArray(dshape, Context());
+        }
+        CopyFromTo(NDArray(recv_blob, 0), &widened, 0);
+        widened.WaitToRead();
+        recved = widened;
+      } else {
+        TBlob recv_blob((real_t*)req_data.vals.data(), // NOLINT(*)
+                        dshape, cpu::kDevMask);
+        recved = NDArray(recv_blob, 0);
+      }
       if (stored.is_none()) {
         // initialization
         stored = NDArray(dshape, Context());
@@ -204,18 +266,323 @@ class KVStoreDistServer {
           });
         server->Response(req_meta);
         stored.WaitToRead();
+        if (ssp_mode_) {
+          SSPClock& ssp = ssp_clock_[key];
+          if (ssp.clock.empty()) ssp.clock.resize(ps::NumWorkers(), 0);
+          ++ssp.clock[ps::Postoffice::IDtoRank(req_meta.sender)];
+          ReleasePulls(key, server);
+        }
       }
+    } else if (ssp_mode_) {
+      // pull with bounded staleness
+      int worker = ps::Postoffice::IDtoRank(req_meta.sender);
+      SSPClock& ssp = ssp_clock_[key];
+      if (ssp.clock.empty()) ssp.clock.resize(ps::NumWorkers(), 0);
+      bool within = IsWithinStaleness(ssp, worker);
+      CountPull(worker, !within);
+      if (within) {
+        ResponsePull(req_meta, req_data.keys, key, server);
+      } else {
+        ssp.pending.push_back(PendingPull{
+            req_meta, req_data.keys, false, std::chrono::steady_clock::now()});
+      }
+      MaybeLogSSPStats();
     } else {
       // pull
-      ps::KVPairs<real_t> response;
-      CHECK(!stored.is_none()) << "init " << key << " first";
-      int len = stored.shape()[0];
-      response.keys = req_data.keys;
+      ResponsePull(req_meta, req_data.keys, key, server);
+    }
+  }
+
+  /**
+   * \brief push or pull a subset of the rows of a key
+   */
+  void DataHandleRowSparse(const ps::KVMeta& req_meta,
+                           const ps::KVPairs<real_t>& req_data,
+                           ps::KVServer<real_t>* server) {
+    size_t num = req_data.keys.size();
+    CHECK_GT(num, 0U);
+    int key = DecodeRowKey(req_data.keys[0]);
+    auto& stored = store_[key];
+    CHECK(!stored.is_none()) << "init " << key << " first";
+    size_t row_len = KeyRowLen(key);
+    CHECK_GT(row_len, 0U) << "unknown row length of key " << key;
+
+    if (req_meta.push) {
+      CHECK_EQ(req_data.lens.size(), num);
+      // keep the received rows as they are, they are summed once all the
+      // pushes arrived
+      auto& merged = row_merge_buf_[key];
+      size_t offset = 0;
+      for (size_t i = 0; i < num; ++i) {
+        // every request has a key without a value, so that the pushes of
+        // workers with no rows on this server are counted too
+        if (req_data.lens[i] == 0) continue;
+        CHECK_EQ(static_cast<size_t>(req_data.lens[i]), row_len);
+        size_t row = DecodeRow(req_data.keys[i]);
+        CHECK_LE((row + 1) * row_len, stored.shape().Size()) << "row out of range";
+        const real_t* src = req_data.vals.data() + offset;
+        merged.vals.insert(merged.vals.end(), src, src + row_len);
+        merged.rows.push_back(row);
+        offset += row_len;
+      }
+      CHECK_EQ(req_data.vals.size(), offset);
+      merged.request.push_back(req_meta);
+
+      size_t num_push = sync_mode_ ? static_cast<size_t>(ps::NumWorkers()) : 1;
+      if (merged.request.size() < num_push) return;
+      if (!merged.rows.empty()) {
+        // sum the rows of the same id, so only the pushed rows are kept
+        std::vector<size_t> uniq, pos;
+        UniqueRows(merged.rows.data(), merged.rows.size(), &uniq, &pos);
+        NDArray grad(mshadow::Shape2(uniq.size(), row_len), Context());
+        real_t* g = static_cast<real_t*>(grad.data().dptr_);
+        std::fill(g, g + uniq.size() * row_len, 0.0f);
+        for (size_t i = 0; i < pos.size(); ++i) {
+          const real_t* src = merged.vals.data() + i * row_len;
+          real_t* dst = g + pos[i] * row_len;
+          for (size_t j = 0; j < row_len; ++j) dst[j] += src[j];
+        }
+        UpdateRows(key, uniq, grad, &stored);
+      }
+      for (const auto& req : merged.request) {
+        server->Response(req);
+      }
+      merged.request.clear();
+      merged.rows.clear();
+      merged.vals.clear();
+      stored.WaitToRead();
+      if (ssp_mode_) {
+        SSPClock& ssp = ssp_clock_[key];
+        if (ssp.clock.empty()) ssp.clock.resize(ps::NumWorkers(), 0);
+        ++ssp.clock[ps::Postoffice::IDtoRank(req_meta.sender)];
+        ReleasePulls(key, server);
+      }
+    } else if (ssp_mode_) {
+      int worker = ps::Postoffice::IDtoRank(req_meta.sender);
+      SSPClock& ssp = ssp_clock_[key];
+      if (ssp.clock.empty()) ssp.clock.resize(ps::NumWorkers(), 0);
+      bool within = IsWithinStaleness(ssp, worker);
+      CountPull(worker, !within);
+      if (within) {
+        ResponseRowSparsePull(req_meta, req_data.keys, key, server);
+      } else {
+        ssp.pending.push_back(PendingPull{
+            req_meta, req_data.keys, true, std::chrono::steady_clock::now()});
+      }
+      MaybeLogSSPStats();
+    } else {
+      ResponseRowSparsePull(req_meta, req_data.keys, key, server);
+    }
+  }
+
+  /**
+   * \brief apply the summed pushed rows \a grad, of the sorted row ids \a rows,
+   * to the stored value of \a key
+   */
+  void UpdateRows(int key, const std::vector<size_t>& rows, const NDArray& grad,
+                  NDArray* stored) {
+    size_t row_len = grad.shape()[1];
+    const real_t* g = static_cast<const real_t*>(grad.data().dptr_);
+    if (row_sparse_updater_) {
+      // only the pushed rows are read and updated
+      NDArray counted(mshadow::Shape1(rows.size() + 1), Context(),
+                      false, mshadow::kInt32);
+      int* cnt = static_cast<int*>(counted.data().dptr_);
+      cnt[0] = static_cast<int>(rows.size());
+      std::copy(rows.begin(), rows.end(), cnt + 1);
+      exec_.Exec([this, key, &grad, &counted, stored](){
+          CHECK(row_sparse_updater_);
+          row_sparse_updater_(key, grad, counted, stored);
+        });
+    } else if (updater_) {
+      // the updater takes a dense gradient, zero except on the pushed rows
+      NDArray dense(stored->shape(), Context());
+      real_t* d = static_cast<real_t*>(dense.data().dptr_);
+      std::fill(d, d + stored->shape().Size(), 0.0f);
+      for (size_t i = 0; i < rows.size(); ++i) {
+        std::copy(g + i * row_len, g + (i + 1) * row_len, d + rows[i] * row_len);
+      }
+      exec_.Exec([this, key, &dense, stored](){
+          CHECK(updater_);
+          updater_(key, dense, stored);
+        });
+    } else {
+      // if no updater, just copy the pushed rows
+      CHECK(sync_mode_) << "updater is not set";
+      stored->WaitToWrite();
+      real_t* dst = static_cast<real_t*>(stored->data().dptr_);
+      for (size_t i = 0; i < rows.size(); ++i) {
+        std::copy(g + i * row_len, g + (i + 1) * row_len, dst + rows[i] * row_len);
+      }
+    }
+  }
+
+  /**
+   * \brief respond a row sparse pull request of \a key with the stored rows
+   */
+  void ResponseRowSparsePull(const ps::KVMeta& req_meta,
+                             const ps::SArray<ps::Key>& keys,
+                             int key,
+                             ps::KVServer<real_t>* server) {
+    auto& stored = store_[key];
+    size_t row_len = KeyRowLen(key);
+    stored.WaitToRead();
+    const real_t* src = static_cast<const real_t*>(stored.data().dptr_);
+    ps::KVPairs<real_t> response;
+    response.keys = keys;
+    response.lens.resize(keys.size(), static_cast<int>(row_len));
+    response.vals.resize(keys.size() * row_len);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      size_t row = DecodeRow(keys[i]);
+      CHECK_LE((row + 1) * row_len, stored.shape().Size()) << "row out of range";
+      std::copy(src + row * row_len, src + (row + 1) * row_len,
+                response.vals.data() + i * row_len);
+    }
+    server->Response(req_meta, response);
+  }
+
+  /**
+   * \brief respond a pull request of \a key with the stored value
+   */
+  void ResponsePull(const ps::KVMeta& req_meta,
+                    const ps::SArray<ps::Key>& keys,
+                    int key,
+                    ps::KVServer<real_t>* server) {
+    auto& stored = store_[key];
+    bool fp16 = IsFP16(key);
+    ps::KVPairs<real_t> response;
+    CHECK(!stored.is_none()) << "init " << key << " first";
+    int len = stored.shape()[0];
+    response.keys = keys;
+    if (fp16) {
+      auto& narrowed = encode_buf_[key];
+      if (narrowed.is_none()) {
+        narrowed = NDArray(stored.shape(), Context(), false, mshadow::kFloat16);
+      }
+      CopyFromTo(stored, &narrowed, 0);
+      narrowed.WaitToRead();
+      len /= 2;
+      response.lens = {len};
+      response.vals.CopyFrom(static_cast<const float*>(narrowed.data().dptr_), len);
+    } else {
       response.lens = {len};
       // TODO(mli) try to remove this CopyFrom
       response.vals.CopyFrom(static_cast<const float*>(stored.data().dptr_), len);
-      server->Response(req_meta, response);
     }
+    server->Response(req_meta, response);
+  }
+
+  /**
+   * \brief the per key clocks for the bounded staleness mode
+   */
+  struct PendingPull {
+    ps::KVMeta meta;
+    ps::SArray<ps::Key> keys;
+    bool row_sparse;
+    std::chrono::steady_clock::time_point start;
+  };
+  struct SSPClock {
+    /// \brief the number of pushes received from each worker
+    std::vector<int> clock;
+    /// \brief the pulls waiting for slower workers
+    std::vector<PendingPull> pending;
+  };
+  /**
+   * \brief counters of how often a worker is blocked by slower workers
+   */
+  struct SSPStats {
+    size_t num_pulls = 0;
+    size_t num_blocked = 0;
+    double blocked_sec = 0;
+  };
+
+  inline bool IsWithinStaleness(const SSPClock& ssp, int worker) const {
+    int slowest = *std::min_element(ssp.clock.begin(), ssp.clock.end());
+    return ssp.clock[worker] - slowest <= staleness_;
+  }
+
+  /**
+   * \brief respond the pending pulls of \a key allowed by the new clocks
+   */
+  void ReleasePulls(int key, ps::KVServer<real_t>* server) {
+    SSPClock& ssp = ssp_clock_[key];
+    if (ssp.pending.empty()) return;
+    auto now = std::chrono::steady_clock::now();
+    std::vector<PendingPull> waiting;
+    for (auto& pull : ssp.pending) {
+      int worker = ps::Postoffice::IDtoRank(pull.meta.sender);
+      if (IsWithinStaleness(ssp, worker)) {
+        AddBlockedTime(worker, std::chrono::duration<double>(now - pull.start).count());
+        if (pull.row_sparse) {
+          ResponseRowSparsePull(pull.meta, pull.keys, key, server);
+        } else {
+          ResponsePull(pull.meta, pull.keys, key, server);
+        }
+      } else {
+        waiting.push_back(pull);
+      }
+    }
+    ssp.pending.swap(waiting);
+  }
+
+  void MaybeLogSSPStats() {
+    if (ssp_log_interval_ <= 0) return;
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last_ssp_log_).count() >= ssp_log_interval_) {
+      last_ssp_log_ = now;
+      LogSSPStats();
+    }
+  }
+
+  /**
+   * \brief count a pull of \a worker. The counters are updated by the data
+   * handler and logged by the command handler too, so they are guarded
+   */
+  void CountPull(int worker, bool blocked) {
+    std::lock_guard<std::mutex> lk(ssp_stats_mu_);
+    if (ssp_stats_.size() <= static_cast<size_t>(worker)) ssp_stats_.resize(worker + 1);
+    ++ssp_stats_[worker].num_pulls;
+    if (blocked) ++ssp_stats_[worker].num_blocked;
+  }
+
+  void AddBlockedTime(int worker, double sec) {
+    std::lock_guard<std::mutex> lk(ssp_stats_mu_);
+    if (ssp_stats_.size() <= static_cast<size_t>(worker)) ssp_stats_.resize(worker + 1);
+    ssp_stats_[worker].blocked_sec += sec;
+  }
+
+  void LogSSPStats() {
+    std::vector<SSPStats> stats;
+    {
+      std::lock_guard<std::mutex> lk(ssp_stats_mu_);
+      stats = ssp_stats_;
+    }
+    for (size_t i = 0; i < stats.size(); ++i) {
+      const SSPStats& st = stats[i];
+      LOG(INFO) << "server " << ps::MyRank() << ": worker " << i << " blocked in "
+                << st.num_blocked << " of " << st.num_pulls << " pulls, waited "
+                << st.blocked_sec << " sec";
+    }
+  }
+
+  /**
+   * \brief whether \a key is sent in fp16. The key info is written by the
+   * command handler and read by the data handler, which run on different
+   * threads
+   */
+  bool IsFP16(int key) {
+    std::lock_guard<std::mutex> lk(key_info_mu_);
+    auto it = wire_type_.find(key);
+    return it != wire_type_.end() && it->second == mshadow::kFloat16;
+  }
+
+  /**
+   * \brief the row length of the row sparse \a key, 0 if unknown
+   */
+  size_t KeyRowLen(int key) {
+    std::lock_guard<std::mutex> lk(key_info_mu_);
+    auto it = row_len_.find(key);
+    return it != row_len_.end() ? it->second : 0;
   }
 
   int DecodeKey(ps::Key key) {
@@ -223,14 +590,48 @@ class KVStoreDistServer {
     return key - kr.begin();
   }
 
+  int DecodeRowKey(ps::Key key) {
+    auto kr = ps::Postoffice::Get()->GetServerKeyRanges()[ps::MyRank()];
+    return static_cast<int>((key - kr.begin()) & ((1ULL << kRowShift) - 1));
+  }
+
+  size_t DecodeRow(ps::Key key) {
+    auto kr = ps::Postoffice::Get()->GetServerKeyRanges()[ps::MyRank()];
+    return static_cast<size_t>((key - kr.begin()) >> kRowShift) - 1;
+  }
+
   /**
    * \brief user defined
    */
   bool sync_mode_;
+  /// \brief whether in the bounded staleness mode
+  bool ssp_mode_;
+  /// \brief the maximal number of pushes a worker can be ahead of others
+  int staleness_;
+  /// \brief the clocks and pending pulls of every key
+  std::unordered_map<int, SSPClock> ssp_clock_;
+  /// \brief the blocking counters of every worker
+  std::vector<SSPStats> ssp_stats_;
+  /// \brief guards ssp_stats_
+  std::mutex ssp_stats_mu_;
+  /// \brief print the counters every ssp_log_interval_ seconds, 0 to disable
+  int ssp_log_interval_;
+  std::chrono::steady_clock::time_point last_ssp_log_;
   KVStore::Controller controller_;
   KVStore::Updater updater_;
+  KVStore::RowSparseUpdater row_sparse_updater_;
 
   std::unordered_map<int, NDArray> store_;
+  /// \brief the type on the wire of every key, fp32 if not set
+  std::unordered_map<int, int> wire_type_;
+  /// \brief the row length of every row sparse key
+  std::unordered_map<int, size_t> row_len_;
+  /// \brief guards wire_type_ and row_len_
+  std::mutex key_info_mu_;
+  /// \brief fp32 buffers for the received fp16 values
+  std::unordered_map<int, NDArray> decode_buf_;
+  /// \brief fp16 buffers for the pulled values
+  std::unordered_map<int, NDArray> encode_buf_;
 
   struct MergeBuf {
     std::vector<ps::KVMeta> request;
@@ -238,6 +639,15 @@ class KVStoreDistServer {
   };
   std::unordered_map<int, MergeBuf> merge_buf_;
 
+  struct RowMergeBuf {
+    std::vector<ps::KVMeta> request;
+    /// \brief the ids of the received rows, can be duplicated
+    std::vector<size_t> rows;
+    /// \brief the received rows, one after another
+    std::vector<real_t> vals;
+  };
+  std::unordered_map<int, RowMergeBuf> row_merge_buf_;
+
   Executor exec_;
 
   ps::KVServer<float>* ps_server_;
@@ -13,6 +13,7 @@
 #include <utility>
 #include <algorithm>
 #include "./comm.h"
+#include "./row_sparse.h"
 
 namespace mxnet {
 namespace kvstore {
@@ -87,7 +88,96 @@ class KVStoreLocal : public KVStore {
     }
   }
 
+  void PushRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray>& values,
+                     const std::vector<NDArray>& row_ids,
+                     int priority) override {
+    std::vector<int> uniq_keys;
+    std::vector<NDArray> rows, ids;
+    GroupRowSparse(keys, values, row_ids, &uniq_keys, &rows, &ids, priority);
+
+    for (size_t i = 0; i < uniq_keys.size(); ++i) {
+      int key = uniq_keys[i];
+      NDArray& local = local_[key];
+      CHECK(!local.is_none()) << "key " << key << " has not been inited";
+      UpdateRows(key, ids[i], rows[i], &local, priority);
+    }
+  }
+
+  void PullRowSparse(const std::vector<int>& keys,
+                     const std::vector<NDArray*>& values,
+                     const std::vector<NDArray>& row_ids,
+                     int priority) override {
+    CHECK_EQ(keys.size(), values.size());
+    CHECK_EQ(keys.size(), row_ids.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      const NDArray& local = local_[keys[i]];
+      CHECK(!local.is_none()) << "key " << keys[i] << " has not been inited";
+      NDArray out = AsRows(*values[i]);
+      NDArray ids(mshadow::Shape1(out.shape()[0]), pinned_ctx_);
+      NDArray rows(out.shape(), pinned_ctx_);
+      CopyFromTo(row_ids[i].Reshape(ids.shape()), &ids, priority);
+      GatherRows(AsRows(local), ids, rows, priority);
+      CopyFromTo(rows, &out, priority);
+    }
+  }
+
  protected:
+  /**
+   * \brief group the row sparse values on keys, the rows and ids of the same
+   * key are concatenated in CPU memory
+   */
+  void GroupRowSparse(const std::vector<int>& keys,
+                      const std::vector<NDArray>& values,
+                      const std::vector<NDArray>& row_ids,
+                      std::vector<int>* uniq_keys,
+                      std::vector<NDArray>* rows,
+                      std::vector<NDArray>* ids,
+                      int priority) {
+    CHECK_EQ(values.size(), row_ids.size());
+    using RowPair = std::pair<NDArray, NDArray>;
+    std::vector<RowPair> pairs(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      pairs[i] = std::make_pair(values[i], row_ids[i]);
+    }
+    std::vector<std::vector<RowPair> > grouped;
+    GroupKVPairs(keys, pairs, uniq_keys, &grouped);
+    rows->resize(grouped.size());
+    ids->resize(grouped.size());
+    for (size_t i = 0; i < grouped.size(); ++i) {
+      std::vector<NDArray> vals, vids;
+      for (const auto& p : grouped[i]) {
+        vals.push_back(p.first);
+        vids.push_back(p.second);
+      }
+      ConcatRows(vals, vids, pinned_ctx_, &(*rows)[i], &(*ids)[i], priority);
+    }
+  }
+  /**
+   * \brief apply the pushed rows to \a local, all in CPU memory
+   */
+  void UpdateRows(int key, const NDArray& ids, const NDArray& rows,
+                  NDArray* local, int priority) {
+    CHECK_EQ(local->ctx().dev_mask(), cpu::kDevMask)
+        << "row sparse push needs the value of key " << key << " in CPU memory";
+    if (row_sparse_updater_ != nullptr) {
+      // only the pushed rows are summed, read and updated
+      NDArray counted(mshadow::Shape1(ids.shape()[0] + 1), local->ctx(),
+                      false, mshadow::kInt32);
+      NDArray merged(rows.shape(), local->ctx());
+      MergeRows(ids, rows, counted, merged, priority);
+      row_sparse_updater_(key, merged, counted, local);
+    } else if (updater_ != nullptr) {
+      // the updater takes a dense gradient, zero except on the pushed rows
+      NDArray grad(local->shape(), local->ctx());
+      grad = 0.0f;
+      ScatterAddRows(ids, rows, AsRows(grad), priority);
+      updater_(key, grad, local);
+    } else {
+      ZeroRows(ids, AsRows(*local), priority);
+      ScatterAddRows(ids, rows, AsRows(*local), priority);
+    }
+  }
   /**
    * \brief group values on keys
    */
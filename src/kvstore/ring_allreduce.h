@@ -0,0 +1,399 @@
+/**
+ * Copyright (c) 2016 by Contributors
+ * @file   ring_allreduce.h
+ * @brief  bandwidth-optimal ring allreduce among workers over TCP sockets
+ */
+#ifndef MXNET_KVSTORE_RING_ALLREDUCE_H_
+#define MXNET_KVSTORE_RING_ALLREDUCE_H_
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/base.h>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif  // !defined(_WIN32)
+
+namespace mxnet {
+namespace kvstore {
+
+#if !defined(_WIN32)
+/**
+ * \brief a minimal blocking TCP socket used by \ref RingAllreduce
+ */
+class RingSocket {
+ public:
+  RingSocket() : fd_(-1) { }
+  explicit RingSocket(int fd) : fd_(fd) { }
+  ~RingSocket() { Close(); }
+
+  RingSocket(const RingSocket&) = delete;
+  RingSocket& operator=(const RingSocket&) = delete;
+
+  void Attach(int fd) {
+    Close();
+    fd_ = fd;
+  }
+
+  int fd() const { return fd_; }
+
+  void Close() {
+    if (fd_ != -1) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  /**
+   * \brief create a listen socket on \a port, 0 means any free port
+   * \return the port actually bound
+   */
+  int Listen(int port) {
+    Attach(socket(AF_INET, SOCK_STREAM, 0));
+    CHECK_NE(fd_, -1) << "socket: " << strerror(errno);
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    CHECK_EQ(bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0)
+        << "bind to port " << port << " failed: " << strerror(errno);
+    CHECK_EQ(listen(fd_, 128), 0) << "listen: " << strerror(errno);
+    socklen_t len = sizeof(addr);
+    CHECK_EQ(getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    return ntohs(addr.sin_port);
+  }
+
+  /**
+   * \brief accept a connection, returns the peer's ip address in \a peer_ip
+   */
+  int Accept(std::string* peer_ip) {
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = accept(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    CHECK_NE(fd, -1) << "accept: " << strerror(errno);
+    if (peer_ip != nullptr) {
+      char buf[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &addr.sin_addr, buf, sizeof(buf));
+      *peer_ip = buf;
+    }
+    return fd;
+  }
+
+  /**
+   * \brief connect to host:port, retry until \a timeout_sec is reached
+   */
+  void Connect(const std::string& host, int port, int timeout_sec) {
+    addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string sport = std::to_string(port);
+    int ret = getaddrinfo(host.c_str(), sport.c_str(), &hints, &res);
+    CHECK_EQ(ret, 0) << "cannot resolve " << host << ": " << gai_strerror(ret);
+    for (int waited_ms = 0; ; waited_ms += 100) {
+      Attach(socket(AF_INET, SOCK_STREAM, 0));
+      CHECK_NE(fd_, -1) << "socket: " << strerror(errno);
+      if (connect(fd_, res->ai_addr, res->ai_addrlen) == 0) break;
+      CHECK_LT(waited_ms, timeout_sec * 1000)
+          << "cannot connect to " << host << ":" << port << ": " << strerror(errno);
+      Close();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    freeaddrinfo(res);
+  }
+
+  /**
+   * \brief disable Nagle and enlarge the kernel buffers for bulk transfers
+   */
+  void SetBulkOptions(int buf_size) {
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+  }
+
+  /** \brief send exactly \a size bytes */
+  void SendAll(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size != 0) {
+      ssize_t n = send(fd_, p, size, MSG_NOSIGNAL);
+      if (n == -1 && errno == EINTR) continue;
+      CHECK_GT(n, 0) << "send: " << strerror(errno);
+      p += n; size -= n;
+    }
+  }
+
+  /** \brief receive exactly \a size bytes */
+  void RecvAll(void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size != 0) {
+      ssize_t n = recv(fd_, p, size, 0);
+      if (n == -1 && errno == EINTR) continue;
+      CHECK_GT(n, 0) << "recv: peer closed or " << strerror(errno);
+      p += n; size -= n;
+    }
+  }
+
+ private:
+  int fd_;
+};
+#endif  // !defined(_WIN32)
+
+/**
+ * \brief ring allreduce (sum) over all workers.
+ *
+ * Workers form a ring rank -> rank+1. A buffer of n elements is split into
+ * one segment per worker, a reduce-scatter of (num_workers-1) steps leaves
+ * every worker owning one fully reduced segment, then an allgather of
+ * (num_workers-1) steps circulates the reduced segments. Every worker sends
+ * and receives 2*(num_workers-1)/num_workers of the buffer, independent of the
+ * number of workers.
+ *
+ * Segments are further cut into chunks of MXNET_KVSTORE_ALLREDUCE_CHUNK bytes.
+ * A sender thread forwards chunk c of step t as soon as chunk c of step t-1
+ * has been received (and reduced), so sending, receiving and summing are
+ * pipelined.
+ *
+ * Bring-up is configured by environment variables
+ * - MXNET_ALLREDUCE_NUM_WORKERS (or DMLC_NUM_WORKER): number of workers
+ * - MXNET_ALLREDUCE_RANK (or OMPI_COMM_WORLD_RANK, PMI_RANK): the rank of this
+ *   worker, in [0, num_workers), required with more than one worker
+ * - MXNET_ALLREDUCE_ROOT_URI, MXNET_ALLREDUCE_ROOT_PORT (or DMLC_PS_ROOT_URI,
+ *   DMLC_PS_ROOT_PORT): where rank 0 listens for the rendezvous
+ *
+ * All workers must call \ref Allreduce on the same sequence of buffer sizes.
+ */
+class RingAllreduce {
+ public:
+  RingAllreduce() {
+    num_workers_ = dmlc::GetEnv("MXNET_ALLREDUCE_NUM_WORKERS",
+                                dmlc::GetEnv("DMLC_NUM_WORKER", 1));
+    // the dmlc launchers do not set a worker rank, mpirun does
+    rank_ = dmlc::GetEnv("MXNET_ALLREDUCE_RANK",
+                         dmlc::GetEnv("OMPI_COMM_WORLD_RANK",
+                                      dmlc::GetEnv("PMI_RANK", -1)));
+    chunk_bytes_ = dmlc::GetEnv("MXNET_KVSTORE_ALLREDUCE_CHUNK", 1 << 18);
+    CHECK_GT(num_workers_, 0);
+    if (num_workers_ == 1 && rank_ < 0) rank_ = 0;
+    CHECK_GE(rank_, 0) << "MXNET_ALLREDUCE_RANK must be set for each of the "
+                       << num_workers_ << " workers";
+    CHECK(rank_ >= 0 && rank_ < num_workers_)
+        << "invalid MXNET_ALLREDUCE_RANK " << rank_;
+    CHECK_GE(chunk_bytes_, sizeof(real_t));
+    if (num_workers_ > 1) Connect();
+  }
+
+  ~RingAllreduce() { }
+
+  /** \brief the rank of this worker */
+  int rank() const { return rank_; }
+  /** \brief the number of workers in the ring */
+  int num_workers() const { return num_workers_; }
+
+  /**
+   * \brief sum \a data over all workers in place. blocking
+   */
+  void Allreduce(real_t* data, size_t size) {
+    if (num_workers_ == 1 || size == 0) return;
+#if !defined(_WIN32)
+    const int n = num_workers_;
+    std::vector<size_t> seg(n + 1);
+    for (int i = 0; i <= n; ++i) {
+      seg[i] = static_cast<size_t>(static_cast<double>(size) / n * i);
+    }
+    seg[n] = size;
+    size_t max_seg = 0;
+    for (int i = 0; i < n; ++i) max_seg = std::max(max_seg, seg[i+1] - seg[i]);
+    const size_t chunk = std::max(chunk_bytes_ / sizeof(real_t), static_cast<size_t>(1));
+    const int nchunk = static_cast<int>((max_seg + chunk - 1) / chunk);
+    const int nstep = 2 * (n - 1);
+    if (recv_buf_.size() < chunk) recv_buf_.resize(chunk);
+
+    // the segment sent / received at global step t
+    auto send_seg = [this, n](int t) {
+      return t < n - 1 ? (rank_ - t + n) % n : (rank_ + 1 - (t - n + 1) + n) % n;
+    };
+    auto recv_seg = [this, n](int t) {
+      return t < n - 1 ? (rank_ - t - 1 + 2 * n) % n : (rank_ - (t - n + 1) + n) % n;
+    };
+    auto chunk_range = [&](int s, int c, size_t* begin, size_t* end) {
+      *begin = std::min(seg[s] + c * chunk, seg[s+1]);
+      *end = std::min(*begin + chunk, seg[s+1]);
+    };
+
+    // sender: chunk c of step t waits for chunk c of step t-1
+    done_ = 0;
+    std::thread sender([&]() {
+        for (int t = 0; t < nstep; ++t) {
+          int s = send_seg(t);
+          for (int c = 0; c < nchunk; ++c) {
+            if (t != 0) {
+              std::unique_lock<std::mutex> lk(mu_);
+              cv_.wait(lk, [&]() { return done_ > (t - 1) * nchunk + c; });
+            }
+            size_t begin, end;
+            chunk_range(s, c, &begin, &end);
+            if (end > begin) {
+              next_.SendAll(data + begin, (end - begin) * sizeof(real_t));
+            }
+          }
+        }
+      });
+
+    for (int t = 0; t < nstep; ++t) {
+      int s = recv_seg(t);
+      bool reduce = t < n - 1;
+      for (int c = 0; c < nchunk; ++c) {
+        size_t begin, end;
+        chunk_range(s, c, &begin, &end);
+        size_t len = end - begin;
+        if (len != 0) {
+          if (reduce) {
+            real_t* buf = dmlc::BeginPtr(recv_buf_);
+            prev_.RecvAll(buf, len * sizeof(real_t));
+            real_t* dst = data + begin;
+            for (size_t i = 0; i < len; ++i) dst[i] += buf[i];
+          } else {
+            prev_.RecvAll(data + begin, len * sizeof(real_t));
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lk(mu_);
+          ++done_;
+        }
+        cv_.notify_one();
+      }
+    }
+    sender.join();
+#endif  // !defined(_WIN32)
+  }
+
+ private:
+  /**
+   * \brief rendezvous at rank 0 and connect the ring
+   */
+  void Connect() {
+#if defined(_WIN32)
+    LOG(FATAL) << "ring allreduce is not supported on Windows";
+#else
+    const char* uri = getenv("MXNET_ALLREDUCE_ROOT_URI");
+    if (uri == nullptr) uri = getenv("DMLC_PS_ROOT_URI");
+    CHECK(uri != nullptr) << "set MXNET_ALLREDUCE_ROOT_URI for dist_allreduce";
+    int root_port = dmlc::GetEnv("MXNET_ALLREDUCE_ROOT_PORT",
+                                 dmlc::GetEnv("DMLC_PS_ROOT_PORT", 0));
+    CHECK_GT(root_port, 0) << "set MXNET_ALLREDUCE_ROOT_PORT for dist_allreduce";
+    int timeout = dmlc::GetEnv("MXNET_ALLREDUCE_CONNECT_TIMEOUT", 300);
+    int sock_buf = dmlc::GetEnv("MXNET_ALLREDUCE_SOCKET_BUFFER", 4 << 20);
+
+    // every worker listens for the connection from its predecessor
+    RingSocket ring_listen;
+    int32_t my_port = ring_listen.Listen(0);
+
+    // exchange (ip, port) of all workers through rank 0
+    std::vector<std::string> hosts(num_workers_);
+    std::vector<int32_t> ports(num_workers_);
+    if (rank_ == 0) {
+      RingSocket root;
+      root.Listen(root_port);
+      hosts[0] = uri;
+      ports[0] = my_port;
+      std::vector<std::unique_ptr<RingSocket>> peers(num_workers_);
+      for (int i = 1; i < num_workers_; ++i) {
+        std::string ip;
+        std::unique_ptr<RingSocket> peer(new RingSocket(root.Accept(&ip)));
+        int32_t head[2];
+        peer->RecvAll(head, sizeof(head));
+        CHECK(head[0] > 0 && head[0] < num_workers_ && peers[head[0]] == nullptr)
+            << "invalid or duplicated rank " << head[0];
+        hosts[head[0]] = ip;
+        ports[head[0]] = head[1];
+        peers[head[0]] = std::move(peer);
+      }
+      std::string table = EncodeTable(hosts, ports);
+      uint64_t len = table.size();
+      for (int i = 1; i < num_workers_; ++i) {
+        peers[i]->SendAll(&len, sizeof(len));
+        peers[i]->SendAll(table.data(), len);
+      }
+    } else {
+      RingSocket root;
+      root.Connect(uri, root_port, timeout);
+      int32_t head[2] = {rank_, my_port};
+      root.SendAll(head, sizeof(head));
+      uint64_t len;
+      root.RecvAll(&len, sizeof(len));
+      std::string table(len, '\0');
+      root.RecvAll(&table[0], len);
+      DecodeTable(table, &hosts, &ports);
+    }
+
+    // connect to the successor, accept the predecessor
+    int next = (rank_ + 1) % num_workers_;
+    std::thread connector([&]() {
+        next_.Connect(hosts[next], ports[next], timeout);
+        next_.SetBulkOptions(sock_buf);
+      });
+    prev_.Attach(ring_listen.Accept(nullptr));
+    prev_.SetBulkOptions(sock_buf);
+    connector.join();
+    LOG(INFO) << "ring allreduce: worker " << rank_ << " of " << num_workers_
+              << " connected to " << hosts[next] << ":" << ports[next];
+#endif  // defined(_WIN32)
+  }
+
+  static std::string EncodeTable(const std::vector<std::string>& hosts,
+                                 const std::vector<int32_t>& ports) {
+    std::ostringstream os;
+    for (size_t i = 0; i < hosts.size(); ++i) {
+      os << hosts[i] << ' ' << ports[i] << '\n';
+    }
+    return os.str();
+  }
+
+  static void DecodeTable(const std::string& table,
+                          std::vector<std::string>* hosts,
+                          std::vector<int32_t>* ports) {
+    std::istringstream is(table);
+    for (size_t i = 0; i < hosts->size(); ++i) {
+      CHECK(is >> (*hosts)[i] >> (*ports)[i]) << "corrupted rendezvous table";
+    }
+  }
+
+  int num_workers_;
+  int rank_;
+  size_t chunk_bytes_;
+#if !defined(_WIN32)
+  /// \brief connection to rank+1
+  RingSocket next_;
+  /// \brief connection from rank-1
+  RingSocket prev_;
+#endif  // !defined(_WIN32)
+  /// \brief staging buffer for one received chunk
+  std::vector<real_t> recv_buf_;
+  /// \brief number of chunks received so far in the current allreduce
+  int done_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+};
+
+}  // namespace kvstore
+}  // namespace mxnet
+#endif  // MXNET_KVSTORE_RING_ALLREDUCE_H_
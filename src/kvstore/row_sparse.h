@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2016 by Contributors
+ * @file   row_sparse.h
+ * @brief  helpers for pushing and pulling a subset of rows
+ */
+#ifndef MXNET_KVSTORE_ROW_SPARSE_H_
+#define MXNET_KVSTORE_ROW_SPARSE_H_
+#include <mxnet/ndarray.h>
+#include <mxnet/engine.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace mxnet {
+namespace kvstore {
+
+/**
+ * \brief the number of elements of a row of \a shape
+ */
+inline size_t RowLength(const TShape& shape) {
+  return shape.ndim() > 1 ? shape.ProdShape(1, shape.ndim()) : 1;
+}
+
+/**
+ * \brief view \a arr as a 2-D matrix of rows
+ */
+inline NDArray AsRows(const NDArray& arr) {
+  return arr.Reshape(mshadow::Shape2(arr.shape()[0], RowLength(arr.shape())));
+}
+
+/**
+ * \brief sort the row ids, and return the unique ids with, for every input,
+ * the position of its id in the unique ids
+ */
+template<typename T>
+inline void UniqueRows(const T* ids, size_t size,
+                       std::vector<size_t>* uniq,
+                       std::vector<size_t>* pos) {
+  std::vector<std::pair<size_t, size_t>> sorted(size);
+  for (size_t i = 0; i < size; ++i) {
+    sorted[i] = std::make_pair(static_cast<size_t>(ids[i]), i);
+  }
+  std::sort(sorted.begin(), sorted.end());
+  uniq->clear();
+  pos->resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    if (uniq->empty() || uniq->back() != sorted[i].first) {
+      uniq->push_back(sorted[i].first);
+    }
+    (*pos)[sorted[i].second] = uniq->size() - 1;
+  }
+}
+
+/**
+ * \brief copy the rows pushed from all devices into \a rows and their ids into
+ * \a ids, both in CPU memory
+ */
+inline void ConcatRows(const std::vector<NDArray>& values,
+                       const std::vector<NDArray>& row_ids,
+                       Context ctx, NDArray* rows, NDArray* ids, int priority) {
+  CHECK_EQ(values.size(), row_ids.size());
+  size_t total = 0;
+  size_t row_len = RowLength(values[0].shape());
+  for (size_t i = 0; i < values.size(); ++i) {
+    CHECK_EQ(values[i].shape()[0], row_ids[i].shape().Size())
+        << "the number of rows and row ids mismatch";
+    CHECK_EQ(RowLength(values[i].shape()), row_len);
+    total += values[i].shape()[0];
+  }
+  *rows = NDArray(mshadow::Shape2(total, row_len), ctx);
+  *ids = NDArray(mshadow::Shape1(total), ctx);
+  size_t begin = 0;
+  for (size_t i = 0; i < values.size(); ++i) {
+    size_t end = begin + values[i].shape()[0];
+    NDArray rows_dst = rows->Slice(begin, end);
+    NDArray ids_dst = ids->Slice(begin, end);
+    CopyFromTo(AsRows(values[i]), &rows_dst, priority);
+    CopyFromTo(row_ids[i].Reshape(mshadow::Shape1(end - begin)), &ids_dst, priority);
+    begin = end;
+  }
+}
+
+/**
+ * \brief out[ids[i]] += rows[i], duplicated ids are summed. All in CPU memory
+ */
+inline void ScatterAddRows(const NDArray& ids, const NDArray& rows,
+                           const NDArray& out, int priority) {
+  CHECK_EQ(out.ctx().dev_mask(), cpu::kDevMask) << "rows are updated on CPU";
+  Engine::Get()->PushSync([ids, rows, out](RunContext ctx) {
+      mshadow::Tensor<cpu, 1> id = ids.data().FlatTo1D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> src = rows.data().FlatTo2D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> dst = out.data().FlatTo2D<cpu, real_t>();
+      for (index_t i = 0; i < src.size(0); ++i) {
+        index_t r = static_cast<index_t>(id[i]);
+        CHECK_LT(r, dst.size(0)) << "row id " << r << " out of range";
+        real_t* d = dst[r].dptr_;
+        const real_t* s = src[i].dptr_;
+        for (index_t j = 0; j < src.size(1); ++j) d[j] += s[j];
+      }
+    }, Context::CPU(), {ids.var(), rows.var()}, {out.var()},
+    FnProperty::kNormal, priority);
+}
+
+/**
+ * \brief sum the rows of duplicated ids, as the row sparse updater takes. The
+ * int32 array \a counted gets the number of unique ids followed by the sorted
+ * unique ids, and row i of \a merged the sum of the rows of the i-th unique id.
+ * Both have room for all the ids. In CPU memory
+ */
+inline void MergeRows(const NDArray& ids, const NDArray& rows,
+                      const NDArray& counted, const NDArray& merged, int priority) {
+  CHECK_EQ(counted.dtype(), mshadow::kInt32);
+  CHECK_GT(counted.shape().Size(), ids.shape().Size());
+  CHECK_EQ(merged.shape(), rows.shape());
+  Engine::Get()->PushSync([ids, rows, counted, merged](RunContext ctx) {
+      mshadow::Tensor<cpu, 1> id = ids.data().FlatTo1D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> src = rows.data().FlatTo2D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> dst = merged.data().FlatTo2D<cpu, real_t>();
+      int* cnt = counted.data().dptr<int>();
+      std::vector<size_t> uniq, pos;
+      UniqueRows(id.dptr_, id.size(0), &uniq, &pos);
+      cnt[0] = static_cast<int>(uniq.size());
+      std::copy(uniq.begin(), uniq.end(), cnt + 1);
+      std::fill(dst.dptr_, dst.dptr_ + uniq.size() * dst.size(1), 0.0f);
+      for (index_t i = 0; i < src.size(0); ++i) {
+        real_t* d = dst[pos[i]].dptr_;
+        const real_t* s = src[i].dptr_;
+        for (index_t j = 0; j < src.size(1); ++j) d[j] += s[j];
+      }
+    }, Context::CPU(), {ids.var(), rows.var()}, {counted.var(), merged.var()},
+    FnProperty::kNormal, priority);
+}
+
+/**
+ * \brief out[ids[i]] = 0. In CPU memory
+ */
+inline void ZeroRows(const NDArray& ids, const NDArray& out, int priority) {
+  CHECK_EQ(out.ctx().dev_mask(), cpu::kDevMask) << "rows are updated on CPU";
+  Engine::Get()->PushSync([ids, out](RunContext ctx) {
+      mshadow::Tensor<cpu, 1> id = ids.data().FlatTo1D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> dst = out.data().FlatTo2D<cpu, real_t>();
+      for (index_t i = 0; i < id.size(0); ++i) {
+        index_t r = static_cast<index_t>(id[i]);
+        CHECK_LT(r, dst.size(0)) << "row id " << r << " out of range";
+        std::fill(dst[r].dptr_, dst[r].dptr_ + dst.size(1), 0.0f);
+      }
+    }, Context::CPU(), {ids.var()}, {out.var()},
+    FnProperty::kNormal, priority);
+}
+
+/**
+ * \brief out[i] = src[ids[i]]. In CPU memory
+ */
+inline void GatherRows(const NDArray& src, const NDArray& ids,
+                       const NDArray& out, int priority) {
+  CHECK_EQ(src.ctx().dev_mask(), cpu::kDevMask) << "rows are gathered on CPU";
+  Engine::Get()->PushSync([src, ids, out](RunContext ctx) {
+      mshadow::Tensor<cpu, 1> id = ids.data().FlatTo1D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> from = src.data().FlatTo2D<cpu, real_t>();
+      mshadow::Tensor<cpu, 2> to = out.data().FlatTo2D<cpu, real_t>();
+      for (index_t i = 0; i < id.size(0); ++i) {
+        CHECK_LT(static_cast<index_t>(id[i]), from.size(0))
+            << "row id " << id[i] << " out of range";
+      }
+      const int nrow = static_cast<int>(id.size(0));
+      #pragma omp parallel for
+      for (int i = 0; i < nrow; ++i) {
+        index_t r = static_cast<index_t>(id[i]);
+        std::copy(from[r].dptr_, from[r].dptr_ + from.size(1), to[i].dptr_);
+      }
+    }, Context::CPU(), {src.var(), ids.var()}, {out.var()},
+    FnProperty::kNormal, priority);
+}
+
+}  // namespace kvstore
+}  // namespace mxnet
+#endif  // MXNET_KVSTORE_ROW_SPARSE_H_
@@ -237,6 +237,22 @@ void CopyFromTo(const NDArray &from, NDArray *to, int priority) {
   int a = from.ctx().dev_mask();
   int b = to->ctx().dev_mask();
 
+  if (from.dtype() != to->dtype() &&
+      (a != b || (a == gpu::kDevMask && from.ctx().dev_id != to->ctx().dev_id))) {
+    // devices only copy the same type. convert on the side which makes the
+    // transfer smaller, e.g. uint8 images are sent to the GPU before the
+    // conversion to float
+    size_t from_size = 0, to_size = 0;
+    MSHADOW_TYPE_SWITCH(from.dtype(), DType, { from_size = sizeof(DType); });
+    MSHADOW_TYPE_SWITCH(to->dtype(), DType, { to_size = sizeof(DType); });
+    NDArray tmp = from_size <= to_size ?
+        NDArray(from.shape(), to->ctx(), true, from.dtype()) :
+        NDArray(from.shape(), from.ctx(), true, to->dtype());
+    CopyFromTo(from, &tmp, priority);
+    CopyFromTo(tmp, to, priority);
+    return;
+  }
+
   std::vector<Engine::VarHandle> const_vars;
   if (from.var() != ret.var()) const_vars.push_back(from.var());
 
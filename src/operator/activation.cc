@@ -6,6 +6,7 @@
 */
 #include "./activation-inl.h"
 #include "./mshadow_op.h"
+#include "./float16_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -17,6 +18,10 @@ namespace op {
 template<>
 Operator *CreateOp<cpu>(ActivationParam param, int dtype) {
   Operator *op = NULL;
+  if (dtype == mshadow::kFloat16) {
+    // float16 storage, computed in float32 on blocks of the tensors
+    return new float16::Float16CPUOp(CreateOp<cpu>(param, mshadow::kFloat32), true);
+  }
 #if MXNET_USE_MKL2017 == 1
   if (param.act_type == activation::kReLU) {
       switch (dtype) {
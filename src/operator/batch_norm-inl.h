@@ -32,6 +32,7 @@ struct BatchNormParam : public dmlc::Parameter<BatchNormParam> {
   float momentum;
   bool fix_gamma;
   bool use_global_stats;
+  bool fuse_relu;
   DMLC_DECLARE_PARAMETER(BatchNormParam) {
     DMLC_DECLARE_FIELD(eps).set_default(1e-3f)
     .describe("Epsilon to prevent div 0");
@@ -42,6 +43,8 @@ struct BatchNormParam : public dmlc::Parameter<BatchNormParam> {
     DMLC_DECLARE_FIELD(use_global_stats).set_default(false)
     .describe("Whether use global moving statistics instead of local batch-norm. "
               "This will force change batch-norm into a scale shift operator.");
+    DMLC_DECLARE_FIELD(fuse_relu).set_default(false)
+    .describe("Apply relu to the output. On CPU it is fused into the normalization.");
   }
 };
 
@@ -112,6 +115,10 @@ class BatchNormOp : public Operator {
              broadcast<1>(bias - (slope * moving_mean) /
                           F<mshadow_op::square_root>(moving_var + param_.eps), data.shape_));
     }
+    if (param_.fuse_relu) {
+      CHECK_NE(req[batchnorm::kOut], kAddTo) << "fuse_relu does not support kAddTo";
+      out = F<mshadow_op::relu>(out);
+    }
   }
 
   virtual void Backward(const OpContext &ctx,
@@ -142,6 +149,18 @@ class BatchNormOp : public Operator {
       grad = out_grad[batchnorm::kOut].get<xpu, 4, real_t>(s);
       grad_in = in_grad[batchnorm::kData].get<xpu, 4, real_t>(s);
     }
+    const index_t nchannel = data.shape_[1];
+    // the gradients of the statistics, followed by the gradient through the relu
+    Tensor<xpu, 1> space = ctx.requested[batchnorm::kTempSpace].get_space<xpu>(
+        mshadow::Shape1(3 * nchannel + (param_.fuse_relu ? grad.shape_.Size() : 0)), s);
+    Tensor<xpu, 2> workspace(space.dptr_, mshadow::Shape2(3, nchannel), s);
+    if (param_.fuse_relu) {
+      Tensor<xpu, 4> out = out_data[batchnorm::kOut].get_with_shape<xpu, 4, real_t>(
+          grad.shape_, s);
+      Tensor<xpu, 4> grad_relu(space.dptr_ + 3 * nchannel, grad.shape_, s);
+      grad_relu = grad * F<mshadow_op::relu_grad>(out);
+      grad = grad_relu;
+    }
 
     Tensor<xpu, 1> mean = out_data[batchnorm::kMean].get<xpu, 1, real_t>(s);
     Tensor<xpu, 1> var = out_data[batchnorm::kVar].get<xpu, 1, real_t>(s);
@@ -156,9 +175,6 @@ class BatchNormOp : public Operator {
     if (param_.fix_gamma) slope = 1.f;
 
     if (ctx.is_train && !param_.use_global_stats) {
-      // get requested temp space
-      Tensor<xpu, 2> workspace = ctx.requested[batchnorm::kTempSpace].get_space<xpu>(
-          mshadow::Shape2(3, mean.shape_[0]), s);
       Tensor<xpu, 1> gmean = workspace[0];
       Tensor<xpu, 1> gvar = workspace[1];
       Tensor<xpu, 1> tmp = workspace[2];
@@ -248,6 +264,32 @@ class BatchNormProp : public OperatorProperty {
     return true;
   }
 
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    CHECK_GE(in_type->size(), 1);
+    int dtype = (*in_type)[0];
+    CHECK_NE(dtype, -1) << "First input must have specified type";
+    // gamma, beta and the statistics stay in float32 for any type of the data
+    const int ptype = mshadow::kFloat32;
+    for (index_t i = 1; i < in_type->size(); ++i) {
+      if ((*in_type)[i] == -1) {
+        (*in_type)[i] = ptype;
+      } else {
+        CHECK_EQ((*in_type)[i], ptype) << "BatchNorm requires float32 "
+                                       << ListArguments()[i] << ", given " << (*in_type)[i];
+      }
+    }
+    out_type->clear();
+    out_type->push_back(dtype);
+    out_type->push_back(ptype);
+    out_type->push_back(ptype);
+    aux_type->clear();
+    aux_type->push_back(ptype);
+    aux_type->push_back(ptype);
+    return true;
+  }
+
   OperatorProperty* Copy() const override {
     auto ptr = new BatchNormProp();
     ptr->param_ = param_;
@@ -262,13 +304,15 @@ class BatchNormProp : public OperatorProperty {
     const std::vector<int> &out_grad,
     const std::vector<int> &in_data,
     const std::vector<int> &out_data) const override {
-    return {out_grad[batchnorm::kOut],
-            out_data[batchnorm::kMean],
-            out_data[batchnorm::kVar],
-            in_data[batchnorm::kData],
-            in_data[batchnorm::kGamma],
-            in_data[batchnorm::kBeta]
-           };
+    std::vector<int> dep = {out_grad[batchnorm::kOut],
+                            out_data[batchnorm::kMean],
+                            out_data[batchnorm::kVar],
+                            in_data[batchnorm::kData],
+                            in_data[batchnorm::kGamma],
+                            in_data[batchnorm::kBeta]};
+    // the relu gradient needs the output
+    if (param_.fuse_relu) dep.push_back(out_data[batchnorm::kOut]);
+    return dep;
   }
 
   std::vector<ResourceRequest> BackwardResource(
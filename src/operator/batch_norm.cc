@@ -6,6 +6,7 @@
 */
 
 #include "./batch_norm-inl.h"
+#include "./batch_norm_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -16,11 +17,16 @@ namespace mxnet {
 namespace op {
 template<>
 Operator *CreateOp<cpu>(BatchNormParam param, int dtype) {
+  Operator *op = NULL;
 #if MXNET_USE_MKL2017 == 1
-  return new MKLBatchNormOp<cpu, float>(param);
-#else
-  return new BatchNormOp<cpu>(param);
+  if (dtype == mshadow::kFloat32 && !param.fuse_relu) {
+    return new MKLBatchNormOp<cpu, float>(param);
+  }
 #endif
+  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
+    op = new BatchNormCPUOp<DType>(param);
+  })
+  return op;
 }
 
 // DO_BIND_DISPATCH comes from operator_common.h
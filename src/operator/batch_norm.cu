@@ -12,8 +12,9 @@ namespace mxnet {
 namespace op {
 template<>
 Operator *CreateOp<gpu>(BatchNormParam param, int dtype) {
+  CHECK_EQ(dtype, mshadow::kFloat32) << "BatchNorm on gpu only supports float32";
 #if MXNET_USE_CUDNN == 1 && CUDNN_MAJOR >= 5
-  if (!param.use_global_stats) {
+  if (!param.use_global_stats && !param.fuse_relu) {
     return new CuDNNBatchNormOp(param);
   } else {
     return new BatchNormOp<gpu>(param);
@@ -0,0 +1,266 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file batch_norm_cpu-inl.h
+ * \brief single pass batch normalization on cpu, parallel over the channels,
+ *  see tests/cpp/batch_norm_test.cc for benchmarks
+ */
+#ifndef MXNET_OPERATOR_BATCH_NORM_CPU_INL_H_
+#define MXNET_OPERATOR_BATCH_NORM_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+#include "./batch_norm-inl.h"
+#include "./float16_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief batch normalization on cpu for data of any type, gamma, beta and the
+ *  statistics are float. The data is viewed as num x channel x spatial, so
+ *  any data with at least 2 dimensions is supported.
+ *
+ *  Forward reads a channel once for the mean and the variance, and once more
+ *  for out = x * a + b with the relu applied in the same pass. Backward reads a
+ *  channel once for the gradients of gamma and beta and once more for the
+ *  gradient of the data. The channels are processed in parallel with openmp,
+ *  the sums are accumulated in float per row and in double per channel.
+ *  float16 rows are converted to float32 as they are read and written.
+ */
+template<typename DType>
+class BatchNormCPUOp : public Operator {
+  /*! \brief the type the rows are read in */
+  typedef typename float16::ComputeType<DType>::type AType;
+
+ public:
+  explicit BatchNormCPUOp(BatchNormParam param) : param_(param) {}
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_states) {
+    CHECK_EQ(in_data.size(), 3);
+    CHECK_EQ(aux_states.size(), 2);
+    if (ctx.is_train) {
+      CHECK_EQ(out_data.size(), 3);
+      CHECK_EQ(req.size(), 3);
+    } else {
+      CHECK_GE(out_data.size(), 1);
+      CHECK_GE(req.size(), 1);
+      CHECK_EQ(req[batchnorm::kOut], kWriteTo);
+    }
+    const TShape &dshape = in_data[batchnorm::kData].shape_;
+    const index_t num = dshape[0], nchannel = dshape[1];
+    const index_t spatial = dshape.Size() / (num * nchannel);
+    const DType *x = in_data[batchnorm::kData].dptr<DType>();
+    DType *y = out_data[batchnorm::kOut].dptr<DType>();
+    real_t *gamma = in_data[batchnorm::kGamma].dptr<real_t>();
+    const real_t *beta = in_data[batchnorm::kBeta].dptr<real_t>();
+    const real_t *moving_mean = aux_states[batchnorm::kMovingMean].dptr<real_t>();
+    const real_t *moving_var = aux_states[batchnorm::kMovingVar].dptr<real_t>();
+    const bool batch_stats = ctx.is_train && !param_.use_global_stats;
+    real_t *mean = nullptr, *var = nullptr;
+    if (batch_stats) {
+      CHECK(req[batchnorm::kMean] == kNullOp || req[batchnorm::kMean] == kWriteTo);
+      CHECK(req[batchnorm::kVar] == kNullOp || req[batchnorm::kVar] == kWriteTo);
+      mean = out_data[batchnorm::kMean].dptr<real_t>();
+      var = out_data[batchnorm::kVar].dptr<real_t>();
+    }
+    const OpReqType oreq = req[batchnorm::kOut];
+    CHECK(!param_.fuse_relu || oreq != kAddTo) << "fuse_relu does not support kAddTo";
+    if (param_.fix_gamma) std::fill(gamma, gamma + nchannel, 1.0f);
+
+    #pragma omp parallel for
+    for (int c = 0; c < static_cast<int>(nchannel); ++c) {
+      std::vector<AType> fx(kConvert ? spatial : 0), fy(kConvert ? spatial : 0);
+      real_t m, v;
+      if (batch_stats) {
+        ChannelStats(x, num, nchannel, spatial, c, fx.data(), &m, &v);
+        mean[c] = m;
+        var[c] = v;
+      } else {
+        m = moving_mean[c];
+        v = moving_var[c];
+      }
+      const real_t a = gamma[c] / std::sqrt(v + param_.eps);
+      const real_t b = beta[c] - a * m;
+      if (oreq == kNullOp) continue;
+      for (index_t n = 0; n < num; ++n) {
+        const size_t offset = (n * nchannel + c) * spatial;
+        const AType *xrow = float16::ToCompute(x + offset, spatial, fx.data());
+        AType *yrow = float16::ComputeOut(y + offset, fy.data());
+        if (oreq == kAddTo) float16::ToCompute(y + offset, spatial, yrow);
+        if (param_.fuse_relu) {
+          Scale<true>(xrow, spatial, a, b, oreq, yrow);
+        } else {
+          Scale<false>(xrow, spatial, a, b, oreq, yrow);
+        }
+        float16::FromCompute(yrow, spatial, y + offset);
+      }
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_states) {
+    CHECK_EQ(out_grad.size(), 1);
+    CHECK_EQ(in_data.size(), 3);
+    CHECK_EQ(out_data.size(), 3);
+    CHECK_EQ(in_grad.size(), 3);
+    const TShape &dshape = in_data[batchnorm::kData].shape_;
+    const index_t num = dshape[0], nchannel = dshape[1];
+    const index_t spatial = dshape.Size() / (num * nchannel);
+    const double count = static_cast<double>(num) * spatial;
+    const DType *x = in_data[batchnorm::kData].dptr<DType>();
+    const DType *dy = out_grad[batchnorm::kOut].dptr<DType>();
+    // the relu passes the gradient where the output is positive
+    const DType *y = param_.fuse_relu ? out_data[batchnorm::kOut].dptr<DType>() : nullptr;
+    DType *dx = in_grad[batchnorm::kData].dptr<DType>();
+    const real_t *gamma = in_data[batchnorm::kGamma].dptr<real_t>();
+    real_t *ggamma = in_grad[batchnorm::kGamma].dptr<real_t>();
+    real_t *gbeta = in_grad[batchnorm::kBeta].dptr<real_t>();
+    real_t *moving_mean = aux_states[batchnorm::kMovingMean].dptr<real_t>();
+    real_t *moving_var = aux_states[batchnorm::kMovingVar].dptr<real_t>();
+    const bool batch_stats = ctx.is_train && !param_.use_global_stats;
+    const real_t *mean = batch_stats ? out_data[batchnorm::kMean].dptr<real_t>() : moving_mean;
+    const real_t *var = batch_stats ? out_data[batchnorm::kVar].dptr<real_t>() : moving_var;
+    const real_t momentum = param_.momentum;
+
+    #pragma omp parallel for
+    for (int c = 0; c < static_cast<int>(nchannel); ++c) {
+      const index_t nbuf = kConvert ? spatial : 0;
+      std::vector<AType> fx(nbuf), fdy(nbuf), fy(y == nullptr ? 0 : nbuf), fdx(nbuf);
+      const AType *xrow, *dyrow, *yrow;
+      // the rows of channel c of image n in the compute type
+      auto read_rows = [&](index_t n) {
+        const size_t offset = (n * nchannel + c) * spatial;
+        xrow = float16::ToCompute(x + offset, spatial, fx.data());
+        dyrow = float16::ToCompute(dy + offset, spatial, fdy.data());
+        yrow = y == nullptr ? nullptr : float16::ToCompute(y + offset, spatial, fy.data());
+      };
+      const real_t m = mean[c];
+      const real_t invstd = 1.0f / std::sqrt(var[c] + param_.eps);
+      double sum_dy = 0.0, sum_dy_xmu = 0.0;
+      for (index_t n = 0; n < num; ++n) {
+        read_rows(n);
+        float row_dy = 0.0f, row_dy_xmu = 0.0f;
+        for (index_t i = 0; i < spatial; ++i) {
+          const float g = Grad(dyrow, yrow, i);
+          row_dy += g;
+          row_dy_xmu += g * (static_cast<float>(xrow[i]) - m);
+        }
+        sum_dy += row_dy;
+        sum_dy_xmu += row_dy_xmu;
+      }
+      AssignReq(gbeta + c, req[batchnorm::kBeta], static_cast<real_t>(sum_dy));
+      AssignReq(ggamma + c, req[batchnorm::kGamma],
+                param_.fix_gamma ? 0.0f : static_cast<real_t>(sum_dy_xmu * invstd));
+      // dx = g * k1 + x * k2 + k3, the last two terms are the gradients of the
+      // batch mean and variance and vanish with the global statistics
+      const real_t slope = param_.fix_gamma ? 1.0f : gamma[c];
+      const real_t k1 = slope * invstd;
+      real_t k2 = 0.0f, k3 = 0.0f;
+      if (batch_stats) {
+        const real_t mean_dy = static_cast<real_t>(sum_dy / count);
+        const real_t mean_dy_xmu = static_cast<real_t>(sum_dy_xmu / count) * invstd * invstd;
+        k2 = -k1 * mean_dy_xmu;
+        k3 = k1 * (mean_dy_xmu * m - mean_dy);
+        moving_mean[c] = moving_mean[c] * momentum + m * (1 - momentum);
+        moving_var[c] = moving_var[c] * momentum + var[c] * (1 - momentum);
+      }
+      if (req[batchnorm::kData] == kNullOp) continue;
+      const bool add_to = req[batchnorm::kData] == kAddTo;
+      for (index_t n = 0; n < num; ++n) {
+        const size_t offset = (n * nchannel + c) * spatial;
+        read_rows(n);
+        AType *dxrow = float16::ComputeOut(dx + offset, fdx.data());
+        if (add_to) float16::ToCompute(dx + offset, spatial, dxrow);
+        for (index_t i = 0; i < spatial; ++i) {
+          float v = Grad(dyrow, yrow, i) * k1 + static_cast<float>(xrow[i]) * k2 + k3;
+          if (add_to) v += static_cast<float>(dxrow[i]);
+          dxrow[i] = AType(v);
+        }
+        float16::FromCompute(dxrow, spatial, dx + offset);
+      }
+    }
+  }
+
+ private:
+  /*! \brief whether the rows are converted to AType */
+  static const bool kConvert = !std::is_same<DType, AType>::value;
+  /*!
+   * \brief the mean and the biased variance of channel c in one pass. The
+   *  values are shifted by the first value of the channel, so that the
+   *  variance does not cancel out for a large mean.
+   */
+  static void ChannelStats(const DType *x, index_t num, index_t nchannel,
+                           index_t spatial, index_t c, AType *buf,
+                           real_t *mean, real_t *var) {
+    const float shift = static_cast<float>(x[c * spatial]);
+    double sum = 0.0, sum_sq = 0.0;
+    for (index_t n = 0; n < num; ++n) {
+      const AType *row = float16::ToCompute(x + (n * nchannel + c) * spatial, spatial, buf);
+      float row_sum = 0.0f, row_sum_sq = 0.0f;
+      for (index_t i = 0; i < spatial; ++i) {
+        const float d = static_cast<float>(row[i]) - shift;
+        row_sum += d;
+        row_sum_sq += d * d;
+      }
+      sum += row_sum;
+      sum_sq += row_sum_sq;
+    }
+    const double count = static_cast<double>(num) * spatial;
+    const double m = sum / count;
+    *mean = static_cast<real_t>(m + shift);
+    *var = static_cast<real_t>(std::max(sum_sq / count - m * m, 0.0));
+  }
+  /*! \brief y = x * a + b, followed by a relu if kRelu, assigned by req */
+  template<bool kRelu>
+  static void Scale(const AType *x, index_t n, real_t a, real_t b,
+                    OpReqType req, AType *y) {
+    switch (req) {
+      case kNullOp:
+        break;
+      case kWriteTo:
+      case kWriteInplace:
+        for (index_t i = 0; i < n; ++i) {
+          const float v = static_cast<float>(x[i]) * a + b;
+          y[i] = AType(kRelu ? std::max(v, 0.0f) : v);
+        }
+        break;
+      case kAddTo:
+        for (index_t i = 0; i < n; ++i) {
+          const float v = static_cast<float>(x[i]) * a + b;
+          y[i] = AType(static_cast<float>(y[i]) + (kRelu ? std::max(v, 0.0f) : v));
+        }
+        break;
+      default:
+        LOG(FATAL) << "not reached";
+    }
+  }
+  /*! \brief the gradient of the normalized output at i */
+  static inline float Grad(const AType *dy, const AType *y, size_t i) {
+    const float g = static_cast<float>(dy[i]);
+    return (y == nullptr || static_cast<float>(y[i]) > 0.0f) ? g : 0.0f;
+  }
+  static inline void AssignReq(real_t *out, OpReqType req, real_t v) {
+    if (req == kWriteTo || req == kWriteInplace) {
+      *out = v;
+    } else if (req == kAddTo) {
+      *out += v;
+    }
+  }
+
+  BatchNormParam param_;
+};  // class BatchNormCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_BATCH_NORM_CPU_INL_H_
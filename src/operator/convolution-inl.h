@@ -327,6 +327,15 @@ class ConvolutionProp : public OperatorProperty {
 
   void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
     param_.Init(kwargs);
+    // the default stride and pad are 2d
+    if (param_.kernel.ndim() == 3) {
+      if (param_.stride.ndim() == 2 && param_.stride.Size() == 1) {
+        param_.stride = mshadow::Shape3(1, 1, 1);
+      }
+      if (param_.pad.ndim() == 2 && param_.pad.Size() == 0) {
+        param_.pad = mshadow::Shape3(0, 0, 0);
+      }
+    }
   }
 
   std::map<std::string, std::string> GetParams() const override {
@@ -404,7 +413,9 @@ class ConvolutionProp : public OperatorProperty {
           << "incorrect stride size: " << param_.stride;
       CHECK_GT(param_.dilate.Size(), 0) \
           << "incorrect dilate size: " << param_.dilate;
-      CHECK(ksize_d < dshape[2] + 2 * param_.pad[0]
+      CHECK_EQ(param_.stride.ndim(), 3) << "stride should be (d, y, x) for 3d convolution";
+      CHECK_EQ(param_.pad.ndim(), 3) << "pad should be (d, y, x) for 3d convolution";
+      CHECK(ksize_d <= dshape[2] + 2 * param_.pad[0]
             && ksize_y <= dshape[3] + 2 * param_.pad[1]
             && ksize_x <= dshape[4] + 2 * param_.pad[2])
           << "kernel size exceed input";
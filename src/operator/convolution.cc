@@ -6,6 +6,8 @@
 */
 
 #include "./convolution-inl.h"
+#include "./convolution_3d_cpu-inl.h"
+#include "./float16_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -20,6 +22,11 @@ Operator* CreateOp<cpu>(ConvolutionParam param, int dtype,
                         std::vector<TShape> *out_shape,
                         Context ctx) {
   Operator *op = NULL;
+  if (dtype == mshadow::kFloat16) {
+    // float16 storage, the float32 kernels compute
+    return new float16::Float16CPUOp(
+        CreateOp<cpu>(param, mshadow::kFloat32, in_shape, out_shape, ctx), false);
+  }
 #if MXNET_USE_MKL2017 == 1
   if ((param.dilate[0] == 1 && param.dilate[1] == 1)
       && param.kernel.ndim() == 2) {
@@ -33,6 +40,12 @@ Operator* CreateOp<cpu>(ConvolutionParam param, int dtype,
     }
   }
 #endif
+  if (param.kernel.ndim() == 3) {
+    MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
+      op = new Convolution3DCPUOp<DType>(param);
+    })
+    return op;
+  }
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
     op = new ConvolutionOp<cpu, DType>(param);
   })
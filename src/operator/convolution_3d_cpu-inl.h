@@ -0,0 +1,360 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file convolution_3d_cpu-inl.h
+ * \brief 3d convolution on cpu, see tools/conv3d_bench.py for benchmarks
+ */
+#ifndef MXNET_OPERATOR_CONVOLUTION_3D_CPU_INL_H_
+#define MXNET_OPERATOR_CONVOLUTION_3D_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <vector>
+#include "./convolution-inl.h"
+#include "./float16_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief 3d convolution of N x C x D x H x W data on cpu.
+ *
+ *  The patches of a sample are unpacked into a column matrix (vol2col), in
+ *  parallel over the channels, and multiplied with the weights of each group
+ *  by gemm. If the column matrix of a sample does not fit in the workspace, it
+ *  is unpacked and multiplied a few output planes at a time. A 1x1x1
+ *  convolution without stride and pad is a gemm on the data itself.
+ *
+ *  When a group has few input channels, e.g. the first layer on gray or color
+ *  volumes, the column matrix is many times the size of the data for little
+ *  compute, so the convolution is computed directly instead, in parallel over
+ *  the output planes in forward, and over the input planes and the weights in
+ *  backward. The sums are accumulated in float32 for float16 data.
+ */
+template<typename DType>
+class Convolution3DCPUOp : public Operator {
+  typedef typename float16::ComputeType<DType>::type AType;
+
+ public:
+  explicit Convolution3DCPUOp(ConvolutionParam p) : param_(p) {
+    CHECK_EQ(param_.kernel.ndim(), 3);
+    CHECK_EQ(param_.stride.ndim(), 3) << "3d convolution needs a 3d stride";
+    CHECK_EQ(param_.pad.ndim(), 3) << "3d convolution needs a 3d pad";
+    // convert MBytes first to Bytes and then to elements.
+    param_.workspace = (param_.workspace << 20) / sizeof(DType);
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(req[conv::kOut], kWriteTo);
+    size_t expected = param_.no_bias ? 2 : 3;
+    CHECK_EQ(in_data.size(), expected);
+    CHECK_EQ(out_data.size(), 1);
+    Stream<cpu> *s = ctx.get_stream<cpu>();
+    const Geometry g(param_, in_data[conv::kData].shape_, out_data[conv::kOut].shape_);
+    const DType *data = in_data[conv::kData].dptr<DType>();
+    DType *weight = in_data[conv::kWeight].dptr<DType>();
+    const DType *bias = param_.no_bias ? NULL : in_data[conv::kBias].dptr<DType>();
+    DType *out = out_data[conv::kOut].dptr<DType>();
+
+    if (g.UseDirect()) {
+      #pragma omp parallel for
+      for (int p = 0; p < g.n * g.f; ++p) {
+        const int n = p / g.f, f = p % g.f, group = f / g.fg;
+        std::vector<AType> acc(g.out_size, bias == NULL ? AType(0) : AType(bias[f]));
+        for (int ci = 0; ci < g.cg; ++ci) {
+          const DType *src = data + (n * g.c + group * g.cg + ci) * g.in_size;
+          const DType *wk = weight + (f * g.cg + ci) * g.ksize;
+          g.ForEachTap([&](int t, int a, int b, int e) {
+              const AType wv = wk[t];
+              g.ForEachRow(a, b, e, 0, g.od, [&](size_t o, ptrdiff_t i, int lo, int hi) {
+                  for (int j = lo; j < hi; ++j) acc[o + j] += wv * AType(src[i + j * g.sw]);
+                });
+            });
+        }
+        DType *dst = out + p * g.out_size;
+        for (size_t i = 0; i < g.out_size; ++i) dst[i] = DType(acc[i]);
+      }
+      return;
+    }
+    const int dstep = g.DepthStep(param_.workspace);
+    DType *col = ColSpace(ctx, g, dstep);
+    const index_t krows = g.cg * g.ksize;
+    for (int n = 0; n < g.n; ++n) {
+      for (int z0 = 0; z0 < g.od; z0 += dstep) {
+        const int z1 = std::min(z0 + dstep, g.od);
+        const index_t csize = (z1 - z0) * g.plane_size;
+        DType *colp = Unpack(g, data + n * g.c * g.in_size, z0, z1, col);
+        for (int group = 0; group < g.group; ++group) {
+          Tensor<cpu, 2, DType> wmat(weight + group * g.fg * krows, Shape2(g.fg, krows), s);
+          Tensor<cpu, 2, DType> cmat(colp + group * krows * csize, Shape2(krows, csize), s);
+          Tensor<cpu, 2, DType> omat(out + (n * g.f + group * g.fg) * g.out_size +
+                                     z0 * g.plane_size, Shape2(g.fg, csize), g.out_size, s);
+          omat = dot(wmat, cmat);
+        }
+      }
+    }
+    if (bias != NULL) {
+      #pragma omp parallel for
+      for (int p = 0; p < g.n * g.f; ++p) {
+        DType *dst = out + p * g.out_size;
+        const DType b = bias[p % g.f];
+        for (size_t i = 0; i < g.out_size; ++i) dst[i] += b;
+      }
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(out_grad.size(), 1);
+    size_t expected = param_.no_bias == 0 ? 3 : 2;
+    CHECK(in_data.size() == expected && in_grad.size() == expected);
+    CHECK_EQ(req.size(), expected);
+    Stream<cpu> *s = ctx.get_stream<cpu>();
+    const Geometry g(param_, in_data[conv::kData].shape_, out_grad[conv::kOut].shape_);
+    const DType *data = in_data[conv::kData].dptr<DType>();
+    DType *weight = in_data[conv::kWeight].dptr<DType>();
+    DType *grad = out_grad[conv::kOut].dptr<DType>();
+    DType *gdata = in_grad[conv::kData].dptr<DType>();
+    DType *gweight = in_grad[conv::kWeight].dptr<DType>();
+    const OpReqType dreq = req[conv::kData], wreq = req[conv::kWeight];
+
+    if (g.UseDirect()) {
+      if (wreq != kNullOp) {
+        #pragma omp parallel for
+        for (int q = 0; q < g.f * g.cg; ++q) {
+          const int f = q / g.cg, ci = q % g.cg, group = f / g.fg;
+          g.ForEachTap([&](int t, int a, int b, int e) {
+              AType acc = AType(0);
+              for (int n = 0; n < g.n; ++n) {
+                const DType *src = data + (n * g.c + group * g.cg + ci) * g.in_size;
+                const DType *dy = grad + (n * g.f + f) * g.out_size;
+                g.ForEachRow(a, b, e, 0, g.od, [&](size_t o, ptrdiff_t i, int lo, int hi) {
+                    for (int j = lo; j < hi; ++j) {
+                      acc += AType(dy[o + j]) * AType(src[i + j * g.sw]);
+                    }
+                  });
+              }
+              Write(gweight + q * g.ksize + t, wreq, DType(acc));
+            });
+        }
+      }
+      if (dreq != kNullOp) {
+        #pragma omp parallel for
+        for (int p = 0; p < g.n * g.c; ++p) {
+          const int n = p / g.c, c = p % g.c, group = c / g.cg, ci = c % g.cg;
+          DType *dst = gdata + p * g.in_size;
+          std::vector<AType> acc(g.in_size, AType(0));
+          if (dreq == kAddTo) std::copy(dst, dst + g.in_size, acc.begin());
+          for (int fo = 0; fo < g.fg; ++fo) {
+            const int f = group * g.fg + fo;
+            const DType *wk = weight + (f * g.cg + ci) * g.ksize;
+            const DType *dy = grad + (n * g.f + f) * g.out_size;
+            g.ForEachTap([&](int t, int a, int b, int e) {
+                const AType wv = wk[t];
+                g.ForEachRow(a, b, e, 0, g.od, [&](size_t o, ptrdiff_t i, int lo, int hi) {
+                    for (int j = lo; j < hi; ++j) acc[i + j * g.sw] += wv * AType(dy[o + j]);
+                  });
+              });
+          }
+          for (size_t i = 0; i < g.in_size; ++i) dst[i] = DType(acc[i]);
+        }
+      }
+    } else {
+      const int dstep = g.DepthStep(param_.workspace);
+      DType *col = ColSpace(ctx, g, dstep);
+      const index_t krows = g.cg * g.ksize;
+      for (int n = 0; n < g.n; ++n) {
+        DType *dst = gdata + n * g.c * g.in_size;
+        if (dreq != kNullOp && dreq != kAddTo && !g.IsPointwise()) {
+          std::fill(dst, dst + g.c * g.in_size, DType(0));
+        }
+        for (int z0 = 0; z0 < g.od; z0 += dstep) {
+          const int z1 = std::min(z0 + dstep, g.od);
+          const index_t csize = (z1 - z0) * g.plane_size;
+          DType *colp = Unpack(g, data + n * g.c * g.in_size, z0, z1, col);
+          for (int group = 0; group < g.group; ++group) {
+            Tensor<cpu, 2, DType> dymat(grad + (n * g.f + group * g.fg) * g.out_size +
+                                        z0 * g.plane_size, Shape2(g.fg, csize), g.out_size, s);
+            Tensor<cpu, 2, DType> cmat(colp + group * krows * csize, Shape2(krows, csize), s);
+            Tensor<cpu, 2, DType> gwmat(gweight + group * g.fg * krows,
+                                        Shape2(g.fg, krows), s);
+            if (n == 0 && z0 == 0) {
+              Assign(gwmat, wreq, dot(dymat, cmat.T()));
+            } else if (wreq != kNullOp) {
+              gwmat += dot(dymat, cmat.T());
+            }
+          }
+          if (dreq == kNullOp) continue;
+          // the gradient of the columns, which are the data itself if pointwise
+          DType *dcol = g.IsPointwise() ? dst : col;
+          for (int group = 0; group < g.group; ++group) {
+            Tensor<cpu, 2, DType> wmat(weight + group * g.fg * krows, Shape2(g.fg, krows), s);
+            Tensor<cpu, 2, DType> dymat(grad + (n * g.f + group * g.fg) * g.out_size +
+                                        z0 * g.plane_size, Shape2(g.fg, csize), g.out_size, s);
+            Tensor<cpu, 2, DType> dcmat(dcol + group * krows * csize, Shape2(krows, csize), s);
+            if (g.IsPointwise()) {
+              Assign(dcmat, dreq, dot(wmat.T(), dymat));
+            } else {
+              dcmat = dot(wmat.T(), dymat);
+            }
+          }
+          if (!g.IsPointwise()) Col2Vol(g, col, z0, z1, dst);
+        }
+      }
+    }
+    if (!param_.no_bias && req[conv::kBias] != kNullOp) {
+      DType *gbias = in_grad[conv::kBias].dptr<DType>();
+      #pragma omp parallel for
+      for (int f = 0; f < g.f; ++f) {
+        AType acc = AType(0);
+        for (int n = 0; n < g.n; ++n) {
+          const DType *dy = grad + (n * g.f + f) * g.out_size;
+          for (size_t i = 0; i < g.out_size; ++i) acc += AType(dy[i]);
+        }
+        Write(gbias + f, req[conv::kBias], DType(acc));
+      }
+    }
+  }
+
+ private:
+  /*! \brief the sizes of the data, the output and the kernel */
+  struct Geometry {
+    int n, c, d, h, w, f, od, oh, ow;
+    int kd, kh, kw, sd, sh, sw, pd, ph, pw;
+    int group, cg, fg, ksize;
+    size_t in_size, out_size, plane_size;
+    Geometry(const ConvolutionParam &param, const TShape &ishape, const TShape &oshape) {
+      CHECK_EQ(ishape.ndim(), 5);
+      n = ishape[0]; c = ishape[1]; d = ishape[2]; h = ishape[3]; w = ishape[4];
+      f = oshape[1]; od = oshape[2]; oh = oshape[3]; ow = oshape[4];
+      kd = param.kernel[0]; kh = param.kernel[1]; kw = param.kernel[2];
+      sd = param.stride[0]; sh = param.stride[1]; sw = param.stride[2];
+      pd = param.pad[0]; ph = param.pad[1]; pw = param.pad[2];
+      group = param.num_group;
+      cg = c / group;
+      fg = f / group;
+      ksize = kd * kh * kw;
+      in_size = static_cast<size_t>(d) * h * w;
+      plane_size = static_cast<size_t>(oh) * ow;
+      out_size = od * plane_size;
+    }
+    /*! \brief whether to skip vol2col, and the gemm with it */
+    inline bool UseDirect() const {
+      return cg <= kDirectMaxChannels && !IsPointwise();
+    }
+    /*! \brief whether the column matrix is the data */
+    inline bool IsPointwise() const {
+      return ksize == 1 && sd == 1 && sh == 1 && sw == 1 && pd == 0 && ph == 0 && pw == 0;
+    }
+    /*!
+     * \brief the number of output planes whose column matrix fits in workspace
+     *  elements, at least one, as nstep of the 2d convolution
+     */
+    inline int DepthStep(size_t workspace) const {
+      if (IsPointwise()) return od;
+      const size_t plane_cols = static_cast<size_t>(c) * ksize * plane_size;
+      return static_cast<int>(std::max<size_t>(1, std::min<size_t>(od, workspace / plane_cols)));
+    }
+    /*! \brief call op(t, a, b, e) for tap t at depth a, row b and column e of the kernel */
+    template<typename Op>
+    inline void ForEachTap(Op op) const {
+      int t = 0;
+      for (int a = 0; a < kd; ++a) {
+        for (int b = 0; b < kh; ++b) {
+          for (int e = 0; e < kw; ++e) op(t++, a, b, e);
+        }
+      }
+    }
+    /*!
+     * \brief call op(o, i, lo, hi) for the rows of output planes [z0, z1) for
+     *  which tap (a, b, e) is inside the input, where output column j in
+     *  [lo, hi) of the row at o from plane z0 reads input i + j * sw. The
+     *  padding is skipped.
+     */
+    template<typename Op>
+    inline void ForEachRow(int a, int b, int e, int z0, int z1, Op op) const {
+      const int off = e - pw;
+      const int lo = off >= 0 ? 0 : (-off + sw - 1) / sw;
+      const int hi = off >= w ? 0 : std::min(ow, (w - 1 - off) / sw + 1);
+      if (lo >= hi) return;
+      for (int z = z0; z < z1; ++z) {
+        const int iz = z * sd - pd + a;
+        if (iz < 0 || iz >= d) continue;
+        for (int y = 0; y < oh; ++y) {
+          const int iy = y * sh - ph + b;
+          if (iy < 0 || iy >= h) continue;
+          op(static_cast<size_t>((z - z0) * oh + y) * ow,
+             static_cast<ptrdiff_t>(iz * h + iy) * w + off, lo, hi);
+        }
+      }
+    }
+  };
+  /*! \brief groups with at most this many input channels are convolved directly */
+  static const int kDirectMaxChannels = 4;
+
+  /*! \brief the space of the column matrix of dstep output planes of a sample */
+  inline DType *ColSpace(const OpContext &ctx, const Geometry &g, int dstep) {
+    if (g.IsPointwise()) return NULL;
+    const size_t required_size = static_cast<size_t>(g.c) * g.ksize * dstep * g.plane_size;
+    return ctx.requested[conv::kTempSpace].get_space_typed<cpu, 1, DType>(
+        mshadow::Shape1(required_size), ctx.get_stream<cpu>()).dptr_;
+  }
+  /*!
+   * \brief the column matrix of output planes [z0, z1) of a sample, unpacked
+   *  into col unless pointwise
+   */
+  static DType *Unpack(const Geometry &g, const DType *src, int z0, int z1, DType *col) {
+    if (g.IsPointwise()) return const_cast<DType*>(src);
+    const size_t csize = (z1 - z0) * g.plane_size;
+    #pragma omp parallel for
+    for (int c = 0; c < g.c; ++c) {
+      const DType *vol = src + c * g.in_size;
+      g.ForEachTap([&](int t, int a, int b, int e) {
+          DType *row = col + (static_cast<size_t>(c) * g.ksize + t) * csize;
+          std::fill(row, row + csize, DType(0));
+          g.ForEachRow(a, b, e, z0, z1, [&](size_t o, ptrdiff_t i, int lo, int hi) {
+              for (int j = lo; j < hi; ++j) row[o + j] = vol[i + j * g.sw];
+            });
+        });
+    }
+    return col;
+  }
+  /*! \brief add the column matrix of output planes [z0, z1) of a sample to its volumes */
+  static void Col2Vol(const Geometry &g, const DType *col, int z0, int z1, DType *dst) {
+    const size_t csize = (z1 - z0) * g.plane_size;
+    #pragma omp parallel for
+    for (int c = 0; c < g.c; ++c) {
+      DType *vol = dst + c * g.in_size;
+      g.ForEachTap([&](int t, int a, int b, int e) {
+          const DType *row = col + (static_cast<size_t>(c) * g.ksize + t) * csize;
+          g.ForEachRow(a, b, e, z0, z1, [&](size_t o, ptrdiff_t i, int lo, int hi) {
+              for (int j = lo; j < hi; ++j) vol[i + j * g.sw] += row[o + j];
+            });
+        });
+    }
+  }
+  static inline void Write(DType *out, OpReqType req, DType v) {
+    if (req == kAddTo) {
+      *out += v;
+    } else if (req != kNullOp) {
+      *out = v;
+    }
+  }
+
+  ConvolutionParam param_;
+};  // class Convolution3DCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_CONVOLUTION_3D_CPU_INL_H_
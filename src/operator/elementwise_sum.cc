@@ -4,6 +4,7 @@
  * \brief elementwise sum operator
 */
 #include "./elementwise_sum-inl.h"
+#include "./float16_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -15,6 +16,10 @@ namespace op {
 template<>
 Operator* CreateOp<cpu>(ElementWiseSumParam param, int dtype) {
   Operator *op = NULL;
+  if (dtype == mshadow::kFloat16) {
+    // float16 storage, summed in float32 on blocks of the tensors
+    return new float16::Float16CPUOp(CreateOp<cpu>(param, mshadow::kFloat32), true);
+  }
 #if MXNET_USE_MKL2017 == 1
   switch (dtype) {
   case mshadow::kFloat32:
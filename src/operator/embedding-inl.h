@@ -15,6 +15,7 @@
 #include <string>
 #include <utility>
 #include "./operator_common.h"
+#include "./sparse_grad_op_common.h"
 
 namespace mxnet {
 namespace op {
@@ -23,16 +24,20 @@ namespace embedding {
 enum EmbeddingOpInputs {kData, kWeight};
 enum EmbeddingOpOutputs {kOut};
 enum EmbeddingOpResource {kTempSpace};
+enum EmbeddingOpAuxiliary {kTouchedRows};
 }  // namespace embedding
 
 struct EmbeddingParam: public dmlc::Parameter<EmbeddingParam> {
   int input_dim;
   int output_dim;
+  bool sparse_grad;
   DMLC_DECLARE_PARAMETER(EmbeddingParam) {
     DMLC_DECLARE_FIELD(input_dim).set_lower_bound(1)
     .describe("input dim of one-hot encoding");
     DMLC_DECLARE_FIELD(output_dim).set_lower_bound(1)
     .describe("output dim of embedding");
+    DMLC_DECLARE_FIELD(sparse_grad).set_default(false)
+    .describe(SparseGradDescription("weight gradient"));
   }
 };
 
@@ -140,6 +145,14 @@ class EmbeddingProp : public OperatorProperty {
     param_.Init(kwargs);
   }
 
+  std::vector<std::string> ListAuxiliaryStates() const override {
+    if (param_.sparse_grad) {
+      return {"touched_rows"};
+    } else {
+      return {};
+    }
+  }
+
   std::map<std::string, std::string> GetParams() const override {
     return param_.__DICT__();
   }
@@ -152,6 +165,11 @@ class EmbeddingProp : public OperatorProperty {
     if (dshape.ndim() ==  0) return false;
     SHAPE_ASSIGN_CHECK(*in_shape, embedding::kWeight, Shape2(param_.input_dim,
                                                           param_.output_dim));
+    aux_shape->clear();
+    if (param_.sparse_grad) {
+      // the number of rows, then the rows, whatever the batch size
+      aux_shape->push_back(Shape1(param_.input_dim + 1));
+    }
     out_shape->clear();
 
     TShape oshape(dshape.ndim()+1);
@@ -181,6 +199,8 @@ class EmbeddingProp : public OperatorProperty {
     }
     out_type->clear();
     out_type->push_back(dtype);
+    aux_type->clear();
+    if (param_.sparse_grad) aux_type->push_back(mshadow::kInt32);
     return true;
   }
 
@@ -6,13 +6,14 @@
 */
 
 #include "./embedding-inl.h"
+#include "./embedding_cpu-inl.h"
 namespace mxnet {
 namespace op {
 template<>
 Operator* CreateOp<cpu>(EmbeddingParam param, int dtype) {
   Operator *op = NULL;
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    op = new EmbeddingOp<cpu, DType>(param);
+    op = new EmbeddingCPUOp<DType>(param);
   });
   return op;
 }
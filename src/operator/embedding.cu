@@ -11,6 +11,7 @@ namespace op {
 template<>
 Operator* CreateOp<gpu>(EmbeddingParam param, int dtype) {
   Operator *op = NULL;
+  CHECK(!param.sparse_grad) << "Embedding: sparse_grad is only supported on cpu";
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
     op = new EmbeddingOp<gpu, DType>(param);
   });
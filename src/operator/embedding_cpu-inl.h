@@ -0,0 +1,161 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file embedding_cpu-inl.h
+ * \brief embedding on cpu with a sorted scatter backward
+ */
+#ifndef MXNET_OPERATOR_EMBEDDING_CPU_INL_H_
+#define MXNET_OPERATOR_EMBEDDING_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "./embedding-inl.h"
+#include "./float16_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief embedding on cpu. The backward sorts the indices of the batch with
+ *  their positions, in parallel, so that every distinct row of the weight
+ *  gradient is the sum of a run of rows of the output gradient. Each distinct
+ *  row is summed by one thread in a vectorized loop, without atomics, and the
+ *  other rows of the gradient are not read.
+ *
+ *  With sparse_grad, the rows written are listed in the touched_rows
+ *  auxiliary state and a kWriteTo backward only zeroes the rows of the previous
+ *  one, see TouchedRows.
+ */
+template<typename DType>
+class EmbeddingCPUOp : public Operator {
+  /*! \brief the type the gradient is summed in */
+  typedef typename float16::ComputeType<DType>::type AType;
+
+ public:
+  explicit EmbeddingCPUOp(EmbeddingParam p) : param_(p) {}
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(req[embedding::kOut], kWriteTo);
+    CHECK_EQ(in_data.size(), 2);
+    CHECK_EQ(out_data.size(), 1);
+    const index_t n = in_data[embedding::kData].Size();
+    const index_t dim = param_.output_dim;
+    const DType *data = in_data[embedding::kData].dptr<DType>();
+    const DType *weight = in_data[embedding::kWeight].dptr<DType>();
+    DType *out = out_data[embedding::kOut].dptr<DType>();
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      const DType *row = weight + Row(data[i]) * dim;
+      std::copy(row, row + dim, out + i * dim);
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(out_grad.size(), 1);
+    CHECK_EQ(in_grad.size(), 2);
+    CHECK_EQ(req[embedding::kData], kNullOp)
+      << "Embedding layer doesn't support calculate data gradient";
+    const OpReqType wreq = req[embedding::kWeight];
+    if (wreq == kNullOp) return;
+    const index_t n = in_data[embedding::kData].Size();
+    const index_t dim = param_.output_dim;
+    const DType *data = in_data[embedding::kData].dptr<DType>();
+    const DType *ograd = out_grad[embedding::kOut].dptr<DType>();
+    DType *grad = in_grad[embedding::kWeight].dptr<DType>();
+    int *touched = param_.sparse_grad ? aux_args[embedding::kTouchedRows].dptr<int>() : NULL;
+
+    // the (row, position) of the indices sorted, and the start of the run of
+    // each distinct row
+    std::vector<std::pair<int, int> > order(n);
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      order[i] = std::make_pair(static_cast<int>(Row(data[i])), i);
+    }
+    SortRows(&order);
+    std::vector<int> starts;
+    for (index_t i = 0; i < n; ++i) {
+      if (i == 0 || order[i].first != order[i - 1].first) starts.push_back(i);
+    }
+    const int nrow = static_cast<int>(starts.size());
+    starts.push_back(n);
+
+    if (wreq != kAddTo) touched_rows_.Clear<DType>({{grad, dim}}, param_.input_dim, touched);
+    #pragma omp parallel
+    {
+      std::vector<AType> acc(dim), buf(kConvert ? dim : 0);
+      // the runs of frequent rows are long
+      #pragma omp for schedule(dynamic, 16)
+      for (int r = 0; r < nrow; ++r) {
+        DType *dst = grad + order[starts[r]].first * dim;
+        if (wreq == kAddTo) {
+          const AType *cur = float16::ToCompute(dst, dim, buf.data());
+          std::copy(cur, cur + dim, acc.begin());
+        } else {
+          std::fill(acc.begin(), acc.end(), AType(0));
+        }
+        for (int k = starts[r]; k < starts[r + 1]; ++k) {
+          const AType *g = float16::ToCompute(ograd + order[k].second * dim, dim, buf.data());
+          for (index_t j = 0; j < dim; ++j) acc[j] += g[j];
+        }
+        float16::FromCompute(acc.data(), dim, dst);
+      }
+    }
+    if (touched != NULL) {
+      std::vector<int> rows(nrow);
+      for (int r = 0; r < nrow; ++r) rows[r] = order[starts[r]].first;
+      TouchedRows::Set(touched, rows, wreq == kAddTo);
+    }
+  }
+
+ private:
+  /*! \brief whether the gradient rows are converted to AType */
+  static const bool kConvert = !std::is_same<DType, AType>::value;
+  /*! \brief the least number of indices sorted by a thread */
+  static const int kMinChunk = 1024;
+
+  /*! \brief the row of an index, clipped to the table as take does */
+  inline index_t Row(DType v) const {
+    const int row = static_cast<int>(static_cast<float>(v));
+    return static_cast<index_t>(std::min(std::max(row, 0), param_.input_dim - 1));
+  }
+  /*! \brief sort chunks of the pairs in parallel, then merge them pairwise in parallel */
+  static void SortRows(std::vector<std::pair<int, int> > *order) {
+    const int n = static_cast<int>(order->size());
+    const int nchunk = std::max(1, std::min(omp_get_max_threads(), n / kMinChunk));
+    std::vector<int> bounds(nchunk + 1);
+    for (int i = 0; i <= nchunk; ++i) {
+      bounds[i] = static_cast<int>(static_cast<int64_t>(n) * i / nchunk);
+    }
+    auto begin = order->begin();
+    #pragma omp parallel for
+    for (int i = 0; i < nchunk; ++i) {
+      std::sort(begin + bounds[i], begin + bounds[i + 1]);
+    }
+    for (int width = 1; width < nchunk; width *= 2) {
+      #pragma omp parallel for
+      for (int i = 0; i < nchunk - width; i += 2 * width) {
+        std::inplace_merge(begin + bounds[i], begin + bounds[i + width],
+                           begin + bounds[std::min(i + 2 * width, nchunk)]);
+      }
+    }
+  }
+
+  EmbeddingParam param_;
+  TouchedRows touched_rows_;
+};  // class EmbeddingCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_EMBEDDING_CPU_INL_H_
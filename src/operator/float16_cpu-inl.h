@@ -0,0 +1,281 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file float16_cpu-inl.h
+ * \brief float16 storage with float32 compute on cpu
+ */
+#ifndef MXNET_OPERATOR_FLOAT16_CPU_INL_H_
+#define MXNET_OPERATOR_FLOAT16_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MXNET_USE_F16C 1
+#else
+#define MXNET_USE_F16C 0
+#endif
+
+namespace mxnet {
+namespace op {
+namespace float16 {
+using mshadow::half::half_t;
+
+#if MXNET_USE_F16C
+/*!
+ * \brief whether the cpu converts float16 in hardware. The conversions are
+ *  compiled for f16c whatever the build flags and chosen at runtime. Every
+ *  cpu with avx2 has f16c.
+ */
+inline bool UseF16C() {
+  static const bool use = __builtin_cpu_supports("avx2");
+  return use;
+}
+
+__attribute__((target("avx,f16c")))
+inline void HalfToFloatF16C(const uint16_t *src, float *dst, index_t n) {
+  index_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  for (; i < n; ++i) dst[i] = _cvtsh_ss(src[i]);
+}
+
+__attribute__((target("avx,f16c")))
+inline void FloatToHalfF16C(const float *src, uint16_t *dst, index_t n) {
+  index_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+  }
+  for (; i < n; ++i) dst[i] = _cvtss_sh(src[i], _MM_FROUND_TO_NEAREST_INT);
+}
+#endif  // MXNET_USE_F16C
+
+/*! \brief convert n float16 values to float32 */
+inline void HalfToFloat(const half_t *src, float *dst, index_t n) {
+#if MXNET_USE_F16C
+  if (UseF16C()) {
+    HalfToFloatF16C(reinterpret_cast<const uint16_t*>(src), dst, n);
+    return;
+  }
+#endif
+  for (index_t i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+/*! \brief convert n float32 values to float16 */
+inline void FloatToHalf(const float *src, half_t *dst, index_t n) {
+#if MXNET_USE_F16C
+  if (UseF16C()) {
+    FloatToHalfF16C(src, reinterpret_cast<uint16_t*>(dst), n);
+    return;
+  }
+#endif
+  for (index_t i = 0; i < n; ++i) dst[i] = half_t(src[i]);
+}
+
+/*! \brief the type a cpu kernel computes in for data of DType, float32 for float16 */
+template<typename DType>
+struct ComputeType {
+  typedef DType type;
+};
+template<>
+struct ComputeType<half_t> {
+  typedef float type;
+};
+
+/*! \brief n values of src in the compute type, src itself or converted to buf */
+template<typename DType>
+inline const DType *ToCompute(const DType *src, index_t n, DType *buf) {
+  return src;
+}
+inline const float *ToCompute(const half_t *src, index_t n, float *buf) {
+  HalfToFloat(src, buf, n);
+  return buf;
+}
+
+/*! \brief where to compute values to be stored in dst, dst itself or buf */
+template<typename DType>
+inline DType *ComputeOut(DType *dst, DType *buf) {
+  return dst;
+}
+inline float *ComputeOut(half_t *dst, float *buf) {
+  return buf;
+}
+
+/*! \brief store n values computed in ComputeOut(dst, buf) to dst */
+template<typename DType>
+inline void FromCompute(const DType *src, index_t n, DType *dst) {
+  if (src != dst) std::copy(src, src + n, dst);
+}
+inline void FromCompute(const float *src, index_t n, half_t *dst) {
+  FloatToHalf(src, dst, n);
+}
+
+/*!
+ * \brief run a float32 operator on float16 tensors. The float16 tensors read
+ *  by the operator are converted to float32, the operator runs on the float32
+ *  copies, and the float16 tensors written are converted back. Tensors of other
+ *  types are passed as they are.
+ *
+ *  Operators that need whole tensors, such as convolution, get float32 copies
+ *  of whole tensors in the host space of their temp space resource, which must
+ *  be the first resource they request. The kernels they run on cpu only use
+ *  the device space of the resource.
+ *
+ *  Elementwise operators, whose tensors all have the same size, run on blocks
+ *  that stay in cache, in parallel, so the float16 tensors are read and written
+ *  once. The blocks are computed by concurrent calls of the wrapped operator,
+ *  so it must be stateless: it keeps nothing between calls, and has no aux
+ *  states or resources.
+ */
+class Float16CPUOp : public Operator {
+ public:
+  Float16CPUOp(Operator *op, bool elementwise) : op_(op), elementwise_(elementwise) {}
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    CHECK(!elementwise_ || aux_args.empty())
+        << "an elementwise float16 operator must be stateless";
+    std::vector<TBlob> blobs(in_data);
+    blobs.insert(blobs.end(), aux_args.begin(), aux_args.end());
+    std::vector<OpReqType> blob_req(in_data.size(), kNullOp);
+    // aux states are read and written
+    blob_req.resize(blobs.size(), kWriteInplace);
+    blobs.insert(blobs.end(), out_data.begin(), out_data.end());
+    blob_req.insert(blob_req.end(), req.begin(), req.end());
+    Run(ctx, blobs, blob_req, [&](const std::vector<TBlob> &fblobs) {
+      auto it = fblobs.begin();
+      std::vector<TBlob> fin(it, it + in_data.size());
+      it += in_data.size();
+      std::vector<TBlob> faux(it, it + aux_args.size());
+      it += aux_args.size();
+      std::vector<TBlob> fout(it, fblobs.end());
+      op_->Forward(ctx, fin, req, fout, faux);
+    });
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    std::vector<TBlob> blobs(out_grad);
+    blobs.insert(blobs.end(), in_data.begin(), in_data.end());
+    blobs.insert(blobs.end(), out_data.begin(), out_data.end());
+    std::vector<OpReqType> blob_req(blobs.size(), kNullOp);
+    blobs.insert(blobs.end(), aux_args.begin(), aux_args.end());
+    blob_req.resize(blobs.size(), kWriteInplace);
+    blobs.insert(blobs.end(), in_grad.begin(), in_grad.end());
+    blob_req.insert(blob_req.end(), req.begin(), req.end());
+    Run(ctx, blobs, blob_req, [&](const std::vector<TBlob> &fblobs) {
+      auto it = fblobs.begin();
+      std::vector<TBlob> fout_grad(it, it + out_grad.size());
+      it += out_grad.size();
+      std::vector<TBlob> fin(it, it + in_data.size());
+      it += in_data.size();
+      std::vector<TBlob> fout(it, it + out_data.size());
+      it += out_data.size();
+      std::vector<TBlob> faux(it, it + aux_args.size());
+      it += aux_args.size();
+      std::vector<TBlob> fin_grad(it, fblobs.end());
+      op_->Backward(ctx, fout_grad, fin, fout, req, fin_grad, faux);
+    });
+  }
+
+ private:
+  /*! \brief the block size of elementwise operators, in values */
+  static const index_t kBlock = 4096;
+
+  static bool IsHalf(const TBlob &blob) {
+    return blob.dptr_ != NULL && blob.type_flag_ == mshadow::kFloat16;
+  }
+  /*! \brief whether a blob with req is read, kNullOp marks the blobs only read */
+  static bool IsRead(OpReqType req) {
+    return req == kNullOp || req == kWriteInplace || req == kAddTo;
+  }
+  /*!
+   * \brief call f with the float16 blobs replaced by float32 copies of values
+   *  [begin, begin + size), as 1D blobs, then write the float16 blobs back
+   */
+  template<typename F>
+  static void RunBlock(const std::vector<TBlob> &blobs, const std::vector<OpReqType> &req,
+                       index_t begin, index_t size, float *buf, F f) {
+    std::vector<TBlob> fblobs(blobs);
+    float *next = buf;
+    for (size_t i = 0; i < blobs.size(); ++i) {
+      if (!IsHalf(blobs[i])) continue;
+      fblobs[i] = TBlob(next, mshadow::Shape1(size), cpu::kDevMask);
+      if (IsRead(req[i])) HalfToFloat(blobs[i].dptr<half_t>() + begin, next, size);
+      next += size;
+    }
+    f(fblobs);
+    for (size_t i = 0; i < blobs.size(); ++i) {
+      if (!IsHalf(blobs[i]) || req[i] == kNullOp) continue;
+      FloatToHalf(fblobs[i].dptr<float>(), blobs[i].dptr<half_t>() + begin, size);
+    }
+  }
+
+  template<typename F>
+  void Run(const OpContext &ctx, const std::vector<TBlob> &blobs,
+           const std::vector<OpReqType> &req, F f) {
+    if (!elementwise_) {
+      size_t total = 0;
+      for (const TBlob &blob : blobs) {
+        if (IsHalf(blob)) total += blob.Size();
+      }
+      CHECK(!ctx.requested.empty() &&
+            ctx.requested[0].req.type == ResourceRequest::kTempSpace)
+          << "a float16 operator needs the temp space for its float32 copies";
+      std::vector<TBlob> fblobs(blobs);
+      float *next = ctx.requested[0].get_host_space_typed<1, float>(
+          mshadow::Shape1(total)).dptr_;
+      for (size_t i = 0; i < blobs.size(); ++i) {
+        if (!IsHalf(blobs[i])) continue;
+        fblobs[i] = TBlob(next, blobs[i].shape_, cpu::kDevMask);
+        if (IsRead(req[i])) HalfToFloat(blobs[i].dptr<half_t>(), next, blobs[i].Size());
+        next += blobs[i].Size();
+      }
+      f(fblobs);
+      for (size_t i = 0; i < blobs.size(); ++i) {
+        if (!IsHalf(blobs[i]) || req[i] == kNullOp) continue;
+        FloatToHalf(fblobs[i].dptr<float>(), blobs[i].dptr<half_t>(), blobs[i].Size());
+      }
+      return;
+    }
+    CHECK(ctx.requested.empty()) << "an elementwise float16 operator must be stateless";
+    index_t size = 0, nhalf = 0;
+    for (const TBlob &blob : blobs) {
+      if (blob.dptr_ == NULL) continue;
+      CHECK_EQ(blob.type_flag_, mshadow::kFloat16)
+          << "the tensors of an elementwise float16 operator must be float16";
+      if (nhalf++ == 0) size = blob.Size();
+      CHECK_EQ(blob.Size(), size) << "the tensors of an elementwise operator differ in size";
+    }
+    const int nblock = static_cast<int>((size + kBlock - 1) / kBlock);
+    #pragma omp parallel
+    {
+      std::vector<float> buf(nhalf * kBlock);
+      #pragma omp for
+      for (int b = 0; b < nblock; ++b) {
+        const index_t begin = b * kBlock;
+        RunBlock(blobs, req, begin, std::min(kBlock, size - begin), buf.data(), f);
+      }
+    }
+  }
+
+  std::unique_ptr<Operator> op_;
+  bool elementwise_;
+};  // class Float16CPUOp
+}  // namespace float16
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_FLOAT16_CPU_INL_H_
@@ -4,6 +4,7 @@
  * \brief fully connect operator
 */
 #include "./fully_connected-inl.h"
+#include "./float16_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -15,6 +16,10 @@ namespace op {
 template<>
 Operator* CreateOp<cpu>(FullyConnectedParam param, int dtype) {
   Operator *op = NULL;
+  if (dtype == mshadow::kFloat16) {
+    // float16 storage, the float32 kernels compute
+    return new float16::Float16CPUOp(CreateOp<cpu>(param, mshadow::kFloat32), false);
+  }
 #if MXNET_USE_MKL2017 == 1
   switch (dtype) {
   case mshadow::kFloat32:
@@ -32,10 +37,6 @@ Operator* CreateOp<cpu>(FullyConnectedParam param, int dtype) {
   case mshadow::kFloat64:
     op = new FullyConnectedOp<cpu, double>(param);
     break;
-  case mshadow::kFloat16:
-    LOG(FATAL) << "float16 fully connected layer is currently"
-                  "only supported by CuDNN version.";
-    break;
   default:
     LOG(FATAL) << "Unsupported type " << dtype;
   }
@@ -0,0 +1,194 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file image_normalize-inl.h
+ * \brief normalize a batch of images, typically 8-bit images from the data
+ *  iterator, by subtracting a per channel mean and scaling
+*/
+#ifndef MXNET_OPERATOR_IMAGE_NORMALIZE_INL_H_
+#define MXNET_OPERATOR_IMAGE_NORMALIZE_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include "./operator_common.h"
+
+namespace mxnet {
+namespace op {
+
+namespace imnorm {
+enum ImageNormalizeOpInputs {kData};
+enum ImageNormalizeOpOutputs {kOut};
+}  // imnorm
+
+struct ImageNormalizeOpParam : public dmlc::Parameter<ImageNormalizeOpParam> {
+  float mean_r;
+  float mean_g;
+  float mean_b;
+  float mean_a;
+  float scale;
+  int dtype;
+  DMLC_DECLARE_PARAMETER(ImageNormalizeOpParam) {
+    DMLC_DECLARE_FIELD(mean_r).set_default(0.0f)
+    .describe("Mean value on the first channel.");
+    DMLC_DECLARE_FIELD(mean_g).set_default(0.0f)
+    .describe("Mean value on the second channel.");
+    DMLC_DECLARE_FIELD(mean_b).set_default(0.0f)
+    .describe("Mean value on the third channel.");
+    DMLC_DECLARE_FIELD(mean_a).set_default(0.0f)
+    .describe("Mean value on the fourth channel.");
+    DMLC_DECLARE_FIELD(scale).set_default(1.0f)
+    .describe("Scale applied after subtracting the mean.");
+    DMLC_DECLARE_FIELD(dtype)
+    .add_enum("float32", mshadow::kFloat32)
+    .add_enum("float64", mshadow::kFloat64)
+    .add_enum("float16", mshadow::kFloat16)
+    .set_default(mshadow::kFloat32)
+    .describe("Output data type.");
+  }
+};
+
+/**
+ * \brief out[n][c] = (data[n][c] - mean[c]) * scale, with the cast from the
+ *  input type fused, on data of shape (batch, channel, height, width)
+ */
+template<typename xpu, typename SrcDType, typename DstDType>
+class ImageNormalizeOp : public Operator {
+ public:
+  explicit ImageNormalizeOp(ImageNormalizeOpParam param) : param_(param) {
+    mean_[0] = param.mean_r;
+    mean_[1] = param.mean_g;
+    mean_[2] = param.mean_b;
+    mean_[3] = param.mean_a;
+    for (int c = 0; c < 4; ++c) mean_host_[c] = DstDType(mean_[c]);
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(in_data.size(), 1);
+    CHECK_EQ(out_data.size(), 1);
+    Stream<xpu> *s = ctx.get_stream<xpu>();
+    const TShape &dshape = in_data[imnorm::kData].shape_;
+    Shape<3> shape = Shape3(dshape[0], dshape[1], dshape.ProdShape(2, dshape.ndim()));
+    Tensor<xpu, 3, SrcDType> data =
+        in_data[imnorm::kData].get_with_shape<xpu, 3, SrcDType>(shape, s);
+    Tensor<xpu, 3, DstDType> out =
+        out_data[imnorm::kOut].get_with_shape<xpu, 3, DstDType>(shape, s);
+    Tensor<xpu, 1, DstDType> mean =
+        ctx.requested[0].get_space_typed<xpu, 1, DstDType>(Shape1(shape[1]), s);
+    Copy(mean, Tensor<cpu, 1, DstDType>(mean_host_, Shape1(shape[1])), s);
+    Assign(out, req[imnorm::kOut],
+           (tcast<DstDType>(data) - broadcast<1>(mean, shape)) *
+           scalar<DstDType>(DstDType(param_.scale)));
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    CHECK_EQ(out_grad.size(), 1);
+    CHECK_EQ(in_grad.size(), 1);
+    Stream<xpu> *s = ctx.get_stream<xpu>();
+    Tensor<xpu, 2, DstDType> grad = out_grad[imnorm::kOut].FlatTo2D<xpu, DstDType>(s);
+    Tensor<xpu, 2, SrcDType> in_grad_data = in_grad[imnorm::kData].FlatTo2D<xpu, SrcDType>(s);
+    Assign(in_grad_data, req[imnorm::kData],
+           tcast<SrcDType>(grad * scalar<DstDType>(DstDType(param_.scale))));
+  }
+
+ private:
+  ImageNormalizeOpParam param_;
+  float mean_[4];
+  // the mean copied to the device, which must live until the copy is done
+  DstDType mean_host_[4];
+};  // class ImageNormalizeOp
+
+template<typename xpu>
+Operator* CreateOp(ImageNormalizeOpParam param, std::vector<int> *in_type);
+
+#if DMLC_USE_CXX11
+class ImageNormalizeProp : public OperatorProperty {
+ public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    CHECK_EQ(in_shape->size(), 1) << "Input:[data]";
+    const TShape &dshape = in_shape->at(imnorm::kData);
+    if (dshape.ndim() == 0) return false;
+    CHECK_GE(dshape.ndim(), 3) << "data must be (batch, channel, ...)";
+    CHECK_LE(dshape[1], 4) << "at most 4 channels are supported";
+    out_shape->clear();
+    out_shape->push_back(dshape);
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    CHECK_EQ(in_type->size(), 1);
+    if ((*in_type)[0] == -1) {
+      // images come from the data iterator in 8 bits
+      (*in_type)[0] = mshadow::kUint8;
+    }
+    out_type->clear();
+    out_type->push_back(param_.dtype);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new ImageNormalizeProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "ImageNormalize";
+  }
+
+  std::vector<int> DeclareBackwardDependency(
+    const std::vector<int> &out_grad,
+    const std::vector<int> &in_data,
+    const std::vector<int> &out_data) const override {
+    return {out_grad[imnorm::kOut]};
+  }
+
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  Operator* CreateOperator(Context ctx) const override {
+    LOG(FATAL) << "Not Implemented.";
+    return NULL;
+  }
+
+  Operator* CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+                             std::vector<int> *in_type) const override;
+
+ private:
+  ImageNormalizeOpParam param_;
+};
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_IMAGE_NORMALIZE_INL_H_
@@ -0,0 +1,42 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file image_normalize.cc
+ * \brief normalize a batch of images
+*/
+#include "./image_normalize-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator *CreateOp<cpu>(ImageNormalizeOpParam param, std::vector<int> *in_type) {
+  Operator *op = NULL;
+  MSHADOW_TYPE_SWITCH((*in_type)[0], SrcDType, {
+    MSHADOW_REAL_TYPE_SWITCH(param.dtype, DstDType, {
+        op = new ImageNormalizeOp<cpu, SrcDType, DstDType>(param);
+    })
+  })
+  return op;
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *ImageNormalizeProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+                                               std::vector<int> *in_type) const {
+  std::vector<TShape> out_shape, aux_shape;
+  std::vector<int> out_type, aux_type;
+  CHECK(InferType(in_type, &out_type, &aux_type));
+  CHECK(InferShape(in_shape, &out_shape, &aux_shape));
+  DO_BIND_DISPATCH(CreateOp, param_, in_type);
+}
+
+DMLC_REGISTER_PARAMETER(ImageNormalizeOpParam);
+
+MXNET_REGISTER_OP_PROPERTY(ImageNormalize, ImageNormalizeProp)
+.describe("Normalize a batch of images of shape (batch, channel, height, width), "
+          "out = (data - mean[channel]) * scale. The data is usually the uint8 "
+          "output of an image iterator with dtype='uint8', so the normalization "
+          "runs on the device of the network instead of in the data iterator.")
+.add_argument("data", "Symbol", "Input images.")
+.add_arguments(ImageNormalizeOpParam::__FIELDS__());
+
+}  // namespace op
+}  // namespace mxnet
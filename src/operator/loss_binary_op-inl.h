@@ -99,6 +99,25 @@ void SoftmaxCrossEntropyBackward_(const OutputGrad& scale,
     });
 }
 
+// the cpu versions read each row of the data once, in loss_binary_op.cc
+template<>
+void SoftmaxCrossEntropyForward_<cpu>(const TBlob& data,
+                                      const TBlob& label,
+                                      const EnvArguments& env,
+                                      TBlob *ret,
+                                      OpReqType req,
+                                      RunContext ctx);
+template<>
+void SoftmaxCrossEntropyBackward_<cpu>(const OutputGrad& scale,
+                                       const Input0& data,
+                                       const Input1& label,
+                                       const EnvArguments& env,
+                                       TBlob* data_grad,
+                                       TBlob* label_grad,
+                                       OpReqType req_data_grad,
+                                       OpReqType req_label_grad,
+                                       RunContext ctx);
+
 MXNET_REGISTER_SIMPLE_OP(softmax_cross_entropy, XPU)
 .set_function(XPU::kDevMask, SoftmaxCrossEntropyForward_<XPU>, kNoInplace)
 .set_gradient(XPU::kDevMask, SoftmaxCrossEntropyBackward_<XPU>, kNoInplace)
@@ -3,4 +3,117 @@
  * \file loss_binary_op.cc
  * \brief loss function that takes a data and label
 */
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
 #include "./loss_binary_op-inl.h"
+#include "./float16_cpu-inl.h"
+#include "./softmax_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*! \brief the loss of a row whose label has a probability below 1e-8, as -log(1e-8) */
+const double kMaxSoftmaxCrossEntropy = 18.420680743952367;
+
+/*!
+ * \brief the sum of the losses of the n rows of k classes into out, the loss
+ *  of a row being log(sum(exp(x))) - x[label], without computing the softmax
+ */
+template<typename DType>
+inline void SoftmaxCrossEntropyCPU(const DType *x, const DType *label, index_t n, index_t k,
+                                   DType *out, bool add) {
+  typedef typename float16::ComputeType<DType>::type AType;
+  const bool convert = !std::is_same<DType, AType>::value;
+  for (index_t i = 0; i < n; ++i) {
+    const int l = static_cast<int>(static_cast<float>(label[i]));
+    CHECK(l >= 0 && l < static_cast<int>(k))
+      << "SoftmaxCrossEntropy: label " << l << " out of range [0, " << k << ")";
+  }
+  AType loss = 0;
+  #pragma omp parallel reduction(+:loss)
+  {
+    std::vector<AType> buf(convert ? k : 0);
+    #pragma omp for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      const AType *row = float16::ToCompute(x + i * k, k, buf.data());
+      const int l = static_cast<int>(static_cast<float>(label[i]));
+      loss += std::min(softmax::LogSumExp(row, k) - row[l], AType(kMaxSoftmaxCrossEntropy));
+    }
+  }
+  out[0] = add ? DType(static_cast<AType>(out[0]) + loss) : DType(loss);
+}
+
+/*!
+ * \brief the gradient of the losses of the n rows of k classes, scale times
+ *  softmax(x) - onehot(label) for a row, computed from the data in one online
+ *  pass into the gradient
+ */
+template<typename DType>
+inline void SoftmaxCrossEntropyGradCPU(const DType *x, const DType *label, index_t n,
+                                       index_t k, const DType *scale, DType *grad, bool add) {
+  typedef typename float16::ComputeType<DType>::type AType;
+  const bool convert = !std::is_same<DType, AType>::value;
+  const AType s = static_cast<AType>(scale[0]);
+  #pragma omp parallel
+  {
+    std::vector<AType> buf(convert ? k : 0), gbuf(convert || add ? k : 0);
+    std::vector<AType> cur(convert && add ? k : 0), bmax(softmax::NumBlocks(k));
+    #pragma omp for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      const AType *row = float16::ToCompute(x + i * k, k, buf.data());
+      AType *g = add ? gbuf.data() : float16::ComputeOut(grad + i * k, gbuf.data());
+      AType max;
+      softmax::SoftmaxRow(row, g, k, s, bmax.data(), &max);
+      const int l = static_cast<int>(static_cast<float>(label[i]));
+      if (l >= 0 && l < static_cast<int>(k)) g[l] -= s;
+      if (add) {
+        const AType *prev = float16::ToCompute(grad + i * k, k, cur.data());
+        for (index_t j = 0; j < k; ++j) g[j] += prev[j];
+      }
+      float16::FromCompute(g, k, grad + i * k);
+    }
+  }
+}
+
+template<>
+void SoftmaxCrossEntropyForward_<cpu>(const TBlob& data,
+                                      const TBlob& label,
+                                      const EnvArguments& env,
+                                      TBlob *ret,
+                                      OpReqType req,
+                                      RunContext ctx) {
+  CHECK_EQ(ret->type_flag_, data.type_flag_)
+    << "Binary function only support input/output with the same type";
+  CHECK_EQ(ret->type_flag_, label.type_flag_)
+    << "Binary function only support input/output with the same type";
+  if (req == kNullOp) return;
+  MSHADOW_REAL_TYPE_SWITCH(data.type_flag_, DType, {
+    SoftmaxCrossEntropyCPU(data.dptr<DType>(), label.dptr<DType>(), data.shape_[0],
+                           data.shape_[1], ret->dptr<DType>(), req == kAddTo);
+  });
+}
+
+template<>
+void SoftmaxCrossEntropyBackward_<cpu>(const OutputGrad& scale,
+                                       const Input0& data,
+                                       const Input1& label,
+                                       const EnvArguments& env,
+                                       TBlob* data_grad,
+                                       TBlob* label_grad,
+                                       OpReqType req_data_grad,
+                                       OpReqType req_label_grad,
+                                       RunContext ctx) {
+  CHECK_EQ(req_label_grad, kNullOp)
+      << "SoftmaxCrossEntropy: Cannot take gradient wrt label";
+  if (req_data_grad == kNullOp) return;
+  MSHADOW_REAL_TYPE_SWITCH(data_grad->type_flag_, DType, {
+    SoftmaxCrossEntropyGradCPU(data.data.dptr<DType>(), label.data.dptr<DType>(),
+                               data.data.shape_[0], data.data.shape_[1],
+                               scale.data.dptr<DType>(), data_grad->dptr<DType>(),
+                               req_data_grad == kAddTo);
+  });
+}
+
+}  // namespace op
+}  // namespace mxnet
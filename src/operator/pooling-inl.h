@@ -23,7 +23,7 @@ namespace op {
 
 namespace pool_enum {
 enum PoolingOpInputs {kData};
-enum PoolingOpOutputs {kOut};
+enum PoolingOpOutputs {kOut, kMask};
 enum PoolingOpType {kMaxPooling, kAvgPooling, kSumPooling};
 enum PoolingOpPadConventionType {kValid, kFull};
 }  // namespace pool_enum
@@ -35,6 +35,7 @@ struct PoolingParam : public dmlc::Parameter<PoolingParam> {
   int pool_type;
   int pooling_convention;
   bool global_pool;
+  bool cache_argmax;
   DMLC_DECLARE_PARAMETER(PoolingParam) {
     DMLC_DECLARE_FIELD(global_pool).set_default(false)
     .describe("Ignore kernel size, do global pooling based on current input feature map. "
@@ -65,6 +66,10 @@ struct PoolingParam : public dmlc::Parameter<PoolingParam> {
     int pad_shape[] = {0, 0};
     DMLC_DECLARE_FIELD(pad).set_default(TShape(pad_shape, pad_shape + 2))
     .describe("pad for pooling: (y, x) or (d, y, x)");
+
+    DMLC_DECLARE_FIELD(cache_argmax).set_default(false)
+    .describe("Only for max pooling on cpu. Store the argmax of each window in training, "
+              "so that backward scatters the gradient instead of searching the windows again.");
   }
 };
 
@@ -185,6 +190,15 @@ class PoolingProp : public OperatorProperty {
  public:
   void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
     param_.Init(kwargs);
+    // the default stride and pad are 2d
+    if (param_.kernel.ndim() == 3) {
+      if (param_.stride.ndim() == 2 && param_.stride.Size() == 1) {
+        param_.stride = mshadow::Shape3(1, 1, 1);
+      }
+      if (param_.pad.ndim() == 2 && param_.pad.Size() == 0) {
+        param_.pad = mshadow::Shape3(0, 0, 0);
+      }
+    }
   }
 
   std::map<std::string, std::string> GetParams() const override {
@@ -227,7 +241,9 @@ class PoolingProp : public OperatorProperty {
       out_shape->push_back(oshape);
     } else if (param_.kernel.ndim() == 3) {
       CHECK_EQ(dshape.ndim(), 5) << "Pooling: Input data should be 5D in (batch, channel, d, y, x)";
-      CHECK(param_.kernel[0] < dshape[2] + 2 * param_.pad[0]
+      CHECK_EQ(param_.stride.ndim(), 3) << "stride should be (d, y, x) for 3d pooling";
+      CHECK_EQ(param_.pad.ndim(), 3) << "pad should be (d, y, x) for 3d pooling";
+      CHECK(param_.kernel[0] <= dshape[2] + 2 * param_.pad[0]
             && param_.kernel[1] <= dshape[3] + 2 * param_.pad[1]
             && param_.kernel[2] <= dshape[4] + 2 * param_.pad[2])
           << "kernel size exceed input";
@@ -236,7 +252,7 @@ class PoolingProp : public OperatorProperty {
         oshape[3] = 1;
         oshape[4] = 1;
       } else {
-        if (param_.pool_type == pool_enum::kValid) {
+        if (param_.pooling_convention == pool_enum::kValid) {
           oshape[2] = 1 + (dshape[2] + 2 * param_.pad[0] - param_.kernel[0]) /
                               param_.stride[0];
           oshape[3] = 1 + (dshape[3] + 2 * param_.pad[1] - param_.kernel[1]) /
@@ -259,6 +275,7 @@ class PoolingProp : public OperatorProperty {
       out_shape->clear();
       out_shape->push_back(oshape);
     }
+    if (param_.cache_argmax) out_shape->push_back(oshape);
     return true;
   }
 
@@ -275,6 +292,7 @@ class PoolingProp : public OperatorProperty {
 
     out_type->clear();
     out_type->push_back(dtype);
+    if (param_.cache_argmax) out_type->push_back(mshadow::kInt32);
     return true;
   }
 
@@ -292,6 +310,9 @@ class PoolingProp : public OperatorProperty {
     const std::vector<int> &out_grad,
     const std::vector<int> &in_data,
     const std::vector<int> &out_data) const override {
+    if (param_.cache_argmax && param_.pool_type == pool_enum::kMaxPooling) {
+      return {out_grad[pool_enum::kOut], out_data[pool_enum::kMask]};
+    }
     return {out_grad[pool_enum::kOut], in_data[pool_enum::kData], out_data[pool_enum::kOut]};
   }
 
@@ -303,10 +324,27 @@ class PoolingProp : public OperatorProperty {
 #if MXNET_USE_CUDNN == 1
     return {};
 #else
+    if (param_.cache_argmax && param_.pool_type == pool_enum::kMaxPooling) return {};
     return {{in_data[pool_enum::kData], in_grad[pool_enum::kData]}};
 #endif
   }
 
+  int NumVisibleOutputs() const override {
+    return 1;
+  }
+
+  int NumOutputs() const override {
+    return param_.cache_argmax ? 2 : 1;
+  }
+
+  std::vector<std::string> ListOutputs() const override {
+    if (param_.cache_argmax) {
+      return {"output", "mask"};
+    } else {
+      return {"output"};
+    }
+  }
+
   Operator* CreateOperator(Context ctx) const override {
     LOG(FATAL) << "Not Implemented.";
     return NULL;
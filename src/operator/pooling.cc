@@ -5,6 +5,7 @@
  * \author Bing Xu
 */
 #include "./pooling-inl.h"
+#include "./pooling_cpu-inl.h"
 #if MXNET_USE_MKL2017 == 1
 #include <mxnet/mkl_memory.h>
 #include "./mkl/mkl_memory-inl.h"
@@ -23,6 +24,7 @@ Operator* CreateOp<cpu>(PoolingParam param, int dtype,
 #if MXNET_USE_MKL2017 == 1
     if ((param.pool_type == pool_enum::kMaxPooling
       || param.pool_type == pool_enum::kAvgPooling)
+      && !param.cache_argmax
       && UseMKLPooling(param, in_shape, out_shape)) {
       switch (dtype) {
       case mshadow::kFloat32:
@@ -35,20 +37,7 @@ Operator* CreateOp<cpu>(PoolingParam param, int dtype,
     }
 #endif
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    switch (param.pool_type) {
-      case pool_enum::kMaxPooling:
-        op = new PoolingOp<cpu, mshadow::red::maximum, DType>(param);
-        break;
-      case pool_enum::kAvgPooling:
-        op = new PoolingOp<cpu, mshadow::red::sum, DType>(param);
-        break;
-      case pool_enum::kSumPooling:
-        op = new PoolingOp<cpu, mshadow::red::sum, DType>(param);
-        break;
-      default:
-        LOG(FATAL) << "unknown pooling type";
-        return NULL;
-    }
+    op = new PoolingCPUOp<DType>(param);
   })
 
   return op;
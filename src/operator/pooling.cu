@@ -16,6 +16,7 @@ template<>
 Operator *CreateOp<gpu>(PoolingParam param, int dtype,
                    std::vector<TShape> *in_shape,
                    std::vector<TShape> *out_shape) {
+  CHECK(!param.cache_argmax) << "Pooling: cache_argmax is only supported on cpu";
   Operator *op = NULL;
 #if MXNET_USE_CUDNN == 1
   MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
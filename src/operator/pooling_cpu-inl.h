@@ -0,0 +1,288 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file pooling_cpu-inl.h
+ * \brief 2d and 3d max, avg and sum pooling on cpu, parallel over the planes
+ */
+#ifndef MXNET_OPERATOR_POOLING_CPU_INL_H_
+#define MXNET_OPERATOR_POOLING_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include "./pooling-inl.h"
+#include "./float16_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief pooling on cpu of N x C x H x W or N x C x D x H x W data. Every
+ *  plane of N x C is pooled by one thread. For an output row, the loops run
+ *  over the depth, rows and columns of the kernel outside, and over the output
+ *  columns inside, so that the
+ *  inner loop is a vectorizable pass over an input row. Padding is handled by
+ *  clipping the loops to the input, so max pooling ignores the padding, and
+ *  avg pooling divides by the kernel size as if the padding were zeros.
+ *
+ *  The backward of max pooling scatters the gradient to the argmax of each
+ *  window, which is cached in the mask output with cache_argmax, or else
+ *  found again from the data.
+ *
+ *  float16 planes are converted to float32 to be pooled, and the outputs
+ *  converted back a plane at a time.
+ */
+template<typename DType>
+class PoolingCPUOp : public Operator {
+  /*! \brief the type the kernels compute in */
+  typedef typename float16::ComputeType<DType>::type AType;
+
+ public:
+  explicit PoolingCPUOp(PoolingParam p) : param_(p) {
+    CHECK(param_.kernel.ndim() == 2 || param_.kernel.ndim() == 3)
+        << "Pooling on cpu only supports 2d and 3d kernels";
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(in_data.size(), 1);
+    CHECK_EQ(out_data.size(), param_.cache_argmax ? 2 : 1);
+    const Geometry g(param_, in_data[pool_enum::kData].shape_,
+                     out_data[pool_enum::kOut].shape_);
+    const DType *in = in_data[pool_enum::kData].dptr<DType>();
+    DType *out = out_data[pool_enum::kOut].dptr<DType>();
+    int *mask = NULL;
+    if (param_.cache_argmax && ctx.is_train && param_.pool_type == pool_enum::kMaxPooling) {
+      mask = out_data[pool_enum::kMask].dptr<int>();
+    }
+    const OpReqType oreq = req[pool_enum::kOut];
+    if (oreq == kNullOp) return;
+
+    #pragma omp parallel for
+    for (int p = 0; p < static_cast<int>(g.nplane); ++p) {
+      std::vector<AType> fin(kConvert ? g.in_size : 0), fout(kConvert ? g.out_size : 0);
+      const AType *src = float16::ToCompute(in + p * g.in_size, g.in_size, fin.data());
+      AType *dst = float16::ComputeOut(out + p * g.out_size, fout.data());
+      if (oreq == kAddTo) float16::ToCompute(out + p * g.out_size, g.out_size, dst);
+      int *dmask = mask == NULL ? NULL : mask + p * g.out_size;
+      if (param_.pool_type == pool_enum::kMaxPooling) {
+        std::vector<AType> acc(g.ow);
+        std::vector<int> idx(g.ow);
+        for (index_t r = 0; r < g.nrow; ++r) {
+          MaxRow(g, src, r, acc.data(), idx.data());
+          for (index_t ow = 0; ow < g.ow; ++ow) {
+            Write(dst + r * g.ow + ow, oreq, acc[ow]);
+          }
+          if (dmask != NULL) std::copy(idx.begin(), idx.end(), dmask + r * g.ow);
+        }
+      } else {
+        std::vector<AType> acc(g.ow);
+        const AType scale = param_.pool_type == pool_enum::kAvgPooling ?
+            AType(1.0f / (g.kz * g.ky * g.kx)) : AType(1.0f);
+        for (index_t r = 0; r < g.nrow; ++r) {
+          SumRow(g, src, r, acc.data());
+          for (index_t ow = 0; ow < g.ow; ++ow) {
+            Write(dst + r * g.ow + ow, oreq, acc[ow] * scale);
+          }
+        }
+      }
+      float16::FromCompute(dst, g.out_size, out + p * g.out_size);
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(out_grad.size(), 1);
+    CHECK_EQ(req.size(), 1);
+    CHECK_EQ(in_grad.size(), 1);
+    const OpReqType ireq = req[pool_enum::kData];
+    if (ireq == kNullOp) return;
+    const Geometry g(param_, in_grad[pool_enum::kData].shape_,
+                     out_grad[pool_enum::kOut].shape_);
+    const DType *ograd = out_grad[pool_enum::kOut].dptr<DType>();
+    DType *igrad = in_grad[pool_enum::kData].dptr<DType>();
+    const bool use_mask = param_.cache_argmax && param_.pool_type == pool_enum::kMaxPooling;
+    const int *mask = use_mask ? out_data[pool_enum::kMask].dptr<int>() : NULL;
+    // the gradient may be in place of the data, in which case a plane
+    // is read entirely before it is overwritten
+    const DType *in = use_mask ? NULL : in_data[pool_enum::kData].dptr<DType>();
+
+    #pragma omp parallel for
+    for (int p = 0; p < static_cast<int>(g.nplane); ++p) {
+      std::vector<AType> fgrad(kConvert ? g.out_size : 0), fdst(kConvert ? g.in_size : 0);
+      const AType *src_grad = float16::ToCompute(ograd + p * g.out_size, g.out_size,
+                                                 fgrad.data());
+      AType *dst = float16::ComputeOut(igrad + p * g.in_size, fdst.data());
+      if (param_.pool_type == pool_enum::kMaxPooling) {
+        std::vector<int> idx;
+        const int *pidx;
+        if (use_mask) {
+          pidx = mask + p * g.out_size;
+        } else {
+          // the converted data is in dst until the gradient is written
+          const AType *src = float16::ToCompute(in + p * g.in_size, g.in_size, dst);
+          std::vector<AType> acc(g.ow);
+          idx.resize(g.out_size);
+          for (index_t r = 0; r < g.nrow; ++r) {
+            MaxRow(g, src, r, acc.data(), idx.data() + r * g.ow);
+          }
+          pidx = idx.data();
+        }
+        if (ireq == kAddTo) {
+          float16::ToCompute(igrad + p * g.in_size, g.in_size, dst);
+        } else {
+          std::fill(dst, dst + g.in_size, AType(0));
+        }
+        for (index_t i = 0; i < g.out_size; ++i) {
+          if (pidx[i] >= 0) dst[pidx[i]] += src_grad[i];
+        }
+      } else {
+        const AType scale = param_.pool_type == pool_enum::kAvgPooling ?
+            AType(1.0f / (g.kz * g.ky * g.kx)) : AType(1.0f);
+        std::vector<AType> row(g.ow);
+        if (ireq == kAddTo) {
+          float16::ToCompute(igrad + p * g.in_size, g.in_size, dst);
+        } else {
+          std::fill(dst, dst + g.in_size, AType(0));
+        }
+        for (index_t r = 0; r < g.nrow; ++r) {
+          for (index_t ow = 0; ow < g.ow; ++ow) row[ow] = src_grad[r * g.ow + ow] * scale;
+          SumRowBackward(g, row.data(), r, dst);
+        }
+      }
+      float16::FromCompute(dst, g.in_size, igrad + p * g.in_size);
+    }
+  }
+
+ private:
+  /*! \brief whether the planes are converted to AType */
+  static const bool kConvert = !std::is_same<DType, AType>::value;
+  /*!
+   * \brief the sizes of the planes and the windows, for the pooled parameters.
+   *  2d pooling is 3d pooling of depth 1.
+   */
+  struct Geometry {
+    index_t nplane, d, h, w, od, oh, ow, nrow, in_size, out_size;
+    int kz, ky, kx, sz, sy, sx, pz, py, px;
+    Geometry(const PoolingParam &param, const TShape &ishape, const TShape &oshape) {
+      CHECK(ishape.ndim() == 4 || ishape.ndim() == 5);
+      const bool is3d = ishape.ndim() == 5;
+      const int k = is3d ? 1 : 0;
+      nplane = ishape[0] * ishape[1];
+      d = is3d ? ishape[2] : 1;
+      h = ishape[2 + k];
+      w = ishape[3 + k];
+      od = is3d ? oshape[2] : 1;
+      oh = oshape[2 + k];
+      ow = oshape[3 + k];
+      nrow = od * oh;
+      in_size = d * h * w;
+      out_size = nrow * ow;
+      kz = is3d ? (param.global_pool ? d : param.kernel[0]) : 1;
+      ky = param.global_pool ? h : param.kernel[k];
+      kx = param.global_pool ? w : param.kernel[1 + k];
+      sz = is3d && !param.global_pool ? param.stride[0] : 1;
+      sy = param.global_pool ? 1 : param.stride[k];
+      sx = param.global_pool ? 1 : param.stride[1 + k];
+      pz = is3d ? param.pad[0] : 0;
+      py = param.pad[k];
+      px = param.pad[1 + k];
+    }
+    /*! \brief the input depths [*zbegin, *zend) and rows [*ybegin, *yend) of output row r */
+    inline void Rows(index_t r, int *zbegin, int *zend, int *ybegin, int *yend) const {
+      const int zstart = static_cast<int>(r / oh) * sz - pz;
+      const int ystart = static_cast<int>(r % oh) * sy - py;
+      *zbegin = std::max(zstart, 0);
+      *zend = std::min(zstart + kz, static_cast<int>(d));
+      *ybegin = std::max(ystart, 0);
+      *yend = std::min(ystart + ky, static_cast<int>(h));
+    }
+    /*!
+     * \brief the output columns [*begin, *end) for which column kw of the
+     *  kernel is inside the input, it is input column ow * sx + *offset
+     */
+    inline void Cols(int kw, int *begin, int *end, int *offset) const {
+      const int off = kw - px;
+      *offset = off;
+      *begin = off >= 0 ? 0 : (-off + sx - 1) / sx;
+      *end = off >= static_cast<int>(w) ? 0 :
+          std::min(static_cast<int>(ow), (static_cast<int>(w) - 1 - off) / sx + 1);
+    }
+  };
+  /*! \brief the max of the windows of output row r and their index in the plane */
+  static void MaxRow(const Geometry &g, const AType *src, index_t r, AType *acc, int *idx) {
+    // no value yet is marked by idx -1
+    std::fill(acc, acc + g.ow, AType(0));
+    std::fill(idx, idx + g.ow, -1);
+    int zbegin, zend, ybegin, yend;
+    g.Rows(r, &zbegin, &zend, &ybegin, &yend);
+    for (int z = zbegin; z < zend; ++z) {
+      for (int y = ybegin; y < yend; ++y) {
+        const int rbase = (z * static_cast<int>(g.h) + y) * static_cast<int>(g.w);
+        const AType *row = src + rbase;
+        for (int kw = 0; kw < g.kx; ++kw) {
+          int begin, end, off;
+          g.Cols(kw, &begin, &end, &off);
+          const int base = rbase + off;
+          for (int j = begin; j < end; ++j) {
+            const AType v = row[j * g.sx + off];
+            const bool gt = idx[j] < 0 || v > acc[j];
+            idx[j] = gt ? base + j * g.sx : idx[j];
+            acc[j] = gt ? v : acc[j];
+          }
+        }
+      }
+    }
+  }
+  /*! \brief the sum of the windows of output row r */
+  static void SumRow(const Geometry &g, const AType *src, index_t r, AType *acc) {
+    std::fill(acc, acc + g.ow, AType(0));
+    int zbegin, zend, ybegin, yend;
+    g.Rows(r, &zbegin, &zend, &ybegin, &yend);
+    for (int z = zbegin; z < zend; ++z) {
+      for (int y = ybegin; y < yend; ++y) {
+        const AType *row = src + (z * g.h + y) * g.w;
+        for (int kw = 0; kw < g.kx; ++kw) {
+          int begin, end, off;
+          g.Cols(kw, &begin, &end, &off);
+          for (int j = begin; j < end; ++j) acc[j] += row[j * g.sx + off];
+        }
+      }
+    }
+  }
+  /*! \brief add the gradient of output row r to its windows */
+  static void SumRowBackward(const Geometry &g, const AType *grad, index_t r, AType *dst) {
+    int zbegin, zend, ybegin, yend;
+    g.Rows(r, &zbegin, &zend, &ybegin, &yend);
+    for (int z = zbegin; z < zend; ++z) {
+      for (int y = ybegin; y < yend; ++y) {
+        AType *row = dst + (z * g.h + y) * g.w;
+        for (int kw = 0; kw < g.kx; ++kw) {
+          int begin, end, off;
+          g.Cols(kw, &begin, &end, &off);
+          for (int j = begin; j < end; ++j) row[j * g.sx + off] += grad[j];
+        }
+      }
+    }
+  }
+  static inline void Write(AType *out, OpReqType req, AType v) {
+    if (req == kAddTo) {
+      *out += v;
+    } else {
+      *out = v;
+    }
+  }
+
+  PoolingParam param_;
+};  // class PoolingCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_POOLING_CPU_INL_H_
@@ -0,0 +1,125 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantize-inl.h
+ * \brief quantize float data to int8 for the quantized operators
+*/
+#ifndef MXNET_OPERATOR_QUANTIZE_INL_H_
+#define MXNET_OPERATOR_QUANTIZE_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include "./operator_common.h"
+#include "./quantized_op_common.h"
+
+namespace mxnet {
+namespace op {
+// Declare enumeration of input order to make code more intuitive.
+// These enums are only visible within this header
+namespace quantize_enum {
+enum QuantizeOpInputs {kData};
+enum QuantizeOpOutputs {kOut};
+}  // quantize_enum
+
+struct QuantizeParam : public dmlc::Parameter<QuantizeParam> {
+  float threshold;
+  DMLC_DECLARE_PARAMETER(QuantizeParam) {
+    DMLC_DECLARE_FIELD(threshold).set_lower_bound(0.0f)
+    .describe("The largest absolute value of the data, it is mapped to 127, "
+              "usually found by calibration.");
+  }
+};
+
+/*!
+ * \brief quantize float32 data to int8, stored in a uint8 array, the
+ *  input of QuantizedConvolution and QuantizedFullyConnected. Inference only.
+ */
+class QuantizeOp : public Operator {
+ public:
+  explicit QuantizeOp(QuantizeParam p) : param_(p) {
+    CHECK_GT(param_.threshold, 0.0f) << "Quantize: threshold must be positive";
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(in_data.size(), 1);
+    CHECK_EQ(out_data.size(), 1);
+    if (req[quantize_enum::kOut] == kNullOp) return;
+    CHECK_NE(req[quantize_enum::kOut], kAddTo) << "Quantize does not support kAddTo";
+    const float *in = in_data[quantize_enum::kData].dptr<float>();
+    int8_t *out = quantized::Int8Ptr(out_data[quantize_enum::kOut]);
+    const float inv_scale = quantized::kInt8Max / param_.threshold;
+    const int size = static_cast<int>(in_data[quantize_enum::kData].Size());
+    #pragma omp parallel for
+    for (int i = 0; i < size; ++i) {
+      out[i] = quantized::Quantize(in[i], inv_scale);
+    }
+  }
+
+ private:
+  QuantizeParam param_;
+};  // class QuantizeOp
+
+// Decalre Factory function, used for dispatch specialization
+template<typename xpu>
+Operator* CreateOp(QuantizeParam param);
+
+#if DMLC_USE_CXX11
+class QuantizeProp : public OperatorProperty {
+ public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    CHECK_EQ(in_shape->size(), 1) << "Input:[data]";
+    const TShape &dshape = in_shape->at(quantize_enum::kData);
+    if (dshape.ndim() == 0) return false;
+    out_shape->clear();
+    out_shape->push_back(dshape);
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    CHECK_EQ(in_type->size(), 1);
+    if ((*in_type)[0] == -1) (*in_type)[0] = mshadow::kFloat32;
+    CHECK_EQ((*in_type)[0], mshadow::kFloat32) << "Quantize only takes float32 data";
+    out_type->clear();
+    out_type->push_back(mshadow::kUint8);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new QuantizeProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "Quantize";
+  }
+
+  Operator* CreateOperator(Context ctx) const override;
+
+ private:
+  QuantizeParam param_;
+};  // class QuantizeProp
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZE_INL_H_
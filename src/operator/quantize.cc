@@ -0,0 +1,30 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantize.cc
+ * \brief quantize operator
+*/
+#include "./quantize-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator *CreateOp<cpu>(QuantizeParam param) {
+  return new QuantizeOp(param);
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *QuantizeProp::CreateOperator(Context ctx) const {
+  DO_BIND_DISPATCH(CreateOp, param_);
+}
+
+DMLC_REGISTER_PARAMETER(QuantizeParam);
+
+MXNET_REGISTER_OP_PROPERTY(Quantize, QuantizeProp)
+.describe("Quantize float32 data to int8 with a fixed threshold, for the input of "
+          "QuantizedConvolution and QuantizedFullyConnected. The int8 values are "
+          "stored in a uint8 array. Only on cpu and for inference.")
+.add_argument("data", "Symbol", "Input float32 data.")
+.add_arguments(QuantizeParam::__FIELDS__());
+
+}  // namespace op
+}  // namespace mxnet
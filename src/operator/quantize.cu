@@ -0,0 +1,16 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantize.cu
+ * \brief quantize operator
+*/
+#include "./quantize-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator *CreateOp<gpu>(QuantizeParam param) {
+  LOG(FATAL) << "Quantize is only supported on cpu";
+  return NULL;
+}
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,274 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_convolution-inl.h
+ * \brief int8 convolution operator for inference
+*/
+#ifndef MXNET_OPERATOR_QUANTIZED_CONVOLUTION_INL_H_
+#define MXNET_OPERATOR_QUANTIZED_CONVOLUTION_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
+#include "./operator_common.h"
+#include "./quantized_op_common.h"
+
+namespace mxnet {
+namespace op {
+
+namespace qconv {
+enum QuantizedConvolutionOpInputs {kData, kWeight, kWeightScale, kBias};
+enum QuantizedConvolutionOpOutputs {kOut};
+enum QuantizedConvolutionOpResource {kTempSpace};
+}
+
+struct QuantizedConvolutionParam : public dmlc::Parameter<QuantizedConvolutionParam> {
+  TShape kernel;
+  TShape stride;
+  TShape dilate;
+  TShape pad;
+  uint32_t num_filter;
+  uint32_t num_group;
+  bool no_bias;
+  float in_threshold;
+  float out_threshold;
+  bool fuse_relu;
+  DMLC_DECLARE_PARAMETER(QuantizedConvolutionParam) {
+    int shape[] = {1, 1};
+    DMLC_DECLARE_FIELD(kernel).describe("convolution kernel size: (y, x)");
+    DMLC_DECLARE_FIELD(stride).set_default(TShape(shape, shape + 2))
+    .describe("convolution stride: (y, x)");
+    DMLC_DECLARE_FIELD(dilate).set_default(TShape(shape, shape + 2))
+    .describe("convolution dilate: (y, x)");
+    shape[0] = shape[1] = 0;
+    DMLC_DECLARE_FIELD(pad).set_default(TShape(shape, shape + 2))
+    .describe("pad for convolution: (y, x)");
+    DMLC_DECLARE_FIELD(num_filter).set_range(1, 100000)
+    .describe("convolution filter(channel) number");
+    DMLC_DECLARE_FIELD(num_group).set_default(1)
+    .describe("Number of groups partition.");
+    DMLC_DECLARE_FIELD(no_bias).set_default(false)
+    .describe("Whether to disable bias parameter.");
+    DMLC_DECLARE_FIELD(in_threshold).set_lower_bound(0.0f)
+    .describe("The threshold the int8 data was quantized with.");
+    DMLC_DECLARE_FIELD(out_threshold).set_default(0.0f).set_lower_bound(0.0f)
+    .describe("If positive, requantize the output to int8 with this threshold, "
+              "for the next quantized layer. Otherwise the output is float32.");
+    DMLC_DECLARE_FIELD(fuse_relu).set_default(false)
+    .describe("Whether to apply relu to the output.");
+  }
+};
+
+/*!
+ * \brief 2d convolution on int8 data and int8 weights with one scale per
+ *  filter. Each image is unpacked to an int8 matrix with one row per output
+ *  pixel, multiplied by the weights in int32, and the result is scaled back to
+ *  float and either written as float32 or requantized to int8 for the next
+ *  quantized layer.
+ */
+class QuantizedConvolutionOp : public Operator {
+ public:
+  explicit QuantizedConvolutionOp(QuantizedConvolutionParam p) : param_(p) {
+    CHECK_GT(param_.in_threshold, 0.0f) << "QuantizedConvolution: in_threshold must be positive";
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    if (req[qconv::kOut] == kNullOp) return;
+    CHECK_EQ(req[qconv::kOut], kWriteTo);
+    size_t expected = param_.no_bias ? 3 : 4;
+    CHECK_EQ(in_data.size(), expected);
+    CHECK_EQ(out_data.size(), 1);
+    const TShape &ishape = in_data[qconv::kData].shape_;
+    const TShape &oshape = out_data[qconv::kOut].shape_;
+    const index_t nbatch = ishape[0], nchannel = ishape[1];
+    const index_t in_size = nchannel * ishape[2] * ishape[3];
+    const index_t npixel = oshape[2] * oshape[3];
+    const index_t group_filter = param_.num_filter / param_.num_group;
+    const index_t group_channel = nchannel / param_.num_group;
+    const index_t ksize = group_channel * param_.kernel[0] * param_.kernel[1];
+    // the int32 result of a group, followed by the unpacked int8 data
+    Tensor<cpu, 1, int32_t> space = ctx.requested[qconv::kTempSpace]
+        .get_space_typed<cpu, 1, int32_t>(
+            Shape1(group_filter * npixel + (npixel * ksize + 3) / 4), ctx.get_stream<cpu>());
+    int32_t *acc = space.dptr_;
+    int8_t *col = reinterpret_cast<int8_t*>(space.dptr_ + group_filter * npixel);
+
+    const int8_t *data = quantized::Int8Ptr(in_data[qconv::kData]);
+    const int8_t *weight = quantized::Int8Ptr(in_data[qconv::kWeight]);
+    const float in_scale = param_.in_threshold / quantized::kInt8Max;
+    const float *wscale = in_data[qconv::kWeightScale].dptr<float>();
+    const float *bias = param_.no_bias ? NULL : in_data[qconv::kBias].dptr<float>();
+    const bool int8_out = param_.out_threshold > 0.0f;
+    const float out_inv_scale = int8_out ? quantized::kInt8Max / param_.out_threshold : 0.0f;
+    for (index_t n = 0; n < nbatch; ++n) {
+      for (index_t g = 0; g < param_.num_group; ++g) {
+        Unpack(data + n * in_size + g * group_channel * ishape[2] * ishape[3],
+               group_channel, ishape[2], ishape[3], oshape[2], oshape[3], col);
+        quantized::Int8GemmNT(weight + g * group_filter * ksize, col, acc,
+                              group_filter, npixel, ksize);
+        const index_t fbegin = g * group_filter;
+        #pragma omp parallel for
+        for (int f = 0; f < static_cast<int>(group_filter); ++f) {
+          const index_t filter = fbegin + f;
+          const index_t offset = (n * param_.num_filter + filter) * npixel;
+          quantized::Requantize(acc + f * npixel, npixel, in_scale * wscale[filter],
+                                bias == NULL ? 0.0f : bias[filter], param_.fuse_relu,
+                                int8_out ? NULL : out_data[qconv::kOut].dptr<float>() + offset,
+                                int8_out ? quantized::Int8Ptr(out_data[qconv::kOut]) + offset
+                                         : NULL,
+                                out_inv_scale);
+        }
+      }
+    }
+  }
+
+ private:
+  /*!
+   * \brief unpack a group of channels of an image to one row of
+   *  channel x kernel_y x kernel_x per output pixel, padding with 0
+   */
+  void Unpack(const int8_t *src, index_t nchannel, index_t height, index_t width,
+              index_t out_height, index_t out_width, int8_t *col) const {
+    const int ky = param_.kernel[0], kx = param_.kernel[1];
+    const int sy = param_.stride[0], sx = param_.stride[1];
+    const int dy = param_.dilate[0], dx = param_.dilate[1];
+    const int py = param_.pad[0], px = param_.pad[1];
+    const int h = static_cast<int>(height), w = static_cast<int>(width);
+    const index_t ksize = nchannel * ky * kx;
+    #pragma omp parallel for
+    for (int oy = 0; oy < static_cast<int>(out_height); ++oy) {
+      for (index_t ox = 0; ox < out_width; ++ox) {
+        int8_t *row = col + (oy * out_width + ox) * ksize;
+        for (index_t c = 0; c < nchannel; ++c) {
+          const int8_t *plane = src + c * h * w;
+          for (int i = 0; i < ky; ++i) {
+            const int y = oy * sy - py + i * dy;
+            for (int j = 0; j < kx; ++j) {
+              const int x = static_cast<int>(ox) * sx - px + j * dx;
+              *row++ = (y >= 0 && y < h && x >= 0 && x < w) ? plane[y * w + x] : 0;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  QuantizedConvolutionParam param_;
+};  // class QuantizedConvolutionOp
+
+template<typename xpu>
+Operator* CreateOp(QuantizedConvolutionParam param);
+
+#if DMLC_USE_CXX11
+class QuantizedConvolutionProp : public OperatorProperty {
+ public:
+  std::vector<std::string> ListArguments() const override {
+    if (!param_.no_bias) {
+      return {"data", "weight", "weight_scale", "bias"};
+    } else {
+      return {"data", "weight", "weight_scale"};
+    }
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    using namespace mshadow;
+    if (!param_.no_bias) {
+      CHECK_EQ(in_shape->size(), 4) << "Input:[data, weight, weight_scale, bias]";
+    } else {
+      CHECK_EQ(in_shape->size(), 3) << "Input:[data, weight, weight_scale]";
+    }
+    const TShape &dshape = (*in_shape)[qconv::kData];
+    if (dshape.ndim() ==  0) return false;
+    CHECK_EQ(param_.kernel.ndim(), 2) << "QuantizedConvolution only supports 2d kernels";
+    CHECK_EQ(dshape.ndim(), 4) \
+        << "Input data should be 4D in batch-num_filter-y-x";
+    CHECK_EQ(dshape[1] % param_.num_group, 0) \
+        << "input num_filter must divide group size";
+    CHECK_EQ(param_.num_filter % param_.num_group, 0) \
+        << "output num_filter must divide group size";
+    SHAPE_ASSIGN_CHECK(*in_shape,
+                       qconv::kWeight,
+                       Shape4(param_.num_filter, dshape[1] / param_.num_group,
+                              param_.kernel[0], param_.kernel[1]));
+    SHAPE_ASSIGN_CHECK(*in_shape, qconv::kWeightScale, Shape1(param_.num_filter));
+    if (!param_.no_bias) {
+      SHAPE_ASSIGN_CHECK(*in_shape, qconv::kBias, Shape1(param_.num_filter));
+    }
+    const index_t ksize_y = static_cast<index_t>(param_.kernel[0]);
+    const index_t ksize_x = static_cast<index_t>(param_.kernel[1]);
+    CHECK(ksize_y <= dshape[2] + 2 * param_.pad[0]
+          && ksize_x <= dshape[3] + 2 * param_.pad[1])
+        << "kernel size exceed input";
+    out_shape->clear();
+    out_shape->push_back(dshape);
+    (*out_shape)[qconv::kOut][1] = param_.num_filter;
+    (*out_shape)[qconv::kOut][2] = (dshape[2] + 2 * param_.pad[0] -
+        (param_.dilate[0] * (ksize_y - 1) + 1)) / param_.stride[0] + 1;
+    (*out_shape)[qconv::kOut][3] = (dshape[3] + 2 * param_.pad[1] -
+        (param_.dilate[1] * (ksize_x - 1) + 1)) / param_.stride[1] + 1;
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    // int8 data and weight in uint8 arrays, float32 scales and bias
+    std::vector<int> expected(in_type->size(), mshadow::kFloat32);
+    expected[qconv::kData] = mshadow::kUint8;
+    expected[qconv::kWeight] = mshadow::kUint8;
+    for (index_t i = 0; i < in_type->size(); ++i) {
+      if ((*in_type)[i] == -1) {
+        (*in_type)[i] = expected[i];
+      } else {
+        CHECK_EQ((*in_type)[i], expected[i]) << "Expected " << expected[i] << " v.s. given "
+                                             << (*in_type)[i] << " at " << ListArguments()[i];
+      }
+    }
+    out_type->clear();
+    out_type->push_back(param_.out_threshold > 0.0f ? mshadow::kUint8 : mshadow::kFloat32);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new QuantizedConvolutionProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "QuantizedConvolution";
+  }
+
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  Operator* CreateOperator(Context ctx) const override;
+
+ private:
+  QuantizedConvolutionParam param_;
+};  // class QuantizedConvolutionProp
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZED_CONVOLUTION_INL_H_
@@ -0,0 +1,34 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_convolution.cc
+ * \brief int8 convolution operator
+*/
+#include "./quantized_convolution-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<cpu>(QuantizedConvolutionParam param) {
+  return new QuantizedConvolutionOp(param);
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *QuantizedConvolutionProp::CreateOperator(Context ctx) const {
+  DO_BIND_DISPATCH(CreateOp, param_);
+}
+
+DMLC_REGISTER_PARAMETER(QuantizedConvolutionParam);
+
+MXNET_REGISTER_OP_PROPERTY(QuantizedConvolution, QuantizedConvolutionProp)
+.describe(R"(2d Convolution on int8 data for inference on cpu.
+The data is int8 from Quantize or from a quantized layer with out_threshold,
+the weight is int8 with one float scale per filter, products are accumulated
+in int32. Both int8 arrays are stored as uint8. The output is float32, or
+int8 requantized with out_threshold.)")
+.add_argument("data", "Symbol", "Input int8 data to the QuantizedConvolutionOp.")
+.add_argument("weight", "Symbol", "Int8 weight.")
+.add_argument("weight_scale", "Symbol", "Float scale of each filter of the weight.")
+.add_argument("bias", "Symbol", "Float bias parameter.")
+.add_arguments(QuantizedConvolutionParam::__FIELDS__());
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,15 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_convolution.cu
+ * \brief int8 convolution operator
+*/
+#include "./quantized_convolution-inl.h"
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<gpu>(QuantizedConvolutionParam param) {
+  LOG(FATAL) << "QuantizedConvolution is only supported on cpu";
+  return NULL;
+}
+}  // namespace op
+}  // namespace mxnet
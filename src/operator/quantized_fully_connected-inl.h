@@ -0,0 +1,200 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_fully_connected-inl.h
+ * \brief int8 fully connected operator for inference
+*/
+#ifndef MXNET_OPERATOR_QUANTIZED_FULLY_CONNECTED_INL_H_
+#define MXNET_OPERATOR_QUANTIZED_FULLY_CONNECTED_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
+#include "./operator_common.h"
+#include "./quantized_op_common.h"
+
+namespace mxnet {
+namespace op {
+
+// Declare enumeration of input order to make code more intuitive.
+// These enums are only visible within this header
+namespace qfullc {
+enum QuantizedFullyConnectedOpInputs {kData, kWeight, kWeightScale, kBias};
+enum QuantizedFullyConnectedOpOutputs {kOut};
+enum QuantizedFullyConnectedOpResource {kTempSpace};
+}  // qfullc
+
+struct QuantizedFullyConnectedParam : public dmlc::Parameter<QuantizedFullyConnectedParam> {
+  int num_hidden;
+  bool no_bias;
+  float in_threshold;
+  float out_threshold;
+  bool fuse_relu;
+  DMLC_DECLARE_PARAMETER(QuantizedFullyConnectedParam) {
+    DMLC_DECLARE_FIELD(num_hidden).set_lower_bound(1)
+    .describe("Number of hidden nodes of the output.");
+    DMLC_DECLARE_FIELD(no_bias).set_default(false)
+    .describe("Whether to disable bias parameter.");
+    DMLC_DECLARE_FIELD(in_threshold).set_lower_bound(0.0f)
+    .describe("The threshold the int8 data was quantized with.");
+    DMLC_DECLARE_FIELD(out_threshold).set_default(0.0f).set_lower_bound(0.0f)
+    .describe("If positive, requantize the output to int8 with this threshold, "
+              "for the next quantized layer. Otherwise the output is float32.");
+    DMLC_DECLARE_FIELD(fuse_relu).set_default(false)
+    .describe("Whether to apply relu to the output.");
+  }
+};
+
+/*!
+ * \brief fully connected layer on int8 data and int8 weights with one scale
+ *  per output, accumulated in int32. The int32 result is scaled back to float,
+ *  added to the float bias and either written as float32 or requantized to
+ *  int8 for the next quantized layer, so no separate requantize pass is needed.
+ */
+class QuantizedFullyConnectedOp : public Operator {
+ public:
+  explicit QuantizedFullyConnectedOp(QuantizedFullyConnectedParam p) : param_(p) {
+    CHECK_GT(param_.in_threshold, 0.0f) << "QuantizedFullyConnected: in_threshold must be positive";
+  }
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    if (req[qfullc::kOut] == kNullOp) return;
+    CHECK_EQ(req[qfullc::kOut], kWriteTo);
+    size_t expected = param_.no_bias ? 3 : 4;
+    CHECK_EQ(in_data.size(), expected);
+    CHECK_EQ(out_data.size(), 1);
+    const TShape& ishape = in_data[qfullc::kData].shape_;
+    const index_t num = ishape[0];
+    const index_t num_input = ishape.ProdShape(1, ishape.ndim());
+    const index_t num_hidden = param_.num_hidden;
+    Tensor<cpu, 1, int32_t> acc = ctx.requested[qfullc::kTempSpace]
+        .get_space_typed<cpu, 1, int32_t>(Shape1(num * num_hidden), ctx.get_stream<cpu>());
+    quantized::Int8GemmNT(quantized::Int8Ptr(in_data[qfullc::kData]),
+                          quantized::Int8Ptr(in_data[qfullc::kWeight]),
+                          acc.dptr_, num, num_hidden, num_input);
+
+    const float in_scale = param_.in_threshold / quantized::kInt8Max;
+    const float *wscale = in_data[qfullc::kWeightScale].dptr<float>();
+    const float *bias = param_.no_bias ? NULL : in_data[qfullc::kBias].dptr<float>();
+    const bool int8_out = param_.out_threshold > 0.0f;
+    const float out_inv_scale = int8_out ? quantized::kInt8Max / param_.out_threshold : 0.0f;
+    float *out = int8_out ? NULL : out_data[qfullc::kOut].dptr<float>();
+    int8_t *qout = int8_out ? quantized::Int8Ptr(out_data[qfullc::kOut]) : NULL;
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(num); ++i) {
+      for (index_t j = 0; j < num_hidden; ++j) {
+        float v = acc.dptr_[i * num_hidden + j] * (in_scale * wscale[j]);
+        if (bias != NULL) v += bias[j];
+        if (param_.fuse_relu) v = std::max(v, 0.0f);
+        if (int8_out) {
+          qout[i * num_hidden + j] = quantized::Quantize(v, out_inv_scale);
+        } else {
+          out[i * num_hidden + j] = v;
+        }
+      }
+    }
+  }
+
+ private:
+  QuantizedFullyConnectedParam param_;
+};  // class QuantizedFullyConnectedOp
+
+// Decalre Factory function, used for dispatch specialization
+template<typename xpu>
+Operator* CreateOp(QuantizedFullyConnectedParam param);
+
+#if DMLC_USE_CXX11
+class QuantizedFullyConnectedProp : public OperatorProperty {
+ public:
+  std::vector<std::string> ListArguments() const override {
+    if (!param_.no_bias) {
+      return {"data", "weight", "weight_scale", "bias"};
+    } else {
+      return {"data", "weight", "weight_scale"};
+    }
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    using namespace mshadow;
+    if (!param_.no_bias) {
+      CHECK_EQ(in_shape->size(), 4) << "Input:[data, weight, weight_scale, bias]";
+    } else {
+      CHECK_EQ(in_shape->size(), 3) << "Input:[data, weight, weight_scale]";
+    }
+    const TShape &dshape = (*in_shape)[qfullc::kData];
+    if (dshape.ndim() ==  0) return false;
+
+    index_t num_input = dshape.ProdShape(1, dshape.ndim());
+    SHAPE_ASSIGN_CHECK(*in_shape, qfullc::kWeight, Shape2(param_.num_hidden, num_input));
+    SHAPE_ASSIGN_CHECK(*in_shape, qfullc::kWeightScale, Shape1(param_.num_hidden));
+    if (!param_.no_bias) {
+      SHAPE_ASSIGN_CHECK(*in_shape, qfullc::kBias, Shape1(param_.num_hidden));
+    }
+    out_shape->clear();
+    out_shape->push_back(Shape2(dshape[0], param_.num_hidden));
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    // int8 data and weight in uint8 arrays, float32 scales and bias
+    std::vector<int> expected(in_type->size(), mshadow::kFloat32);
+    expected[qfullc::kData] = mshadow::kUint8;
+    expected[qfullc::kWeight] = mshadow::kUint8;
+    for (index_t i = 0; i < in_type->size(); ++i) {
+      if ((*in_type)[i] == -1) {
+        (*in_type)[i] = expected[i];
+      } else {
+        CHECK_EQ((*in_type)[i], expected[i]) << "Expected " << expected[i] << " v.s. given "
+                                             << (*in_type)[i] << " at " << ListArguments()[i];
+      }
+    }
+    out_type->clear();
+    out_type->push_back(param_.out_threshold > 0.0f ? mshadow::kUint8 : mshadow::kFloat32);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new QuantizedFullyConnectedProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "QuantizedFullyConnected";
+  }
+
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  Operator* CreateOperator(Context ctx) const override;
+
+ private:
+  QuantizedFullyConnectedParam param_;
+};  // class QuantizedFullyConnectedProp
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZED_FULLY_CONNECTED_INL_H_
@@ -0,0 +1,34 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_fully_connected.cc
+ * \brief int8 fully connected operator
+*/
+#include "./quantized_fully_connected-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<cpu>(QuantizedFullyConnectedParam param) {
+  return new QuantizedFullyConnectedOp(param);
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *QuantizedFullyConnectedProp::CreateOperator(Context ctx) const {
+  DO_BIND_DISPATCH(CreateOp, param_);
+}
+
+DMLC_REGISTER_PARAMETER(QuantizedFullyConnectedParam);
+
+MXNET_REGISTER_OP_PROPERTY(QuantizedFullyConnected, QuantizedFullyConnectedProp)
+.describe(R"(FullyConnected on int8 data for inference on cpu.
+The data is int8 from Quantize or from a quantized layer with out_threshold,
+the weight is int8 with one float scale per output, products are accumulated
+in int32. Both int8 arrays are stored as uint8. The output is float32, or
+int8 requantized with out_threshold.)")
+.add_argument("data", "Symbol", "Input int8 data.")
+.add_argument("weight", "Symbol", "Int8 weight matrix.")
+.add_argument("weight_scale", "Symbol", "Float scale of each row of the weight.")
+.add_argument("bias", "Symbol", "Float bias parameter.")
+.add_arguments(QuantizedFullyConnectedParam::__FIELDS__());
+}  // namespace op
+}  // namespace mxnet
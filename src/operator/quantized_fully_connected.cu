@@ -0,0 +1,15 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_fully_connected.cu
+ * \brief int8 fully connected operator
+*/
+#include "./quantized_fully_connected-inl.h"
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<gpu>(QuantizedFullyConnectedParam param) {
+  LOG(FATAL) << "QuantizedFullyConnected is only supported on cpu";
+  return NULL;
+}
+}  // namespace op
+}  // namespace mxnet
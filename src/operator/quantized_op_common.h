@@ -0,0 +1,107 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file quantized_op_common.h
+ * \brief common functions of the int8 quantized operators
+ */
+#ifndef MXNET_OPERATOR_QUANTIZED_OP_COMMON_H_
+#define MXNET_OPERATOR_QUANTIZED_OP_COMMON_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/base.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace mxnet {
+namespace op {
+namespace quantized {
+/*!
+ * \brief the int8 values are symmetric, a tensor quantized with threshold t
+ *  stores round(x * 127 / t), clipped to [-127, 127], so 0 is exact.
+ *  mshadow has no int8 type, the int8 values are stored in uint8 arrays.
+ */
+const int kInt8Max = 127;
+
+/*! \brief the int8 data of a uint8 blob */
+inline int8_t *Int8Ptr(const TBlob &blob) {
+  return reinterpret_cast<int8_t*>(blob.dptr<uint8_t>());
+}
+
+/*! \brief round v / scale to int8, rounding half away from zero */
+inline int8_t Quantize(float v, float inv_scale) {
+  const float q = v * inv_scale;
+  const float r = q + (q >= 0.0f ? 0.5f : -0.5f);
+  return static_cast<int8_t>(std::max(-static_cast<float>(kInt8Max),
+                                      std::min(r, static_cast<float>(kInt8Max))));
+}
+
+/*!
+ * \brief the epilogue of a quantized layer, v = acc * scale + bias followed by
+ *  an optional relu, written as float to out, or requantized to int8 with
+ *  out_inv_scale when int8_out is not NULL
+ */
+inline void Requantize(const int32_t *acc, index_t n, float scale, float bias, bool relu,
+                       float *out, int8_t *int8_out, float out_inv_scale) {
+  if (int8_out != NULL) {
+    for (index_t i = 0; i < n; ++i) {
+      float v = acc[i] * scale + bias;
+      if (relu) v = std::max(v, 0.0f);
+      int8_out[i] = Quantize(v, out_inv_scale);
+    }
+  } else {
+    for (index_t i = 0; i < n; ++i) {
+      float v = acc[i] * scale + bias;
+      out[i] = relu ? std::max(v, 0.0f) : v;
+    }
+  }
+}
+
+/*!
+ * \brief c = a * b^T for the int8 matrices a (m x k) and b (n x k), with the
+ *  int32 result c (m x n). The rows of b are split in blocks over the threads,
+ *  a block of b stays in cache while it meets the rows of a four at a time, so
+ *  each value of b loaded is used by four dot products. The dot products run
+ *  over contiguous int8 rows and are vectorized by the compiler.
+ */
+inline void Int8GemmNT(const int8_t *a, const int8_t *b, int32_t *c,
+                       index_t m, index_t n, index_t k) {
+  const int kBlock = 16;
+  const int nblock = static_cast<int>((n + kBlock - 1) / kBlock);
+  #pragma omp parallel for
+  for (int blk = 0; blk < nblock; ++blk) {
+    const index_t jbegin = blk * kBlock;
+    const index_t jend = std::min(jbegin + kBlock, n);
+    index_t i = 0;
+    for (; i + 4 <= m; i += 4) {
+      const int8_t *a0 = a + i * k, *a1 = a0 + k, *a2 = a1 + k, *a3 = a2 + k;
+      for (index_t j = jbegin; j < jend; ++j) {
+        const int8_t *bj = b + j * k;
+        int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (index_t p = 0; p < k; ++p) {
+          const int32_t v = bj[p];
+          s0 += a0[p] * v;
+          s1 += a1[p] * v;
+          s2 += a2[p] * v;
+          s3 += a3[p] * v;
+        }
+        c[i * n + j] = s0;
+        c[(i + 1) * n + j] = s1;
+        c[(i + 2) * n + j] = s2;
+        c[(i + 3) * n + j] = s3;
+      }
+    }
+    for (; i < m; ++i) {
+      const int8_t *ai = a + i * k;
+      for (index_t j = jbegin; j < jend; ++j) {
+        const int8_t *bj = b + j * k;
+        int32_t s = 0;
+        for (index_t p = 0; p < k; ++p) s += ai[p] * bj[p];
+        c[i * n + j] = s;
+      }
+    }
+  }
+}
+}  // namespace quantized
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_QUANTIZED_OP_COMMON_H_
@@ -0,0 +1,195 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file sampled_softmax_output-inl.h
+ * \brief softmax output over a large number of classes, trained on sampled classes
+*/
+#ifndef MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_INL_H_
+#define MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_INL_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/parameter.h>
+#include <mxnet/operator.h>
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
+#include "./operator_common.h"
+#include "./sparse_grad_op_common.h"
+
+namespace mxnet {
+namespace op {
+
+namespace sampled_softmax {
+enum SampledSoftmaxOutputOpInputs {kData, kLabel, kWeight, kBias};
+enum SampledSoftmaxOutputOpOutputs {kOut, kProb, kSamples};
+// the backward only requests kTempSpace
+enum SampledSoftmaxOutputOpResource {kTempSpace, kRandom};
+enum SampledSoftmaxOutputOpAuxiliary {kTouchedRows};
+}  // namespace sampled_softmax
+
+struct SampledSoftmaxOutputParam : public dmlc::Parameter<SampledSoftmaxOutputParam> {
+  int num_hidden;
+  int num_sampled;
+  bool no_bias;
+  bool remove_accidental_hits;
+  float grad_scale;
+  bool sparse_grad;
+  DMLC_DECLARE_PARAMETER(SampledSoftmaxOutputParam) {
+    DMLC_DECLARE_FIELD(num_hidden).set_lower_bound(1)
+    .describe("Number of classes, the rows of the weight.");
+    DMLC_DECLARE_FIELD(num_sampled).set_lower_bound(1)
+    .describe("Number of classes sampled for each batch in training, shared by "
+              "all the instances of the batch.");
+    DMLC_DECLARE_FIELD(no_bias).set_default(false)
+    .describe("Whether to disable bias parameter.");
+    DMLC_DECLARE_FIELD(remove_accidental_hits).set_default(true)
+    .describe("Whether to leave out the sampled classes that are the label "
+              "of an instance from its softmax.");
+    DMLC_DECLARE_FIELD(grad_scale).set_default(1.0f)
+    .describe("Scale the gradient by a float factor");
+    DMLC_DECLARE_FIELD(sparse_grad).set_default(false)
+    .describe(SparseGradDescription("weight and bias gradients"));
+  }
+};
+
+// Decalre Factory function, used for dispatch specialization
+template<typename xpu>
+Operator* CreateOp(SampledSoftmaxOutputParam param, int dtype);
+
+#if DMLC_USE_CXX11
+class SampledSoftmaxOutputProp : public OperatorProperty {
+ public:
+  std::vector<std::string> ListArguments() const override {
+    if (!param_.no_bias) {
+      return {"data", "label", "weight", "bias"};
+    } else {
+      return {"data", "label", "weight"};
+    }
+  }
+
+  std::vector<std::string> ListOutputs() const override {
+    return {"output", "prob", "samples"};
+  }
+
+  std::vector<std::string> ListAuxiliaryStates() const override {
+    if (param_.sparse_grad) {
+      return {"touched_rows"};
+    } else {
+      return {};
+    }
+  }
+
+  int NumOutputs() const override {
+    return 3;
+  }
+
+  int NumVisibleOutputs() const override {
+    return 1;
+  }
+
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  std::map<std::string, std::string> GetParams() const override {
+    return param_.__DICT__();
+  }
+
+  bool InferShape(std::vector<TShape> *in_shape,
+                  std::vector<TShape> *out_shape,
+                  std::vector<TShape> *aux_shape) const override {
+    using namespace mshadow;
+    if (!param_.no_bias) {
+      CHECK_EQ(in_shape->size(), 4) << "Input:[data, label, weight, bias]";
+    } else {
+      CHECK_EQ(in_shape->size(), 3) << "Input:[data, label, weight]";
+    }
+    const TShape &dshape = (*in_shape)[sampled_softmax::kData];
+    if (dshape.ndim() ==  0) return false;
+
+    index_t num_input = dshape.ProdShape(1, dshape.ndim());
+    SHAPE_ASSIGN_CHECK(*in_shape, sampled_softmax::kLabel, Shape1(dshape[0]));
+    SHAPE_ASSIGN_CHECK(*in_shape, sampled_softmax::kWeight, Shape2(param_.num_hidden, num_input));
+    if (!param_.no_bias) {
+      SHAPE_ASSIGN_CHECK(*in_shape, sampled_softmax::kBias, Shape1(param_.num_hidden));
+    }
+    out_shape->clear();
+    // the loss of each instance, then the softmax over the label and the
+    // sampled classes, and the sampled classes, for the backward
+    out_shape->push_back(Shape1(dshape[0]));
+    out_shape->push_back(Shape2(dshape[0], param_.num_sampled + 1));
+    out_shape->push_back(Shape1(param_.num_sampled));
+    aux_shape->clear();
+    if (param_.sparse_grad) {
+      // the number of rows, then the rows, whatever the batch size
+      aux_shape->push_back(Shape1(param_.num_hidden + 1));
+    }
+    return true;
+  }
+
+  bool InferType(std::vector<int> *in_type,
+                 std::vector<int> *out_type,
+                 std::vector<int> *aux_type) const override {
+    CHECK_GE(in_type->size(), 1);
+    int dtype = (*in_type)[0];
+    CHECK_NE(dtype, -1) << "First input must have specified type";
+    for (index_t i = 0; i < in_type->size(); ++i) {
+      if ((*in_type)[i] == -1) {
+        (*in_type)[i] = dtype;
+      } else {
+        CHECK_EQ((*in_type)[i], dtype) << "This layer requires uniform type. "
+                                       << "Expected " << dtype << " v.s. given "
+                                       << (*in_type)[i] << " at " << ListArguments()[i];
+      }
+    }
+    out_type->clear();
+    for (int i = 0; i < NumOutputs(); ++i) out_type->push_back(dtype);
+    aux_type->clear();
+    if (param_.sparse_grad) aux_type->push_back(mshadow::kInt32);
+    return true;
+  }
+
+  OperatorProperty* Copy() const override {
+    auto ptr = new SampledSoftmaxOutputProp();
+    ptr->param_ = param_;
+    return ptr;
+  }
+
+  std::string TypeString() const override {
+    return "SampledSoftmaxOutput";
+  }
+
+  std::vector<int> DeclareBackwardDependency(
+    const std::vector<int> &out_grad,
+    const std::vector<int> &in_data,
+    const std::vector<int> &out_data) const override {
+    return {in_data[sampled_softmax::kData], in_data[sampled_softmax::kLabel],
+            in_data[sampled_softmax::kWeight], out_data[sampled_softmax::kProb],
+            out_data[sampled_softmax::kSamples]};
+  }
+
+  std::vector<ResourceRequest> ForwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace, ResourceRequest::kRandom};
+  }
+
+  std::vector<ResourceRequest> BackwardResource(
+      const std::vector<TShape> &in_shape) const override {
+    return {ResourceRequest::kTempSpace};
+  }
+
+  Operator* CreateOperator(Context ctx) const override {
+    LOG(FATAL) << "Not Implemented.";
+    return NULL;
+  }
+
+  Operator* CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+                             std::vector<int> *in_type) const override;
+
+ private:
+  SampledSoftmaxOutputParam param_;
+};  // class SampledSoftmaxOutputProp
+#endif  // DMLC_USE_CXX11
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_INL_H_
@@ -0,0 +1,59 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file sampled_softmax_output.cc
+ * \brief softmax output over a large number of classes, trained on sampled classes
+*/
+#include "./sampled_softmax_output-inl.h"
+#include "./sampled_softmax_output_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<cpu>(SampledSoftmaxOutputParam param, int dtype) {
+  Operator *op = NULL;
+  switch (dtype) {
+  case mshadow::kFloat32:
+    op = new SampledSoftmaxOutputCPUOp<float>(param);
+    break;
+  case mshadow::kFloat64:
+    op = new SampledSoftmaxOutputCPUOp<double>(param);
+    break;
+  default:
+    LOG(FATAL) << "Unsupported type " << dtype;
+  }
+  return op;
+}
+
+// DO_BIND_DISPATCH comes from operator_common.h
+Operator *SampledSoftmaxOutputProp::CreateOperatorEx(Context ctx, std::vector<TShape> *in_shape,
+                                                     std::vector<int> *in_type) const {
+  std::vector<TShape> out_shape, aux_shape;
+  std::vector<int> out_type, aux_type;
+  CHECK(InferType(in_type, &out_type, &aux_type));
+  CHECK(InferShape(in_shape, &out_shape, &aux_shape));
+  DO_BIND_DISPATCH(CreateOp, param_, (*in_type)[0]);
+}
+
+DMLC_REGISTER_PARAMETER(SampledSoftmaxOutputParam);
+
+MXNET_REGISTER_OP_PROPERTY(SampledSoftmaxOutput, SampledSoftmaxOutputProp)
+.describe(R"(Softmax output over num_hidden classes, whose logits are
+dot(data, weight.T) + bias, for large vocabularies on cpu. It replaces
+FullyConnected and SoftmaxOutput, and outputs the cross entropy of each
+instance, with a gradient as SoftmaxOutput.
+In training, the softmax of each instance is taken over its label and
+num_sampled classes drawn for the batch from a log-uniform distribution,
+so the classes must be sorted by decreasing frequency. Only the logits
+of these classes are computed and only their rows of the weight get a
+gradient. In inference, the cross entropy is that of the full softmax,
+so that exp(mean(output)) is the perplexity.
+The probabilities of all the classes, e.g. to decode, are those of
+SoftmaxOutput(FullyConnected(data, weight, bias, num_hidden)) bound to
+the same weight and bias, in a separate inference graph.)")
+.add_argument("data", "Symbol", "Input data, the hidden state.")
+.add_argument("label", "Symbol", "Label of each instance.")
+.add_argument("weight", "Symbol", "Weight matrix, a row for each class.")
+.add_argument("bias", "Symbol", "Bias parameter.")
+.add_arguments(SampledSoftmaxOutputParam::__FIELDS__());
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,15 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file sampled_softmax_output.cu
+ * \brief softmax output over a large number of classes, trained on sampled classes
+*/
+#include "./sampled_softmax_output-inl.h"
+namespace mxnet {
+namespace op {
+template<>
+Operator* CreateOp<gpu>(SampledSoftmaxOutputParam param, int dtype) {
+  LOG(FATAL) << "SampledSoftmaxOutput is only supported on cpu";
+  return NULL;
+}
+}  // namespace op
+}  // namespace mxnet
@@ -0,0 +1,324 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file sampled_softmax_output_cpu-inl.h
+ * \brief sampled softmax output on cpu
+ */
+#ifndef MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_CPU_INL_H_
+#define MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "./sampled_softmax_output-inl.h"
+#include "./softmax_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief softmax output over num_hidden classes whose logits are the rows of
+ *  the weight times the data, plus the bias. The output is the cross entropy
+ *  of each instance.
+ *
+ *  In training, num_sampled classes are drawn for the batch from the
+ *  log-uniform distribution P(c) = log((c + 2) / (c + 1)) / log(num_hidden + 1),
+ *  which suits classes sorted by decreasing frequency, and the softmax of each
+ *  instance is taken over its label and the sampled classes only, with the log
+ *  of the expected count of each class subtracted from its logit. Only the
+ *  sampled rows of the weight are multiplied, and only them and the rows of
+ *  the labels get a gradient. The softmax and the sampled classes are kept in
+ *  hidden outputs for the backward.
+ *
+ *  In inference, the cross entropy is that of the full softmax, computed over
+ *  blocks of classes with the online softmax, so that the logits of all the
+ *  classes are never stored at once.
+ */
+template<typename DType>
+class SampledSoftmaxOutputCPUOp : public Operator {
+ public:
+  explicit SampledSoftmaxOutputCPUOp(SampledSoftmaxOutputParam p) : param_(p) {}
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    size_t expected = param_.no_bias ? 3 : 4;
+    CHECK_EQ(in_data.size(), expected);
+    CHECK_EQ(out_data.size(), 3);
+    Stream<cpu> *s = ctx.get_stream<cpu>();
+    const TShape &ishape = in_data[sampled_softmax::kData].shape_;
+    const index_t n = ishape[0];
+    const index_t dim = ishape.ProdShape(1, ishape.ndim());
+    const DType *data = in_data[sampled_softmax::kData].dptr<DType>();
+    const DType *weight = in_data[sampled_softmax::kWeight].dptr<DType>();
+    const DType *bias = param_.no_bias ? NULL : in_data[sampled_softmax::kBias].dptr<DType>();
+    const std::vector<index_t> labels = Labels(in_data[sampled_softmax::kLabel]);
+    DType *out = out_data[sampled_softmax::kOut].dptr<DType>();
+    Tensor<cpu, 2, DType> dmat(const_cast<DType*>(data), Shape2(n, dim), s);
+
+    if (!ctx.is_train) {
+      // the full softmax, over blocks of classes
+      const index_t num_hidden = param_.num_hidden;
+      const index_t block = std::min(num_hidden, std::max(softmax::kBlock, kMaxLogits / n));
+      DType *logits = ctx.requested[sampled_softmax::kTempSpace].get_space_typed<cpu, 1, DType>(
+          Shape1(n * block), s).dptr_;
+      std::vector<DType> max(n, -std::numeric_limits<DType>::infinity()), sum(n, DType(0));
+      std::vector<DType> target(n);
+      for (index_t begin = 0; begin < num_hidden; begin += block) {
+        const index_t m = std::min(block, num_hidden - begin);
+        Tensor<cpu, 2, DType> wmat(const_cast<DType*>(weight) + begin * dim, Shape2(m, dim), s);
+        Tensor<cpu, 2, DType> lmat(logits, Shape2(n, m), s);
+        lmat = dot(dmat, wmat.T());
+        #pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(n); ++i) {
+          DType *x = logits + i * m;
+          if (bias != NULL) {
+            for (index_t j = 0; j < m; ++j) x[j] += bias[begin + j];
+          }
+          if (labels[i] >= begin && labels[i] < begin + m) target[i] = x[labels[i] - begin];
+          const DType mb = softmax::Max(x, m);
+          if (mb > max[i]) {
+            sum[i] *= softmax::Exp(max[i] - mb);
+            max[i] = mb;
+          }
+          sum[i] += softmax::ExpSum(x, max[i], x, m);
+        }
+      }
+      for (index_t i = 0; i < n; ++i) {
+        Write(out + i, req[sampled_softmax::kOut], max[i] + std::log(sum[i]) - target[i]);
+      }
+      return;
+    }
+
+    const index_t num_sampled = param_.num_sampled;
+    const index_t k = num_sampled + 1;
+    Tensor<cpu, 1, DType> samples = out_data[sampled_softmax::kSamples].get<cpu, 1, DType>(s);
+    Random<cpu> *prnd = ctx.requested[sampled_softmax::kRandom].get_random<cpu, real_t>(s);
+    samples = tcast<DType>(prnd->uniform(samples.shape_));
+    std::vector<index_t> classes(num_sampled);
+    for (index_t j = 0; j < num_sampled; ++j) {
+      classes[j] = SampleClass(samples.dptr_[j]);
+      samples.dptr_[j] = static_cast<DType>(classes[j]);
+    }
+    // the sampled rows of the weight, and their logits
+    DType *space = ctx.requested[sampled_softmax::kTempSpace].get_space_typed<cpu, 1, DType>(
+        Shape1(num_sampled * (dim + n)), s).dptr_;
+    GatherRows(weight, classes, dim, space);
+    Tensor<cpu, 2, DType> wmat(space, Shape2(num_sampled, dim), s);
+    Tensor<cpu, 2, DType> lmat(space + num_sampled * dim, Shape2(n, num_sampled), s);
+    lmat = dot(dmat, wmat.T());
+    // the bias of each sampled class, less the log of its expected count
+    std::vector<DType> offset(num_sampled);
+    for (index_t j = 0; j < num_sampled; ++j) {
+      offset[j] = (bias != NULL ? bias[classes[j]] : DType(0)) - LogExpectedCount(classes[j]);
+    }
+    DType *prob = out_data[sampled_softmax::kProb].dptr<DType>();
+    #pragma omp parallel
+    {
+      std::vector<DType> bmax(softmax::NumBlocks(k));
+      #pragma omp for
+      for (int i = 0; i < static_cast<int>(n); ++i) {
+        const index_t y = labels[i];
+        DType *p = prob + i * k;
+        const DType *x = lmat.dptr_ + i * num_sampled;
+        p[0] = Dot(data + i * dim, weight + y * dim, dim) - LogExpectedCount(y);
+        if (bias != NULL) p[0] += bias[y];
+        for (index_t j = 0; j < num_sampled; ++j) {
+          p[j + 1] = param_.remove_accidental_hits && classes[j] == y ?
+              -std::numeric_limits<DType>::infinity() : x[j] + offset[j];
+        }
+        const DType target = p[0];
+        DType max;
+        const DType sum = softmax::SoftmaxRow(p, p, k, DType(1), bmax.data(), &max);
+        Write(out + i, req[sampled_softmax::kOut], max + std::log(sum) - target);
+      }
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    using namespace mshadow;
+    using namespace mshadow::expr;
+    size_t expected = param_.no_bias ? 3 : 4;
+    CHECK(in_data.size() == expected && in_grad.size() == expected);
+    CHECK_NE(req[sampled_softmax::kWeight], kWriteInplace) << "cannot write weight inplace";
+    Stream<cpu> *s = ctx.get_stream<cpu>();
+    const TShape &ishape = in_data[sampled_softmax::kData].shape_;
+    const index_t n = ishape[0];
+    const index_t dim = ishape.ProdShape(1, ishape.ndim());
+    const index_t num_sampled = param_.num_sampled;
+    const index_t k = num_sampled + 1;
+    const DType *data = in_data[sampled_softmax::kData].dptr<DType>();
+    const DType *weight = in_data[sampled_softmax::kWeight].dptr<DType>();
+    const DType *prob = out_data[sampled_softmax::kProb].dptr<DType>();
+    const DType *samples = out_data[sampled_softmax::kSamples].dptr<DType>();
+    const std::vector<index_t> labels = Labels(in_data[sampled_softmax::kLabel]);
+    std::vector<index_t> classes(num_sampled);
+    for (index_t j = 0; j < num_sampled; ++j) classes[j] = static_cast<index_t>(samples[j]);
+
+    // the gradient of the logits of the sampled classes, of the sampled rows
+    // of the weight, and the sampled rows of the weight
+    DType *space = ctx.requested[sampled_softmax::kTempSpace].get_space_typed<cpu, 1, DType>(
+        Shape1(num_sampled * (n + 2 * dim)), s).dptr_;
+    Tensor<cpu, 2, DType> dmat(const_cast<DType*>(data), Shape2(n, dim), s);
+    Tensor<cpu, 2, DType> glmat(space, Shape2(n, num_sampled), s);
+    Tensor<cpu, 2, DType> gwmat(space + n * num_sampled, Shape2(num_sampled, dim), s);
+    Tensor<cpu, 2, DType> wmat(space + num_sampled * (n + dim), Shape2(num_sampled, dim), s);
+    // the gradient of the logit of the label
+    std::vector<DType> gtarget(n);
+    const DType scale = static_cast<DType>(param_.grad_scale);
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      const DType *p = prob + i * k;
+      DType *g = glmat.dptr_ + i * num_sampled;
+      gtarget[i] = (p[0] - DType(1)) * scale;
+      for (index_t j = 0; j < num_sampled; ++j) g[j] = p[j + 1] * scale;
+    }
+
+    const OpReqType dreq = req[sampled_softmax::kData];
+    if (dreq != kNullOp) {
+      GatherRows(weight, classes, dim, wmat.dptr_);
+      Tensor<cpu, 2, DType> gdata = in_grad[sampled_softmax::kData].get_with_shape<cpu, 2, DType>(
+          Shape2(n, dim), s);
+      Assign(gdata, dreq, dot(glmat, wmat));
+      #pragma omp parallel for
+      for (int i = 0; i < static_cast<int>(n); ++i) {
+        const DType *w = weight + labels[i] * dim;
+        DType *g = gdata.dptr_ + i * dim;
+        for (index_t j = 0; j < dim; ++j) g[j] += gtarget[i] * w[j];
+      }
+    }
+
+    const OpReqType wreq = req[sampled_softmax::kWeight];
+    const OpReqType breq = param_.no_bias ? kNullOp : req[sampled_softmax::kBias];
+    if (wreq == kNullOp && breq == kNullOp) return;
+    if (wreq != kNullOp) gwmat = dot(glmat.T(), dmat);
+    std::vector<DType> gbias(num_sampled);
+    if (breq != kNullOp) {
+      Tensor<cpu, 1, DType> gbvec(gbias.data(), Shape1(num_sampled), s);
+      gbvec = sum_rows(glmat);
+    }
+    // the (row, source) of the gradients sorted, where a source below
+    // num_sampled is a sampled class and the others the label of an instance,
+    // and the start of the run of each distinct row
+    std::vector<std::pair<int, int> > order;
+    order.reserve(num_sampled + n);
+    for (index_t j = 0; j < num_sampled; ++j) {
+      order.push_back(std::make_pair(static_cast<int>(classes[j]), static_cast<int>(j)));
+    }
+    for (index_t i = 0; i < n; ++i) {
+      order.push_back(std::make_pair(static_cast<int>(labels[i]),
+                                     static_cast<int>(num_sampled + i)));
+    }
+    std::sort(order.begin(), order.end());
+    std::vector<int> starts;
+    for (size_t i = 0; i < order.size(); ++i) {
+      if (i == 0 || order[i].first != order[i - 1].first) starts.push_back(i);
+    }
+    const int nrow = static_cast<int>(starts.size());
+    starts.push_back(order.size());
+
+    DType *gweight = wreq == kNullOp ? NULL : in_grad[sampled_softmax::kWeight].dptr<DType>();
+    DType *gb = breq == kNullOp ? NULL : in_grad[sampled_softmax::kBias].dptr<DType>();
+    int *touched = param_.sparse_grad ?
+        aux_args[sampled_softmax::kTouchedRows].dptr<int>() : NULL;
+    std::vector<std::pair<DType*, index_t> > cleared;
+    if (gweight != NULL && wreq != kAddTo) cleared.push_back(std::make_pair(gweight, dim));
+    if (gb != NULL && breq != kAddTo) cleared.push_back(std::make_pair(gb, index_t(1)));
+    touched_rows_.Clear(cleared, param_.num_hidden, touched);
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int r = 0; r < nrow; ++r) {
+      const int row = order[starts[r]].first;
+      for (int t = starts[r]; t < starts[r + 1]; ++t) {
+        const index_t src = order[t].second;
+        if (src < num_sampled) {
+          if (gweight != NULL) {
+            const DType *g = gwmat.dptr_ + src * dim;
+            DType *dst = gweight + row * dim;
+            for (index_t j = 0; j < dim; ++j) dst[j] += g[j];
+          }
+          if (gb != NULL) gb[row] += gbias[src];
+        } else {
+          const index_t i = src - num_sampled;
+          if (gweight != NULL) {
+            const DType *x = data + i * dim;
+            DType *dst = gweight + row * dim;
+            for (index_t j = 0; j < dim; ++j) dst[j] += gtarget[i] * x[j];
+          }
+          if (gb != NULL) gb[row] += gtarget[i];
+        }
+      }
+    }
+    if (touched != NULL) {
+      std::vector<int> rows(nrow);
+      for (int r = 0; r < nrow; ++r) rows[r] = order[starts[r]].first;
+      TouchedRows::Set(touched, rows, (gweight != NULL ? wreq : breq) == kAddTo);
+    }
+  }
+
+ private:
+  /*! \brief the most logits of the full softmax stored at once in inference */
+  static const index_t kMaxLogits = 1 << 22;
+
+  /*! \brief the labels as rows of the weight */
+  inline std::vector<index_t> Labels(const TBlob &label) const {
+    const DType *ptr = label.dptr<DType>();
+    std::vector<index_t> labels(label.Size());
+    for (index_t i = 0; i < labels.size(); ++i) {
+      const int y = static_cast<int>(ptr[i]);
+      CHECK(y >= 0 && y < param_.num_hidden)
+        << "SampledSoftmaxOutput: label " << y << " is out of [0, " << param_.num_hidden << ")";
+      labels[i] = y;
+    }
+    return labels;
+  }
+  /*! \brief the class of a uniform sample u in [0, 1) under the log-uniform distribution */
+  inline index_t SampleClass(DType u) const {
+    const double c = std::exp(static_cast<double>(u) * std::log(param_.num_hidden + 1.0)) - 1.0;
+    return std::min(static_cast<index_t>(std::max(c, 0.0)),
+                    static_cast<index_t>(param_.num_hidden - 1));
+  }
+  /*! \brief the log of the expected number of times class c is sampled */
+  inline DType LogExpectedCount(index_t c) const {
+    const double p = std::log((c + 2.0) / (c + 1.0)) / std::log(param_.num_hidden + 1.0);
+    return static_cast<DType>(std::log(param_.num_sampled * p));
+  }
+  /*! \brief copy the rows of src into dst */
+  static void GatherRows(const DType *src, const std::vector<index_t> &rows,
+                         index_t dim, DType *dst) {
+    #pragma omp parallel for
+    for (int j = 0; j < static_cast<int>(rows.size()); ++j) {
+      std::copy(src + rows[j] * dim, src + (rows[j] + 1) * dim, dst + j * dim);
+    }
+  }
+  static inline DType Dot(const DType *a, const DType *b, index_t n) {
+    DType sum = 0;
+    #pragma omp simd reduction(+:sum)
+    for (index_t j = 0; j < n; ++j) sum += a[j] * b[j];
+    return sum;
+  }
+  static inline void Write(DType *out, OpReqType req, DType v) {
+    if (req == kAddTo) {
+      *out += v;
+    } else if (req != kNullOp) {
+      *out = v;
+    }
+  }
+
+  SampledSoftmaxOutputParam param_;
+  TouchedRows touched_rows_;
+};  // class SampledSoftmaxOutputCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_SAMPLED_SOFTMAX_OUTPUT_CPU_INL_H_
@@ -0,0 +1,168 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file softmax_cpu-inl.h
+ * \brief softmax kernels on cpu that read the input once
+ */
+#ifndef MXNET_OPERATOR_SOFTMAX_CPU_INL_H_
+#define MXNET_OPERATOR_SOFTMAX_CPU_INL_H_
+
+#include <mxnet/base.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace mxnet {
+namespace op {
+namespace softmax {
+
+/*! \brief the number of classes whose maximum is taken before they are exponentiated */
+const index_t kBlock = 512;
+
+/*! \brief the number of blocks of a row of k classes */
+inline index_t NumBlocks(index_t k) {
+  return (k + kBlock - 1) / kBlock;
+}
+
+/*!
+ * \brief exp of x <= 88 with arithmetic and bit operations only, so that the
+ *  loops calling it vectorize. The relative error is below 1e-7, and exp(x)
+ *  is 0 below -87 and for -inf.
+ */
+inline float Exp(float x) {
+  // x below the range is replaced by 0 and its result by 0, with a mask rather
+  // than a branch, which would stop the vectorization
+  const int32_t keep = -static_cast<int32_t>(x >= -87.0f);
+  int32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  bits &= keep;
+  std::memcpy(&x, &bits, sizeof(x));
+  // round x / ln(2) to the nearest integer n by the float rounding
+  const float kRound = 12582912.0f;
+  const float n = (x * 1.44269504088896341f + kRound) - kRound;
+  // x - n ln(2), with ln(2) in two parts
+  const float r = (x - n * 0.693359375f) + n * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  // times 2^n, built in the exponent bits
+  bits = (static_cast<int32_t>(n) + 127) << 23;
+  float y;
+  std::memcpy(&y, &bits, sizeof(y));
+  y *= p;
+  std::memcpy(&bits, &y, sizeof(bits));
+  bits &= keep;
+  std::memcpy(&y, &bits, sizeof(y));
+  return y;
+}
+
+inline double Exp(double x) {
+  return std::exp(x);
+}
+
+/*! \brief the maximum of n values */
+template<typename DType>
+inline DType Max(const DType *x, index_t n) {
+  DType m = x[0];
+  #pragma omp simd reduction(max:m)
+  for (index_t j = 1; j < n; ++j) m = std::max(m, x[j]);
+  return m;
+}
+
+/*! \brief y = exp(x - m) for n values, returning the sum of y. y may be x. */
+template<typename DType>
+inline DType ExpSum(const DType *x, DType m, DType *y, index_t n) {
+  DType sum = 0;
+  #pragma omp simd reduction(+:sum)
+  for (index_t j = 0; j < n; ++j) {
+    y[j] = Exp(x[j] - m);
+    sum += y[j];
+  }
+  return sum;
+}
+
+/*!
+ * \brief softmax of a row of k values into y, times scale, in one online pass
+ *  over x. The maximum of each block of kBlock values is taken while the block
+ *  is in cache, the running sum is rescaled when the running maximum grows,
+ *  and the block is exponentiated with the running maximum into y. A last
+ *  pass over y rescales each block to the final maximum and sum, so that every
+ *  value is exponentiated once. y may be x.
+ * \param bmax scratch of NumBlocks(k) values
+ * \param[out] max the maximum of x
+ * \return the sum of exp(x - max)
+ */
+template<typename DType>
+inline DType SoftmaxRow(const DType *x, DType *y, index_t k, DType scale,
+                        DType *bmax, DType *max) {
+  DType m = -std::numeric_limits<DType>::infinity(), sum = 0;
+  for (index_t b = 0, begin = 0; begin < k; ++b, begin += kBlock) {
+    const index_t n = std::min(kBlock, k - begin);
+    const DType mb = Max(x + begin, n);
+    if (mb > m) {
+      sum *= Exp(m - mb);
+      m = mb;
+    }
+    sum += ExpSum(x + begin, m, y + begin, n);
+    bmax[b] = m;
+  }
+  for (index_t b = 0, begin = 0; begin < k; ++b, begin += kBlock) {
+    const index_t n = std::min(kBlock, k - begin);
+    const DType r = Exp(bmax[b] - m) * scale / sum;
+    for (index_t j = begin; j < begin + n; ++j) y[j] *= r;
+  }
+  *max = m;
+  return sum;
+}
+
+/*! \brief log(sum(exp(x))) of a row of k values, in one online pass without writing x */
+template<typename DType>
+inline DType LogSumExp(const DType *x, index_t k) {
+  DType m = -std::numeric_limits<DType>::infinity(), sum = 0;
+  DType y[kBlock];
+  for (index_t begin = 0; begin < k; begin += kBlock) {
+    const index_t n = std::min(kBlock, k - begin);
+    const DType mb = Max(x + begin, n);
+    if (mb > m) {
+      sum *= Exp(m - mb);
+      m = mb;
+    }
+    sum += ExpSum(x + begin, m, y, n);
+  }
+  return m + std::log(sum);
+}
+
+/*!
+ * \brief softmax over the k classes of a (k, n) block whose n positions are
+ *  contiguous, as in multi_output, vectorized over the positions. y may be x.
+ * \param buf scratch of 2 * n values
+ */
+template<typename DType>
+inline void SoftmaxColumns(const DType *x, DType *y, index_t k, index_t n, DType *buf) {
+  DType *m = buf, *sum = buf + n;
+  std::copy(x, x + n, m);
+  for (index_t c = 1; c < k; ++c) {
+    for (index_t j = 0; j < n; ++j) m[j] = std::max(m[j], x[c * n + j]);
+  }
+  std::fill(sum, sum + n, DType(0));
+  for (index_t c = 0; c < k; ++c) {
+    for (index_t j = 0; j < n; ++j) {
+      y[c * n + j] = Exp(x[c * n + j] - m[j]);
+      sum[j] += y[c * n + j];
+    }
+  }
+  for (index_t j = 0; j < n; ++j) sum[j] = DType(1) / sum[j];
+  for (index_t c = 0; c < k; ++c) {
+    for (index_t j = 0; j < n; ++j) y[c * n + j] *= sum[j];
+  }
+}
+
+}  // namespace softmax
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_SOFTMAX_CPU_INL_H_
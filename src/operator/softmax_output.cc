@@ -5,15 +5,28 @@
  * \author Bing Xu
 */
 #include "./softmax_output-inl.h"
+#include "./softmax_output_cpu-inl.h"
+#include "./float16_cpu-inl.h"
 
 namespace mxnet {
 namespace op {
 template<>
 Operator *CreateOp<cpu>(SoftmaxOutputParam param, int dtype) {
   Operator *op = NULL;
-  MSHADOW_REAL_TYPE_SWITCH(dtype, DType, {
-    op = new SoftmaxOutputOp<cpu, DType>(param);
-  })
+  if (dtype == mshadow::kFloat16) {
+    // float16 storage, the float32 kernel computes
+    return new float16::Float16CPUOp(CreateOp<cpu>(param, mshadow::kFloat32), false);
+  }
+  switch (dtype) {
+  case mshadow::kFloat32:
+    op = new SoftmaxOutputCPUOp<float>(param);
+    break;
+  case mshadow::kFloat64:
+    op = new SoftmaxOutputCPUOp<double>(param);
+    break;
+  default:
+    LOG(FATAL) << "Unsupported type " << dtype;
+  }
   return op;
 }
 
@@ -0,0 +1,129 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file softmax_output_cpu-inl.h
+ * \brief softmax output on cpu with the fused softmax kernels
+ */
+#ifndef MXNET_OPERATOR_SOFTMAX_OUTPUT_CPU_INL_H_
+#define MXNET_OPERATOR_SOFTMAX_OUTPUT_CPU_INL_H_
+
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <vector>
+#include "./softmax_output-inl.h"
+#include "./softmax_cpu-inl.h"
+
+namespace mxnet {
+namespace op {
+/*!
+ * \brief softmax output on cpu. The forward reads each row once with the
+ *  online softmax, the rows in parallel, and the backward with index labels
+ *  writes the scaled gradient in one pass. Gradients from probability labels
+ *  are computed as SoftmaxOutputOp does.
+ */
+template<typename DType>
+class SoftmaxOutputCPUOp : public SoftmaxOutputOp<cpu, DType> {
+ public:
+  explicit SoftmaxOutputCPUOp(SoftmaxOutputParam p)
+    : SoftmaxOutputOp<cpu, DType>(p), param_(p) {}
+
+  virtual void Forward(const OpContext &ctx,
+                       const std::vector<TBlob> &in_data,
+                       const std::vector<OpReqType> &req,
+                       const std::vector<TBlob> &out_data,
+                       const std::vector<TBlob> &aux_args) {
+    CHECK_EQ(in_data.size(), 2) << "SoftmaxOutput Input: [data, label]";
+    CHECK_EQ(out_data.size(), 1) << "SoftmaxOutput Output: [output]";
+    index_t n, k, m;
+    Layout(out_data[softmaxout_enum::kOut].shape_, &n, &k, &m);
+    const DType *data = in_data[softmaxout_enum::kData].dptr<DType>();
+    DType *out = out_data[softmaxout_enum::kOut].dptr<DType>();
+    #pragma omp parallel
+    {
+      std::vector<DType> buf(m == 1 ? softmax::NumBlocks(k) : 2 * m);
+      #pragma omp for
+      for (int i = 0; i < static_cast<int>(n); ++i) {
+        if (m == 1) {
+          DType max;
+          softmax::SoftmaxRow(data + i * k, out + i * k, k, DType(1), buf.data(), &max);
+        } else {
+          softmax::SoftmaxColumns(data + i * k * m, out + i * k * m, k, m, buf.data());
+        }
+      }
+    }
+  }
+
+  virtual void Backward(const OpContext &ctx,
+                        const std::vector<TBlob> &out_grad,
+                        const std::vector<TBlob> &in_data,
+                        const std::vector<TBlob> &out_data,
+                        const std::vector<OpReqType> &req,
+                        const std::vector<TBlob> &in_grad,
+                        const std::vector<TBlob> &aux_args) {
+    if (out_data[softmaxout_enum::kOut].shape_ == in_data[softmaxout_enum::kLabel].shape_) {
+      // use probability as label
+      SoftmaxOutputOp<cpu, DType>::Backward(ctx, out_grad, in_data, out_data, req,
+                                            in_grad, aux_args);
+      return;
+    }
+    index_t n, k, m;
+    Layout(out_data[softmaxout_enum::kOut].shape_, &n, &k, &m);
+    const DType *label = in_data[softmaxout_enum::kLabel].dptr<DType>();
+    const DType *out = out_data[softmaxout_enum::kOut].dptr<DType>();
+    DType *grad = in_grad[softmaxout_enum::kData].dptr<DType>();
+    const int ignore = static_cast<int>(param_.ignore_label);
+
+    index_t valid_cnt = 1;
+    if (param_.normalization == softmaxout_enum::kBatch) {
+      valid_cnt = n;
+    } else if (param_.normalization == softmaxout_enum::kValid) {
+      valid_cnt = n * m;
+      for (index_t i = 0; i < n * m; ++i) {
+        if (static_cast<int>(label[i]) == ignore) --valid_cnt;
+      }
+      valid_cnt = valid_cnt == 0 ? 1 : valid_cnt;
+    }
+    float scale = param_.grad_scale / valid_cnt;
+    if (param_.multi_output && param_.normalization != softmaxout_enum::kValid) scale /= m;
+    const DType s = DType(scale);
+
+    // out may be grad
+    #pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      const DType *o = out + i * k * m;
+      DType *g = grad + i * k * m;
+      for (index_t c = 0; c < k * m; ++c) g[c] = o[c] * s;
+      for (index_t j = 0; j < m; ++j) {
+        const int y = static_cast<int>(label[i * m + j]);
+        if (param_.use_ignore && y == ignore) {
+          for (index_t c = 0; c < k; ++c) g[c * m + j] = DType(0);
+        } else if (y >= 0 && y < static_cast<int>(k)) {
+          g[y * m + j] -= s;
+        }
+      }
+    }
+  }
+
+ private:
+  /*! \brief the n instances of k classes at the m positions of the output */
+  inline void Layout(const TShape &shape, index_t *n, index_t *k, index_t *m) const {
+    if (param_.multi_output) {
+      *n = shape[0];
+      *k = shape[1];
+      *m = shape.Size() / *n / *k;
+    } else if (param_.preserve_shape) {
+      *k = shape[shape.ndim() - 1];
+      *n = shape.Size() / *k;
+      *m = 1;
+    } else {
+      *n = shape[0];
+      *k = shape.Size() / *n;
+      *m = 1;
+    }
+  }
+
+  SoftmaxOutputParam param_;
+};  // class SoftmaxOutputCPUOp
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_SOFTMAX_OUTPUT_CPU_INL_H_
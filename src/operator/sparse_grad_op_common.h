@@ -0,0 +1,90 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file sparse_grad_op_common.h
+ * \brief the touched rows of the operators with sparse_grad
+*/
+#ifndef MXNET_OPERATOR_SPARSE_GRAD_OP_COMMON_H_
+#define MXNET_OPERATOR_SPARSE_GRAD_OP_COMMON_H_
+#include <dmlc/logging.h>
+#include <mxnet/operator.h>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mxnet {
+namespace op {
+/*! \brief the description of the sparse_grad parameter, whose rows are those of grads */
+inline std::string SparseGradDescription(const std::string &grads) {
+  return "Only write the rows of the " + grads + " of the batch on cpu, and list them "
+      "in the touched_rows auxiliary state, for large tables. The other rows must be "
+      "left zero between backwards, unless the count in touched_rows is set to -1, as "
+      "the trainers do when a kvstore writes the summed gradient back.";
+}
+
+/*!
+ * \brief the rows of the gradients written by the backward of an operator with
+ *  sparse_grad, listed in its touched_rows auxiliary state as the count
+ *  followed by the sorted rows, for an optimizer to update these rows only.
+ *
+ *  A kWriteTo backward only zeroes the rows written by the previous backward
+ *  instead of the whole gradients. A count of -1 marks the rows unknown, e.g.
+ *  after a kvstore wrote a summed gradient back, and the next kWriteTo
+ *  backward zeroes the whole gradients.
+ */
+class TouchedRows {
+ public:
+  TouchedRows() : cleared_(false) {}
+  /*!
+   * \brief zero the gradients of num_rows rows about to be written, given as
+   *  (gradient, values per row). Only the rows in touched are zeroed, unless
+   *  the gradients were never zeroed, the rows are unknown, or touched is NULL
+   *  without sparse_grad.
+   */
+  template<typename DType>
+  void Clear(const std::vector<std::pair<DType*, index_t> > &grads, int num_rows,
+             const int *touched) {
+    if (grads.empty()) return;
+    const bool all = touched == NULL || !cleared_ || touched[0] < 0;
+    for (const auto &g : grads) {
+      DType *grad = g.first;
+      const index_t dim = g.second;
+      if (all) {
+        #pragma omp parallel for
+        for (int r = 0; r < num_rows; ++r) {
+          std::fill(grad + r * dim, grad + (r + 1) * dim, DType(0));
+        }
+      } else {
+        #pragma omp parallel for
+        for (int i = 0; i < touched[0]; ++i) {
+          std::fill(grad + touched[1 + i] * dim, grad + (touched[1 + i] + 1) * dim, DType(0));
+        }
+      }
+    }
+    cleared_ = true;
+  }
+  /*!
+   * \brief list the sorted rows written by a backward in touched, after the
+   *  rows of the earlier gradient if it was added to
+   */
+  static void Set(int *touched, std::vector<int> rows, bool add_to) {
+    if (add_to && touched[0] != 0) {
+      // the rows of the earlier gradient are still there, or unknown
+      if (touched[0] < 0) return;
+      std::vector<int> merged;
+      std::set_union(touched + 1, touched + 1 + touched[0], rows.begin(), rows.end(),
+                     std::back_inserter(merged));
+      rows.swap(merged);
+    }
+    touched[0] = static_cast<int>(rows.size());
+    std::copy(rows.begin(), rows.end(), touched + 1);
+  }
+
+ private:
+  /*! \brief whether the whole gradients were zeroed once */
+  bool cleared_;
+};
+}  // namespace op
+}  // namespace mxnet
+#endif  // MXNET_OPERATOR_SPARSE_GRAD_OP_COMMON_H_
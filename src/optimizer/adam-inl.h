@@ -0,0 +1,133 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file adam-inl.h
+ * \brief adam optimizer
+ */
+#ifndef MXNET_OPTIMIZER_ADAM_INL_H_
+#define MXNET_OPTIMIZER_ADAM_INL_H_
+
+#include <mxnet/optimizer.h>
+#include <dmlc/parameter.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include "./optimizer_common.h"
+
+namespace mxnet {
+namespace opt {
+
+struct AdamParam : public dmlc::Parameter<AdamParam> {
+  float beta1;
+  float beta2;
+  float epsilon;
+  float rescale_grad;
+  float clip_gradient;
+  DMLC_DECLARE_PARAMETER(AdamParam) {
+    DMLC_DECLARE_FIELD(beta1)
+    .set_range(0.0f, 1.0f)
+    .set_default(0.9f)
+    .describe("decay rate of the moving average of the gradient.");
+    DMLC_DECLARE_FIELD(beta2)
+    .set_range(0.0f, 1.0f)
+    .set_default(0.999f)
+    .describe("decay rate of the moving average of the squared gradient.");
+    DMLC_DECLARE_FIELD(epsilon)
+    .set_default(1e-8f)
+    .describe("small value added to the root of the variance.");
+    DMLC_DECLARE_FIELD(rescale_grad)
+    .set_default(1.0f)
+    .describe("rescale gradient as grad = rescale_grad*grad.");
+    DMLC_DECLARE_FIELD(clip_gradient)
+    .set_default(-1.0f)
+    .describe("If greater than 0, clip the rescaled gradient to "
+              "grad = max(min(grad, clip_gradient), -clip_gradient). "
+              "Otherwise turned off.");
+  }
+};
+
+/*!
+ * \brief adam on a group of weights on cpu in one parallel pass
+ * \param lrs the learning rate of each weight, with the bias correction of its step
+ */
+void call_adam_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                                const std::vector<TBlob> &grads,
+                                const std::vector<TBlob> &means,
+                                const std::vector<TBlob> &vars,
+                                const std::vector<float> &lrs,
+                                const std::vector<float> &wds, const AdamParam& param);
+
+#if DMLC_USE_CXX11
+
+/*!
+ * \brief adam optimizer on cpu, as the python Adam optimizer. The weights of
+ *  a group update are updated by a single engine function.
+ */
+class AdamOpt : public Optimizer {
+ public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  void CreateState(const int index, const NDArray *weight) override {
+    if (mean_.find(index) == mean_.end()) {
+      mean_[index] = NDArray(weight->shape(), weight->ctx());
+      mean_[index] = 0.0f;
+      var_[index] = NDArray(weight->shape(), weight->ctx());
+      var_[index] = 0.0f;
+    }
+  }
+
+  void Update(const int index, NDArray *weight,
+              const NDArray *grad, const float lr, const float wd) override {
+    UpdateGroup({index}, {weight}, {grad}, {lr}, {wd});
+  }
+
+  void UpdateGroup(const std::vector<int> &indices,
+                   const std::vector<NDArray*> &weights,
+                   const std::vector<const NDArray*> &grads,
+                   const std::vector<float> &lrs,
+                   const std::vector<float> &wds) override {
+    std::vector<NDArray> w, g, m, v;
+    std::vector<float> lr(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      CHECK_EQ(weights[i]->ctx().dev_mask(), cpu::kDevMask)
+        << "ccadam only supports cpu, use adam on gpu";
+      CreateState(indices[i], weights[i]);
+      w.push_back(*weights[i]);
+      g.push_back(*grads[i]);
+      m.push_back(mean_[indices[i]]);
+      v.push_back(var_[indices[i]]);
+      const int t = ++count_[indices[i]];
+      lr[i] = lrs[i] * std::sqrt(1.0 - std::pow(param_.beta2, t)) /
+              (1.0 - std::pow(param_.beta1, t));
+    }
+    if (w.size() == 0) return;
+    std::vector<Engine::VarHandle> const_vars, mutate_vars;
+    AppendVars(g, &const_vars);
+    AppendVars(w, &mutate_vars);
+    AppendVars(m, &mutate_vars);
+    AppendVars(v, &mutate_vars);
+    std::vector<float> wd = wds;
+    Engine::Get()->PushSync([this, w, g, m, v, lr, wd](RunContext ctx) {
+      call_adam_group_update_cpu(ctx, GroupData(w), GroupData(g), GroupData(m), GroupData(v),
+                                 lr, wd, param_);
+    }, w[0].ctx(), const_vars, mutate_vars, FnProperty::kNormal);
+  }
+
+ private:
+  AdamParam param_;
+  /*! \brief the moving average of the gradient of each weight */
+  std::map<int, NDArray> mean_;
+  /*! \brief the moving average of the squared gradient of each weight */
+  std::map<int, NDArray> var_;
+  /*! \brief the number of updates of each weight, for the bias correction */
+  std::map<int, int> count_;
+};
+
+#endif  // DMLC_USE_CXX11
+
+}  // namespace opt
+}  // namespace mxnet
+#endif  // MXNET_OPTIMIZER_ADAM_INL_H_
@@ -0,0 +1,49 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file adam.cc
+ * \brief adam optimizer
+*/
+#include <mxnet/ndarray.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "./adam-inl.h"
+
+namespace mxnet {
+namespace opt {
+
+void call_adam_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                                const std::vector<TBlob> &grads,
+                                const std::vector<TBlob> &means,
+                                const std::vector<TBlob> &vars,
+                                const std::vector<float> &lrs,
+                                const std::vector<float> &wds, const AdamParam& param) {
+  const real_t bound = param.clip_gradient > 0.0f ? param.clip_gradient
+                                                  : std::numeric_limits<real_t>::max();
+  const real_t beta1 = param.beta1, beta2 = param.beta2;
+  const real_t rescale = param.rescale_grad, eps = param.epsilon;
+  ForEachGroupChunk(GroupSizes(weights), [&](int t, index_t begin, index_t end) {
+    real_t *w = weights[t].dptr<real_t>() + begin;
+    const real_t *g = grads[t].dptr<real_t>() + begin;
+    real_t *m = means[t].dptr<real_t>() + begin;
+    real_t *v = vars[t].dptr<real_t>() + begin;
+    const real_t lr = lrs[t], decay = 1.0f - lrs[t] * wds[t];
+    const index_t n = end - begin;
+    for (index_t j = 0; j < n; ++j) {
+      const real_t gj = std::max(std::min(rescale * g[j], bound), -bound);
+      m[j] = beta1 * m[j] + (1.0f - beta1) * gj;
+      v[j] = beta2 * v[j] + (1.0f - beta2) * gj * gj;
+      // the weight decay is applied after the step
+      w[j] = decay * (w[j] - lr * m[j] / (std::sqrt(v[j]) + eps));
+    }
+  });
+}
+
+DMLC_REGISTER_PARAMETER(AdamParam);
+
+MXNET_REGISTER_OPTIMIZER(ccadam, AdamOpt)
+.describe("Adam optimizer implemented in C++, on cpu.");
+
+}  // namespace opt
+}  // namespace mxnet
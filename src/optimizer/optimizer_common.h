@@ -0,0 +1,74 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file optimizer_common.h
+ * \brief common helpers of the optimizers updating a group of weights at once
+ */
+#ifndef MXNET_OPTIMIZER_OPTIMIZER_COMMON_H_
+#define MXNET_OPTIMIZER_OPTIMIZER_COMMON_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <mxnet/base.h>
+#include <mxnet/engine.h>
+#include <algorithm>
+#include <vector>
+
+#if DMLC_USE_CXX11
+#include <mxnet/ndarray.h>
+#endif
+
+namespace mxnet {
+namespace opt {
+
+/*! \brief the number of elements a thread updates at a time in a group update */
+const index_t kGroupChunk = 1 << 14;
+
+/*!
+ * \brief run f(t, begin, end) over the elements of all the tensors of a group
+ *  in one parallel loop, each tensor cut in chunks of kGroupChunk elements so
+ *  that small and large tensors are balanced among the threads.
+ * \param sizes the number of elements of each tensor
+ */
+template<typename F>
+inline void ForEachGroupChunk(const std::vector<index_t> &sizes, F f) {
+  std::vector<int> tensor;
+  std::vector<index_t> begin;
+  for (size_t t = 0; t < sizes.size(); ++t) {
+    for (index_t i = 0; i < sizes[t]; i += kGroupChunk) {
+      tensor.push_back(static_cast<int>(t));
+      begin.push_back(i);
+    }
+  }
+  const int nchunk = static_cast<int>(tensor.size());
+  #pragma omp parallel for
+  for (int c = 0; c < nchunk; ++c) {
+    const int t = tensor[c];
+    f(t, begin[c], std::min(begin[c] + kGroupChunk, sizes[t]));
+  }
+}
+
+/*! \brief the number of elements of each blob */
+inline std::vector<index_t> GroupSizes(const std::vector<TBlob> &blobs) {
+  std::vector<index_t> sizes(blobs.size());
+  for (size_t i = 0; i < blobs.size(); ++i) sizes[i] = blobs[i].Size();
+  return sizes;
+}
+
+#if DMLC_USE_CXX11
+/*! \brief the data of each array, to be called in the engine function */
+inline std::vector<TBlob> GroupData(const std::vector<NDArray> &arrays) {
+  std::vector<TBlob> blobs(arrays.size());
+  for (size_t i = 0; i < arrays.size(); ++i) blobs[i] = arrays[i].data();
+  return blobs;
+}
+
+/*! \brief append the variables of the arrays to vars */
+inline void AppendVars(const std::vector<NDArray> &arrays,
+                       std::vector<Engine::VarHandle> *vars) {
+  for (const NDArray &arr : arrays) vars->push_back(arr.var());
+}
+#endif  // DMLC_USE_CXX11
+
+}  // namespace opt
+}  // namespace mxnet
+#endif  // MXNET_OPTIMIZER_OPTIMIZER_COMMON_H_
@@ -0,0 +1,130 @@
+/*!
+ *  Copyright (c) 2016 by Contributors
+ * \file rmsprop-inl.h
+ * \brief rmsprop optimizer
+ */
+#ifndef MXNET_OPTIMIZER_RMSPROP_INL_H_
+#define MXNET_OPTIMIZER_RMSPROP_INL_H_
+
+#include <mxnet/optimizer.h>
+#include <dmlc/parameter.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include "./optimizer_common.h"
+
+namespace mxnet {
+namespace opt {
+
+struct RMSPropParam : public dmlc::Parameter<RMSPropParam> {
+  float gamma1;
+  float gamma2;
+  float epsilon;
+  float rescale_grad;
+  float clip_gradient;
+  DMLC_DECLARE_PARAMETER(RMSPropParam) {
+    DMLC_DECLARE_FIELD(gamma1)
+    .set_range(0.0f, 1.0f)
+    .set_default(0.95f)
+    .describe("decay rate of the moving averages of the gradient and the squared gradient.");
+    DMLC_DECLARE_FIELD(gamma2)
+    .set_range(0.0f, 1.0f)
+    .set_default(0.9f)
+    .describe("momentum");
+    DMLC_DECLARE_FIELD(epsilon)
+    .set_default(1e-4f)
+    .describe("small value added to the variance.");
+    DMLC_DECLARE_FIELD(rescale_grad)
+    .set_default(1.0f)
+    .describe("rescale gradient as grad = rescale_grad*grad.");
+    DMLC_DECLARE_FIELD(clip_gradient)
+    .set_default(-1.0f)
+    .describe("If greater than 0, clip the rescaled gradient to "
+              "grad = max(min(grad, clip_gradient), -clip_gradient). "
+              "Otherwise turned off.");
+  }
+};
+
+/*! \brief rmsprop on a group of weights on cpu in one parallel pass */
+void call_rmsprop_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                                   const std::vector<TBlob> &grads,
+                                   const std::vector<TBlob> &ns,
+                                   const std::vector<TBlob> &gs,
+                                   const std::vector<TBlob> &deltas,
+                                   const std::vector<float> &lrs,
+                                   const std::vector<float> &wds, const RMSPropParam& param);
+
+#if DMLC_USE_CXX11
+
+/*!
+ * \brief rmsprop optimizer on cpu, as the python RMSProp optimizer. The
+ *  weights of a group update are updated by a single engine function.
+ */
+class RMSPropOpt : public Optimizer {
+ public:
+  void Init(const std::vector<std::pair<std::string, std::string> >& kwargs) override {
+    param_.Init(kwargs);
+  }
+
+  void CreateState(const int index, const NDArray *weight) override {
+    if (n_.find(index) == n_.end()) {
+      n_[index] = NDArray(weight->shape(), weight->ctx());
+      n_[index] = 0.0f;
+      g_[index] = NDArray(weight->shape(), weight->ctx());
+      g_[index] = 0.0f;
+      delta_[index] = NDArray(weight->shape(), weight->ctx());
+      delta_[index] = 0.0f;
+    }
+  }
+
+  void Update(const int index, NDArray *weight,
+              const NDArray *grad, const float lr, const float wd) override {
+    UpdateGroup({index}, {weight}, {grad}, {lr}, {wd});
+  }
+
+  void UpdateGroup(const std::vector<int> &indices,
+                   const std::vector<NDArray*> &weights,
+                   const std::vector<const NDArray*> &grads,
+                   const std::vector<float> &lrs,
+                   const std::vector<float> &wds) override {
+    std::vector<NDArray> w, g, n, gm, delta;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      CHECK_EQ(weights[i]->ctx().dev_mask(), cpu::kDevMask)
+        << "ccrmsprop only supports cpu, use rmsprop on gpu";
+      CreateState(indices[i], weights[i]);
+      w.push_back(*weights[i]);
+      g.push_back(*grads[i]);
+      n.push_back(n_[indices[i]]);
+      gm.push_back(g_[indices[i]]);
+      delta.push_back(delta_[indices[i]]);
+    }
+    if (w.size() == 0) return;
+    std::vector<Engine::VarHandle> const_vars, mutate_vars;
+    AppendVars(g, &const_vars);
+    AppendVars(w, &mutate_vars);
+    AppendVars(n, &mutate_vars);
+    AppendVars(gm, &mutate_vars);
+    AppendVars(delta, &mutate_vars);
+    std::vector<float> lr = lrs, wd = wds;
+    Engine::Get()->PushSync([this, w, g, n, gm, delta, lr, wd](RunContext ctx) {
+      call_rmsprop_group_update_cpu(ctx, GroupData(w), GroupData(g), GroupData(n),
+                                    GroupData(gm), GroupData(delta), lr, wd, param_);
+    }, w[0].ctx(), const_vars, mutate_vars, FnProperty::kNormal);
+  }
+
+ private:
+  RMSPropParam param_;
+  /*! \brief the moving average of the squared gradient of each weight */
+  std::map<int, NDArray> n_;
+  /*! \brief the moving average of the gradient of each weight */
+  std::map<int, NDArray> g_;
+  /*! \brief the last step of each weight */
+  std::map<int, NDArray> delta_;
+};
+
+#endif  // DMLC_USE_CXX11
+
+}  // namespace opt
+}  // namespace mxnet
+#endif  // MXNET_OPTIMIZER_RMSPROP_INL_H_
@@ -0,0 +1,52 @@
+/*!
+ * Copyright (c) 2016 by Contributors
+ * \file rmsprop.cc
+ * \brief rmsprop optimizer
+*/
+#include <mxnet/ndarray.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "./rmsprop-inl.h"
+
+namespace mxnet {
+namespace opt {
+
+void call_rmsprop_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                                   const std::vector<TBlob> &grads,
+                                   const std::vector<TBlob> &ns,
+                                   const std::vector<TBlob> &gs,
+                                   const std::vector<TBlob> &deltas,
+                                   const std::vector<float> &lrs,
+                                   const std::vector<float> &wds, const RMSPropParam& param) {
+  const real_t bound = param.clip_gradient > 0.0f ? param.clip_gradient
+                                                  : std::numeric_limits<real_t>::max();
+  const real_t gamma1 = param.gamma1, gamma2 = param.gamma2;
+  const real_t rescale = param.rescale_grad, eps = param.epsilon;
+  ForEachGroupChunk(GroupSizes(weights), [&](int t, index_t begin, index_t end) {
+    real_t *w = weights[t].dptr<real_t>() + begin;
+    const real_t *g = grads[t].dptr<real_t>() + begin;
+    real_t *nm = ns[t].dptr<real_t>() + begin;
+    real_t *gm = gs[t].dptr<real_t>() + begin;
+    real_t *delta = deltas[t].dptr<real_t>() + begin;
+    const real_t lr = lrs[t], wd = wds[t];
+    const index_t n = end - begin;
+    for (index_t j = 0; j < n; ++j) {
+      const real_t gj = std::max(std::min(rescale * g[j], bound), -bound);
+      nm[j] = (1.0f - gamma1) * gj * gj + gamma1 * nm[j];
+      gm[j] = (1.0f - gamma1) * gj + gamma1 * gm[j];
+      delta[j] = gamma2 * delta[j] -
+                 lr * (gj / std::sqrt(nm[j] - gm[j] * gm[j] + eps) + wd * w[j]);
+      w[j] += delta[j];
+    }
+  });
+}
+
+DMLC_REGISTER_PARAMETER(RMSPropParam);
+
+MXNET_REGISTER_OPTIMIZER(ccrmsprop, RMSPropOpt)
+.describe("RMSProp optimizer implemented in C++, on cpu.");
+
+}  // namespace opt
+}  // namespace mxnet
@@ -14,6 +14,7 @@
 #include <vector>
 #include <map>
 #include <utility>
+#include "./optimizer_common.h"
 
 namespace mxnet {
 namespace opt {
@@ -90,6 +91,29 @@ void call_sgd_mom_update_cpu(RunContext ctx, TBlob weight, const TBlob grad, TBl
                 float lr, float wd, const SGDParam& param);
 void call_sgd_update_cpu(RunContext ctx, TBlob weight, const TBlob grad,
                 float lr, float wd, const SGDParam& param);
+/*!
+ * \brief sgd on some rows of a weight on cpu, the rows in parallel. The steps
+ *  missed by a row since its last update had a zero gradient, their weight
+ *  decay and momentum are applied first in closed form, which is exact if lr
+ *  and wd did not change meanwhile.
+ * \param mom the momentum, unused without momentum
+ * \param rows the number of rows followed by the rows, NULL for all rows
+ * \param compact whether grad has only the rows, row i for rows[1 + i]
+ * \param last the step each row was last updated at, updated
+ * \param step the step of this update, from 1
+ */
+void call_sgd_lazy_update_cpu(RunContext ctx, TBlob weight, const TBlob grad, TBlob mom,
+                              const int *rows, bool compact, int *last, int step,
+                              float lr, float wd, const SGDParam& param);
+/*!
+ * \brief sgd on a group of weights on cpu in one parallel pass
+ * \param moms the momentum of each weight, empty without momentum
+ */
+void call_sgd_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                               const std::vector<TBlob> &grads,
+                               const std::vector<TBlob> &moms,
+                               const std::vector<float> &lrs,
+                               const std::vector<float> &wds, const SGDParam& param);
 #if MXNET_USE_CUDA
 void call_sgd_mom_update_gpu(RunContext ctx, TBlob weight, const TBlob grad, TBlob mom,
                 float lr, float wd, const SGDParam& param);
@@ -114,6 +138,11 @@ class SGDOpt : public Optimizer {
 
   void Update(const int index, NDArray *weight,
               const NDArray *grad, const float lr, const float wd) override {
+    if (last_.count(index) != 0) {
+      // the rows behind catch up
+      LazyUpdate(index, weight, grad, NULL, false, lr, wd);
+      return;
+    }
     NDArray w = *weight, g = *grad;
     CreateState(index, weight);
     switch (w.ctx().dev_type) {
@@ -149,9 +178,85 @@ class SGDOpt : public Optimizer {
     }
   }
 
+  void UpdateRows(const int index, NDArray *weight, const NDArray *grad,
+                  const NDArray *rows, bool compact,
+                  const float lr, const float wd) override {
+    CHECK_EQ(rows->dtype(), mshadow::kInt32) << "sgd: rows must be int32";
+    CHECK_EQ(rows->ctx().dev_mask(), cpu::kDevMask) << "sgd: rows must be on cpu";
+    if (compact) {
+      CHECK_EQ(grad->shape().Size() / grad->shape()[0],
+               weight->shape().Size() / weight->shape()[0])
+          << "sgd: the rows of grad and weight mismatch";
+      CHECK_GE(grad->shape()[0] + 1, rows->shape().Size())
+          << "sgd: grad has fewer rows than rows";
+    } else {
+      CHECK_EQ(grad->shape(), weight->shape()) << "sgd: grad and weight mismatch";
+    }
+    LazyUpdate(index, weight, grad, rows, compact, lr, wd);
+  }
+
+  void UpdateGroup(const std::vector<int> &indices,
+                   const std::vector<NDArray*> &weights,
+                   const std::vector<const NDArray*> &grads,
+                   const std::vector<float> &lrs,
+                   const std::vector<float> &wds) override {
+    // the weights on cpu are updated by one engine function, the others one by one
+    std::vector<NDArray> w, g, m;
+    std::vector<float> lr, wd;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      if (weights[i]->ctx().dev_mask() != cpu::kDevMask || last_.count(indices[i]) != 0) {
+        Update(indices[i], weights[i], grads[i], lrs[i], wds[i]);
+        continue;
+      }
+      CreateState(indices[i], weights[i]);
+      w.push_back(*weights[i]);
+      g.push_back(*grads[i]);
+      if (param_.momentum > 0.0f) m.push_back(mom[indices[i]]);
+      lr.push_back(lrs[i]);
+      wd.push_back(wds[i]);
+    }
+    if (w.size() == 0) return;
+    std::vector<Engine::VarHandle> const_vars, mutate_vars;
+    AppendVars(g, &const_vars);
+    AppendVars(w, &mutate_vars);
+    AppendVars(m, &mutate_vars);
+    Engine::Get()->PushSync([this, w, g, m, lr, wd](RunContext ctx) {
+      call_sgd_group_update_cpu(ctx, GroupData(w), GroupData(g), GroupData(m), lr, wd, param_);
+    }, w[0].ctx(), const_vars, mutate_vars, FnProperty::kNormal);
+  }
+
  private:
+  /*! \brief update the rows, or all rows if rows is NULL, catching up the missed steps */
+  void LazyUpdate(const int index, NDArray *weight, const NDArray *grad,
+                  const NDArray *rows, bool compact, const float lr, const float wd) {
+    NDArray w = *weight, g = *grad, r, m;
+    CHECK_EQ(w.ctx().dev_mask(), cpu::kDevMask) << "sgd: rows can only be updated on cpu";
+    CreateState(index, weight);
+    if (last_.count(index) == 0) last_[index].assign(w.shape()[0], 0);
+    int *last = last_[index].data();
+    const int step = ++step_[index];
+    std::vector<Engine::VarHandle> const_vars = {g.var()}, mutate_vars = {w.var()};
+    if (rows != NULL) {
+      r = *rows;
+      const_vars.push_back(r.var());
+    }
+    if (param_.momentum > 0.0f) {
+      m = mom[index];
+      mutate_vars.push_back(m.var());
+    }
+    Engine::Get()->PushSync([this, w, g, r, compact, m, last, step, lr, wd](RunContext ctx) {
+      call_sgd_lazy_update_cpu(ctx, w.data(), g.data(), m.is_none() ? TBlob() : m.data(),
+                               r.is_none() ? NULL : r.data().dptr<int>(), compact,
+                               last, step, lr, wd, param_);
+    }, w.ctx(), const_vars, mutate_vars, FnProperty::kNormal);
+  }
+
   SGDParam param_;
   std::map<int, NDArray> mom;
+  /*! \brief the step each row was last updated at, for the weights updated by rows */
+  std::map<int, std::vector<int> > last_;
+  /*! \brief the number of updates since the first update by rows */
+  std::map<int, int> step_;
 };
 
 #endif  // DMLC_USE_CXX11
@@ -4,6 +4,10 @@
  * \brief sgd optimizer
 */
 #include <mxnet/ndarray.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 #include "./sgd-inl.h"
 
 
@@ -19,6 +23,108 @@ void call_sgd_update_cpu(RunContext ctx, TBlob weight, const TBlob grad,
   sgd_update<cpu>(ctx, weight, grad, lr, wd, param);
 }
 
+/*!
+ * \brief k steps of momentum sgd with a zero gradient on a row, as
+ *  (w, m) = A^k (w, m) with A = [[1 - lr * wd, momentum], [-lr * wd, momentum]],
+ *  or w = (1 - lr * wd)^k w without momentum
+ */
+inline void sgd_catch_up(real_t *w, real_t *m, index_t n, int k,
+                         float lr, float wd, const SGDParam& param) {
+  const double decay = 1.0 - static_cast<double>(lr) * wd;
+  if (m == NULL) {
+    const real_t scale = static_cast<real_t>(std::pow(decay, k));
+    for (index_t j = 0; j < n; ++j) w[j] *= scale;
+    return;
+  }
+  double a[2][2] = {{decay, param.momentum}, {decay - 1.0, param.momentum}};
+  double p[2][2] = {{1.0, 0.0}, {0.0, 1.0}};
+  for (; k > 0; k >>= 1) {
+    double t[2][2];
+    if (k & 1) {
+      for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) t[i][j] = p[i][0] * a[0][j] + p[i][1] * a[1][j];
+      }
+      std::copy(&t[0][0], &t[0][0] + 4, &p[0][0]);
+    }
+    for (int i = 0; i < 2; ++i) {
+      for (int j = 0; j < 2; ++j) t[i][j] = a[i][0] * a[0][j] + a[i][1] * a[1][j];
+    }
+    std::copy(&t[0][0], &t[0][0] + 4, &a[0][0]);
+  }
+  const real_t ww = p[0][0], wm = p[0][1], mw = p[1][0], mm = p[1][1];
+  for (index_t j = 0; j < n; ++j) {
+    const real_t wj = w[j], mj = m[j];
+    w[j] = ww * wj + wm * mj;
+    m[j] = mw * wj + mm * mj;
+  }
+}
+
+void call_sgd_lazy_update_cpu(RunContext ctx, TBlob weight, const TBlob grad, TBlob mom,
+                              const int *rows, bool compact, int *last, int step,
+                              float lr, float wd, const SGDParam& param) {
+  const index_t nrow = weight.shape_[0];
+  const index_t ncol = weight.shape_.Size() / nrow;
+  real_t *w = weight.dptr<real_t>();
+  const real_t *g = grad.dptr<real_t>();
+  real_t *m = param.momentum > 0.0f ? mom.dptr<real_t>() : NULL;
+  const bool all = rows == NULL || rows[0] < 0;
+  const int count = all ? static_cast<int>(nrow) : rows[0];
+  CHECK(!compact || !all) << "sgd: a compact gradient needs the rows";
+  #pragma omp parallel for
+  for (int i = 0; i < count; ++i) {
+    const index_t row = all ? i : rows[1 + i];
+    real_t *wr = w + row * ncol;
+    real_t *mr = m == NULL ? NULL : m + row * ncol;
+    const real_t *gr = g + (compact ? i : row) * ncol;
+    if (step - last[row] > 1) {
+      sgd_catch_up(wr, mr, ncol, step - last[row] - 1, lr, wd, param);
+    }
+    last[row] = step;
+    for (index_t j = 0; j < ncol; ++j) {
+      real_t gj = gr[j];
+      if (param.clip_gradient > 0.0f) {
+        gj = std::max(std::min(gj, param.clip_gradient), -param.clip_gradient);
+      }
+      gj *= param.rescale_grad;
+      if (mr != NULL) {
+        mr[j] = param.momentum * mr[j] - lr * (gj + wd * wr[j]);
+        wr[j] += mr[j];
+      } else {
+        wr[j] -= lr * (gj + wd * wr[j]);
+      }
+    }
+  }
+}
+
+void call_sgd_group_update_cpu(RunContext ctx, const std::vector<TBlob> &weights,
+                               const std::vector<TBlob> &grads,
+                               const std::vector<TBlob> &moms,
+                               const std::vector<float> &lrs,
+                               const std::vector<float> &wds, const SGDParam& param) {
+  const real_t bound = param.clip_gradient > 0.0f ? param.clip_gradient
+                                                  : std::numeric_limits<real_t>::max();
+  const real_t momentum = param.momentum, rescale = param.rescale_grad;
+  ForEachGroupChunk(GroupSizes(weights), [&](int t, index_t begin, index_t end) {
+    real_t *w = weights[t].dptr<real_t>() + begin;
+    const real_t *g = grads[t].dptr<real_t>() + begin;
+    const real_t lr = lrs[t], wd = wds[t];
+    const index_t n = end - begin;
+    if (moms.size() != 0) {
+      real_t *m = moms[t].dptr<real_t>() + begin;
+      for (index_t j = 0; j < n; ++j) {
+        const real_t gj = rescale * std::max(std::min(g[j], bound), -bound);
+        m[j] = momentum * m[j] - lr * (gj + wd * w[j]);
+        w[j] += m[j];
+      }
+    } else {
+      for (index_t j = 0; j < n; ++j) {
+        const real_t gj = rescale * std::max(std::min(g[j], bound), -bound);
+        w[j] -= lr * (gj + wd * w[j]);
+      }
+    }
+  });
+}
+
 DMLC_REGISTER_PARAMETER(SGDParam);
 
 MXNET_REGISTER_OPTIMIZER(ccsgd, SGDOpt)
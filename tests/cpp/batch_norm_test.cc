@@ -0,0 +1,171 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include <dmlc/logging.h>
+#include <dmlc/timer.h>
+#include <mxnet/resource.h>
+#include "../../src/operator/batch_norm_cpu-inl.h"
+
+using namespace mxnet;
+using namespace mxnet::op;
+
+namespace {
+const int kRepeat = 20;
+
+// the arrays of a batch norm op, with the data in DType
+template<typename DType>
+struct BNArrays {
+  TShape shape;
+  std::vector<DType> data, out, grad, gdata;
+  std::vector<real_t> gamma, beta, mean, var, moving_mean, moving_var, ggamma, gbeta;
+
+  explicit BNArrays(const std::vector<index_t>& dims)
+      : shape(dims.begin(), dims.end()) {
+    const size_t size = shape.Size(), nchannel = shape[1];
+    std::mt19937 rnd(0);
+    std::normal_distribution<float> normal(1.0f, 2.0f);
+    for (size_t i = 0; i < size; ++i) {
+      data.push_back(DType(normal(rnd)));
+      grad.push_back(DType(normal(rnd)));
+    }
+    out.resize(size);
+    gdata.resize(size);
+    for (size_t i = 0; i < nchannel; ++i) {
+      gamma.push_back(normal(rnd));
+      beta.push_back(normal(rnd));
+      moving_mean.push_back(normal(rnd));
+      moving_var.push_back(std::abs(normal(rnd)));
+    }
+    mean.resize(nchannel);
+    var.resize(nchannel);
+    ggamma.resize(nchannel);
+    gbeta.resize(nchannel);
+  }
+};
+
+template<typename DType>
+TBlob Blob(std::vector<DType>* v, const TShape& shape) {
+  return TBlob(v->data(), shape, cpu::kDevMask);
+}
+
+template<typename DType>
+void Run(Operator* op, BNArrays<DType>* a, bool is_train, bool backward) {
+  TShape cshape = mshadow::Shape1(a->shape[1]);
+  std::vector<TBlob> in_data = {Blob(&a->data, a->shape), Blob(&a->gamma, cshape),
+                                Blob(&a->beta, cshape)};
+  std::vector<TBlob> out_data = {Blob(&a->out, a->shape), Blob(&a->mean, cshape),
+                                 Blob(&a->var, cshape)};
+  std::vector<TBlob> aux = {Blob(&a->moving_mean, cshape), Blob(&a->moving_var, cshape)};
+  std::vector<TBlob> out_grad = {Blob(&a->grad, a->shape)};
+  std::vector<TBlob> in_grad = {Blob(&a->gdata, a->shape), Blob(&a->ggamma, cshape),
+                                Blob(&a->gbeta, cshape)};
+  std::vector<OpReqType> req(3, kWriteTo);
+  OpContext ctx;
+  ctx.is_train = is_train;
+  ctx.run_ctx.stream = nullptr;
+  ctx.requested.push_back(ResourceManager::Get()->Request(
+      Context::CPU(), ResourceRequest(ResourceRequest::kTempSpace)));
+  op->Forward(ctx, in_data, req, out_data, aux);
+  if (backward) op->Backward(ctx, out_grad, in_data, out_data, req, in_grad, aux);
+}
+
+BatchNormParam Param(bool fuse_relu, bool use_global_stats) {
+  BatchNormParam param;
+  std::vector<std::pair<std::string, std::string> > kwargs = {
+    {"fix_gamma", "false"},
+    {"fuse_relu", fuse_relu ? "true" : "false"},
+    {"use_global_stats", use_global_stats ? "true" : "false"}};
+  param.Init(kwargs);
+  return param;
+}
+
+template<typename DType>
+void ExpectNear(const std::vector<DType>& a, const std::vector<real_t>& b, float tol) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    float x = static_cast<float>(a[i]);
+    EXPECT_NEAR(x, b[i], tol * (1.0f + std::abs(b[i]))) << "at " << i;
+  }
+}
+
+// run the old kernel, which only takes 4d data, on the same data as a
+template<typename DType>
+BNArrays<real_t> RunLegacy(const BNArrays<DType>& a, bool fuse_relu, bool use_global_stats) {
+  std::vector<index_t> dims4 = {a.shape[0], a.shape[1], 1, 1};
+  for (index_t i = 2; i < a.shape.ndim(); ++i) dims4[2] *= a.shape[i];
+  BNArrays<real_t> ref(dims4);
+  for (size_t i = 0; i < a.data.size(); ++i) {
+    ref.data[i] = static_cast<real_t>(a.data[i]);
+    ref.grad[i] = static_cast<real_t>(a.grad[i]);
+  }
+  BatchNormOp<cpu> op(Param(fuse_relu, use_global_stats));
+  Run(&op, &ref, true, true);
+  return ref;
+}
+
+template<typename DType>
+void Compare(const std::vector<index_t>& dims, float tol) {
+  for (bool fuse_relu : {false, true}) {
+    for (bool use_global_stats : {false, true}) {
+      BNArrays<DType> a(dims);
+      BNArrays<real_t> ref = RunLegacy(a, fuse_relu, use_global_stats);
+      BatchNormCPUOp<DType> op(Param(fuse_relu, use_global_stats));
+      Run(&op, &a, true, true);
+      ExpectNear(a.out, ref.out, tol);
+      ExpectNear(a.gdata, ref.gdata, tol);
+      ExpectNear(a.ggamma, ref.ggamma, tol);
+      ExpectNear(a.gbeta, ref.gbeta, tol);
+      ExpectNear(a.moving_mean, ref.moving_mean, tol);
+      ExpectNear(a.moving_var, ref.moving_var, tol);
+    }
+  }
+}
+
+template<typename F>
+double TimeIt(F f) {
+  f();
+  double start = dmlc::GetTime();
+  for (int i = 0; i < kRepeat; ++i) f();
+  return (dmlc::GetTime() - start) / kRepeat * 1e3;
+}
+}  // namespace
+
+TEST(BatchNormCPU, Float) {
+  Compare<float>({16, 8}, 1e-4f);
+  Compare<float>({4, 8, 5, 7}, 1e-4f);
+  // the old kernel only takes 4d data, it is run on 4 x 3 x 60 x 1
+  Compare<float>({4, 3, 3, 4, 5}, 1e-4f);
+}
+
+TEST(BatchNormCPU, Half) {
+  Compare<mshadow::half::half_t>({4, 8, 5, 7}, 2e-2f);
+}
+
+TEST(BatchNormCPU, Benchmark) {
+  std::vector<std::vector<index_t> > shapes = {
+    {256, 1024}, {32, 64, 56, 56}, {32, 256, 28, 28}, {32, 512, 7, 7}};
+  for (const auto& dims : shapes) {
+    BNArrays<real_t> a(dims);
+    std::string name = std::to_string(dims[0]);
+    for (size_t i = 1; i < dims.size(); ++i) name += "x" + std::to_string(dims[i]);
+    for (bool fuse_relu : {false, true}) {
+      BatchNormOp<cpu> legacy(Param(fuse_relu, false));
+      BatchNormCPUOp<real_t> op(Param(fuse_relu, false));
+      double legacy_fwd = TimeIt([&]() { Run(&legacy, &a, true, false); });
+      double fwd = TimeIt([&]() { Run(&op, &a, true, false); });
+      double legacy_all = TimeIt([&]() { Run(&legacy, &a, true, true); });
+      double all = TimeIt([&]() { Run(&op, &a, true, true); });
+      LOG(INFO) << "BatchNorm " << name << (fuse_relu ? " + relu" : "")
+                << ": forward " << legacy_fwd << " ms old, " << fwd << " ms new"
+                << ", forward + backward " << legacy_all << " ms old, " << all << " ms new";
+    }
+  }
+}
+
+int main(int argc, char ** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
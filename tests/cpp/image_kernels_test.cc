@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <gtest/gtest.h>
+#include <dmlc/logging.h>
+#include <dmlc/timer.h>
+#include "../../src/io/image_kernels.h"
+
+namespace {
+const int kRows = 224, kCols = 224, kRepeat = 200;
+
+std::vector<uint8_t> RandomImage(int rows, int cols, int channels, size_t stride) {
+  std::mt19937 rnd(0);
+  std::vector<uint8_t> img(rows * stride);
+  for (auto& v : img) v = rnd() % 256;
+  return img;
+}
+
+// the per pixel loops the kernels replace
+void NaiveHWCToCHW(const uint8_t* src, int rows, int cols, int channels,
+                   size_t stride, bool mirror, float mul, float add, float* dst) {
+  std::vector<int> swap_indices;
+  if (channels == 1) swap_indices = {0};
+  if (channels == 3) swap_indices = {2, 1, 0};
+  if (channels == 4) swap_indices = {2, 1, 0, 3};
+  for (int i = 0; i < rows; ++i) {
+    const uint8_t* im_data = src + i * stride;
+    for (int j = 0; j < cols; ++j) {
+      int dj = mirror ? cols - 1 - j : j;
+      for (int k = 0; k < channels; ++k) {
+        dst[(k * rows + i) * cols + dj] = im_data[swap_indices[k]] * mul + add;
+      }
+      im_data += channels;
+    }
+  }
+}
+
+void NaiveColorJitter(const uint8_t* src, size_t stride, int rows, int cols,
+                      float b, float c, float s, float mean_gray, uint8_t* dst) {
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      const uint8_t* p = src + i * stride + j * 3;
+      float v[3];
+      for (int k = 0; k < 3; ++k) v[k] = p[k] * b;
+      for (int k = 0; k < 3; ++k) v[k] = v[k] * c + (1 - c) * b * mean_gray;
+      float gray = 0.114f * v[0] + 0.587f * v[1] + 0.299f * v[2];
+      for (int k = 0; k < 3; ++k) {
+        v[k] = v[k] * s + (1 - s) * gray;
+        dst[i * cols * 3 + j * 3 + k] =
+            static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, v[k])) + 0.5f);
+      }
+    }
+  }
+}
+
+template<typename F>
+double TimeIt(F f) {
+  f();
+  double start = dmlc::GetTime();
+  for (int i = 0; i < kRepeat; ++i) f();
+  return (dmlc::GetTime() - start) / kRepeat * 1e6;
+}
+}  // namespace
+
+TEST(ImageKernels, HWCToCHW) {
+  for (int channels : {1, 3, 4}) {
+    // a crop of a wider image
+    const size_t stride = (kCols + 7) * channels;
+    std::vector<uint8_t> img = RandomImage(kRows, kCols, channels, stride);
+    std::vector<float> out(channels * kRows * kCols), ref(out.size());
+    for (bool mirror : {false, true}) {
+      mxnet::io::HWCToCHW(img.data(), kRows, kCols, channels, stride, mirror, out.data());
+      NaiveHWCToCHW(img.data(), kRows, kCols, channels, stride, mirror, 1.0f, 0.0f,
+                    ref.data());
+      EXPECT_EQ(out, ref);
+      std::vector<float> mul(channels, 0.5f), add(channels, -3.0f);
+      mxnet::io::HWCToCHWAffine(img.data(), kRows, kCols, channels, stride, mirror,
+                                mul.data(), add.data(), out.data());
+      NaiveHWCToCHW(img.data(), kRows, kCols, channels, stride, mirror, 0.5f, -3.0f,
+                    ref.data());
+      EXPECT_EQ(out, ref);
+    }
+    std::vector<uint8_t> out8(out.size());
+    mxnet::io::HWCToCHW(img.data(), kRows, kCols, channels, stride, false, out8.data());
+    NaiveHWCToCHW(img.data(), kRows, kCols, channels, stride, false, 1.0f, 0.0f,
+                  ref.data());
+    for (size_t i = 0; i < out8.size(); ++i) EXPECT_EQ(out8[i], ref[i]);
+  }
+}
+
+TEST(ImageKernels, ColorJitter) {
+  const size_t stride = kCols * 3;
+  std::vector<uint8_t> img = RandomImage(kRows, kCols, 3, stride);
+  std::vector<uint8_t> out(img.size()), ref(img.size());
+  mxnet::io::ColorJitter(img.data(), stride, kRows, kCols, 3, 1.2f, 0.7f, 1.4f, 110.0f,
+                         out.data(), stride);
+  NaiveColorJitter(img.data(), stride, kRows, kCols, 1.2f, 0.7f, 1.4f, 110.0f, ref.data());
+  for (size_t i = 0; i < out.size(); ++i) {
+    // the fused kernel rounds differently, but only by one
+    EXPECT_LE(std::abs(out[i] - ref[i]), 1);
+  }
+  // no change
+  mxnet::io::ColorJitter(img.data(), stride, kRows, kCols, 3, 1.0f, 1.0f, 1.0f, 0.0f,
+                         out.data(), stride);
+  EXPECT_EQ(out, img);
+}
+
+TEST(ImageKernels, Benchmark) {
+  const int channels = 3;
+  const size_t stride = kCols * channels;
+  std::vector<uint8_t> img = RandomImage(kRows, kCols, channels, stride);
+  std::vector<float> out(channels * kRows * kCols);
+  std::vector<uint8_t> out8(img.size());
+  float mul[3] = {0.5f, 0.5f, 0.5f}, add[3] = {-3.0f, -3.0f, -3.0f};
+  double naive = TimeIt([&]() {
+      NaiveHWCToCHW(img.data(), kRows, kCols, channels, stride, false, 1.0f, 0.0f,
+                    out.data());
+    });
+  double fast = TimeIt([&]() {
+      mxnet::io::HWCToCHW(img.data(), kRows, kCols, channels, stride, false, out.data());
+    });
+  LOG(INFO) << "HWCToCHW " << kRows << "x" << kCols << "x" << channels << ": "
+            << naive << " us per image naive, " << fast << " us per image";
+  naive = TimeIt([&]() {
+      NaiveHWCToCHW(img.data(), kRows, kCols, channels, stride, true, 0.5f, -3.0f,
+                    out.data());
+    });
+  fast = TimeIt([&]() {
+      mxnet::io::HWCToCHWAffine(img.data(), kRows, kCols, channels, stride, true,
+                                mul, add, out.data());
+    });
+  LOG(INFO) << "HWCToCHWAffine mirrored: " << naive << " us per image naive, "
+            << fast << " us per image";
+  naive = TimeIt([&]() {
+      NaiveColorJitter(img.data(), stride, kRows, kCols, 1.2f, 0.7f, 1.4f, 110.0f,
+                       out8.data());
+    });
+  fast = TimeIt([&]() {
+      mxnet::io::ColorJitter(img.data(), stride, kRows, kCols, 3, 1.2f, 0.7f, 1.4f,
+                             110.0f, out8.data(), stride);
+    });
+  LOG(INFO) << "ColorJitter: " << naive << " us per image naive, "
+            << fast << " us per image";
+}
+
+int main(int argc, char ** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+# pylint: skip-file
+"""test dist_allreduce kvstore with several local processes
+
+run without arguments to start 4 workers on this machine, or
+`python dist_allreduce_kvstore.py n` to start n workers
+"""
+import sys
+import os
+import subprocess
+sys.path.insert(0, "../../python/")
+import numpy as np
+
+def check_diff_to_scalar(A, x):
+    """ assert A == x"""
+    assert(np.sum(np.abs((A - x).asnumpy())) == 0), A.asnumpy()
+
+def test_allreduce_push_pull():
+    import mxnet as mx
+    keys = [3, 5, 7]
+    rate = 2
+    shape = (2, 2)
+    big_shape = (1200, 1200)        # spans several chunks of the ring
+
+    kv = mx.kv.create('dist_allreduce')
+    my_rank = kv.rank
+    nworker = kv.num_workers
+
+    # only rank 0's values are used for initialization
+    kv.init(keys, [mx.nd.ones(shape) * (my_rank + 1)] * len(keys))
+    kv.init(99, mx.nd.ones(big_shape) * (my_rank + 1))
+    kv.set_optimizer(mx.optimizer.create('test', rate))
+
+    nrepeat = 3
+    for i in range(nrepeat):
+        kv.push(3, mx.nd.ones(shape)*(my_rank+1))
+        kv.push(99, mx.nd.ones(big_shape)*(my_rank+1))
+
+    num = (nworker + 1) * nworker * rate / 2 * nrepeat + 1
+    val = mx.nd.zeros(shape)
+    kv.pull(3, out = val)
+    check_diff_to_scalar(val, num)
+
+    val2 = mx.nd.zeros(big_shape)
+    kv.pull(99, out = val2)
+    check_diff_to_scalar(val2, num)
+
+    # keys not pushed keep rank 0's initial value
+    kv.pull(5, out = val)
+    check_diff_to_scalar(val, 1)
+    kv.barrier()
+
+def launch_local(nworker, port=9071):
+    """start nworker processes of this script on localhost"""
+    procs = []
+    for rank in range(nworker):
+        env = os.environ.copy()
+        env.update({'MXNET_ALLREDUCE_NUM_WORKERS': str(nworker),
+                    'MXNET_ALLREDUCE_RANK': str(rank),
+                    'MXNET_ALLREDUCE_ROOT_URI': '127.0.0.1',
+                    'MXNET_ALLREDUCE_ROOT_PORT': str(port),
+                    # small chunks to exercise the pipeline
+                    'MXNET_KVSTORE_ALLREDUCE_CHUNK': str(64 * 1024)})
+        procs.append(subprocess.Popen([sys.executable, __file__], env=env))
+    ret = [p.wait() for p in procs]
+    assert all(r == 0 for r in ret), ret
+
+if __name__ == "__main__":
+    if 'MXNET_ALLREDUCE_RANK' in os.environ:
+        test_allreduce_push_pull()
+    else:
+        for n in ([int(sys.argv[1])] if len(sys.argv) > 1 else [1, 2, 3, 4]):
+            launch_local(n)
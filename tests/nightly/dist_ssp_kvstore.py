@@ -0,0 +1,42 @@
+#!/usr/bin/env python
+# pylint: skip-file
+import sys
+sys.path.insert(0, "../../python/")
+import mxnet as mx
+import numpy as np
+import os
+
+# setup
+keys = [3, 5, 7]
+rate = 2
+shape = (2, 2)
+staleness = int(os.getenv('MXNET_KVSTORE_STALENESS', 1))
+
+kv = mx.kv.create('dist_ssp')
+
+# init kv
+kv.init(keys, [mx.nd.ones(shape)] * len(keys))
+# init updater on servers
+kv.set_optimizer(mx.optimizer.create('test', rate))
+
+my_rank = kv.rank
+nworker = kv.num_workers
+
+def test_ssp_push_pull():
+    nrepeat = 5
+    val = mx.nd.zeros(shape)
+    for i in range(1, nrepeat + 1):
+        kv.push(3, mx.nd.ones(shape)*(my_rank+1))
+        kv.pull(3, out = val)
+        # every other worker has pushed at least i - staleness times
+        lower = 1 + rate * sum((r+1) * (i if r == my_rank else max(0, i - staleness))
+                               for r in range(nworker))
+        assert np.min(val.asnumpy()) >= lower, (val.asnumpy(), lower)
+
+    kv.barrier()
+    num = (nworker + 1) * nworker * rate / 2 * nrepeat + 1
+    kv.pull(3, out = val)
+    assert(np.sum(np.abs((val - num).asnumpy())) == 0), val.asnumpy()
+
+if __name__ == "__main__":
+    test_ssp_push_pull()
@@ -22,6 +22,13 @@ kv = mx.kv.create('dist_sync')
 # init kv
 kv.init(keys, [mx.nd.ones(shape)] * len(keys))
 kv.init(99, mx.nd.ones(big_shape))
+# fp16 values are sent in fp16, odd sizes need padding on the wire
+fp16_shape = (3, 3)
+fp16_big_shape = (1201, 1201)
+kv.init(9, mx.nd.ones(fp16_shape, dtype=np.float16))
+kv.init(98, mx.nd.ones(fp16_big_shape, dtype=np.float16))
+# row sparse keys, a big one is partitioned over servers by rows
+kv.init_row_sparse(97, mx.nd.ones(big_shape))
 # init updater on servers
 kv.set_optimizer(mx.optimizer.create('test', rate))
 
@@ -44,5 +51,37 @@ def test_sync_push_pull():
     kv.pull(99, out = val2)
     check_diff_to_scalar(val2, num)
 
+def test_sync_push_pull_fp16():
+    nrepeat = 3
+    for i in range(nrepeat):
+        kv.push(9, mx.nd.ones(fp16_shape, dtype=np.float16)*(my_rank+1))
+        kv.push(98, mx.nd.ones(fp16_big_shape, dtype=np.float16)*(my_rank+1))
+
+    num = (nworker + 1 ) * nworker * rate / 2 * nrepeat + 1
+    val = mx.nd.zeros(fp16_shape, dtype=np.float16)
+    kv.pull(9, out = val)
+    check_diff_to_scalar(val, num)
+
+    val2 = mx.nd.zeros(fp16_big_shape, dtype=np.float16)
+    kv.pull(98, out = val2)
+    check_diff_to_scalar(val2, num)
+
+def test_sync_push_pull_row_sparse():
+    # every worker pushes row 0 and its own row, row 1 is never pushed
+    nrepeat = 3
+    my_row = big_shape[0] - 1 - my_rank
+    ids = mx.nd.array([0, my_row])
+    for i in range(nrepeat):
+        kv.push_row_sparse(97, mx.nd.ones((2, big_shape[1]))*(my_rank+1), ids)
+
+    num = (nworker + 1 ) * nworker * rate / 2 * nrepeat + 1
+    val = mx.nd.zeros((3, big_shape[1]))
+    kv.pull_row_sparse(97, out = val, row_ids = mx.nd.array([0, 1, my_row]))
+    check_diff_to_scalar(val[0:1], num)
+    check_diff_to_scalar(val[1:2], 1)
+    check_diff_to_scalar(val[2:3], (my_rank + 1) * rate * nrepeat + 1)
+
 if __name__ == "__main__":
     test_sync_push_pull()
+    test_sync_push_pull_fp16()
+    test_sync_push_pull_row_sparse()
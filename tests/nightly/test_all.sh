@@ -35,6 +35,10 @@ juLog -name=Python.Local.KVStore -error=Error python test_kvstore.py
 
 # python: distributed kvstore
 juLog -name=Python.Distributed.KVStore -error=Error ../../tools/launch.py -n 4 python dist_sync_kvstore.py
+juLog -name=Python.Distributed.SSP.KVStore -error=Error ../../tools/launch.py -n 4 python dist_ssp_kvstore.py
+
+# python: distributed kvstore with ring allreduce, started as local processes
+juLog -name=Python.Distributed.Allreduce.KVStore -error=Error python dist_allreduce_kvstore.py
 
 # download data
 juLog -name=DownloadData bash ./download.sh
@@ -22,6 +22,9 @@ def test_batchnorm_with_type():
     sym = mx.sym.BatchNorm(name='norm', fix_gamma=True)
     check_consistency(sym, ctx_list)
 
+    sym = mx.sym.BatchNorm(name='norm', fix_gamma=False, fuse_relu=True)
+    check_consistency(sym, ctx_list)
+
 def test_convolution_with_type():
     sym = mx.sym.Convolution(num_filter=3, kernel=(3,3), name='conv')
     ctx_list = [{'ctx': mx.gpu(0), 'conv_data': (2, 2, 10, 10), 'type_dict': {'conv_data': np.float64}},
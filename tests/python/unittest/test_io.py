@@ -5,8 +5,20 @@ import os, gzip
 import pickle as pickle
 import time
 import sys
+import tempfile
+import shutil
+import contextlib
 from common import get_data
 
+@contextlib.contextmanager
+def _temp_dir():
+    """a temporary directory, removed with its files after use"""
+    dirname = tempfile.mkdtemp()
+    try:
+        yield dirname
+    finally:
+        shutil.rmtree(dirname)
+
 def test_MNISTIter():
     # prepare data
     get_data.GetMNIST_ubyte()
@@ -36,6 +48,27 @@ def test_MNISTIter():
     label_1 = train_dataiter.getlabel().asnumpy().flatten()
     assert(sum(label_0 - label_1) == 0)
 
+def test_MNISTIter_device_ring():
+    get_data.GetMNIST_ubyte()
+
+    def make_iter(**kwargs):
+        return mx.io.MNISTIter(
+            image="data/train-images-idx3-ubyte",
+            label="data/train-labels-idx1-ubyte",
+            data_shape=(784,), batch_size=100, shuffle=0, flat=1, silent=1,
+            **kwargs)
+    host_iter = make_iter()
+    ring_iter = make_iter(ctx='cpu', device_buffer=2)
+    for epoch in range(2):
+        host_iter.reset()
+        ring_iter.reset()
+        nbatch = 0
+        for host_batch, ring_batch in zip(host_iter, ring_iter):
+            assert (host_batch.data[0].asnumpy() == ring_batch.data[0].asnumpy()).all()
+            assert (host_batch.label[0].asnumpy() == ring_batch.label[0].asnumpy()).all()
+            nbatch += 1
+        assert nbatch == 600
+
 def test_Cifar10Rec():
     # skip-this test for saving time
     return
@@ -88,7 +121,165 @@ def test_NDArrayIter():
         else:
             assert(labelcount[i] == 100)
 
+def test_DenseBinaryIter():
+    import struct
+    num_rows, num_cols = 1050, 6
+    data = np.arange(num_rows * num_cols, dtype=np.float32).reshape(num_rows, num_cols)
+    label = np.arange(num_rows, dtype=np.float32).reshape(num_rows, 1)
+    with _temp_dir() as tmp:
+        fname = os.path.join(tmp, 'data.bin')
+        with open(fname, 'wb') as fout:
+            fout.write(struct.pack('=IIQQQ', 0x4d444258, 1, num_rows, num_cols, 1))
+            fout.write(data.tobytes())
+            fout.write(label.tobytes())
+
+        def read(dtype='float32', **kwargs):
+            dataiter = mx.io.DenseBinaryIter(data_bin=fname, data_shape=(2, 3),
+                                             batch_size=100, dtype=dtype, **kwargs)
+            rows = []
+            for batch in dataiter:
+                assert batch.data[0].dtype == np.dtype(dtype)
+                x = batch.data[0].asnumpy().reshape(100, num_cols)
+                y = batch.label[0].asnumpy().flatten()
+                assert (x[:, 0] == y * num_cols).all()
+                rows += list(y[:100 - batch.pad].astype(int))
+            return rows
+        # the last batch is padded
+        assert read() == list(range(num_rows))
+        rows = read(shuffle=True)
+        assert rows != list(range(num_rows))
+        assert sorted(rows) == list(range(num_rows))
+        parts = [read(num_parts=2, part_index=i) for i in range(2)]
+        assert parts[0] + parts[1] == list(range(num_rows))
+        assert read(dtype='int32') == list(range(num_rows))
+        # a batch outlives the iterator, which unmaps the file
+        dataiter = mx.io.DenseBinaryIter(data_bin=fname, data_shape=(2, 3), batch_size=100)
+        batch = dataiter.next()
+        del dataiter
+        assert (batch.data[0].asnumpy()[:, 0, 0] == np.arange(100) * num_cols).all()
+
+def _pack_images(N, size, dirname):
+    """pack N images of size x size, whose pixels are their labels, in dirname"""
+    fidx = os.path.join(dirname, 'images.idx')
+    frec = os.path.join(dirname, 'images.rec')
+    writer = mx.recordio.MXIndexedRecordIO(fidx, frec, 'w')
+    for i in range(N):
+        img = np.full((size, size, 3), i, dtype=np.uint8)
+        header = mx.recordio.IRHeader(0, i, i, 0)
+        writer.write_idx(i, mx.recordio.pack_img(header, img, img_fmt='.png'))
+    writer.close()
+    return fidx, frec
+
+def _read_epochs(dataiter, N, num_epoch):
+    """read the labels of num_epoch epochs, checking the images"""
+    epochs = []
+    for epoch in range(num_epoch):
+        dataiter.reset()
+        labels = []
+        for batch in dataiter:
+            label = batch.label[0].asnumpy()
+            data = batch.data[0].asnumpy()
+            for k in range(len(label)):
+                assert (data[k] == label[k]).all()
+            labels += list(label.astype(int))
+        assert sorted(labels) == list(range(N))
+        epochs.append(labels)
+    return epochs
+
+def test_ImageRecordIter_indexed():
+    try:
+        import cv2
+    except ImportError:
+        return
+    N = 100
+    with _temp_dir() as tmp:
+        fidx, frec = _pack_images(N, 8, tmp)
+
+        def read_labels(path_imgidx):
+            dataiter = mx.io.ImageRecordIter(
+                    path_imgrec=frec, path_imgidx=path_imgidx, shuffle=True,
+                    data_shape=(3, 8, 8), batch_size=10, preprocess_threads=2)
+            epochs = _read_epochs(dataiter, N, 2)
+            # shuffled over all records, and differently in every epoch
+            assert epochs[0] != list(range(N))
+            assert epochs[0] != epochs[1]
+
+        read_labels(fidx)
+        # without the index file, it is built from the records
+        read_labels(fidx + '.missing')
+
+def test_ImageRecordIter_cache():
+    try:
+        import cv2
+    except ImportError:
+        return
+    N = 100
+    with _temp_dir() as tmp:
+        # 1.2 MB of images, so some are spilled to disk
+        fidx, frec = _pack_images(N, 64, tmp)
+        dataiter = mx.io.ImageRecordIter(
+                path_imgrec=frec, cache_size=1, cache_dir=tmp,
+                shuffle=True, data_shape=(3, 64, 64), batch_size=10,
+                preprocess_threads=2)
+        epochs = _read_epochs(dataiter, N, 3)
+        # once all images are cached, all records are shuffled
+        assert epochs[1] != epochs[2]
+        # stop the threads writing to the cache before it is removed
+        del dataiter
+
+def test_ImageRecordIter_stats():
+    try:
+        import cv2
+    except ImportError:
+        return
+    N = 40
+    with _temp_dir() as tmp:
+        fidx, frec = _pack_images(N, 32, tmp)
+        for name in ['ImageRecordIter', 'ImageRecordIter_v1']:
+            dataiter = getattr(mx.io, name)(
+                    path_imgrec=frec, data_shape=(3, 32, 32), batch_size=10,
+                    preprocess_threads=2)
+            _read_epochs(dataiter, N, 1)
+            stats = dataiter.get_stats()
+            for key in ['read.time', 'decode.count', 'augment.time', 'convert.count',
+                        'prefetch.wait.time', 'prefetch.occupancy', 'prefetch.empty']:
+                assert key in stats, (name, key)
+            if os.environ.get('MXNET_IO_PROFILE', '0') != '0':
+                # the images decoded ahead before the reset are decoded again
+                assert stats['decode.count'] >= N
+                assert stats['prefetch.wait.count'] == N / 10
+
+def test_ImageRecordIter_uint8():
+    try:
+        import cv2
+    except ImportError:
+        return
+    N = 20
+    with _temp_dir() as tmp:
+        fidx, frec = _pack_images(N, 8, tmp)
+        for name in ['ImageRecordIter', 'ImageRecordIter_v1']:
+            for dtype in ['uint8', 'int32']:
+                dataiter = getattr(mx.io, name)(
+                        path_imgrec=frec, data_shape=(3, 8, 8), batch_size=10, dtype=dtype)
+                _read_epochs(dataiter, N, 1)
+                dataiter.reset()
+                batch = dataiter.next()
+                assert batch.data[0].dtype == np.dtype(dtype), (name, dtype)
+                # the raw pixels can not be normalized
+                try:
+                    getattr(mx.io, name)(path_imgrec=frec, data_shape=(3, 8, 8),
+                                         batch_size=10, dtype=dtype, mean_r=1.0)
+                    assert False, (name, dtype)
+                except mx.base.MXNetError:
+                    pass
+
 if __name__ == "__main__":
     test_NDArrayIter()
     test_MNISTIter()
+    test_MNISTIter_device_ring()
+    test_DenseBinaryIter()
     test_Cifar10Rec()
+    test_ImageRecordIter_indexed()
+    test_ImageRecordIter_cache()
+    test_ImageRecordIter_stats()
+    test_ImageRecordIter_uint8()
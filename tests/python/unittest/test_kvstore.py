@@ -111,6 +111,61 @@ def test_updater(dev = 'cpu'):
         for v in vv:
             check_diff_to_scalar(v, num_devs * num_push)
 
+def test_row_sparse():
+    """row sparse push & pull"""
+    kv = init_kv()
+    # duplicated ids are summed, other rows are untouched
+    ids = mx.nd.array([0, 2, 2])
+    rows = mx.nd.array(np.arange(12).reshape((3, 4)))
+    kv.push_row_sparse(3, rows, ids)
+    expected = np.zeros(shape)
+    expected[0] = [0, 1, 2, 3]
+    expected[2] = [12, 14, 16, 18]
+    val = mx.nd.empty(shape)
+    kv.pull(3, out = val)
+    assert(np.sum(np.abs(val.asnumpy() - expected)) == 0)
+
+    out = mx.nd.empty((3, 4))
+    kv.pull_row_sparse(3, out = out, row_ids = mx.nd.array([2, 1, 0]))
+    assert(np.sum(np.abs(out.asnumpy() - expected[[2, 1, 0]])) == 0)
+
+    # rows from multiple devices, with the updater
+    kv._set_updater(updater)
+    devs = [mx.Context('cpu', i) for i in range(2)]
+    kv.push_row_sparse(3, [mx.nd.ones((1, 4), d) for d in devs],
+                       [mx.nd.array([i], d) for i, d in enumerate(devs)])
+    expected[0:2] += 1
+    kv.pull(3, out = val)
+    assert(np.sum(np.abs(val.asnumpy() - expected)) == 0)
+
+    # a row sparse updater only sees the pushed rows, summed
+    def update_rows(key, grad, rows, stored):
+        r = rows.asnumpy()
+        r = r[1:1 + r[0]]
+        assert(list(r) == [0, 2])
+        s = stored.asnumpy()
+        s[r] += grad.asnumpy()[:len(r)]
+        stored[:] = s
+    kv = mx.kv.create()
+    kv.init_row_sparse(9, mx.nd.ones(shape))
+    kv._set_row_sparse_updater(update_rows)
+    kv.push_row_sparse(9, mx.nd.ones((3, 4)), mx.nd.array([2, 0, 2]))
+    expected = np.ones(shape)
+    expected[0] += 1
+    expected[2] += 2
+    kv.pull(9, out = val)
+    assert(np.sum(np.abs(val.asnumpy() - expected)) == 0)
+
+    # an optimizer updating rows leaves the other rows, even with weight decay
+    kv = mx.kv.create()
+    kv.init_row_sparse(9, mx.nd.ones(shape))
+    kv.set_optimizer(mx.optimizer.create('ccsgd', learning_rate=0.1, wd=0.1))
+    kv.push_row_sparse(9, mx.nd.ones((2, 4)), mx.nd.array([2, 0]))
+    expected = np.ones(shape)
+    expected[[0, 2]] = 1 - 0.1 * (1 + 0.1)
+    kv.pull(9, out = val)
+    assert(np.max(np.abs(val.asnumpy() - expected)) < 1e-6)
+
 def test_get_type():
     kvtype = 'local_allreduce_cpu'
     kv = mx.kv.create(kvtype)
@@ -123,3 +178,4 @@ if __name__ == '__main__':
     test_list_kv_pair()
     test_aggregator()
     test_updater()
+    test_row_sparse()
@@ -260,6 +260,117 @@ def test_softmax():
     check_softmax_with_shape((3, 4), default_context(), preserve_shape=True)
     check_softmax_with_shape((3, 4, 2), default_context(), preserve_shape=True)
 
+def test_softmax_large_vocab():
+    # the rows of large vocabularies span many blocks of the online softmax,
+    # and the large offset checks the stability
+    X = mx.symbol.Variable('X')
+    L = mx.symbol.Variable('L')
+    shape = (4, 3000)
+    x_np = np.random.normal(100, 5, shape) + np.linspace(0, 20, shape[1])
+    l_np = np.random.randint(0, shape[1], (shape[0],))
+    grad = mx.nd.empty(shape)
+    exe = mx.symbol.SoftmaxOutput(data=X, label=L).bind(
+        mx.cpu(), args=[mx.nd.array(x_np), mx.nd.array(l_np)], args_grad={'X': grad})
+    exe.forward(is_train=True)
+    prob = np_softmax(x_np)
+    assert_allclose(exe.outputs[0].asnumpy(), prob, rtol=1e-4, atol=1e-7)
+    exe.backward()
+    onehot = np.zeros(shape)
+    onehot[np.arange(shape[0]), l_np] = 1
+    assert_allclose(grad.asnumpy(), prob - onehot, rtol=1e-4, atol=1e-7)
+
+    # multi_output normalizes over the second axis
+    shape = (2, 50, 7)
+    x_np = np.random.normal(0, 10, shape)
+    l_np = np.random.randint(0, shape[1], (shape[0], shape[2]))
+    grad = mx.nd.empty(shape)
+    exe = mx.symbol.SoftmaxOutput(data=X, label=L, multi_output=True).bind(
+        mx.cpu(), args=[mx.nd.array(x_np), mx.nd.array(l_np)], args_grad={'X': grad})
+    exe.forward(is_train=True)
+    prob = np_softmax(x_np.transpose(0, 2, 1)).transpose(0, 2, 1)
+    assert_allclose(exe.outputs[0].asnumpy(), prob, rtol=1e-4, atol=1e-7)
+    exe.backward()
+    onehot = np.zeros(shape)
+    for i in range(shape[0]):
+        onehot[i, l_np[i], np.arange(shape[2])] = 1
+    assert_allclose(grad.asnumpy(), (prob - onehot) / shape[2], rtol=1e-4, atol=1e-7)
+
+    # softmax_cross_entropy computes the loss and the gradient without the softmax
+    shape = (5, 2000)
+    x_np = np.random.normal(0, 5, shape)
+    l_np = np.random.randint(0, shape[1], (shape[0],))
+    grad = mx.nd.empty(shape)
+    exe = mx.symbol.softmax_cross_entropy(X, L).bind(
+        mx.cpu(), args=[mx.nd.array(x_np), mx.nd.array(l_np)], args_grad={'X': grad},
+        grad_req={'X': 'write', 'L': 'null'})
+    exe.forward(is_train=True)
+    prob = np_softmax(x_np)
+    loss = -np.sum(np.log(prob[np.arange(shape[0]), l_np]))
+    assert_allclose(exe.outputs[0].asnumpy(), [loss], rtol=1e-4)
+    exe.backward(mx.nd.array([0.5]))
+    onehot = np.zeros(shape)
+    onehot[np.arange(shape[0]), l_np] = 1
+    assert_allclose(grad.asnumpy(), 0.5 * (prob - onehot), rtol=1e-4, atol=1e-7)
+
+def test_sampled_softmax_output():
+    num_hidden, num_sampled, shape = 1000, 50, (6, 8)
+    data = mx.symbol.Variable('data')
+    sym = mx.symbol.SampledSoftmaxOutput(data=data, num_hidden=num_hidden, num_sampled=num_sampled,
+                                         sparse_grad=True, name='sm')
+    exe = sym.simple_bind(mx.cpu(), data=shape, grad_req={'data': 'write', 'sm_label': 'null',
+                                                          'sm_weight': 'write', 'sm_bias': 'write'})
+    x = np.random.normal(0, 1, shape)
+    w = np.random.normal(0, 1, (num_hidden, shape[1]))
+    b = np.random.normal(0, 1, (num_hidden,))
+    # frequent classes, so that some are sampled too
+    y = np.random.randint(0, 20, (shape[0],))
+    for name, value in [('data', x), ('sm_weight', w), ('sm_bias', b), ('sm_label', y)]:
+        exe.arg_dict[name][:] = value
+    # inference is the cross entropy of the full softmax
+    exe.forward(is_train=False)
+    prob = np_softmax(np.dot(x, w.T) + b)
+    assert_allclose(exe.outputs[0].asnumpy(), -np.log(prob[np.arange(shape[0]), y]), rtol=1e-4)
+    # the probabilities come from an inference graph sharing the weight and bias
+    fc = mx.symbol.FullyConnected(data=data, weight=mx.symbol.Variable('sm_weight'),
+                                  bias=mx.symbol.Variable('sm_bias'), num_hidden=num_hidden)
+    pred = mx.symbol.SoftmaxOutput(data=fc, name='sm')
+    pexe = pred.bind(mx.cpu(), dict((name, exe.arg_dict[name]) for name in pred.list_arguments()))
+    pexe.forward(is_train=False)
+    assert_allclose(pexe.outputs[0].asnumpy(), prob, rtol=1e-4, atol=1e-7)
+    loss_from_prob = -np.log(pexe.outputs[0].asnumpy()[np.arange(shape[0]), y])
+    assert_allclose(exe.outputs[0].asnumpy(), loss_from_prob, rtol=1e-4)
+
+    def loss():
+        # the same samples for the same seed
+        mx.random.seed(7)
+        exe.forward(is_train=True)
+        return exe.outputs[0].asnumpy().sum()
+    loss()
+    exe.backward()
+    grads = dict((name, exe.grad_dict[name].asnumpy()) for name in ['data', 'sm_weight', 'sm_bias'])
+    # only the rows of the labels and the sampled classes get a gradient
+    rows = exe.aux_dict['sm_touched_rows'].asnumpy()
+    assert rows.shape == (num_hidden + 1,)
+    assert 0 < rows[0] <= shape[0] + num_sampled
+    touched = rows[1:1 + rows[0]]
+    assert set(y) <= set(touched)
+    assert set(np.nonzero(np.abs(grads['sm_weight']).sum(axis=1))[0]) <= set(touched)
+    # the gradient of the sampled loss, with the same samples
+    eps = 1e-2
+    for name, index in [('data', (1, 3)), ('sm_weight', (y[0], 2)), ('sm_bias', (y[2],)),
+                        ('sm_weight', (touched[-1], 5)), ('sm_bias', (touched[-1],))]:
+        value = exe.arg_dict[name].asnumpy()
+        orig = value[index]
+        value[index] = orig + eps
+        exe.arg_dict[name][:] = value
+        up = loss()
+        value[index] = orig - eps
+        exe.arg_dict[name][:] = value
+        down = loss()
+        value[index] = orig
+        exe.arg_dict[name][:] = value
+        assert_allclose(grads[name][index], (up - down) / (2 * eps), rtol=1e-2, atol=1e-3)
+
 def check_multi_softmax_with_shape(shape, xpu):
     X = mx.symbol.Variable('X')
     L = mx.symbol.Variable('L')
@@ -390,6 +501,67 @@ def test_embedding():
     exe_test.backward([grad])
     assert reldiff(grad_map["embed_weight"].asnumpy(), np.dot(np_onehot.T, np_grad)) < 1e-6
 
+def test_embedding_sparse_grad():
+    in_dim, out_dim, batch = 50, 6, (4, 5)
+    data = mx.sym.Variable('data')
+    for grad_req in ['write', 'add']:
+        embed = mx.sym.Embedding(data=data, input_dim=in_dim, output_dim=out_dim,
+                                 sparse_grad=True, name='embed')
+        exe = embed.simple_bind(mx.cpu(), grad_req={'data': 'null', 'embed_weight': grad_req},
+                                data=batch)
+        assert exe.aux_dict['embed_touched_rows'].dtype == np.int32
+        # independent of the batch, for bucketing and checkpoints
+        assert exe.aux_dict['embed_touched_rows'].shape == (in_dim + 1,)
+        np_weight = np.random.uniform(-1, 1, (in_dim, out_dim))
+        exe.arg_dict['embed_weight'][:] = np_weight
+        expected = np.zeros((in_dim, out_dim))
+        touched = set()
+        # the rows of one batch must be cleared by the next
+        for high in [in_dim, 10, in_dim]:
+            np_data = np.random.randint(low=0, high=high, size=batch)
+            exe.arg_dict['data'][:] = np_data
+            exe.forward(is_train=True)
+            assert_allclose(exe.outputs[0].asnumpy(), np_weight[np_data], rtol=1e-6)
+            np_grad = np.random.uniform(-1, 1, exe.outputs[0].shape)
+            exe.backward([mx.nd.array(np_grad)])
+            if grad_req == 'write':
+                expected[:] = 0
+                touched = set()
+            np.add.at(expected, np_data.ravel(), np_grad.reshape((-1, out_dim)))
+            touched |= set(np_data.ravel())
+            assert_allclose(exe.grad_dict['embed_weight'].asnumpy(), expected, rtol=1e-5, atol=1e-6)
+            rows = exe.aux_dict['embed_touched_rows'].asnumpy()
+            assert list(rows[1:1 + rows[0]]) == sorted(touched)
+        if grad_req == 'write':
+            # rows written by a kvstore are cleared once the rows are marked unknown
+            exe.grad_dict['embed_weight'][:] = 1
+            exe.aux_dict['embed_touched_rows'][0:1] = -1
+            exe.forward(is_train=True)
+            exe.backward([mx.nd.array(np_grad)])
+            expected[:] = 0
+            np.add.at(expected, np_data.ravel(), np_grad.reshape((-1, out_dim)))
+            assert_allclose(exe.grad_dict['embed_weight'].asnumpy(), expected, rtol=1e-5, atol=1e-6)
+
+def test_embedding_touched_rows_params():
+    in_dim, out_dim, batch = 50, 6, (4, 5)
+    embed = mx.sym.Embedding(data=mx.sym.Variable('data'), input_dim=in_dim, output_dim=out_dim,
+                             sparse_grad=True, name='embed')
+    mod = mx.mod.Module(embed, label_names=None, context=[mx.cpu(0), mx.cpu(1)])
+    mod.bind(data_shapes=[('data', batch)])
+    mod.init_params()
+    np_data = np.random.randint(low=0, high=in_dim, size=batch)
+    mod.forward(mx.io.DataBatch([mx.nd.array(np_data)], []), is_train=True)
+    mod.backward([mx.nd.ones(batch + (out_dim,))])
+    # the touched rows differ on the devices, they are neither averaged nor loaded
+    arg_params, aux_params = mod.get_params()
+    assert aux_params['embed_touched_rows'].asnumpy()[0] == -1
+    rows = mod._exec_group.aux_arrays[0][0].asnumpy()
+    assert rows[0] > 0
+    aux_params['embed_touched_rows'][:] = rows
+    mod.set_params(arg_params, aux_params)
+    for arr in mod._exec_group.aux_arrays[0]:
+        assert arr.asnumpy()[0] == -1
+
 # check ops handle duplicate input correctly.
 def test_binary_op_duplicate_input():
     data = mx.symbol.Variable('data')
@@ -716,7 +888,10 @@ def test_nearest_upsampling():
                     check_nearest_upsampling_with_shape(shapes, scale, root_scale)
 
 def test_batchnorm_training():
-    for shape in [(2, 3), (2, 3, 2, 2)]:
+    shapes = [(2, 3), (2, 3, 2, 2)]
+    if default_context().device_type == 'cpu':
+        shapes.append((2, 3, 2, 2, 2))
+    for shape in shapes:
         data_tmp = np.random.normal(size=shape)
         s = shape[1],
         gamma = np.ones(s)
@@ -734,6 +909,203 @@ def test_batchnorm_training():
         test = mx.symbol.BatchNorm(data, fix_gamma=False, use_global_stats=True)
         check_numeric_gradient(test, [data_tmp, gamma, beta], [rolling_mean, rolling_std], numeric_eps=1e-3, check_eps=0.16)
 
+        test = mx.symbol.BatchNorm(data, fix_gamma=False, fuse_relu=True)
+        check_numeric_gradient(test, [data_tmp, gamma, beta], [rolling_mean, rolling_std], numeric_eps=1e-3, check_eps=0.16)
+
+def test_batchnorm_fp16():
+    # float16 data with float32 statistics on cpu, against float32 data
+    shape = (4, 3, 5, 5)
+    x = np.random.normal(size=shape).astype(np.float16)
+    g = np.random.normal(size=shape).astype(np.float16)
+    for fuse_relu in [False, True]:
+        sym = mx.symbol.BatchNorm(mx.symbol.Variable('data'), name='bn', fix_gamma=False,
+                                  fuse_relu=fuse_relu)
+        outputs = []
+        for dtype in [np.float32, np.float16]:
+            exe = sym.simple_bind(mx.cpu(), data=shape, type_dict={'data': dtype})
+            exe.arg_dict['data'][:] = x.astype(dtype)
+            exe.arg_dict['bn_gamma'][:] = np.random.RandomState(0).uniform(1, 2, 3)
+            exe.arg_dict['bn_beta'][:] = 0.5
+            exe.forward(is_train=True)
+            exe.backward([mx.nd.array(g, ctx=mx.cpu(), dtype=dtype)])
+            assert exe.outputs[0].dtype == dtype
+            outputs.append([exe.outputs[0].asnumpy().astype(np.float32),
+                            exe.grad_dict['data'].asnumpy().astype(np.float32),
+                            exe.grad_dict['bn_gamma'].asnumpy()])
+        for a, b in zip(*outputs):
+            assert_allclose(a, b, rtol=1e-2, atol=1e-2)
+
+def test_fp16_cpu():
+    # float16 storage with float32 compute on cpu, against float32
+    data = mx.symbol.Variable('data')
+    shape = (2, 4, 8, 8)
+    symbols = [
+        mx.symbol.Convolution(data, kernel=(3, 3), pad=(1, 1), num_filter=6, name='conv'),
+        mx.symbol.Convolution(data, kernel=(3, 3), stride=(2, 2), num_filter=4, num_group=2,
+                              name='conv'),
+        mx.symbol.FullyConnected(data, num_hidden=10, name='fc'),
+        mx.symbol.Pooling(data, kernel=(3, 3), stride=(2, 2), pad=(1, 1), pool_type='max'),
+        mx.symbol.Pooling(data, kernel=(2, 2), stride=(2, 2), pool_type='avg'),
+        mx.symbol.BatchNorm(data, fix_gamma=False, name='bn'),
+        mx.symbol.Activation(data, act_type='relu'),
+        mx.symbol.Activation(data, act_type='tanh'),
+        mx.symbol.Concat(data, mx.symbol.Variable('data2'), dim=1),
+        mx.symbol.ElementWiseSum(data, mx.symbol.Variable('data2'), data, num_args=3),
+        mx.symbol.SoftmaxOutput(mx.symbol.Flatten(data), name='softmax')]
+    for sym in symbols:
+        outputs = []
+        for dtype in [np.float32, np.float16]:
+            type_dict = dict((name, dtype) for name in sym.list_arguments() if 'data' in name)
+            exe = sym.simple_bind(mx.cpu(), type_dict=type_dict,
+                                  **dict((name, shape) for name in type_dict))
+            rng = np.random.RandomState(0)
+            for name, arr in exe.arg_dict.items():
+                if name == 'softmax_label':
+                    arr[:] = rng.randint(0, 256, arr.shape)
+                else:
+                    # the same values in both types
+                    arr[:] = rng.normal(size=arr.shape).astype(np.float16)
+            exe.forward(is_train=True)
+            out = exe.outputs[0]
+            assert out.dtype == dtype
+            g = np.random.RandomState(1).normal(size=out.shape).astype(np.float16)
+            exe.backward([mx.nd.array(g, ctx=mx.cpu(), dtype=dtype)])
+            outputs.append([out.asnumpy().astype(np.float32)] +
+                           [exe.grad_dict[name].asnumpy().astype(np.float32)
+                            for name in sym.list_arguments() if name != 'softmax_label'])
+        for a, b in zip(*outputs):
+            assert_allclose(a, b, rtol=1e-2, atol=1e-2 * max(1, np.abs(b).max()))
+
+def np_pooling(x, kernel, stride, pad, pool_type):
+    """n-d pooling of N x C x ... data, max pooling ignores the padding,
+    avg pooling counts it as zeros"""
+    n, c = x.shape[:2]
+    spatial = x.shape[2:]
+    oshape = [1 + (s + 2 * p - k) // st for s, k, st, p in zip(spatial, kernel, stride, pad)]
+    fill = -np.inf if pool_type == 'max' else 0
+    xp = np.full((n, c) + tuple(s + 2 * p for s, p in zip(spatial, pad)), fill)
+    xp[(slice(None), slice(None)) + tuple(slice(p, p + s) for s, p in zip(spatial, pad))] = x
+    axes = tuple(range(2, x.ndim))
+    out = np.zeros((n, c) + tuple(oshape))
+    for pos in np.ndindex(*oshape):
+        window = xp[(slice(None), slice(None)) +
+                    tuple(slice(i * st, i * st + k) for i, st, k in zip(pos, stride, kernel))]
+        if pool_type == 'max':
+            out[(slice(None), slice(None)) + pos] = window.max(axis=axes)
+        elif pool_type == 'sum':
+            out[(slice(None), slice(None)) + pos] = window.sum(axis=axes)
+        else:
+            out[(slice(None), slice(None)) + pos] = window.sum(axis=axes) / np.prod(kernel)
+    return out
+
+def test_pooling():
+    shape = (2, 3, 7, 8)
+    x = np.random.normal(size=shape)
+    data = mx.symbol.Variable('data')
+    for pool_type in ['max', 'avg', 'sum']:
+        for kernel, stride in [((2, 2), (2, 2)), ((3, 3), (1, 1)), ((3, 2), (2, 1))]:
+            # cudnn excludes the padding from the average, and the padded max
+            # pooling is only exact on cpu, gpus without cudnn pad with zeros
+            padded = pool_type == 'sum' or (pool_type == 'max' and
+                                            default_context().device_type == 'cpu')
+            pads = [(0, 0), (1, 1)] if padded else [(0, 0)]
+            for pad in pads:
+                kwargs = dict(kernel=kernel, stride=stride, pad=pad, pool_type=pool_type)
+                exe = mx.symbol.Pooling(data, **kwargs).simple_bind(default_context(), data=shape)
+                exe.arg_dict['data'][:] = x
+                exe.forward(is_train=True)
+                assert_allclose(exe.outputs[0].asnumpy(),
+                                np_pooling(x, kernel, stride, pad, pool_type), rtol=1e-5, atol=1e-5)
+                check_numeric_gradient(mx.symbol.Pooling(data, **kwargs), [x],
+                                       numeric_eps=1e-3, check_eps=1e-2)
+                if pool_type != 'max' or default_context().device_type != 'cpu':
+                    continue
+                # the cached argmax gives the same gradient as the search
+                grad = mx.nd.array(np.random.normal(size=exe.outputs[0].shape))
+                exe.backward([grad])
+                cached = mx.symbol.Pooling(data, cache_argmax=True, **kwargs).simple_bind(
+                    default_context(), data=shape)
+                assert len(cached.outputs) == 1
+                cached.arg_dict['data'][:] = x
+                cached.forward(is_train=True)
+                cached.backward([grad])
+                assert_allclose(cached.outputs[0].asnumpy(), exe.outputs[0].asnumpy())
+                assert_allclose(cached.grad_dict['data'].asnumpy(), exe.grad_dict['data'].asnumpy())
+
+def np_convolution_3d(x, w, b, stride, pad, num_group):
+    n, c, d, h, wd = x.shape
+    f, cg, kd, kh, kw = w.shape
+    xp = np.zeros((n, c, d + 2 * pad[0], h + 2 * pad[1], wd + 2 * pad[2]))
+    xp[:, :, pad[0]:pad[0] + d, pad[1]:pad[1] + h, pad[2]:pad[2] + wd] = x
+    od = (d + 2 * pad[0] - kd) // stride[0] + 1
+    oh = (h + 2 * pad[1] - kh) // stride[1] + 1
+    ow = (wd + 2 * pad[2] - kw) // stride[2] + 1
+    out = np.zeros((n, f, od, oh, ow))
+    fg = f // num_group
+    for g in range(num_group):
+        xg = xp[:, g * cg:(g + 1) * cg]
+        wg = w[g * fg:(g + 1) * fg]
+        for i in range(od):
+            for j in range(oh):
+                for k in range(ow):
+                    patch = xg[:, :, i * stride[0]:i * stride[0] + kd,
+                               j * stride[1]:j * stride[1] + kh, k * stride[2]:k * stride[2] + kw]
+                    out[:, g * fg:(g + 1) * fg, i, j, k] = np.tensordot(
+                        patch, wg, axes=([1, 2, 3, 4], [1, 2, 3, 4]))
+    return out + b.reshape((1, f, 1, 1, 1))
+
+def test_convolution_3d():
+    # the first two are convolved directly, the others by vol2col and gemm
+    for num_channel, num_group in [(2, 1), (6, 3), (6, 1), (10, 2)]:
+        for kernel, stride, pad in [((3, 3, 3), (1, 1, 1), (1, 1, 1)),
+                                    ((2, 3, 3), (1, 2, 2), (0, 1, 0)),
+                                    ((1, 1, 1), (1, 1, 1), (0, 0, 0))]:
+            shape = (2, num_channel, 4, 5, 6)
+            num_filter = 6
+            data = mx.symbol.Variable('data')
+            conv = mx.symbol.Convolution(data, kernel=kernel, stride=stride, pad=pad,
+                                         num_filter=num_filter, num_group=num_group)
+            exe = conv.simple_bind(mx.cpu(), data=shape)
+            x = np.random.normal(size=shape)
+            w = np.random.normal(size=exe.arg_arrays[1].shape)
+            b = np.random.normal(size=(num_filter,))
+            for arr, value in zip(exe.arg_arrays, [x, w, b]):
+                arr[:] = value
+            exe.forward(is_train=False)
+            assert_allclose(exe.outputs[0].asnumpy(),
+                            np_convolution_3d(x, w, b, stride, pad, num_group), rtol=1e-4, atol=1e-4)
+            check_numeric_gradient(conv, [x, w, b], numeric_eps=1e-3, check_eps=2e-2, ctx=mx.cpu())
+            # without workspace, vol2col is done one output plane at a time
+            small = mx.symbol.Convolution(data, kernel=kernel, stride=stride, pad=pad,
+                                          num_filter=num_filter, num_group=num_group, workspace=0)
+            sexe = small.simple_bind(mx.cpu(), data=shape)
+            for arr, value in zip(sexe.arg_arrays, [x, w, b]):
+                arr[:] = value
+            dy = mx.nd.array(np.random.normal(size=exe.outputs[0].shape))
+            exe.forward(is_train=True)
+            exe.backward([dy])
+            sexe.forward(is_train=True)
+            sexe.backward([dy])
+            for got, want in zip([sexe.outputs[0]] + sexe.grad_arrays,
+                                 [exe.outputs[0]] + exe.grad_arrays):
+                assert_allclose(got.asnumpy(), want.asnumpy(), rtol=1e-5, atol=1e-5)
+
+def test_pooling_3d():
+    shape = (2, 3, 4, 5, 6)
+    x = np.random.normal(size=shape)
+    data = mx.symbol.Variable('data')
+    for pool_type in ['max', 'avg', 'sum']:
+        for kernel, stride, pad in [((2, 2, 2), (2, 2, 2), (0, 0, 0)),
+                                    ((3, 3, 3), (1, 2, 1), (1, 1, 1))]:
+            pool = mx.symbol.Pooling(data, kernel=kernel, stride=stride, pad=pad,
+                                     pool_type=pool_type)
+            exe = pool.simple_bind(mx.cpu(), data=shape)
+            exe.arg_dict['data'][:] = x
+            exe.forward(is_train=False)
+            assert_allclose(exe.outputs[0].asnumpy(),
+                            np_pooling(x, kernel, stride, pad, pool_type), rtol=1e-5, atol=1e-5)
+            check_numeric_gradient(pool, [x], numeric_eps=1e-3, check_eps=1e-2, ctx=mx.cpu())
+
 def test_convolution_grouping():
     num_filter = 4
     num_group = 2
@@ -1459,10 +1831,30 @@ def test_roipooling():
                            grad_nodes={'data':'add', 'rois':'write'},
                            numeric_eps=1e-3, check_eps=1e-2)
 
+def test_image_normalize():
+    mean = [123., 117., 104.]
+    scale = 0.017
+    x = np.random.randint(0, 256, size=(2, 3, 5, 4))
+    data = mx.symbol.Variable('data')
+    sym = mx.symbol.ImageNormalize(data, mean_r=mean[0], mean_g=mean[1],
+                                   mean_b=mean[2], scale=scale)
+    # uint8 images as from an iterator with dtype='uint8', and float inputs
+    for dtype in [np.uint8, np.float32]:
+        exe = sym.simple_bind(default_context(), data=x.shape, type_dict={'data': dtype},
+                              grad_req='null')
+        exe.arg_dict['data'][:] = x.astype(dtype)
+        exe.forward(is_train=False)
+        out = exe.outputs[0]
+        assert out.dtype == np.float32
+        expected = (x - np.array(mean).reshape((1, 3, 1, 1))) * scale
+        assert_allclose(out.asnumpy(), expected, rtol=1e-5, atol=1e-5)
+
 if __name__ == '__main__':
     test_expand_dims()
     test_slice_axis()
     test_softmax()
+    test_softmax_large_vocab()
+    test_sampled_softmax_output()
     test_broadcast_binary_op()
     test_flip()
     test_crop()
@@ -1481,6 +1873,8 @@ if __name__ == '__main__':
     test_symbol_pow()
     test_pow_fn()
     test_embedding()
+    test_embedding_sparse_grad()
+    test_embedding_touched_rows_params()
     test_rsqrt_cos_sin()
     test_maximum_minimum()
     test_maximum_minimum_scalar()
@@ -1488,6 +1882,11 @@ if __name__ == '__main__':
     test_round_ceil_floor()
     test_deconvolution()
     test_batchnorm_training()
+    test_batchnorm_fp16()
+    test_fp16_cpu()
+    test_pooling()
+    test_convolution_3d()
+    test_pooling_3d()
     check_softmax_with_ignore_label(default_context())
     test_convolution_dilated_impulse_response()
     test_reshape()
@@ -1500,3 +1899,4 @@ if __name__ == '__main__':
     test_support_vector_machine_l1_svm()
     test_support_vector_machine_l2_svm()
     test_roipooling()
+    test_image_normalize()
@@ -0,0 +1,92 @@
+# pylint: skip-file
+import numpy as np
+import mxnet as mx
+from numpy.testing import assert_allclose
+
+def np_sgd(weight, grad, mom, lr, wd, momentum, rescale_grad, clip_gradient):
+    grad = rescale_grad * np.clip(grad, -clip_gradient, clip_gradient)
+    mom = momentum * mom - lr * (grad + wd * weight)
+    return weight + mom, mom
+
+def np_adam(weight, grad, state, lr, wd, t, beta1, beta2, epsilon):
+    mean, var = state
+    mean = beta1 * mean + (1 - beta1) * grad
+    var = beta2 * var + (1 - beta2) * grad * grad
+    lr = lr * np.sqrt(1 - beta2 ** t) / (1 - beta1 ** t)
+    weight = weight - lr * mean / (np.sqrt(var) + epsilon)
+    return weight - lr * wd * weight, (mean, var)
+
+def np_rmsprop(weight, grad, state, lr, wd, gamma1, gamma2, epsilon):
+    n, g, delta = state
+    n = (1 - gamma1) * grad * grad + gamma1 * n
+    g = (1 - gamma1) * grad + gamma1 * g
+    delta = gamma2 * delta - lr * (grad / np.sqrt(n - g * g + epsilon) + wd * weight)
+    return weight + delta, (n, g, delta)
+
+def test_sgd_update_rows():
+    nrow, ncol = 20, 3
+    lr, wd, rescale_grad, clip_gradient = 0.1, 0.05, 0.5, 1.5
+    for momentum in [0.0, 0.9]:
+        opt = mx.optimizer.ccSGD(learning_rate=lr, wd=wd, momentum=momentum,
+                                 rescale_grad=rescale_grad, clip_gradient=clip_gradient)
+        weight = np.random.uniform(-1, 1, (nrow, ncol))
+        mom = np.zeros((nrow, ncol))
+        w = mx.nd.array(weight)
+        # the same updates with only the rows of the gradient
+        compact = mx.nd.array(weight)
+        for step in range(10):
+            rows = np.unique(np.random.randint(0, nrow, 4))
+            grad = np.zeros((nrow, ncol))
+            grad[rows] = np.random.uniform(-2, 2, (len(rows), ncol))
+            weight, mom = np_sgd(weight, grad, mom, lr, wd, momentum, rescale_grad, clip_gradient)
+            touched = mx.nd.array(np.concatenate([[len(rows)], rows]), dtype=np.int32)
+            opt.update_rows(0, w, mx.nd.array(grad), touched)
+            opt.update_rows(1, compact, mx.nd.array(grad[rows]), touched, compact=True)
+            # the rows updated are up to date, the others are behind
+            assert_allclose(w.asnumpy()[rows], weight[rows], rtol=1e-4, atol=1e-5)
+            assert_allclose(compact.asnumpy(), w.asnumpy(), rtol=1e-6, atol=1e-7)
+        # a dense update brings all the rows up to date
+        grad = np.random.uniform(-2, 2, (nrow, ncol))
+        weight, mom = np_sgd(weight, grad, mom, lr, wd, momentum, rescale_grad, clip_gradient)
+        opt.update(0, w, mx.nd.array(grad), None)
+        assert_allclose(w.asnumpy(), weight, rtol=1e-4, atol=1e-5)
+
+def test_update_group():
+    shapes = [(3, 4), (50000,), (7,), (20, 1000)]
+    lr, wd, rescale_grad = 0.01, 0.05, 0.5
+    opts = [
+        (mx.optimizer.ccSGD(learning_rate=lr, wd=wd, momentum=0.9, rescale_grad=rescale_grad),
+         lambda w, g, s, t: np_sgd(w, g, s, lr, wd, 0.9, rescale_grad, np.inf),
+         lambda shape: np.zeros(shape)),
+        (mx.optimizer.ccSGD(learning_rate=lr, wd=wd, rescale_grad=rescale_grad),
+         lambda w, g, s, t: np_sgd(w, g, s, lr, wd, 0.0, rescale_grad, np.inf),
+         lambda shape: np.zeros(shape)),
+        (mx.optimizer.ccAdam(learning_rate=lr, wd=wd, rescale_grad=rescale_grad),
+         lambda w, g, s, t: np_adam(w, rescale_grad * g, s, lr, wd, t, 0.9, 0.999, 1e-8),
+         lambda shape: (np.zeros(shape), np.zeros(shape))),
+        (mx.optimizer.ccRMSProp(learning_rate=lr, wd=wd, rescale_grad=rescale_grad),
+         lambda w, g, s, t: np_rmsprop(w, rescale_grad * g, s, lr, wd, 0.95, 0.9, 1e-4),
+         lambda shape: (np.zeros(shape), np.zeros(shape), np.zeros(shape)))]
+    for opt, np_update, np_state in opts:
+        weights = [np.random.uniform(-1, 1, shape) for shape in shapes]
+        states = [np_state(shape) for shape in shapes]
+        ws = [mx.nd.array(w) for w in weights]
+        for t in range(1, 4):
+            grads = [np.random.uniform(-1, 1, shape) for shape in shapes]
+            for i in range(len(shapes)):
+                weights[i], states[i] = np_update(weights[i], grads[i], states[i], t)
+            opt.update_group(list(range(len(shapes))), ws, [mx.nd.array(g) for g in grads])
+            for w, weight in zip(ws, weights):
+                assert_allclose(w.asnumpy(), weight, rtol=1e-4, atol=1e-5)
+        # updating one weight matches the same update in a group
+        index = len(shapes)
+        weight = np.random.uniform(-1, 1, shapes[0])
+        grad = np.random.uniform(-1, 1, shapes[0])
+        w = mx.nd.array(weight)
+        opt.update(index, w, mx.nd.array(grad), None)
+        weight, _ = np_update(weight, grad, np_state(shapes[0]), 1)
+        assert_allclose(w.asnumpy(), weight, rtol=1e-4, atol=1e-5)
+
+if __name__ == '__main__':
+    test_sgd_update_rows()
+    test_update_group()
@@ -0,0 +1,162 @@
+# pylint: skip-file
+import os
+import sys
+import json
+import shutil
+import tempfile
+import numpy as np
+import mxnet as mx
+from numpy.testing import assert_allclose
+from mxnet.quantization import quantize_params, quantize_model
+curr_path = os.path.dirname(os.path.abspath(os.path.expanduser(__file__)))
+sys.path.append(os.path.join(curr_path, '../../../amalgamation/python/'))
+
+def np_quantize(x, threshold):
+    return np.clip(np.round(x * 127.0 / threshold), -127, 127)
+
+def bind_quantized(sym, shape, arg_params, aux_params={}):
+    exe = sym.simple_bind(mx.cpu(), grad_req='null', type_dict={'data': np.float32}, data=shape)
+    exe.copy_params_from(arg_params, aux_params, allow_extra_params=True)
+    return exe
+
+def check_quantized_layer(float_sym, quantized_sym, shape, fuse_relu):
+    float_exe = float_sym.simple_bind(mx.cpu(), grad_req='null', data=shape)
+    args = {}
+    for name, arr in float_exe.arg_dict.items():
+        arr[:] = np.random.uniform(-1, 1, arr.shape)
+        args[name] = arr
+    float_exe.forward()
+    expected = float_exe.outputs[0].asnumpy()
+    if fuse_relu:
+        expected = np.maximum(expected, 0)
+    threshold = np.abs(args['data'].asnumpy()).max()
+    qargs = dict(args)
+    qargs['layer_weight'], qargs['layer_weight_scale'] = quantize_params(args['layer_weight'])
+    exe = bind_quantized(quantized_sym(threshold, 0.0), shape, qargs)
+    exe.forward()
+    out = exe.outputs[0].asnumpy()
+    assert out.dtype == np.float32
+    # the error of int8 rounding of the data and the weight
+    assert np.abs(out - expected).max() < 0.05 * np.abs(expected).max()
+    # the same output requantized to int8
+    out_threshold = np.abs(out).max()
+    exe = bind_quantized(quantized_sym(threshold, out_threshold), shape, qargs)
+    exe.forward()
+    out8 = exe.outputs[0].asnumpy().view(np.int8)
+    assert np.abs(out8 - np_quantize(out, out_threshold)).max() <= 1
+
+def test_quantize():
+    data = mx.symbol.Variable('data')
+    x = np.array([0, 1, -1, 2, -5, 0.0079, 0.0078], dtype=np.float32)
+    exe = mx.symbol.Quantize(data, threshold=2.0).bind(mx.cpu(), {'data': mx.nd.array(x)})
+    exe.forward()
+    out = exe.outputs[0].asnumpy().view(np.int8)
+    assert (out == [0, 64, -64, 127, -127, 1, 0]).all()
+
+def test_quantized_fully_connected():
+    data = mx.symbol.Variable('data')
+    for fuse_relu in [False, True]:
+        for no_bias in [False, True]:
+            fc = mx.symbol.FullyConnected(data, num_hidden=20, no_bias=no_bias, name='layer')
+            def quantized_fc(threshold, out_threshold):
+                qdata = mx.symbol.Quantize(data, threshold=threshold)
+                return mx.symbol.QuantizedFullyConnected(
+                    qdata, num_hidden=20, no_bias=no_bias, name='layer', in_threshold=threshold,
+                    out_threshold=out_threshold, fuse_relu=fuse_relu)
+            check_quantized_layer(fc, quantized_fc, (5, 3, 10), fuse_relu)
+
+def test_quantized_convolution():
+    data = mx.symbol.Variable('data')
+    for num_group, kernel, stride, pad, dilate in [
+            (1, (3, 3), (1, 1), (1, 1), (1, 1)),
+            (2, (3, 3), (2, 2), (0, 0), (1, 1)),
+            (1, (1, 1), (1, 1), (0, 0), (1, 1)),
+            (1, (3, 3), (1, 1), (2, 2), (2, 2))]:
+        for fuse_relu in [False, True]:
+            params = dict(num_filter=6, num_group=num_group, kernel=kernel, stride=stride,
+                          pad=pad, dilate=dilate, name='layer')
+            conv = mx.symbol.Convolution(data, **params)
+            def quantized_conv(threshold, out_threshold):
+                qdata = mx.symbol.Quantize(data, threshold=threshold)
+                return mx.symbol.QuantizedConvolution(
+                    qdata, in_threshold=threshold, out_threshold=out_threshold,
+                    fuse_relu=fuse_relu, **params)
+            check_quantized_layer(conv, quantized_conv, (2, 4, 9, 8), fuse_relu)
+
+def make_quantized_model():
+    """a small float model, its input and its int8 quantization"""
+    data = mx.symbol.Variable('data')
+    net = mx.symbol.Convolution(data, kernel=(3, 3), pad=(1, 1), num_filter=8, name='conv1')
+    net = mx.symbol.Activation(net, act_type='relu', name='relu1')
+    net = mx.symbol.Convolution(net, kernel=(3, 3), pad=(1, 1), num_filter=8, name='conv2')
+    net = mx.symbol.Activation(net, act_type='relu', name='relu2')
+    net = mx.symbol.Pooling(net, kernel=(2, 2), stride=(2, 2), pool_type='max', name='pool')
+    net = mx.symbol.Flatten(net, name='flatten')
+    net = mx.symbol.FullyConnected(net, num_hidden=16, name='fc1')
+    net = mx.symbol.Activation(net, act_type='relu', name='relu3')
+    net = mx.symbol.FullyConnected(net, num_hidden=4, name='fc2')
+    net = mx.symbol.SoftmaxOutput(net, name='softmax')
+
+    shape = (8, 3, 8, 8)
+    exe = net.simple_bind(mx.cpu(), grad_req='null', data=shape)
+    arg_params = {}
+    for name, arr in exe.arg_dict.items():
+        if name not in ['data', 'softmax_label']:
+            arr[:] = np.random.uniform(-0.5, 0.5, arr.shape)
+            arg_params[name] = arr
+    x = np.random.uniform(-1, 1, (32,) + shape[1:])
+    data_iter = mx.io.NDArrayIter(x, np.zeros(32), batch_size=8)
+    qsym, qarg_params, _ = quantize_model(net, arg_params, {}, data_iter, num_batches=4)
+    return exe, x, qsym, qarg_params
+
+def test_quantize_model():
+    exe, x, qsym, qarg_params = make_quantized_model()
+    shape = exe.arg_dict['data'].shape
+    ops = [node['op'] for node in json.loads(qsym.tojson())['nodes']]
+    assert ops.count('QuantizedConvolution') == 2
+    assert ops.count('QuantizedFullyConnected') == 2
+    # conv1 and fc1 read float data, conv2 and fc2 read int8 from conv1 and fc1
+    assert ops.count('Quantize') == 2
+    # the relus are fused
+    assert 'Activation' not in ops
+    assert qarg_params['conv1_weight'].dtype == np.uint8
+
+    qsym = mx.symbol.load_json(qsym.tojson())
+    qexe = bind_quantized(qsym, shape, qarg_params)
+    for i in range(4):
+        exe.arg_dict['data'][:] = x[i * 8:(i + 1) * 8]
+        qexe.arg_dict['data'][:] = x[i * 8:(i + 1) * 8]
+        exe.forward()
+        qexe.forward()
+        prob = exe.outputs[0].asnumpy()
+        qprob = qexe.outputs[0].asnumpy()
+        assert np.abs(prob - qprob).max() < 0.05
+
+def test_quantize_model_predict_api():
+    from mxnet_predict import Predictor
+    _, x, qsym, qarg_params = make_quantized_model()
+    shape = (8,) + x.shape[1:]
+    qexe = bind_quantized(qsym, shape, qarg_params)
+    # save the model as a checkpoint would, and load it with the predict api
+    tmp = tempfile.mkdtemp()
+    try:
+        fname = os.path.join(tmp, 'quantized.params')
+        mx.nd.save(fname, {'arg:%s' % k: v for k, v in qarg_params.items()})
+        with open(fname, 'rb') as fin:
+            params = fin.read()
+    finally:
+        shutil.rmtree(tmp)
+    predictor = Predictor(qsym.tojson(), params, {'data': shape})
+    for i in range(4):
+        batch = x[i * 8:(i + 1) * 8]
+        qexe.arg_dict['data'][:] = batch
+        qexe.forward()
+        predictor.forward(data=batch)
+        assert_allclose(predictor.get_output(0), qexe.outputs[0].asnumpy(), rtol=1e-5, atol=1e-6)
+
+if __name__ == '__main__':
+    test_quantize()
+    test_quantized_fully_connected()
+    test_quantized_convolution()
+    test_quantize_model()
+    test_quantize_model_predict_api()
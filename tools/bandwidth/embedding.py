@@ -0,0 +1,99 @@
+"""Benchmark the training step of a big embedding weight through kvstore
+
+Every batch runs the same forward and backward of an Embedding with
+sparse_grad, and the weight is pulled and its gradient pushed, either
+
+- dense: the full weight is pulled and the full gradient is pushed, or
+- row sparse: only the rows indexed by the batch are pulled with
+  pull_row_sparse, and the rows of the gradient at the unique ids of the batch
+  are gathered and pushed with push_row_sparse. The pulled rows are not copied
+  into the weight, as there is no operator to scatter them.
+
+Run on a single machine with e.g.
+
+    python embedding.py --kv-store local --input-dim 1000000
+
+or with the parameter servers by ../launch.py with --kv-store dist_sync.
+"""
+import os, sys
+curr_path = os.path.abspath(os.path.dirname(__file__))
+sys.path.insert(0, os.path.join(curr_path, "../../python"))
+import mxnet as mx
+import logging
+import argparse
+import time
+import numpy as np
+
+logger = logging.getLogger()
+logger.setLevel(logging.INFO)
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="benchmark embedding training through kv-store")
+    parser.add_argument('--kv-store', type=str, default='local',
+                        help='the kvstore type')
+    parser.add_argument('--input-dim', type=int, default=1000000,
+                        help='the number of rows of the embedding weight')
+    parser.add_argument('--output-dim', type=int, default=64,
+                        help='the length of a row')
+    parser.add_argument('--batch-size', type=int, default=128,
+                        help='the batch size')
+    parser.add_argument('--seq-len', type=int, default=32,
+                        help='the number of ids of an example')
+    parser.add_argument('--num-batches', type=int, default=10,
+                        help='number of batches to run')
+    parser.add_argument('--mode', type=str, default='dense,row_sparse',
+                        help='the modes to test')
+    args = parser.parse_args()
+    logging.info(args)
+    return args
+
+def run(args, kv, key, mode):
+    shape = (args.input_dim, args.output_dim)
+    if mode == 'dense':
+        kv.init(key, mx.nd.zeros(shape))
+    else:
+        kv.init_row_sparse(key, mx.nd.zeros(shape))
+    data = mx.sym.Variable('data')
+    weight = mx.sym.Variable('weight')
+    embed = mx.sym.Embedding(data=data, weight=weight, input_dim=args.input_dim,
+                             output_dim=args.output_dim, sparse_grad=True)
+    ids_shape = (args.batch_size, args.seq_len)
+    exe = embed.simple_bind(mx.cpu(), data=ids_shape, grad_req={'data':'null', 'weight':'write'})
+    num_ids = args.batch_size * args.seq_len
+    rows = mx.nd.zeros((num_ids, args.output_dim))
+    # gathers the rows of the gradient at the unique ids, padded to num_ids
+    uniq_ids = mx.nd.zeros((num_ids,))
+    gather = mx.sym.Embedding(data=data, weight=weight, input_dim=args.input_dim,
+                              output_dim=args.output_dim)
+    gather_exe = gather.bind(mx.cpu(), {'data': uniq_ids, 'weight': exe.grad_dict['weight']},
+                             grad_req='null')
+    for i in range(args.num_batches + 1):
+        if i == 1:
+            # the first batch allocates the buffers
+            mx.nd.waitall()
+            tic = time.time()
+        ids = np.random.randint(0, args.input_dim, size=ids_shape)
+        exe.arg_dict['data'][:] = ids
+        if mode == 'dense':
+            kv.pull(key, out=exe.arg_dict['weight'])
+        else:
+            kv.pull_row_sparse(key, out=rows, row_ids=exe.arg_dict['data'].reshape((num_ids,)))
+        exe.forward(is_train=True)
+        exe.backward(exe.outputs[0])
+        if mode == 'dense':
+            kv.push(key, exe.grad_dict['weight'])
+        else:
+            uniq = np.unique(ids)
+            uniq_ids[:len(uniq)] = uniq
+            gather_exe.forward(is_train=False)
+            kv.push_row_sparse(key, gather_exe.outputs[0][:len(uniq)], uniq_ids[:len(uniq)])
+    mx.nd.waitall()
+    return (time.time() - tic) / args.num_batches
+
+if __name__ == '__main__':
+    args = parse_args()
+    kv = mx.kv.create(args.kv_store)
+    for key, mode in enumerate(args.mode.split(',')):
+        t = run(args, kv, key, mode)
+        num_ids = args.batch_size * args.seq_len
+        logging.info('%s: %f sec per batch, %f ids/sec', mode, t, num_ids / t)
@@ -0,0 +1,73 @@
+"""Benchmark the CPU reduction of kvstore 'local'
+
+Compares the pipelined chunk reduce (MXNET_KVSTORE_REDUCE_PIPELINE=1) with
+copying every source into a full buffer and then summing
+(MXNET_KVSTORE_REDUCE_PIPELINE=0), for 2 to 8 source arrays.
+
+Only sources on gpus go through the staging pool, so use --gpus to measure it.
+Without gpus, the sources are on cpu and only the single summation pass is
+compared with the copies and sum of the other path.
+"""
+import os, sys
+curr_path = os.path.abspath(os.path.dirname(__file__))
+sys.path.insert(0, os.path.join(curr_path, "../../python"))
+import mxnet as mx
+import logging
+import argparse
+import time
+import numpy as np
+
+logger = logging.getLogger()
+logger.setLevel(logging.INFO)
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="benchmark the cpu reduction of kv-store")
+    parser.add_argument('--gpus', type=str, default='',
+                        help='the gpus holding the sources, e.g "0,1,2,3". '
+                        'if empty, the sources are placed on cpu(0), cpu(1), ...')
+    parser.add_argument('--size', type=int, default=16*1024*1024,
+                        help='the number of elements of the array')
+    parser.add_argument('--num-sources', type=str, default='2,4,8',
+                        help='the numbers of source arrays to test')
+    parser.add_argument('--num-batches', type=int, default=10,
+                        help='number of batches to run')
+    args = parser.parse_args()
+    logging.info(args)
+    return args
+
+def run(args, num_sources, pipeline):
+    os.environ['MXNET_KVSTORE_REDUCE_PIPELINE'] = str(pipeline)
+    kv = mx.kv.create('local')
+    if args.gpus:
+        gpus = [int(i) for i in args.gpus.split(',')]
+        ctx = [mx.gpu(gpus[i % len(gpus)]) for i in range(num_sources)]
+    else:
+        ctx = [mx.cpu(i) for i in range(num_sources)]
+    shape = (args.size,)
+    kv.init(0, mx.nd.zeros(shape))
+    src = [mx.nd.ones(shape, c) * (i + 1) for i, c in enumerate(ctx)]
+    out = mx.nd.zeros(shape)
+    # warm up, allocate the buffers
+    kv.push(0, src)
+    kv.pull(0, out=out)
+    out.wait_to_read()
+    expected = num_sources * (num_sources + 1) / 2
+    assert np.sum(np.abs(out.asnumpy() - expected)) == 0
+    tic = time.time()
+    for _ in range(args.num_batches):
+        kv.push(0, src)
+    kv.pull(0, out=out)
+    out.wait_to_read()
+    return (time.time() - tic) / args.num_batches
+
+if __name__ == '__main__':
+    args = parse_args()
+    if not args.gpus:
+        logging.warning('no --gpus, the staging of device chunks is not measured')
+    for n in [int(i) for i in args.num_sources.split(',')]:
+        base = run(args, n, 0)
+        pipe = run(args, n, 1)
+        size_gb = args.size * 4 * n / 1e9
+        logging.info('%d sources, full copy then sum %f sec (%f GB/sec), '
+                     'pipelined chunks %f sec (%f GB/sec), speedup %.2fx',
+                     n, base, size_gb / base, pipe, size_gb / pipe, base / pipe)
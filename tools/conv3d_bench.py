@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+"""Measure the throughput of 3d convolution and pooling on cpu
+
+The layers are those of C3D on 16 x 112 x 112 clips, e.g.
+
+    OMP_NUM_THREADS=16 python conv3d_bench.py --batch-size 8
+
+Layers are given by --layers as "channels,depth,height,width,filters" for a
+3x3x3 convolution with pad 1, or "pool,channels,depth,height,width" for a
+2x2x2 max pooling with stride 2.
+"""
+import os, sys
+curr_path = os.path.abspath(os.path.dirname(__file__))
+sys.path.insert(0, os.path.join(curr_path, "../python"))
+import mxnet as mx
+import numpy as np
+import logging
+import argparse
+import time
+
+logging.basicConfig(level=logging.INFO)
+
+C3D_LAYERS = ';'.join([
+    '3,16,112,112,64', 'pool,64,16,112,112',
+    '64,8,56,56,128', 'pool,128,8,56,56',
+    '128,4,28,28,256', '256,4,28,28,256', 'pool,256,4,28,28',
+    '256,2,14,14,512', '512,2,14,14,512'])
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="benchmark 3d convolution and pooling on cpu")
+    parser.add_argument('--batch-size', type=int, default=8,
+                        help='the batch size')
+    parser.add_argument('--layers', type=str, default=C3D_LAYERS,
+                        help='the layers to test, separated by ";"')
+    parser.add_argument('--repeat', type=int, default=5,
+                        help='the number of batches to time')
+    args = parser.parse_args()
+    logging.info(args)
+    return args
+
+def layer(spec, batch_size):
+    """return the symbol and the data shape of a layer"""
+    fields = spec.split(',')
+    data = mx.symbol.Variable('data')
+    if fields[0] == 'pool':
+        c, d, h, w = [int(i) for i in fields[1:]]
+        sym = mx.symbol.Pooling(data, kernel=(2, 2, 2), stride=(2, 2, 2), pool_type='max')
+    else:
+        c, d, h, w, f = [int(i) for i in fields]
+        sym = mx.symbol.Convolution(data, kernel=(3, 3, 3), pad=(1, 1, 1), num_filter=f)
+    return sym, (batch_size, c, d, h, w)
+
+def run(exe, is_train, repeat):
+    """return the seconds of a batch"""
+    def step():
+        exe.forward(is_train=is_train)
+        if is_train:
+            exe.backward(exe.outputs)
+        exe.outputs[0].wait_to_read()
+        for grad in exe.grad_arrays:
+            if grad is not None:
+                grad.wait_to_read()
+    # the first batch allocates the workspace
+    step()
+    tic = time.time()
+    for _ in range(repeat):
+        step()
+    return (time.time() - tic) / repeat
+
+if __name__ == '__main__':
+    args = parse_args()
+    for spec in args.layers.split(';'):
+        sym, shape = layer(spec, args.batch_size)
+        exe = sym.simple_bind(mx.cpu(), data=shape)
+        for arr in exe.arg_arrays:
+            arr[:] = np.random.uniform(-1, 1, arr.shape)
+        fwd = run(exe, False, args.repeat)
+        fwd_bwd = run(exe, True, args.repeat)
+        logging.info('%s, data %s: forward %.1f samples/sec, forward + backward %.1f samples/sec',
+                     spec, shape, args.batch_size / fwd, args.batch_size / fwd_bwd)
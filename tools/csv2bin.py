@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+"""Convert csv files into the dense binary format of DenseBinaryIter
+
+The output is a 32 byte header, followed by the data, rows x cols float32 in
+row major, and then the labels, rows x label_width float32 in row major:
+
+    uint32 magic, uint32 version, uint64 rows, uint64 cols, uint64 label_width
+
+The csv files are converted in a single pass with constant memory, e.g.
+
+    python csv2bin.py data.csv data.bin --label-csv label.csv
+"""
+import argparse
+import logging
+import os
+import shutil
+import struct
+import tempfile
+import numpy as np
+
+logging.basicConfig(level=logging.INFO)
+
+MAGIC = 0x4d444258
+VERSION = 1
+# native byte order, as the iterator reads it
+HEADER = '=IIQQQ'
+
+def parse_args():
+    parser = argparse.ArgumentParser(description='convert csv into dense binary files')
+    parser.add_argument('data_csv', type=str, help='the csv file of the data')
+    parser.add_argument('output', type=str, help='the output binary file')
+    parser.add_argument('--label-csv', type=str, default=None,
+                        help='the csv file of the labels, with a row for every data row')
+    parser.add_argument('--chunk-rows', type=int, default=100000,
+                        help='the number of rows converted at once')
+    return parser.parse_args()
+
+def read_chunks(fname, chunk_rows):
+    """yield the rows of a csv file as float32 matrices"""
+    with open(fname) as fin:
+        rows = []
+        for line in fin:
+            line = line.strip()
+            if not line:
+                continue
+            rows.append(np.array(line.split(','), dtype=np.float32))
+            if len(rows) == chunk_rows:
+                yield np.vstack(rows)
+                rows = []
+        if rows:
+            yield np.vstack(rows)
+
+def write_matrix(fname, fout, chunk_rows):
+    """append the csv file to fout, return the number of rows and columns"""
+    num_rows, num_cols = 0, None
+    for chunk in read_chunks(fname, chunk_rows):
+        if num_cols is None:
+            num_cols = chunk.shape[1]
+        assert chunk.shape[1] == num_cols, \
+            '%s has rows of %d and %d columns' % (fname, num_cols, chunk.shape[1])
+        fout.write(chunk.tobytes())
+        num_rows += chunk.shape[0]
+        logging.info('%s: %d rows converted', fname, num_rows)
+    return num_rows, num_cols or 0
+
+def main():
+    args = parse_args()
+    with open(args.output, 'wb') as fout:
+        fout.write(struct.pack(HEADER, MAGIC, VERSION, 0, 0, 0))
+        num_rows, num_cols = write_matrix(args.data_csv, fout, args.chunk_rows)
+        label_width = 0
+        if args.label_csv is not None:
+            # the labels follow all data, so they are converted into a temporary file first
+            with tempfile.TemporaryFile() as ftmp:
+                num_labels, label_width = write_matrix(args.label_csv, ftmp, args.chunk_rows)
+                assert num_labels == num_rows, \
+                    '%d data rows but %d label rows' % (num_rows, num_labels)
+                ftmp.seek(0)
+                shutil.copyfileobj(ftmp, fout)
+        fout.seek(0)
+        fout.write(struct.pack(HEADER, MAGIC, VERSION, num_rows, num_cols, label_width))
+    logging.info('wrote %d rows, %d columns and %d labels to %s (%d bytes)',
+                 num_rows, num_cols, label_width, args.output,
+                 os.path.getsize(args.output))
+
+if __name__ == '__main__':
+    main()
@@ -14,11 +14,16 @@
 #include <vector>
 #include <iomanip>
 #include <sstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <dmlc/base.h>
 #include <dmlc/io.h>
 #include <dmlc/timer.h>
 #include <dmlc/logging.h>
 #include <dmlc/recordio.h>
+#include <dmlc/memory_io.h>
 #include <opencv2/opencv.hpp>
 #include "../src/io/image_recordio.h"
 #include <random>
@@ -56,7 +61,9 @@ int main(int argc, char *argv[]) {
            "\tquality=QUALITY[default=80] JPEG quality for encoding (1-100, default: 80) or PNG compression for encoding (1-9, default: 3).\n"\
            "\tencoding=ENCODING[default='.jpg'] Encoding type. Can be '.jpg' or '.png'\n"\
            "\tinter_method=INTER_METHOD[default=1] NN(0) BILINEAR(1) CUBIC(2) AREA(3) LANCZOS4(4) AUTO(9) RAND(10).\n"\
-           "\tunchanged=UNCHANGED[default=0] Keep the original image encoding, size and color. If set to 1, it will ignore the others parameters.\n");
+           "\tunchanged=UNCHANGED[default=0] Keep the original image encoding, size and color. If set to 1, it will ignore the others parameters.\n"\
+           "\tindex=INDEX[default=1] Also write an index of the records to output.idx, which allows random access, e.g. by path_imgidx of ImageRecordIter.\n"\
+           "\tnum_thread=NUM_THREAD[default=1] Number of threads to read, decode, resize and encode the images. The records stay in the order of the list.\n");
     return 0;
   }
   int label_width = 1;
@@ -68,6 +75,8 @@ int main(int argc, char *argv[]) {
   int quality = 80;
   int color_mode = CV_LOAD_IMAGE_COLOR;
   int unchanged = 0;
+  int write_index = 1;
+  int num_thread = 1;
   int inter_method = CV_INTER_LINEAR;
   std::string encoding(".jpg");
   for (int i = 4; i < argc; ++i) {
@@ -91,6 +100,8 @@ int main(int argc, char *argv[]) {
       if (!strcmp(key, "color")) color_mode = atoi(val);
       if (!strcmp(key, "encoding")) encoding = std::string(val);
       if (!strcmp(key, "unchanged")) unchanged = atoi(val);
+      if (!strcmp(key, "index")) write_index = atoi(val);
+      if (!strcmp(key, "num_thread")) num_thread = atoi(val);
       if (!strcmp(key, "inter_method")) inter_method = atoi(val);
     }
   }
@@ -119,6 +130,10 @@ int main(int argc, char *argv[]) {
     LOG(INFO) << "Keep original color mode";
   }
   LOG(INFO) << "Encoding is " << encoding;
+  if (num_thread < 1) {
+    LOG(FATAL) << "num_thread must be at least 1.";
+  }
+  LOG(INFO) << "Use " << num_thread << " threads";
 
   if (encoding == std::string(".png") && quality > 9) {
       quality = 3;
@@ -149,11 +164,11 @@ int main(int argc, char *argv[]) {
       }
   }
   std::random_device rd;
-  std::mt19937 prnd(rd());
   using namespace dmlc;
   const static size_t kBufferSize = 1 << 20UL;
+  // records are written to the file in blocks of this size
+  const static size_t kWriteBufferSize = 16 << 20UL;
   std::string root = argv[2];
-  mxnet::io::ImageRecordIO rec;
   size_t imcnt = 0;
   double tstart = dmlc::GetTime();
   dmlc::InputSplit *flist = dmlc::InputSplit::
@@ -167,10 +182,25 @@ int main(int argc, char *argv[]) {
   LOG(INFO) << "Write to output: " << os.str();
   dmlc::Stream *fo = dmlc::Stream::Create(os.str().c_str(), "w");
   LOG(INFO) << "Output: " << os.str();
-  dmlc::RecordIOWriter writer(fo);
-  std::string fname, path, blob;
-  std::vector<unsigned char> decode_buf;
-  std::vector<unsigned char> encode_buf;
+  // the records are written into a memory buffer, which is flushed to fo in
+  // large blocks
+  std::string write_buf;
+  dmlc::MemoryStringStream write_strm(&write_buf);
+  dmlc::RecordIOWriter writer(&write_strm);
+  size_t flushed = 0;
+  // the index has a line "image_index\tposition" for every record
+  dmlc::Stream *fidx = NULL;
+  if (write_index) {
+    std::string idx_path = os.str();
+    const std::string ext(".rec");
+    if (idx_path.length() > ext.length() &&
+        idx_path.compare(idx_path.length() - ext.length(), ext.length(), ext) == 0) {
+      idx_path.resize(idx_path.length() - ext.length());
+    }
+    idx_path += ".idx";
+    LOG(INFO) << "Write index to: " << idx_path;
+    fidx = dmlc::Stream::Create(idx_path.c_str(), "w");
+  }
   std::vector<int> encode_params;
   if (encoding == std::string(".png")) {
       encode_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
@@ -181,13 +211,16 @@ int main(int argc, char *argv[]) {
       encode_params.push_back(quality);
       LOG(INFO) << "JPEG encoding quality: " << quality;
   }
-  dmlc::InputSplit::Blob line;
-  std::vector<float> label_buf(label_width, 0.f);
 
-  while (flist->NextRecord(&line)) {
-    std::string sline(static_cast<char*>(line.dptr), line.size);
+  // pack the image of a line of the list into blob, false if the line is invalid
+  auto pack = [&](const std::string& sline, std::mt19937& prnd,
+                  std::string *pblob, uint64_t *image_id) -> bool {
+    std::string& blob = *pblob;
+    mxnet::io::ImageRecordIO rec;
+    std::vector<float> label_buf(label_width, 0.f);
     std::istringstream is(sline);
-    if (!(is >> rec.header.image_id[0] >> rec.header.label)) continue;
+    if (!(is >> rec.header.image_id[0] >> rec.header.label)) return false;
+    *image_id = rec.header.image_id[0];
     label_buf[0] = rec.header.label;
     for (int k = 1; k < label_width; ++k) {
       CHECK(is >> label_buf[k])
@@ -201,6 +234,7 @@ int main(int argc, char *argv[]) {
       memcpy(BeginPtr(blob) + bsize,
              BeginPtr(label_buf), label_buf.size()*sizeof(float));
     }
+    std::string fname, path;
     CHECK(std::getline(is, fname));
     // eliminate invalid chars in the end
     while (fname.length() != 0 &&
@@ -213,7 +247,7 @@ int main(int argc, char *argv[]) {
     path = root + p;
     // use "r" is equal to rb in dmlc::Stream
     dmlc::Stream *fi = dmlc::Stream::Create(path.c_str(), "r");
-    decode_buf.clear();
+    std::vector<unsigned char> decode_buf;
     size_t imsize = 0;
     while (true) {
       decode_buf.resize(imsize + kBufferSize);
@@ -256,7 +290,7 @@ int main(int argc, char *argv[]) {
             }
         }
       }
-      encode_buf.clear();
+      std::vector<unsigned char> encode_buf;
       CHECK(cv::imencode(encoding, res, encode_buf, encode_params));
 
       // write buffer
@@ -270,15 +304,94 @@ int main(int argc, char *argv[]) {
       memcpy(BeginPtr(blob) + bsize,
              BeginPtr(decode_buf), decode_buf.size());
     }
-    writer.WriteRecord(BeginPtr(blob), blob.size());
+    return true;
+  };
+
+  // a packed line of the list, by its position in the list
+  struct Packed {
+    bool valid;
+    uint64_t image_id;
+    std::string blob;
+  };
+  // the workers read the lines in order, and pack them in parallel into the
+  // reorder buffer, which the main thread writes in the order of the list.
+  // A worker waits if its line is too far ahead of the writer, which bounds
+  // the memory of the buffer.
+  const size_t window = static_cast<size_t>(num_thread) * 16;
+  std::mutex mu;
+  std::condition_variable cv_ready, cv_space;
+  std::map<size_t, Packed> reorder;
+  size_t next_read = 0, next_write = 0;
+  bool list_end = false;
+  auto work = [&](unsigned seed) {
+    std::mt19937 prnd(seed);
+    dmlc::InputSplit::Blob line;
+    while (true) {
+      std::string sline;
+      size_t seq;
+      {
+        std::unique_lock<std::mutex> lk(mu);
+        cv_space.wait(lk, [&]() { return list_end || next_read < next_write + window; });
+        if (list_end || !flist->NextRecord(&line)) {
+          list_end = true;
+          cv_ready.notify_all();
+          return;
+        }
+        sline.assign(static_cast<char*>(line.dptr), line.size);
+        seq = next_read++;
+      }
+      Packed packed;
+      packed.valid = pack(sline, prnd, &packed.blob, &packed.image_id);
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        reorder[seq] = std::move(packed);
+      }
+      cv_ready.notify_all();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_thread; ++i) {
+    workers.emplace_back(work, rd());
+  }
+  auto flush = [&]() {
+    fo->Write(BeginPtr(write_buf), write_buf.size());
+    flushed += write_buf.size();
+    write_buf.clear();
+    write_strm.Seek(0);
+  };
+  while (true) {
+    Packed packed;
+    {
+      std::unique_lock<std::mutex> lk(mu);
+      cv_ready.wait(lk, [&]() {
+          return reorder.count(next_write) != 0 || (list_end && next_write == next_read);
+        });
+      if (reorder.count(next_write) == 0) break;
+      packed = std::move(reorder[next_write]);
+      reorder.erase(next_write);
+      ++next_write;
+    }
+    cv_space.notify_all();
+    if (!packed.valid) continue;
+    if (fidx != NULL) {
+      std::ostringstream idx_line;
+      idx_line << packed.image_id << '\t' << flushed + writer.Tell() << '\n';
+      std::string entry = idx_line.str();
+      fidx->Write(entry.c_str(), entry.size());
+    }
+    writer.WriteRecord(BeginPtr(packed.blob), packed.blob.size());
+    if (write_buf.size() >= kWriteBufferSize) flush();
     // write header
     ++imcnt;
     if (imcnt % 1000 == 0) {
       LOG(INFO) << imcnt << " images processed, " << GetTime() - tstart << " sec elapsed";
     }
   }
+  for (auto& t : workers) t.join();
+  flush();
   LOG(INFO) << "Total: " << imcnt << " images processed, " << GetTime() - tstart << " sec elapsed";
   delete fo;
+  delete fidx;
   delete flist;
   return 0;
 }
@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+"""Measure the throughput of the image record iterators
+
+Compares ImageRecordIter, which normalizes and batches the images in the
+decoding threads, with ImageRecordIter_v1, which does it in a single thread,
+e.g.
+
+    python iter_bench.py --rec data/train.rec --data-shape 3,224,224 --threads 32
+
+Extra iterator arguments are passed by --kwargs, e.g. --kwargs rand_crop=1,mean_r=123
+
+With --reduced-decode 1,0 it also compares decoding the JPEG images at a
+reduced resolution, which the iterators do when resize is smaller than the
+shorter edge of the images, with always decoding them at full resolution.
+
+With --epochs, every epoch is measured separately, e.g. to see the effect of
+the decoded image cache:
+
+    python iter_bench.py --rec data/train.rec --num-batches 0 --epochs 3 \
+        --kwargs resize=256,rand_crop=1,cache_size=40000
+"""
+import os, sys
+curr_path = os.path.abspath(os.path.dirname(__file__))
+sys.path.insert(0, os.path.join(curr_path, "../python"))
+import mxnet as mx
+import logging
+import argparse
+import time
+
+logging.basicConfig(level=logging.INFO)
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="benchmark the image record iterators")
+    parser.add_argument('--rec', type=str, required=True,
+                        help='the record file')
+    parser.add_argument('--data-shape', type=str, default='3,224,224',
+                        help='the shape of an image')
+    parser.add_argument('--batch-size', type=int, default=128,
+                        help='the batch size')
+    parser.add_argument('--threads', type=str, default='4,8,16,32',
+                        help='the numbers of preprocess threads to test')
+    parser.add_argument('--num-batches', type=int, default=100,
+                        help='the number of batches to read, 0 for one epoch')
+    parser.add_argument('--iters', type=str, default='ImageRecordIter,ImageRecordIter_v1',
+                        help='the iterators to test')
+    parser.add_argument('--kwargs', type=str, default='resize=256,rand_crop=1,rand_mirror=1',
+                        help='extra iterator arguments, e.g. "rand_crop=1,mean_r=123"')
+    parser.add_argument('--epochs', type=int, default=1,
+                        help='the number of epochs to measure')
+    parser.add_argument('--reduced-decode', type=str, default='0',
+                        help='the reduced_decode values to test, e.g. "1,0"')
+    args = parser.parse_args()
+    logging.info(args)
+    return args
+
+def run(args, name, threads, reduced_decode):
+    kwargs = dict(kv.split('=') for kv in args.kwargs.split(',') if kv)
+    kwargs['reduced_decode'] = reduced_decode
+    data_iter = getattr(mx.io, name)(
+        path_imgrec=args.rec,
+        data_shape=tuple(int(i) for i in args.data_shape.split(',')),
+        batch_size=args.batch_size,
+        preprocess_threads=threads,
+        verbose=False,
+        **kwargs)
+    speeds = []
+    for epoch in range(args.epochs):
+        data_iter.reset()
+        # the first batch includes the time to start the threads
+        data_iter.next()
+        tic = time.time()
+        num = 0
+        for batch in data_iter:
+            batch.data[0].wait_to_read()
+            num += 1
+            if num == args.num_batches:
+                break
+        speeds.append(num * args.batch_size / (time.time() - tic))
+    return speeds
+
+if __name__ == '__main__':
+    args = parse_args()
+    for threads in [int(i) for i in args.threads.split(',')]:
+        for name in args.iters.split(','):
+            for reduced in [int(i) for i in args.reduced_decode.split(',')]:
+                speeds = run(args, name, threads, reduced)
+                for epoch, speed in enumerate(speeds):
+                    logging.info('%s, %d threads, reduced_decode=%d, epoch %d: %.1f images/sec',
+                                 name, threads, reduced, epoch, speed)
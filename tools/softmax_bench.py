@@ -0,0 +1,69 @@
+#!/usr/bin/env python
+"""Measure the throughput of softmax with a cross entropy loss on cpu
+
+For the output layer of a language model, over vocabularies of 10k to 800k
+words, e.g.
+
+    OMP_NUM_THREADS=16 python softmax_bench.py --batch-size 64
+
+Both SoftmaxOutput and softmax_cross_entropy are timed, the former computing
+the probabilities in the forward, the latter only the loss.
+"""
+import os, sys
+curr_path = os.path.abspath(os.path.dirname(__file__))
+sys.path.insert(0, os.path.join(curr_path, "../python"))
+import mxnet as mx
+import numpy as np
+import logging
+import argparse
+import time
+
+logging.basicConfig(level=logging.INFO)
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="benchmark softmax on cpu")
+    parser.add_argument('--batch-size', type=int, default=64,
+                        help='the number of rows, e.g. batch size times sequence length')
+    parser.add_argument('--vocab', type=str, default='10000,50000,200000,800000',
+                        help='the vocabulary sizes to test, separated by ","')
+    parser.add_argument('--repeat', type=int, default=5,
+                        help='the number of batches to time')
+    args = parser.parse_args()
+    logging.info(args)
+    return args
+
+def run(exe, is_train, repeat):
+    """return the seconds of a batch"""
+    # the loss of softmax_cross_entropy needs a head gradient
+    head = [mx.nd.ones((1,))] if exe.outputs[0].shape == (1,) else None
+    def step():
+        exe.forward(is_train=is_train)
+        if is_train:
+            exe.backward(head)
+        exe.outputs[0].wait_to_read()
+        for grad in exe.grad_arrays:
+            if grad is not None:
+                grad.wait_to_read()
+    step()
+    tic = time.time()
+    for _ in range(repeat):
+        step()
+    return (time.time() - tic) / repeat
+
+if __name__ == '__main__':
+    args = parse_args()
+    data = mx.symbol.Variable('data')
+    label = mx.symbol.Variable('label')
+    syms = [('SoftmaxOutput', mx.symbol.SoftmaxOutput(data, label)),
+            ('softmax_cross_entropy', mx.symbol.softmax_cross_entropy(data, label))]
+    for vocab in [int(v) for v in args.vocab.split(',')]:
+        shape = (args.batch_size, vocab)
+        for name, sym in syms:
+            exe = sym.simple_bind(mx.cpu(), data=shape, label=(args.batch_size,),
+                                  grad_req={'data': 'write', 'label': 'null'})
+            exe.arg_dict['data'][:] = np.random.normal(0, 5, shape)
+            exe.arg_dict['label'][:] = np.random.randint(0, vocab, (args.batch_size,))
+            fwd = run(exe, False, args.repeat)
+            fwd_bwd = run(exe, True, args.repeat)
+            logging.info('%s, vocab %d: forward %.2f ms, forward + backward %.2f ms',
+                         name, vocab, fwd * 1000, fwd_bwd * 1000)